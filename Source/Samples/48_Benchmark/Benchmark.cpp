@@ -0,0 +1,1562 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Container/Allocator.h>
+#include <Urho3D/Container/FlatHashMap.h>
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/FrameAllocator.h>
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/OcclusionBuffer.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/PackageFile.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#ifdef URHO3D_PHYSICS
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#endif
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#define BENCHMARK_THREAD_LOCAL __declspec(thread)
+#else
+#define BENCHMARK_THREAD_LOCAL __thread
+#endif
+
+/// Maximum number of threads whose heap allocations are counted separately. Any further threads share the last counter.
+static const unsigned MAX_COUNTED_THREADS = 64;
+
+/// Whether heap allocations are being counted.
+static bool countAllocations = false;
+/// Heap allocations counted per thread. Each thread increments only its own counter, so that worker threads can not lose
+/// each other's increments.
+static unsigned threadAllocations[MAX_COUNTED_THREADS];
+/// Number of threads which have been assigned a counter.
+static unsigned numCountedThreads = 0;
+/// Mutex for assigning the counters.
+static Mutex countedThreadsMutex;
+/// Index of the current thread's counter plus one, or zero if the thread has not allocated while counting yet.
+static BENCHMARK_THREAD_LOCAL unsigned threadCounter = 0;
+
+/// Zero the heap allocation counters of all threads. Call before enabling counting.
+static void ResetAllocations()
+{
+    MutexLock lock(countedThreadsMutex);
+    for (unsigned i = 0; i < MAX_COUNTED_THREADS; ++i)
+        threadAllocations[i] = 0;
+}
+
+/// Return the total heap allocations counted in all threads. Call after disabling counting, when the worker threads are idle.
+static unsigned GetNumAllocations()
+{
+    MutexLock lock(countedThreadsMutex);
+    unsigned total = 0;
+    for (unsigned i = 0; i < MAX_COUNTED_THREADS; ++i)
+        total += threadAllocations[i];
+    return total;
+}
+
+// Replace the global allocation functions to count the heap allocations made by the benchmarks. Note that when
+// linking to a shared Urho3D library on Windows, allocations made inside the library do not pass through these, as the
+// library then has its own copies of the allocation functions, and are therefore not counted
+void* operator new(size_t size)
+{
+    if (countAllocations)
+    {
+        if (!threadCounter)
+        {
+            MutexLock lock(countedThreadsMutex);
+            threadCounter = Min(++numCountedThreads, MAX_COUNTED_THREADS);
+        }
+        ++threadAllocations[threadCounter - 1];
+    }
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+    free(ptr);
+}
+
+#include <Urho3D/DebugNew.h>
+
+URHO3D_DEFINE_APPLICATION_MAIN(Benchmark)
+
+/// Names of the benchmarks which can be selected on the command line.
+static const char* benchmarkNames[] =
+{
+    "Containers",
+    "WorkQueue",
+    "Variants",
+    "Quantization",
+    "Attributes",
+    "Packages",
+    "HugeObjectCount",
+    "SpatialIndex",
+    "FrustumCulling",
+    "FrameAllocations",
+    "Occlusion",
+    "PoseBuffer",
+    0
+};
+
+/// Number of keys in the container benchmark.
+static const unsigned NUM_CONTAINER_KEYS = 100000;
+/// Number of times the container lookups and iteration are repeated.
+static const unsigned NUM_CONTAINER_REPEATS = 10;
+
+/// Number of work items in the work queue benchmark.
+static const unsigned NUM_WORK_ITEMS = 100000;
+/// Number of data-parallel phases, each followed by a serial merge, in the work queue benchmark.
+static const unsigned NUM_WORK_PHASES = 3;
+/// Number of work items per phase in the work queue benchmark.
+static const unsigned NUM_WORK_PHASE_ITEMS = 64;
+/// Number of times the work queue benchmark's phases are run.
+static const unsigned NUM_WORK_PHASE_REPEATS = 100;
+
+/// Number of events sent and attributes set in the variant benchmark.
+static const unsigned NUM_VARIANT_OPERATIONS = 1000000;
+
+/// Number of nodes in the quantization benchmark.
+static const unsigned NUM_QUANTIZED_NODES = 10000;
+/// Range of the node positions in the quantization benchmark.
+static const float QUANTIZED_POSITION_RANGE = 1000.0f;
+
+/// Number of nodes, each with a static model, in the attribute benchmark.
+static const unsigned NUM_ATTRIBUTE_NODES = 20000;
+/// Number of times the attribute benchmark saves and loads all objects.
+static const unsigned NUM_ATTRIBUTE_REPEATS = 5;
+
+/// Number of times the package benchmark reads all files.
+static const unsigned NUM_PACKAGE_REPEATS = 5;
+/// Number of reads from random positions of compressed package files.
+static const unsigned NUM_PACKAGE_RANDOM_READS = 1000;
+/// Size of each random read in bytes.
+static const unsigned PACKAGE_RANDOM_READ_SIZE = 256;
+
+/// Event sent by the variant benchmark.
+URHO3D_EVENT(E_BENCHMARKEVENT, BenchmarkEvent)
+{
+    URHO3D_PARAM(P_INDEX, Index);                  // int
+    URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
+    URHO3D_PARAM(P_POSITION, Position);            // Vector3
+    URHO3D_PARAM(P_TRANSFORM, Transform);          // Matrix3x4
+}
+
+/// Boxes per side of the huge object count benchmark's box grid. The HugeObjectCount sample has 250.
+static const int NUM_HUGE_BOXES_PER_SIDE = 500;
+/// Number of frames in the huge object count benchmark.
+static const unsigned NUM_HUGE_FRAMES = 20;
+
+/// Boxes per side of the spatial index benchmark's box grid.
+static const int NUM_INDEX_BOXES_PER_SIDE = 250;
+/// Number of update frames, frustum queries and raycasts in the spatial index benchmark.
+static const unsigned NUM_INDEX_OPERATIONS = 100;
+/// Fraction of the boxes moved on each update frame of the spatial index benchmark.
+static const unsigned INDEX_MOVING_BOX_INTERVAL = 10;
+
+/// Boxes per side of the frustum culling benchmark's box grid.
+static const int NUM_CULLING_BOXES_PER_SIDE = 250;
+/// Number of frustum queries, each from a different direction.
+static const unsigned NUM_CULLING_QUERIES = 200;
+
+/// Number of animated models in the frame allocation benchmark.
+static const unsigned NUM_ANIMATED_MODELS = 100;
+/// Number of boxes in the frame allocation benchmark.
+static const unsigned NUM_BOXES = 1000;
+/// Number of frames run before counting the allocations. Containers, pools and frame arenas grow to their working size meanwhile.
+static const unsigned NUM_WARMUP_FRAMES = 300;
+/// Number of frames during which the allocations are counted.
+static const unsigned NUM_COUNTED_FRAMES = 120;
+/// Time step of the frame allocation benchmark's frames. Fixed, so that the scene advances the same way on every run.
+static const float FRAME_TIME_STEP = 1.0f / 60.0f;
+
+/// Occlusion buffer width in the occlusion benchmark. The renderer's default.
+static const int OCCLUSION_BUFFER_WIDTH = 256;
+/// Occlusion buffer height in the occlusion benchmark, for a 16:9 view.
+static const int OCCLUSION_BUFFER_HEIGHT = 144;
+/// Number of box occluders in the occlusion benchmark.
+static const unsigned NUM_OCCLUDERS = 300;
+/// Number of box occludees in the occlusion benchmark.
+static const unsigned NUM_OCCLUDEES = 4000;
+/// Number of views in the occlusion benchmark, each turned to a different direction.
+static const unsigned NUM_OCCLUSION_VIEWS = 100;
+
+/// Number of animated models in the pose buffer benchmark.
+static const unsigned NUM_POSE_MODELS = 300;
+/// Number of frames timed at a time in the pose buffer benchmark.
+static const unsigned NUM_POSE_FRAMES = 60;
+/// Number of times the pose buffer benchmark times each mode.
+static const unsigned NUM_POSE_REPEATS = 5;
+
+/// Corners of a unit cube for the occlusion benchmark.
+static const Vector3 cubeVertices[] =
+{
+    Vector3(-0.5f, -0.5f, -0.5f),
+    Vector3(0.5f, -0.5f, -0.5f),
+    Vector3(-0.5f, 0.5f, -0.5f),
+    Vector3(0.5f, 0.5f, -0.5f),
+    Vector3(-0.5f, -0.5f, 0.5f),
+    Vector3(0.5f, -0.5f, 0.5f),
+    Vector3(-0.5f, 0.5f, 0.5f),
+    Vector3(0.5f, 0.5f, 0.5f)
+};
+
+/// Triangles of a unit cube for the occlusion benchmark. Drawn without culling, so the winding does not matter.
+static const unsigned short cubeIndices[] =
+{
+    0, 2, 6, 0, 6, 4,
+    1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,
+    2, 3, 7, 2, 7, 6,
+    0, 1, 3, 0, 3, 2,
+    4, 5, 7, 4, 7, 6
+};
+
+/// Time the basic operations of a hash map with StringHash keys. The times are returned in microseconds in the order of
+/// insert, successful find, failed find, iteration and erase.
+template <class T> static void TimeHashMap(const PODVector<StringHash>& keys, const PODVector<StringHash>& missingKeys,
+    long long* times)
+{
+    HiresTimer timer;
+    unsigned sum = 0;
+    T map;
+
+    for (unsigned i = 0; i < keys.Size(); ++i)
+        map[keys[i]] = i;
+    times[0] = timer.GetUSec(true);
+
+    for (unsigned r = 0; r < NUM_CONTAINER_REPEATS; ++r)
+    {
+        for (unsigned i = 0; i < keys.Size(); ++i)
+            sum += map.Find(keys[i])->second_;
+    }
+    times[1] = timer.GetUSec(true);
+
+    for (unsigned r = 0; r < NUM_CONTAINER_REPEATS; ++r)
+    {
+        for (unsigned i = 0; i < missingKeys.Size(); ++i)
+            sum += map.Find(missingKeys[i]) != map.End() ? 1 : 0;
+    }
+    times[2] = timer.GetUSec(true);
+
+    for (unsigned r = 0; r < NUM_CONTAINER_REPEATS; ++r)
+    {
+        for (typename T::ConstIterator i = map.Begin(); i != map.End(); ++i)
+            sum += i->second_;
+    }
+    times[3] = timer.GetUSec(true);
+
+    for (unsigned i = 0; i < keys.Size(); ++i)
+        map.Erase(keys[i]);
+    times[4] = timer.GetUSec(true);
+
+    // Use the sum so that the lookups can not be optimized away
+    if (sum == M_MAX_UNSIGNED)
+        PrintLine("");
+}
+
+/// Work function of the work queue benchmark. Increments the counter the item points to.
+static void IncrementCounter(const WorkItem* item, unsigned threadIndex)
+{
+    ++*reinterpret_cast<unsigned*>(item->start_);
+}
+
+/// Work function of the work queue benchmark's phases. Increments the counters in the item's range.
+static void IncrementCounters(const WorkItem* item, unsigned threadIndex)
+{
+    for (unsigned* i = reinterpret_cast<unsigned*>(item->start_); i != reinterpret_cast<unsigned*>(item->end_); ++i)
+        ++*i;
+}
+
+/// Merge function of the work queue benchmark's phases. Adds the counters in the item's range to the total in the auxiliary
+/// pointer.
+static void SumCounters(const WorkItem* item, unsigned threadIndex)
+{
+    unsigned long long& total = *reinterpret_cast<unsigned long long*>(item->aux_);
+    for (unsigned* i = reinterpret_cast<unsigned*>(item->start_); i != reinterpret_cast<unsigned*>(item->end_); ++i)
+        total += *i;
+}
+
+/// Save an object's attributes in binary by converting each to a Variant first, the way Serializable::Save() did before the
+/// direct attribute access.
+static void SaveThroughVariant(const Serializable* object, Serializer& dest)
+{
+    const Vector<AttributeInfo>* attributes = object->GetAttributes();
+    Variant value;
+    for (Vector<AttributeInfo>::ConstIterator i = attributes->Begin(); i != attributes->End(); ++i)
+    {
+        if (!(i->mode_ & AM_FILE) || (i->mode_ & AM_FILEREADONLY) == AM_FILEREADONLY)
+            continue;
+        object->OnGetAttribute(*i, value);
+        dest.WriteVariantData(value);
+    }
+}
+
+/// Load an object's attributes in binary through a Variant, the way Serializable::Load() did before the direct attribute
+/// access.
+static void LoadThroughVariant(Serializable* object, Deserializer& source)
+{
+    const Vector<AttributeInfo>* attributes = object->GetAttributes();
+    for (Vector<AttributeInfo>::ConstIterator i = attributes->Begin(); i != attributes->End(); ++i)
+    {
+        if (i->mode_ & AM_FILE)
+            object->OnSetAttribute(*i, source.ReadVariant(i->type_));
+    }
+}
+
+/// Time filling event parameters into a map and reading them back, the way an event sender and a handler do. The time is
+/// returned in microseconds.
+static long long TimeEventParameters()
+{
+    using namespace BenchmarkEvent;
+
+    HiresTimer timer;
+    float sum = 0.0f;
+    VariantMap eventData;
+
+    for (unsigned i = 0; i < NUM_VARIANT_OPERATIONS; ++i)
+    {
+        eventData.Clear();
+        eventData[P_INDEX] = (int)i;
+        eventData[P_TIMESTEP] = 0.1f;
+        eventData[P_POSITION] = Vector3(1.0f, 2.0f, 3.0f);
+        eventData[P_TRANSFORM] = Matrix3x4(Vector3::ONE, Quaternion::IDENTITY, (float)i);
+
+        sum += (float)eventData[P_INDEX].GetInt() + eventData[P_TIMESTEP].GetFloat() + eventData[P_POSITION].GetVector3().x_ +
+            eventData[P_TRANSFORM].GetMatrix3x4().m00_;
+    }
+
+    // Use the sum so that the work can not be optimized away
+    if (sum < 0.0f)
+        PrintLine("");
+
+    return timer.GetUSec(false);
+}
+
+Benchmark::Benchmark(Context* context) :
+    Application(context),
+    eventSum_(0.0f),
+    numWorkerThreads_(0)
+{
+}
+
+void Benchmark::Setup()
+{
+    // Arguments which name a benchmark select it. The engine parses the rest
+    const Vector<String>& arguments = GetArguments();
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        for (const char** name = benchmarkNames; *name; ++name)
+        {
+            if (!arguments[i].Compare(*name, false))
+                selected_.Push(*name);
+        }
+
+        // Create a fixed number of worker threads instead of one per CPU core, to measure the threaded code paths also on
+        // machines with few cores
+        if (!arguments[i].Compare("-workers", false) && i + 1 < arguments.Size())
+        {
+            numWorkerThreads_ = ToUInt(arguments[i + 1]);
+            engineParameters_[EP_WORKER_THREADS] = false;
+        }
+        else if (!arguments[i].Compare("-package", false) && i + 1 < arguments.Size())
+            packageName_ = arguments[i + 1];
+    }
+
+    engineParameters_[EP_LOG_NAME] = GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "logs") + GetTypeName() + ".log";
+    engineParameters_[EP_HEADLESS] = true;
+    engineParameters_[EP_SOUND] = false;
+    if (!engineParameters_.Contains(EP_RESOURCE_PREFIX_PATHS))
+        engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";../share/Resources;../share/Urho3D/Resources";
+}
+
+void Benchmark::Start()
+{
+    char header[256];
+    sprintf(header, "%-36s %13s %13s %9s", "Operation", "Before", "After", "Speedup");
+    PrintLine(header);
+
+    if (numWorkerThreads_)
+        GetSubsystem<WorkQueue>()->CreateThreads(numWorkerThreads_);
+
+    if (IsSelected("Containers"))
+        BenchmarkContainers();
+    if (IsSelected("WorkQueue"))
+        BenchmarkWorkQueue();
+    if (IsSelected("Variants"))
+        BenchmarkVariants();
+    if (IsSelected("Quantization"))
+        BenchmarkQuantization();
+    if (IsSelected("Attributes"))
+        BenchmarkAttributes();
+    if (IsSelected("Packages"))
+        BenchmarkPackages();
+    if (IsSelected("HugeObjectCount"))
+        BenchmarkHugeObjectCount();
+    if (IsSelected("SpatialIndex"))
+        BenchmarkSpatialIndex();
+    if (IsSelected("FrustumCulling"))
+        BenchmarkFrustumCulling();
+    if (IsSelected("FrameAllocations"))
+        BenchmarkFrameAllocations();
+    if (IsSelected("Occlusion"))
+        BenchmarkOcclusion();
+    if (IsSelected("PoseBuffer"))
+        BenchmarkPoseBuffer();
+
+    if (exitCode_ == EXIT_SUCCESS)
+        engine_->Exit();
+}
+
+bool Benchmark::IsSelected(const char* name) const
+{
+    return selected_.Empty() || selected_.Contains(String(name));
+}
+
+void Benchmark::PrintResult(const String& operation, long long baseTime, long long time)
+{
+    char line[256];
+    sprintf(line, "%-36s %10.3f ms %10.3f ms %8.2fx", operation.CString(), baseTime / 1000.0, time / 1000.0,
+        time ? (double)baseTime / (double)time : 0.0);
+    PrintLine(line);
+}
+
+void Benchmark::PrintTime(const String& operation, long long time, float allocationsPerCall)
+{
+    char line[256];
+    sprintf(line, "%-36s %13s %10.3f ms %9s   %.2f heap allocations per call", operation.CString(), "-", time / 1000.0, "-",
+        allocationsPerCall);
+    PrintLine(line);
+}
+
+void Benchmark::PrintRate(const String& operation, long long time, unsigned count)
+{
+    char line[256];
+    sprintf(line, "%-36s %13s %10.3f ms %9s   %.0f per second", operation.CString(), "-", time / 1000.0, "-",
+        time ? count * 1000000.0 / (double)time : 0.0);
+    PrintLine(line);
+}
+
+void Benchmark::BenchmarkContainers()
+{
+    PODVector<StringHash> keys;
+    PODVector<StringHash> missingKeys;
+    for (unsigned i = 0; i < NUM_CONTAINER_KEYS; ++i)
+    {
+        keys.Push(StringHash("Resource" + String(i)));
+        missingKeys.Push(StringHash("Missing" + String(i)));
+    }
+
+    long long baseTimes[5];
+    long long times[5];
+    TimeHashMap<HashMap<StringHash, unsigned> >(keys, missingKeys, baseTimes);
+    TimeHashMap<FlatHashMap<StringHash, unsigned> >(keys, missingKeys, times);
+
+    PrintLine("Containers: HashMap vs. FlatHashMap, " + String(NUM_CONTAINER_KEYS) + " keys");
+    PrintResult("  Insert", baseTimes[0], times[0]);
+    PrintResult("  Find existing x" + String(NUM_CONTAINER_REPEATS), baseTimes[1], times[1]);
+    PrintResult("  Find missing x" + String(NUM_CONTAINER_REPEATS), baseTimes[2], times[2]);
+    PrintResult("  Iterate x" + String(NUM_CONTAINER_REPEATS), baseTimes[3], times[3]);
+    PrintResult("  Erase", baseTimes[4], times[4]);
+
+    // The maps' nodes were allocated from the size-class pool. Now that they are freed, its completely free slabs can be
+    // returned to the heap
+    unsigned long long reserved = GetAllocatorStats().bytesReserved_;
+    HiresTimer timer;
+    AllocatorTrim();
+    long long time = timer.GetUSec(false);
+    PrintLine("  Pool trim: " + String((unsigned)(reserved / 1024)) + " KB reserved before, " +
+        String((unsigned)(GetAllocatorStats().bytesReserved_ / 1024)) + " KB after, " + String(time / 1000.0f) + " ms");
+}
+
+void Benchmark::BenchmarkWorkQueue()
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    PODVector<unsigned> counters(NUM_WORK_ITEMS);
+    for (unsigned i = 0; i < NUM_WORK_ITEMS; ++i)
+        counters[i] = 0;
+
+    // Queue tiny items one at a time, so that the time is dominated by the queue's own overhead. Run twice, so that the item
+    // pool has grown to its working size on the timed run
+    long long time = 0;
+    for (unsigned run = 0; run < 2; ++run)
+    {
+        HiresTimer timer;
+        for (unsigned i = 0; i < NUM_WORK_ITEMS; ++i)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = IncrementCounter;
+            item->start_ = &counters[i];
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(M_MAX_UNSIGNED);
+        time = timer.GetUSec(false);
+    }
+
+    for (unsigned i = 0; i < NUM_WORK_ITEMS; ++i)
+    {
+        if (counters[i] != 2)
+        {
+            ErrorExit("Work item " + String(i) + " was executed " + String(counters[i]) + " times instead of once per run");
+            return;
+        }
+    }
+
+    // Run data-parallel phases which are each followed by a serial merge of their results. Either join in the main thread after
+    // each phase and merge there, or queue the merge as an item depending on the phase's items and the next phase's items
+    // depending on the merge, so that the main thread waits only once
+    long long phaseTimes[2];
+    unsigned long long totals[2] = { 0, 0 };
+    unsigned* counterBegin = &counters[0];
+    for (unsigned chained = 0; chained < 2; ++chained)
+    {
+        for (unsigned i = 0; i < NUM_WORK_ITEMS; ++i)
+            counters[i] = 0;
+
+        HiresTimer timer;
+        for (unsigned r = 0; r < NUM_WORK_PHASE_REPEATS; ++r)
+        {
+            SharedPtr<WorkItem> merge;
+            for (unsigned phase = 0; phase < NUM_WORK_PHASES; ++phase)
+            {
+                PODVector<WorkItem*> previousMerge;
+                if (merge)
+                    previousMerge.Push(merge);
+
+                PODVector<WorkItem*> phaseItems;
+                for (unsigned i = 0; i < NUM_WORK_PHASE_ITEMS; ++i)
+                {
+                    SharedPtr<WorkItem> item = queue->GetFreeItem();
+                    item->priority_ = M_MAX_UNSIGNED;
+                    item->workFunction_ = IncrementCounters;
+                    item->start_ = counterBegin + NUM_WORK_ITEMS * i / NUM_WORK_PHASE_ITEMS;
+                    item->end_ = counterBegin + NUM_WORK_ITEMS * (i + 1) / NUM_WORK_PHASE_ITEMS;
+                    if (merge)
+                        queue->AddWorkItem(item, previousMerge);
+                    else
+                        queue->AddWorkItem(item);
+                    phaseItems.Push(item);
+                }
+
+                if (chained)
+                {
+                    merge = queue->GetFreeItem();
+                    merge->priority_ = M_MAX_UNSIGNED;
+                    merge->workFunction_ = SumCounters;
+                    merge->start_ = counterBegin;
+                    merge->end_ = counterBegin + NUM_WORK_ITEMS;
+                    merge->aux_ = &totals[1];
+                    queue->AddWorkItem(merge, phaseItems);
+                }
+                else
+                {
+                    queue->Complete(M_MAX_UNSIGNED);
+                    for (unsigned i = 0; i < NUM_WORK_ITEMS; ++i)
+                        totals[0] += counters[i];
+                }
+            }
+
+            if (chained)
+            {
+                queue->CompleteItem(merge);
+                // Return the items to the pool
+                queue->Complete(M_MAX_UNSIGNED);
+            }
+        }
+        phaseTimes[chained] = timer.GetUSec(false);
+    }
+
+    PrintLine("WorkQueue: " + String(NUM_WORK_ITEMS) + " tiny work items, " + String(queue->GetNumThreads()) +
+        " worker threads");
+    PrintRate("  Add and complete, items", time, NUM_WORK_ITEMS);
+    PrintResult("  " + String(NUM_WORK_PHASES) + " phases, joined vs. chained", phaseTimes[0], phaseTimes[1]);
+
+    if (totals[1] != totals[0])
+        ErrorExit("The chained phases' merges saw different counters than the joined phases' merges");
+}
+
+void Benchmark::BenchmarkVariants()
+{
+    using namespace BenchmarkEvent;
+
+    // The VariantMap and Variant types they replaced no longer exist in the same build, so all times are absolute. Their
+    // baseline is obtained by running the benchmark on an earlier revision
+    ResetAllocations();
+    countAllocations = true;
+    long long time = TimeEventParameters();
+    countAllocations = false;
+
+    PrintLine("Variants: " + String(NUM_VARIANT_OPERATIONS) + " operations");
+    PrintTime("  Fill and read event parameters", time, (float)GetNumAllocations() / NUM_VARIANT_OPERATIONS);
+
+    // Send an event with the same parameters, reusing the event data map like the engine's own events
+    SubscribeToEvent(E_BENCHMARKEVENT, URHO3D_HANDLER(Benchmark, HandleBenchmarkEvent));
+    ResetAllocations();
+    countAllocations = true;
+    HiresTimer timer;
+    for (unsigned i = 0; i < NUM_VARIANT_OPERATIONS; ++i)
+    {
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_INDEX] = (int)i;
+        eventData[P_TIMESTEP] = 0.1f;
+        eventData[P_POSITION] = Vector3(1.0f, 2.0f, 3.0f);
+        eventData[P_TRANSFORM] = Matrix3x4(Vector3::ONE, Quaternion::IDENTITY, (float)i);
+        SendEvent(E_BENCHMARKEVENT, eventData);
+    }
+    time = timer.GetUSec(false);
+    countAllocations = false;
+    UnsubscribeFromEvent(E_BENCHMARKEVENT);
+    PrintTime("  SendEvent, 4 parameters", time, (float)GetNumAllocations() / NUM_VARIANT_OPERATIONS);
+
+    // Set a node's position and its variables, which hold a matrix among others
+    SharedPtr<Node> node(new Node(context_));
+    Variant position(Vector3(1.0f, 2.0f, 3.0f));
+    VariantMap vars;
+    vars[P_INDEX] = 1;
+    vars[P_TIMESTEP] = 0.1f;
+    vars[P_POSITION] = Vector3(1.0f, 2.0f, 3.0f);
+    vars[P_TRANSFORM] = Matrix3x4(Vector3::ONE, Quaternion::IDENTITY, 2.0f);
+    Variant variables(vars);
+
+    ResetAllocations();
+    countAllocations = true;
+    timer.Reset();
+    for (unsigned i = 0; i < NUM_VARIANT_OPERATIONS; ++i)
+        node->SetAttribute("Position", position);
+    time = timer.GetUSec(false);
+    countAllocations = false;
+    PrintTime("  SetAttribute, Vector3", time, (float)GetNumAllocations() / NUM_VARIANT_OPERATIONS);
+
+    ResetAllocations();
+    countAllocations = true;
+    timer.Reset();
+    for (unsigned i = 0; i < NUM_VARIANT_OPERATIONS; ++i)
+        node->SetAttribute("Variables", variables);
+    time = timer.GetUSec(false);
+    countAllocations = false;
+    PrintTime("  SetAttribute, VariantMap of 4", time, (float)GetNumAllocations() / NUM_VARIANT_OPERATIONS);
+}
+
+void Benchmark::BenchmarkQuantization()
+{
+    // Remember the node transform quantization registered by Node::RegisterObject, so that it can be turned off for comparison
+    const Vector<AttributeInfo>* attributes = context_->GetNetworkAttributes(Node::GetTypeStatic());
+    unsigned positionIndex = M_MAX_UNSIGNED;
+    unsigned rotationIndex = M_MAX_UNSIGNED;
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        if (attributes->At(i).name_ == "Network Position")
+            positionIndex = i;
+        else if (attributes->At(i).name_ == "Network Rotation")
+            rotationIndex = i;
+    }
+    if (positionIndex == M_MAX_UNSIGNED || rotationIndex == M_MAX_UNSIGNED)
+    {
+        ErrorExit("Node network transform attributes not found");
+        return;
+    }
+    AttributeInfo position = attributes->At(positionIndex);
+    AttributeInfo rotation = attributes->At(rotationIndex);
+
+    SetRandomSeed(1);
+    Vector<SharedPtr<Node> > nodes;
+    Vector<SharedPtr<Node> > receivers;
+    for (unsigned i = 0; i < NUM_QUANTIZED_NODES; ++i)
+    {
+        SharedPtr<Node> node(new Node(context_));
+        node->SetPosition(Vector3(Random(-QUANTIZED_POSITION_RANGE, QUANTIZED_POSITION_RANGE), Random(-QUANTIZED_POSITION_RANGE,
+            QUANTIZED_POSITION_RANGE), Random(-QUANTIZED_POSITION_RANGE, QUANTIZED_POSITION_RANGE)));
+        node->SetRotation(Quaternion(Random(360.0f), Random(360.0f), Random(360.0f)));
+        node->PrepareNetworkUpdate();
+        nodes.Push(node);
+        receivers.Push(SharedPtr<Node>(new Node(context_)));
+    }
+
+    // Send the latest data of all nodes first in full precision, then with the default quantization, and read it back
+    unsigned bytes[2];
+    float positionErrors[2];
+    float rotationErrors[2];
+    for (unsigned pass = 0; pass < 2; ++pass)
+    {
+        if (!pass)
+        {
+            context_->SetAttributeQuantization<Node>("Network Position", 0);
+            context_->SetAttributeQuantization<Node>("Network Rotation", 0);
+        }
+        else
+        {
+            context_->SetAttributeQuantization<Node>("Network Position", position.quantizeBits_, position.quantizeMin_,
+                position.quantizeMax_);
+            context_->SetAttributeQuantization<Node>("Network Rotation", rotation.quantizeBits_);
+        }
+
+        VectorBuffer buffer;
+        for (unsigned i = 0; i < NUM_QUANTIZED_NODES; ++i)
+            nodes[i]->WriteLatestDataUpdate(buffer, 0);
+        bytes[pass] = buffer.GetSize();
+
+        MemoryBuffer source(buffer.GetData(), buffer.GetSize());
+        positionErrors[pass] = 0.0f;
+        rotationErrors[pass] = 0.0f;
+        for (unsigned i = 0; i < NUM_QUANTIZED_NODES; ++i)
+        {
+            receivers[i]->ReadLatestDataUpdate(source);
+            positionErrors[pass] = Max(positionErrors[pass], (receivers[i]->GetPosition() - nodes[i]->GetPosition()).Length());
+            // For small differences the distance between the unit quaternions is half the rotation angle in radians. The acos
+            // of their dot product would be dominated by float rounding
+            Quaternion received = receivers[i]->GetRotation();
+            const Quaternion& original = nodes[i]->GetRotation();
+            if (received.DotProduct(original) < 0.0f)
+                received = -received;
+            Vector4 difference(received.w_ - original.w_, received.x_ - original.x_, received.y_ - original.y_,
+                received.z_ - original.z_);
+            rotationErrors[pass] = Max(rotationErrors[pass], 2.0f * sqrtf(difference.DotProduct(difference)) * M_RADTODEG);
+        }
+    }
+
+    PrintLine("Quantization: full precision vs. default node transform quantization, " + String(NUM_QUANTIZED_NODES) + " nodes");
+    PrintLine("  Position " + String(position.quantizeBits_) + " bits in " + String(position.quantizeMin_) + " - " +
+        String(position.quantizeMax_) + ", rotation " + String(rotation.quantizeBits_) + " bits smallest-three");
+    char line[256];
+    sprintf(line, "%-36s %13.2f %13.2f %8.2fx", "  Latest data bytes per node", (float)bytes[0] / NUM_QUANTIZED_NODES,
+        (float)bytes[1] / NUM_QUANTIZED_NODES, bytes[1] ? (double)bytes[0] / (double)bytes[1] : 0.0);
+    PrintLine(line);
+    sprintf(line, "%-36s %13g %13g", "  Max position error", positionErrors[0], positionErrors[1]);
+    PrintLine(line);
+    sprintf(line, "%-36s %13g %13g", "  Max rotation error, degrees", rotationErrors[0], rotationErrors[1]);
+    PrintLine(line);
+}
+
+void Benchmark::BenchmarkAttributes()
+{
+    Model* boxModel = GetSubsystem<ResourceCache>()->GetResource<Model>("Models/Box.mdl");
+
+    // Give the attributes other than default values, and create a second set of objects to load into
+    SetRandomSeed(1);
+    Vector<SharedPtr<Node> > nodes;
+    PODVector<Serializable*> objects;
+    PODVector<Serializable*> loadedObjects;
+    for (unsigned i = 0; i < NUM_ATTRIBUTE_NODES * 2; ++i)
+    {
+        SharedPtr<Node> node(new Node(context_));
+        node->SetName("Box" + String(i / 2));
+        node->SetPosition(Vector3(Random(100.0f), Random(100.0f), Random(100.0f)));
+        node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+        node->SetScale(Random(1.0f, 2.0f));
+        StaticModel* model = node->CreateComponent<StaticModel>();
+        model->SetModel(boxModel);
+        model->SetCastShadows(true);
+        nodes.Push(node);
+
+        PODVector<Serializable*>& dest = (i & 1) ? loadedObjects : objects;
+        dest.Push(node);
+        dest.Push(model);
+    }
+
+    // Alternate the methods and take the fastest of the repeats, as loading into objects which already hold the values is
+    // sensitive to what ran before
+    long long saveTimes[2] = { M_MAX_INT, M_MAX_INT };
+    long long loadTimes[2] = { M_MAX_INT, M_MAX_INT };
+    VectorBuffer buffers[2];
+    for (unsigned repeat = 0; repeat < NUM_ATTRIBUTE_REPEATS; ++repeat)
+    {
+        for (unsigned method = 0; method < 2; ++method)
+        {
+            HiresTimer timer;
+            buffers[method].Clear();
+            for (PODVector<Serializable*>::ConstIterator i = objects.Begin(); i != objects.End(); ++i)
+            {
+                // Call the base class function, as Node::Save() would also write the components and child nodes
+                if (!method)
+                    SaveThroughVariant(*i, buffers[method]);
+                else
+                    (*i)->Serializable::Save(buffers[method]);
+            }
+            saveTimes[method] = Min(saveTimes[method], timer.GetUSec(false));
+
+            timer.Reset();
+            MemoryBuffer source(buffers[method].GetData(), buffers[method].GetSize());
+            for (PODVector<Serializable*>::ConstIterator i = loadedObjects.Begin(); i != loadedObjects.End(); ++i)
+            {
+                if (!method)
+                    LoadThroughVariant(*i, source);
+                else
+                    (*i)->Serializable::Load(source);
+            }
+            loadTimes[method] = Min(loadTimes[method], timer.GetUSec(false));
+        }
+    }
+
+    PrintLine("Attributes: Variant vs. direct binary save and load, " + String(NUM_ATTRIBUTE_NODES) + " nodes with static "
+        "models, fastest of " + String(NUM_ATTRIBUTE_REPEATS));
+    PrintResult("  Save", saveTimes[0], saveTimes[1]);
+    PrintResult("  Load", loadTimes[0], loadTimes[1]);
+
+    // The loaded objects must save the same bytes as the originals
+    VectorBuffer reloaded;
+    for (PODVector<Serializable*>::ConstIterator i = loadedObjects.Begin(); i != loadedObjects.End(); ++i)
+        (*i)->Serializable::Save(reloaded);
+    if (buffers[1].GetBuffer() != buffers[0].GetBuffer() || reloaded.GetBuffer() != buffers[0].GetBuffer())
+        ErrorExit("The direct attribute save and load differ from the Variant path");
+}
+
+void Benchmark::BenchmarkPackages()
+{
+    if (packageName_.Empty())
+    {
+        PrintLine("Packages: skipped, give a package file built with PackageTool with -package <file>");
+        return;
+    }
+
+    SharedPtr<PackageFile> package(new PackageFile(context_));
+    if (!package->Open(packageName_))
+    {
+        ErrorExit("Could not open package file " + packageName_);
+        return;
+    }
+
+    const HashMap<String, PackageEntry>& entries = package->GetEntries();
+    unsigned maxSize = 0;
+    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+        maxSize = Max(maxSize, i->second_.size_);
+    PODVector<unsigned char> buffer(maxSize);
+
+    PrintLine("Packages: " + GetFileNameAndExtension(packageName_) + ", format version " + String(package->GetFormatVersion()) +
+        (package->IsCompressed() ? ", compressed" : ", uncompressed") + (package->IsMemoryMapped() ? ", mapped" : ", not mapped") +
+        ", " + String(entries.Size()) + " files, " + String(package->GetTotalDataSize() / 1024) + " KB");
+
+    // Uncompressed packages were read before the mapping by opening a file handle on the package for each file, seeking to the
+    // file's data and reading it into a buffer. The XML parser then parsed a copy of that buffer. Repeat that with the public
+    // File API for the baseline, and compare against opening the files from the package, which uses the mapping
+    if (!package->IsCompressed() && package->IsMemoryMapped())
+    {
+        long long readTimes[2] = { M_MAX_INT, M_MAX_INT };
+        long long xmlTimes[2] = { M_MAX_INT, M_MAX_INT };
+        unsigned readHashes[2] = { 0, 0 };
+        unsigned numXMLFiles = 0;
+        for (unsigned repeat = 0; repeat < NUM_PACKAGE_REPEATS; ++repeat)
+        {
+            for (unsigned method = 0; method < 2; ++method)
+            {
+                unsigned hash = 0;
+                HiresTimer timer;
+                for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+                {
+                    unsigned size = i->second_.size_;
+                    if (!method)
+                    {
+                        File file(context_, packageName_);
+                        file.Seek(i->second_.offset_);
+                        file.Read(&buffer[0], size);
+                    }
+                    else
+                    {
+                        File file(context_, package, i->first_);
+                        file.Read(&buffer[0], size);
+                    }
+                    // Touch the data once so that the mapping's pages are read
+                    for (unsigned j = 0; j < size; j += 64)
+                        hash = SDBMHash(hash, buffer[j]);
+                }
+                readTimes[method] = Min(readTimes[method], timer.GetUSec(false));
+                readHashes[method] = hash;
+
+                numXMLFiles = 0;
+                timer.Reset();
+                for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+                {
+                    if (GetExtension(i->first_) != ".xml")
+                        continue;
+
+                    XMLFile xml(context_);
+                    if (!method)
+                    {
+                        File file(context_, packageName_);
+                        file.Seek(i->second_.offset_);
+                        file.Read(&buffer[0], i->second_.size_);
+                        MemoryBuffer source(&buffer[0], i->second_.size_);
+                        xml.Load(source);
+                    }
+                    else
+                    {
+                        File file(context_, package, i->first_);
+                        xml.Load(file);
+                    }
+                    ++numXMLFiles;
+                }
+                xmlTimes[method] = Min(xmlTimes[method], timer.GetUSec(false));
+            }
+        }
+
+        PrintResult("  Read all files, handle vs. mapped", readTimes[0], readTimes[1]);
+        PrintResult("  Load " + String(numXMLFiles) + " XML files, copy vs. mapped", xmlTimes[0], xmlTimes[1]);
+
+        if (readHashes[0] != readHashes[1])
+            ErrorExit("The files read from the package mapping differ from the file handle reads");
+    }
+
+    // Version 1 compressed packages could only be read forward from the beginning of each file, so reaching a position meant
+    // decompressing everything before it. Emulate that by reading up to the position, and compare against seeking to the
+    // position through the block offset table
+    if (package->IsCompressed() && package->GetBlockSize())
+    {
+        Vector<String> names;
+        for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+        {
+            if (i->second_.size_ >= PACKAGE_RANDOM_READ_SIZE)
+                names.Push(i->first_);
+        }
+        if (names.Empty())
+            return;
+
+        SetRandomSeed(1);
+        PODVector<Pair<unsigned, unsigned> > reads;
+        for (unsigned i = 0; i < NUM_PACKAGE_RANDOM_READS; ++i)
+        {
+            unsigned index = (unsigned)Random((int)names.Size());
+            unsigned maxPosition = package->GetEntry(names[index])->size_ - PACKAGE_RANDOM_READ_SIZE;
+            reads.Push(MakePair(index, (unsigned)(Random(1.0f) * maxPosition)));
+        }
+
+        long long readTime = M_MAX_INT;
+        long long randomTimes[2] = { M_MAX_INT, M_MAX_INT };
+        unsigned randomHashes[2] = { 0, 0 };
+        for (unsigned repeat = 0; repeat < NUM_PACKAGE_REPEATS; ++repeat)
+        {
+            HiresTimer timer;
+            for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+            {
+                File file(context_, package, i->first_);
+                file.Read(&buffer[0], i->second_.size_);
+            }
+            readTime = Min(readTime, timer.GetUSec(false));
+
+            for (unsigned method = 0; method < 2; ++method)
+            {
+                unsigned hash = 0;
+                timer.Reset();
+                for (unsigned i = 0; i < reads.Size(); ++i)
+                {
+                    File file(context_, package, names[reads[i].first_]);
+                    if (!method)
+                        file.Read(&buffer[0], reads[i].second_);
+                    else
+                        file.Seek(reads[i].second_);
+                    file.Read(&buffer[0], PACKAGE_RANDOM_READ_SIZE);
+                    for (unsigned j = 0; j < PACKAGE_RANDOM_READ_SIZE; ++j)
+                        hash = SDBMHash(hash, buffer[j]);
+                }
+                randomTimes[method] = Min(randomTimes[method], timer.GetUSec(false));
+                randomHashes[method] = hash;
+            }
+        }
+
+        PrintRate("  Read all files, KB", readTime, package->GetTotalDataSize() / 1024);
+        PrintResult("  " + String(NUM_PACKAGE_RANDOM_READS) + " random reads, stream vs. seek", randomTimes[0], randomTimes[1]);
+
+        if (randomHashes[0] != randomHashes[1])
+            ErrorExit("The reads after seeking in compressed files differ from reading the files from the beginning");
+    }
+}
+
+void Benchmark::HandleBenchmarkEvent(StringHash eventType, VariantMap& eventData)
+{
+    using namespace BenchmarkEvent;
+
+    eventSum_ += (float)eventData[P_INDEX].GetInt() + eventData[P_TIMESTEP].GetFloat() +
+        eventData[P_POSITION].GetVector3().x_ + eventData[P_TRANSFORM].GetMatrix3x4().m00_;
+}
+
+void Benchmark::CreateBoxGridScene(int boxesPerSide)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    scene_ = new Scene(context_);
+    scene_->CreateComponent<Octree>();
+
+    boxNodes_.Clear();
+    for (int y = -boxesPerSide / 2; y < boxesPerSide - boxesPerSide / 2; ++y)
+    {
+        for (int x = -boxesPerSide / 2; x < boxesPerSide - boxesPerSide / 2; ++x)
+        {
+            Node* boxNode = scene_->CreateChild("Box");
+            boxNode->SetPosition(Vector3(x * 0.3f, 0.0f, y * 0.3f));
+            boxNode->SetScale(0.25f);
+            boxNode->CreateComponent<StaticModel>()->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+            boxNodes_.Push(boxNode);
+        }
+    }
+
+    // Insert the boxes into the octants
+    RunFixedFrame();
+}
+
+void Benchmark::RunFixedFrame()
+{
+    // Run as fast as possible. The window is never focused in headless mode, so also the inactive limit applies
+    int maxFps = engine_->GetMaxFps();
+    int maxInactiveFps = engine_->GetMaxInactiveFps();
+    engine_->SetMaxFps(0);
+    engine_->SetMaxInactiveFps(0);
+
+    engine_->SetNextTimeStep(FRAME_TIME_STEP);
+    engine_->RunFrame();
+
+    engine_->SetMaxFps(maxFps);
+    engine_->SetMaxInactiveFps(maxInactiveFps);
+}
+
+void Benchmark::BenchmarkHugeObjectCount()
+{
+    CreateBoxGridScene(NUM_HUGE_BOXES_PER_SIDE);
+    Octree* octree = scene_->GetComponent<Octree>();
+
+    // View the whole grid from above, like the sample's camera after zooming out
+    Frustum frustum;
+    frustum.Define(45.0f, 16.0f / 9.0f, 1.0f, 0.1f, 300.0f, Matrix3x4(Vector3(0.0f, 50.0f, -100.0f), Quaternion(30.0f, 0.0f,
+        0.0f), 1.0f));
+
+    FrameInfo frame;
+    frame.frameNumber_ = 0;
+    frame.timeStep_ = FRAME_TIME_STEP;
+    frame.viewSize_ = IntVector2::ZERO;
+    frame.camera_ = 0;
+
+    long long updateTime = 0;
+    long long queryTimes[2] = { 0, 0 };
+    unsigned numResults[2] = { 0, 0 };
+    ResetAllocations();
+
+    for (unsigned i = 0; i < NUM_HUGE_FRAMES; ++i)
+    {
+        // Rotate all boxes like the sample does, so that every drawable is queued for reinsertion
+        Quaternion rotation(10.0f * FRAME_TIME_STEP, 20.0f * FRAME_TIME_STEP, 30.0f * FRAME_TIME_STEP);
+        for (PODVector<Node*>::ConstIterator j = boxNodes_.Begin(); j != boxNodes_.End(); ++j)
+            (*j)->Rotate(rotation);
+
+        ++frame.frameNumber_;
+        countAllocations = true;
+        HiresTimer timer;
+        octree->Update(frame);
+        updateTime += timer.GetUSec(false);
+        countAllocations = false;
+
+        for (unsigned threaded = 0; threaded < 2; ++threaded)
+        {
+            timer.Reset();
+            FrustumOctreeQuery query(queryResults_, frustum, DRAWABLE_GEOMETRY);
+            if (threaded)
+                octree->GetDrawablesThreaded(query);
+            else
+                octree->GetDrawables(query);
+            queryTimes[threaded] += timer.GetUSec(false);
+            numResults[threaded] += queryResults_.Size();
+        }
+    }
+
+    scene_.Reset();
+    boxNodes_.Clear();
+
+    PrintLine("HugeObjectCount: serial vs. threaded, " + String(NUM_HUGE_BOXES_PER_SIDE * NUM_HUGE_BOXES_PER_SIDE) + " boxes, " +
+        String(NUM_HUGE_FRAMES) + " frames, " + String(GetSubsystem<WorkQueue>()->GetNumThreads()) + " worker threads");
+    PrintResult("  Frustum query", queryTimes[0], queryTimes[1]);
+    PrintTime("  Octree update, all boxes moving", updateTime, (float)GetNumAllocations() / NUM_HUGE_FRAMES);
+
+    if (numResults[1] != numResults[0])
+    {
+        ErrorExit("The serial and threaded queries returned different numbers of drawables: " + String(numResults[0]) + ", " +
+            String(numResults[1]));
+    }
+}
+
+void Benchmark::BenchmarkSpatialIndex()
+{
+    CreateBoxGridScene(NUM_INDEX_BOXES_PER_SIDE);
+    Octree* octree = scene_->GetComponent<Octree>();
+
+    FrameInfo frame;
+    frame.frameNumber_ = 0;
+    frame.timeStep_ = FRAME_TIME_STEP;
+    frame.viewSize_ = IntVector2::ZERO;
+    frame.camera_ = 0;
+
+    // Insert all drawables into the BVH, then back into the octants
+    HiresTimer timer;
+    octree->SetSpatialIndexType(SPATIAL_INDEX_LINEAR_BVH);
+    octree->Update(frame);
+    long long insertTime = timer.GetUSec(true);
+    octree->SetSpatialIndexType(SPATIAL_INDEX_OCTANTS);
+    octree->Update(frame);
+    long long baseInsertTime = timer.GetUSec(false);
+
+    long long baseTimes[4];
+    long long times[4];
+    unsigned baseNumResults[2];
+    unsigned numResults[2];
+    TimeSpatialIndex(baseTimes, baseNumResults);
+    octree->SetSpatialIndexType(SPATIAL_INDEX_LINEAR_BVH);
+    octree->Update(frame);
+    TimeSpatialIndex(times, numResults);
+
+    scene_.Reset();
+    boxNodes_.Clear();
+
+    PrintLine("SpatialIndex: octants vs. linear BVH, " + String(NUM_INDEX_BOXES_PER_SIDE * NUM_INDEX_BOXES_PER_SIDE) + " boxes, " +
+        String(NUM_INDEX_OPERATIONS) + " operations");
+    PrintResult("  Insert all", baseInsertTime, insertTime);
+    PrintResult("  Update, 1/" + String(INDEX_MOVING_BOX_INTERVAL) + " of boxes moving", baseTimes[0], times[0]);
+    PrintResult("  Frustum query", baseTimes[1], times[1]);
+    PrintResult("  Raycast", baseTimes[2], times[2]);
+    PrintResult("  RaycastSingle", baseTimes[3], times[3]);
+
+    if (numResults[0] != baseNumResults[0] || numResults[1] != baseNumResults[1])
+        ErrorExit("The octants and the linear BVH returned different drawables");
+}
+
+void Benchmark::TimeSpatialIndex(long long* times, unsigned* numResults)
+{
+    Octree* octree = scene_->GetComponent<Octree>();
+
+    FrameInfo frame;
+    frame.frameNumber_ = 0;
+    frame.timeStep_ = FRAME_TIME_STEP;
+    frame.viewSize_ = IntVector2::ZERO;
+    frame.camera_ = 0;
+
+    // Move a different set of boxes back and forth on each frame, so that both indices see the same changes
+    times[0] = 0;
+    for (unsigned i = 0; i < NUM_INDEX_OPERATIONS; ++i)
+    {
+        Vector3 offset(i & 1 ? -1.0f : 1.0f, 0.0f, 0.0f);
+        for (unsigned j = (i / 2) % INDEX_MOVING_BOX_INTERVAL; j < boxNodes_.Size(); j += INDEX_MOVING_BOX_INTERVAL)
+            boxNodes_[j]->Translate(offset, TS_WORLD);
+
+        ++frame.frameNumber_;
+        HiresTimer timer;
+        octree->Update(frame);
+        times[0] += timer.GetUSec(false);
+    }
+
+    numResults[0] = 0;
+    numResults[1] = 0;
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < NUM_INDEX_OPERATIONS; ++i)
+    {
+        Frustum frustum;
+        frustum.Define(45.0f, 16.0f / 9.0f, 1.0f, 0.1f, 100.0f, Matrix3x4(Vector3(0.0f, 10.0f, 0.0f),
+            Quaternion(30.0f, 360.0f * i / NUM_INDEX_OPERATIONS, 0.0f), 1.0f));
+        FrustumOctreeQuery query(queryResults_, frustum, DRAWABLE_GEOMETRY);
+        query.useBoxBatches_ = true;
+        octree->GetDrawables(query);
+        numResults[0] += queryResults_.Size();
+    }
+    times[1] = timer.GetUSec(true);
+
+    // Cast the rays across the grid just above the ground, so that they pass many boxes
+    for (unsigned i = 0; i < NUM_INDEX_OPERATIONS; ++i)
+    {
+        Ray ray(Vector3(-40.0f, 0.1f, -40.0f + 80.0f * i / NUM_INDEX_OPERATIONS), Vector3(1.0f, 0.0f, 0.1f));
+        RayOctreeQuery query(rayQueryResults_, ray, RAY_AABB);
+        octree->Raycast(query);
+        numResults[1] += rayQueryResults_.Size();
+    }
+    times[2] = timer.GetUSec(true);
+
+    for (unsigned i = 0; i < NUM_INDEX_OPERATIONS; ++i)
+    {
+        Ray ray(Vector3(-40.0f, 0.1f, -40.0f + 80.0f * i / NUM_INDEX_OPERATIONS), Vector3(1.0f, 0.0f, 0.1f));
+        RayOctreeQuery query(rayQueryResults_, ray, RAY_AABB);
+        octree->RaycastSingle(query);
+    }
+    times[3] = timer.GetUSec(false);
+}
+
+void Benchmark::BenchmarkFrustumCulling()
+{
+    CreateBoxGridScene(NUM_CULLING_BOXES_PER_SIDE);
+    Octree* octree = scene_->GetComponent<Octree>();
+
+    // Look at the grid from above its edge, turning around so that the view covers a different part each time
+    Vector<Frustum> frustums(NUM_CULLING_QUERIES);
+    for (unsigned i = 0; i < NUM_CULLING_QUERIES; ++i)
+    {
+        Quaternion rotation(30.0f, 360.0f * i / NUM_CULLING_QUERIES, 0.0f);
+        frustums[i].Define(45.0f, 16.0f / 9.0f, 1.0f, 0.1f, 100.0f, Matrix3x4(Vector3(0.0f, 10.0f, 0.0f), rotation, 1.0f));
+    }
+
+    long long times[2][2];
+    unsigned numResults[2][2];
+    for (unsigned threaded = 0; threaded < 2; ++threaded)
+    {
+        for (unsigned batched = 0; batched < 2; ++batched)
+        {
+            HiresTimer timer;
+            numResults[threaded][batched] = 0;
+            for (unsigned i = 0; i < NUM_CULLING_QUERIES; ++i)
+            {
+                FrustumOctreeQuery query(queryResults_, frustums[i], DRAWABLE_GEOMETRY);
+                query.useBoxBatches_ = batched != 0;
+                if (threaded)
+                    octree->GetDrawablesThreaded(query);
+                else
+                    octree->GetDrawables(query);
+                numResults[threaded][batched] += queryResults_.Size();
+            }
+            times[threaded][batched] = timer.GetUSec(false);
+        }
+    }
+
+    scene_.Reset();
+    boxNodes_.Clear();
+
+    PrintLine("FrustumCulling: one by one vs. batched bounding boxes, " +
+        String(NUM_CULLING_BOXES_PER_SIDE * NUM_CULLING_BOXES_PER_SIDE) + " boxes, " + String(NUM_CULLING_QUERIES) + " queries");
+    PrintResult("  GetDrawables", times[0][0], times[0][1]);
+    PrintResult("  GetDrawablesThreaded", times[1][0], times[1][1]);
+
+    if (numResults[0][1] != numResults[0][0] || numResults[1][0] != numResults[0][0] || numResults[1][1] != numResults[0][0])
+    {
+        ErrorExit("The frustum queries returned different numbers of drawables: " + String(numResults[0][0]) + ", " +
+            String(numResults[0][1]) + ", " + String(numResults[1][0]) + ", " + String(numResults[1][1]));
+    }
+}
+
+void Benchmark::BenchmarkFrameAllocations()
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    scene_ = new Scene(context_);
+    scene_->CreateComponent<Octree>();
+
+    Node* floorNode = scene_->CreateChild("Floor");
+    floorNode->SetScale(Vector3(500.0f, 1.0f, 500.0f));
+    floorNode->CreateComponent<StaticModel>()->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+#ifdef URHO3D_PHYSICS
+    scene_->CreateComponent<PhysicsWorld>();
+    floorNode->CreateComponent<RigidBody>();
+    floorNode->CreateComponent<CollisionShape>()->SetBox(Vector3::ONE);
+#endif
+
+    // Every other box rotates every frame, so that the octree reinserts it. The others lie on the floor, so that physics sends
+    // collision events for them every frame
+    for (unsigned i = 0; i < NUM_BOXES; ++i)
+    {
+        Node* boxNode = scene_->CreateChild("Box");
+        boxNode->SetPosition(Vector3(Random(400.0f) - 200.0f, 1.0f, Random(400.0f) - 200.0f));
+        boxNode->CreateComponent<StaticModel>()->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+        if (!(i & 1))
+            movingNodes_.Push(boxNode);
+#ifdef URHO3D_PHYSICS
+        else
+        {
+            RigidBody* body = boxNode->CreateComponent<RigidBody>();
+            body->SetMass(1.0f);
+            body->SetCollisionEventMode(COLLISION_ALWAYS);
+            boxNode->CreateComponent<CollisionShape>()->SetBox(Vector3::ONE);
+        }
+#endif
+    }
+
+    for (unsigned i = 0; i < NUM_ANIMATED_MODELS; ++i)
+    {
+        Node* modelNode = scene_->CreateChild("Jack");
+        modelNode->SetPosition(Vector3(Random(400.0f) - 200.0f, 0.5f, Random(400.0f) - 200.0f));
+        AnimatedModel* model = modelNode->CreateComponent<AnimatedModel>();
+        model->SetModel(cache->GetResource<Model>("Models/Jack.mdl"));
+        modelNode->CreateComponent<AnimationController>()->Play("Models/Jack_Walk.ani", 0, true);
+    }
+
+    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(Benchmark, HandleAllocationSceneUpdate));
+
+    // Run the frames as fast as possible with a fixed time step. The window is never focused in headless mode, so also the
+    // inactive limit applies
+    int maxFps = engine_->GetMaxFps();
+    int maxInactiveFps = engine_->GetMaxInactiveFps();
+    engine_->SetMaxFps(0);
+    engine_->SetMaxInactiveFps(0);
+
+    for (unsigned i = 0; i < NUM_WARMUP_FRAMES; ++i)
+    {
+        engine_->SetNextTimeStep(FRAME_TIME_STEP);
+        engine_->RunFrame();
+    }
+
+    ResetAllocations();
+    countAllocations = true;
+    HiresTimer timer;
+    for (unsigned i = 0; i < NUM_COUNTED_FRAMES; ++i)
+    {
+        engine_->SetNextTimeStep(FRAME_TIME_STEP);
+        engine_->RunFrame();
+    }
+    long long time = timer.GetUSec(false);
+    countAllocations = false;
+
+    engine_->SetMaxFps(maxFps);
+    engine_->SetMaxInactiveFps(maxInactiveFps);
+    UnsubscribeFromEvent(E_UPDATE);
+    movingNodes_.Clear();
+    scene_.Reset();
+
+    FrameAllocator* frameAllocator = GetSubsystem<FrameAllocator>();
+    PrintLine("FrameAllocations: " + String(NUM_COUNTED_FRAMES) + " frames, " + String(NUM_ANIMATED_MODELS) +
+        " animated models, " + String(NUM_BOXES) + " boxes");
+    PrintLine("  Average frame time: " + String(time / 1000.0f / NUM_COUNTED_FRAMES) + " ms");
+    unsigned numAllocations = GetNumAllocations();
+    PrintLine("  Heap allocations: " + String(numAllocations) + ", frame arena high-water mark: " +
+        String(frameAllocator ? frameAllocator->GetHighWaterMark() : 0) + " bytes");
+
+    if (numAllocations)
+        ErrorExit("The steady-state frame loop made " + String(numAllocations) + " heap allocations");
+}
+
+void Benchmark::HandleAllocationSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+    using namespace Update;
+
+    float timeStep = eventData[P_TIMESTEP].GetFloat();
+    for (PODVector<Node*>::ConstIterator i = movingNodes_.Begin(); i != movingNodes_.End(); ++i)
+        (*i)->Rotate(Quaternion(10.0f * timeStep, 20.0f * timeStep, 30.0f * timeStep));
+
+    Octree* octree = scene_->GetComponent<Octree>();
+    BoxOctreeQuery boxQuery(queryResults_, BoundingBox(Vector3(-100.0f, -10.0f, -100.0f), Vector3(100.0f, 10.0f, 100.0f)));
+    octree->GetDrawablesThreaded(boxQuery);
+
+    RayOctreeQuery rayQuery(rayQueryResults_, Ray(Vector3(-200.0f, 1.0f, -200.0f), Vector3(1.0f, 0.0f, 1.0f)), RAY_AABB);
+    octree->Raycast(rayQuery);
+}
+
+void Benchmark::BenchmarkOcclusion()
+{
+    // Scatter wall-like occluders and smaller occludees around the camera with a fixed seed, so that every run is the same
+    SetRandomSeed(1);
+
+    PODVector<Matrix3x4> occluders;
+    PODVector<BoundingBox> occluderBoxes;
+    for (unsigned i = 0; i < NUM_OCCLUDERS; ++i)
+    {
+        float angle = Random(360.0f);
+        float distance = Random(5.0f, 60.0f);
+        Vector3 size(Random(1.0f, 6.0f), Random(1.0f, 5.0f), Random(0.3f, 2.0f));
+        Matrix3x4 model(Vector3(Cos(angle) * distance, 0.5f * size.y_, Sin(angle) * distance),
+            Quaternion(Random(360.0f), Vector3::UP), size);
+        occluders.Push(model);
+        occluderBoxes.Push(BoundingBox(-0.5f * Vector3::ONE, 0.5f * Vector3::ONE).Transformed(model));
+    }
+
+    PODVector<BoundingBox> occludees;
+    for (unsigned i = 0; i < NUM_OCCLUDEES; ++i)
+    {
+        float angle = Random(360.0f);
+        float distance = Random(3.0f, 80.0f);
+        Vector3 center(Cos(angle) * distance, Random(3.0f), Sin(angle) * distance);
+        Vector3 halfSize(Random(0.1f, 0.75f), Random(0.1f, 0.75f), Random(0.1f, 0.75f));
+        occludees.Push(BoundingBox(center - halfSize, center + halfSize));
+    }
+
+    SharedPtr<Node> cameraNode(new Node(context_));
+    Camera* camera = cameraNode->CreateComponent<Camera>();
+    camera->SetFarClip(100.0f);
+    camera->SetAspectRatio((float)OCCLUSION_BUFFER_WIDTH / (float)OCCLUSION_BUFFER_HEIGHT);
+
+    SharedPtr<OcclusionBuffer> buffer(new OcclusionBuffer(context_));
+    buffer->SetSize(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT, false);
+
+    long long drawAllTime = 0;
+    long long oneByOneTime = 0;
+    long long singleTestTime = 0;
+    long long batchedTestTime = 0;
+    unsigned drawAllAllocations = 0;
+    unsigned oneByOneAllocations = 0;
+    unsigned numOccluded = 0;
+    unsigned numBatchMismatches = 0;
+    PODVector<bool> visible(NUM_OCCLUDEES);
+    PODVector<bool> batchedVisible(NUM_OCCLUDEES);
+
+    for (unsigned i = 0; i < NUM_OCCLUSION_VIEWS; ++i)
+    {
+        cameraNode->SetPosition(Vector3(0.0f, 2.0f, 0.0f));
+        cameraNode->SetRotation(Quaternion(10.0f, 360.0f * i / NUM_OCCLUSION_VIEWS, 0.0f));
+        buffer->SetView(camera);
+        buffer->SetCullMode(CULL_NONE);
+
+        // Submit all occluders and draw them at once, like View does with threaded occlusion
+        ResetAllocations();
+        countAllocations = true;
+        HiresTimer timer;
+        buffer->Clear();
+        for (unsigned k = 0; k < occluders.Size(); ++k)
+            buffer->AddTriangles(occluders[k], cubeVertices, sizeof(Vector3), cubeIndices, sizeof(unsigned short), 0, 36);
+        buffer->DrawTriangles();
+        buffer->BuildDepthHierarchy();
+        drawAllTime += timer.GetUSec(false);
+        countAllocations = false;
+        drawAllAllocations += GetNumAllocations();
+
+        // Draw the occluders one by one, skipping those already occluded, like View does without threading
+        ResetAllocations();
+        countAllocations = true;
+        timer.Reset();
+        buffer->Clear();
+        for (unsigned k = 0; k < occluders.Size(); ++k)
+        {
+            if (k > 0 && !buffer->IsVisible(occluderBoxes[k]))
+                continue;
+            buffer->AddTriangles(occluders[k], cubeVertices, sizeof(Vector3), cubeIndices, sizeof(unsigned short), 0, 36);
+            buffer->DrawTriangles();
+        }
+        buffer->BuildDepthHierarchy();
+        oneByOneTime += timer.GetUSec(false);
+        countAllocations = false;
+        oneByOneAllocations += GetNumAllocations();
+
+        timer.Reset();
+        for (unsigned k = 0; k < occludees.Size(); ++k)
+            visible[k] = buffer->IsVisible(occludees[k]);
+        singleTestTime += timer.GetUSec(false);
+
+        timer.Reset();
+        buffer->IsVisible(&occludees[0], occludees.Size(), &batchedVisible[0]);
+        batchedTestTime += timer.GetUSec(false);
+
+        for (unsigned k = 0; k < occludees.Size(); ++k)
+        {
+            if (!visible[k])
+                ++numOccluded;
+            if (batchedVisible[k] != visible[k])
+                ++numBatchMismatches;
+        }
+    }
+
+    PrintLine("Occlusion: " + String(NUM_OCCLUDERS) + " occluders, " + String(NUM_OCCLUDEES) + " occludees, " +
+        String(NUM_OCCLUSION_VIEWS) + " views");
+    PrintTime("  Draw all occluders", drawAllTime, (float)drawAllAllocations / NUM_OCCLUSION_VIEWS);
+    PrintTime("  Draw occluders one by one", oneByOneTime, (float)oneByOneAllocations / NUM_OCCLUSION_VIEWS);
+    PrintResult("  IsVisible, single vs. batched", singleTestTime, batchedTestTime);
+    PrintLine("  Occluded: " + String(numOccluded) + " of " + String(NUM_OCCLUDEES * NUM_OCCLUSION_VIEWS));
+
+    if (numBatchMismatches)
+        ErrorExit("The batched and single occludee tests returned different results for " + String(numBatchMismatches) + " occludees");
+}
+
+void Benchmark::BenchmarkPoseBuffer()
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    Model* jackModel = cache->GetResource<Model>("Models/Jack.mdl");
+
+    // Create two identical scenes of walking models at different animation times. Index 0 animates the bone nodes, 1 the pose
+    // buffer. Only the scene being timed is updated, so that both advance the same number of frames
+    SharedPtr<Scene> scenes[2];
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        SetRandomSeed(1);
+        scenes[i] = new Scene(context_);
+        scenes[i]->CreateComponent<Octree>();
+        for (unsigned j = 0; j < NUM_POSE_MODELS; ++j)
+        {
+            Node* modelNode = scenes[i]->CreateChild("Jack");
+            modelNode->SetPosition(Vector3(Random(200.0f) - 100.0f, 0.0f, Random(200.0f) - 100.0f));
+            modelNode->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+            AnimatedModel* model = modelNode->CreateComponent<AnimatedModel>();
+            model->SetModel(jackModel);
+            model->SetUsePoseBuffer(i != 0);
+            AnimationController* controller = modelNode->CreateComponent<AnimationController>();
+            controller->Play("Models/Jack_Walk.ani", 0, true);
+            controller->SetTime("Models/Jack_Walk.ani", Random(1.0f));
+        }
+    }
+
+    long long times[2] = { M_MAX_INT, M_MAX_INT };
+    for (unsigned repeat = 0; repeat < NUM_POSE_REPEATS; ++repeat)
+    {
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            scenes[i]->SetUpdateEnabled(true);
+            scenes[1 - i]->SetUpdateEnabled(false);
+
+            HiresTimer timer;
+            for (unsigned j = 0; j < NUM_POSE_FRAMES; ++j)
+                RunFixedFrame();
+            times[i] = Min(times[i], timer.GetUSec(false));
+        }
+    }
+
+    // Both modes must animate the models' bone bounding boxes the same
+    float maxError = 0.0f;
+    const Vector<SharedPtr<Node> >& nodes = scenes[0]->GetChildren();
+    const Vector<SharedPtr<Node> >& poseNodes = scenes[1]->GetChildren();
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+    {
+        const BoundingBox& box = nodes[i]->GetComponent<AnimatedModel>()->GetWorldBoundingBox();
+        const BoundingBox& poseBox = poseNodes[i]->GetComponent<AnimatedModel>()->GetWorldBoundingBox();
+        maxError = Max(maxError, Max((box.min_ - poseBox.min_).Abs().Length(), (box.max_ - poseBox.max_).Abs().Length()));
+    }
+
+    PrintLine("PoseBuffer: bone nodes vs. pose buffer, " + String(NUM_POSE_MODELS) + " walking models, " +
+        String(NUM_POSE_FRAMES) + " frames, fastest of " + String(NUM_POSE_REPEATS));
+    PrintResult("  Frame time", times[0] / NUM_POSE_FRAMES, times[1] / NUM_POSE_FRAMES);
+    PrintLine("  Maximum bounding box difference: " + String(maxError));
+
+    for (unsigned i = 0; i < 2; ++i)
+        scenes[i].Reset();
+
+    if (maxError > 0.001f)
+        ErrorExit("The pose buffer animated the models differently from the bone nodes");
+}
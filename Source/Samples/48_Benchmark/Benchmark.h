@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+
+}
+
+// All Urho3D classes reside in namespace Urho3D
+using namespace Urho3D;
+
+/// Headless benchmark example.
+/// This sample demonstrates:
+///     - Running the engine in headless mode without a window or rendering
+///     - Timing engine operations with HiresTimer to measure optimizations
+///
+/// The benchmarks to run can be given by name on the command line, for example "48_Benchmark Containers". By default all
+/// of them are run. The results are printed to the standard output, after which the application exits. "-workers N" creates N
+/// worker threads instead of one per CPU core. "-package <file>" gives the package file which the package benchmark reads.
+class Benchmark : public Application
+{
+    URHO3D_OBJECT(Benchmark, Application);
+
+public:
+    /// Construct.
+    Benchmark(Context* context);
+
+    /// Setup before engine initialization. Selects the benchmarks to run and modifies the engine parameters.
+    virtual void Setup();
+    /// Setup after engine initialization. Runs the benchmarks.
+    virtual void Start();
+
+private:
+    /// Return whether a benchmark has been selected to run.
+    bool IsSelected(const char* name) const;
+    /// Print a result row comparing the time of an operation against a baseline time, both in microseconds.
+    void PrintResult(const String& operation, long long baseTime, long long time);
+    /// Print a result row of an operation which has no baseline in the same build, with its time in microseconds and heap
+    /// allocations per call. Its baseline is obtained by running the benchmark on an earlier revision.
+    void PrintTime(const String& operation, long long time, float allocationsPerCall);
+    /// Print a result row of a throughput, with the time in microseconds taken to process count items.
+    void PrintRate(const String& operation, long long time, unsigned count);
+    /// Time adding and completing a large number of tiny work items, and print the items processed per second. Then compare
+    /// data-parallel phases joined in the main thread against phases chained through work item dependencies.
+    void BenchmarkWorkQueue();
+    /// Compare FlatHashMap against HashMap.
+    void BenchmarkContainers();
+    /// Time filling and reading event parameters, SendEvent() and Serializable::SetAttribute().
+    void BenchmarkVariants();
+    /// Compare the latest data size and round-trip precision of node transforms in full precision and with the default
+    /// quantization.
+    void BenchmarkQuantization();
+    /// Compare saving and loading attributes in binary through a Variant against the direct attribute access, and check that
+    /// they produce the same bytes.
+    void BenchmarkAttributes();
+    /// Compare reading all files of the package given with -package through file handles against reading them from the
+    /// package's memory mapping, and loading its XML files from a copy against loading them in place. For a compressed package,
+    /// compare random reads which decompress the files from the beginning against seeking through the block offset table.
+    void BenchmarkPackages();
+    /// Handle the event sent by the variant benchmark. Reads all its parameters.
+    void HandleBenchmarkEvent(StringHash eventType, VariantMap& eventData);
+    /// Move all objects of a scene like the HugeObjectCount sample scaled up, and compare serial and threaded octree queries. The
+    /// octree update time has no baseline in the same run; run the benchmark with -nothreads for it.
+    void BenchmarkHugeObjectCount();
+    /// Compare the linear BVH spatial index against the octants in inserting, updating, frustum queries and raycasts.
+    void BenchmarkSpatialIndex();
+    /// Time the spatial index benchmark's operations with the octree's current spatial index. The times are returned in
+    /// microseconds in the order of update, frustum query, raycast and single raycast, and the total numbers of drawables found
+    /// by the frustum queries and raycasts.
+    void TimeSpatialIndex(long long* times, unsigned* numResults);
+    /// Compare frustum queries which test the drawables one by one against queries which test their bounding boxes in batches.
+    void BenchmarkFrustumCulling();
+    /// Create a scene with an octree and a square grid of boxes like the HugeObjectCount sample, and update it once.
+    void CreateBoxGridScene(int boxesPerSide);
+    /// Run one frame with the benchmarks' fixed time step, so that the octree updates.
+    void RunFixedFrame();
+    /// Run frames of an animated physics scene in headless mode and check that the steady state makes no heap allocations.
+    void BenchmarkFrameAllocations();
+    /// Handle the logic update event of the frame allocation benchmark. Moves the scene's objects and queries the octree.
+    void HandleAllocationSceneUpdate(StringHash eventType, VariantMap& eventData);
+    /// Time drawing occluders into the occlusion buffer, and compare testing occludees one by one against testing them in batches.
+    /// Exits with an error if the batched and single tests disagree.
+    void BenchmarkOcclusion();
+    /// Compare the frame time of animating models through their bone nodes against animating them through the pose buffer, and
+    /// check that both give the same bounding boxes.
+    void BenchmarkPoseBuffer();
+
+    /// Names of the benchmarks to run. Empty to run all.
+    Vector<String> selected_;
+    /// Sum of the event parameters read by the variant benchmark's event handler.
+    float eventSum_;
+    /// Number of worker threads to create instead of the engine's default, or 0 to use the default.
+    unsigned numWorkerThreads_;
+    /// Package file read by the package benchmark.
+    String packageName_;
+    /// Scene of the frame allocation benchmark.
+    SharedPtr<Scene> scene_;
+    /// Moving nodes of the frame allocation benchmark.
+    PODVector<Node*> movingNodes_;
+    /// Box nodes of the box grid scene.
+    PODVector<Node*> boxNodes_;
+    /// Octree query results of the frame allocation benchmark. Kept across frames like a real application would.
+    PODVector<Drawable*> queryResults_;
+    /// Raycast results of the frame allocation benchmark.
+    PODVector<RayQueryResult> rayQueryResults_;
+};
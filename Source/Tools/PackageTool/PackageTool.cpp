@@ -22,7 +22,11 @@
 
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Container/ArrayPtr.h>
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/Mutex.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/PackageFile.h>
@@ -39,6 +43,8 @@
 using namespace Urho3D;
 
 static const unsigned COMPRESSED_BLOCK_SIZE = 32768;
+static const unsigned BATCH_DATA_SIZE = 64 * 1024 * 1024;
+static const unsigned CACHE_FORMAT_VERSION = 1;
 
 struct FileEntry
 {
@@ -46,6 +52,56 @@ struct FileEntry
     unsigned offset_;
     unsigned size_;
     unsigned checksum_;
+    unsigned long long hash_;
+};
+
+/// File read into memory for packaging.
+struct BatchFile
+{
+    /// Index of the file entry.
+    unsigned entryIndex_;
+    /// File contents.
+    SharedArrayPtr<unsigned char> data_;
+    /// Index of the first block in the batch's block list.
+    unsigned firstBlock_;
+    /// Number of blocks.
+    unsigned numBlocks_;
+    /// Index of an earlier file entry with identical contents, or M_MAX_UNSIGNED if unique.
+    unsigned duplicateOf_;
+    /// Read success flag.
+    bool success_;
+};
+
+/// Block of a file to be compressed.
+struct BatchBlock
+{
+    /// Uncompressed data.
+    const unsigned char* data_;
+    /// Uncompressed size.
+    unsigned size_;
+    /// Content hash of the uncompressed data.
+    unsigned long long hash_;
+    /// SDBM checksum of the uncompressed data, used to verify cache hits.
+    unsigned checksum_;
+    /// Data as written to the package. Blocks that do not compress are stored as is.
+    PODVector<unsigned char> packed_;
+    /// Whether the packed data came from the block cache.
+    bool cached_;
+    /// Compression success flag.
+    bool success_;
+};
+
+/// Location of a block in the block cache file.
+struct CachedBlock
+{
+    /// SDBM checksum of the uncompressed data.
+    unsigned checksum_;
+    /// Uncompressed size.
+    unsigned size_;
+    /// Packed size.
+    unsigned packedSize_;
+    /// Offset in the cache file.
+    unsigned offset_;
 };
 
 SharedPtr<Context> context_(new Context());
@@ -56,6 +112,15 @@ unsigned checksum_ = 0;
 bool compress_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
+int compressionLevel_ = LZ4HC_CLEVEL_DEFAULT;
+unsigned numThreads_ = GetNumLogicalCPUs();
+String cacheName_;
+SharedPtr<File> oldCache_;
+HashMap<unsigned long long, CachedBlock> oldCacheBlocks_;
+Mutex oldCacheMutex_;
+SharedPtr<File> newCache_;
+HashMap<unsigned long long, CachedBlock> newCacheBlocks_;
+String rootDir_;
 
 String ignoreExtensions_[] = {
     ".bak",
@@ -68,6 +133,10 @@ void Run(const Vector<String>& arguments);
 void ProcessFile(const String& fileName, const String& rootDir);
 void WritePackageFile(const String& fileName, const String& rootDir);
 void WriteHeader(File& dest);
+void OpenCache();
+void CloseCache();
+unsigned long long ContentHash(const unsigned char* data, unsigned size);
+unsigned SDBMHashMultiplier(unsigned size);
 
 int main(int argc, char** argv)
 {
@@ -90,8 +159,13 @@ void Run(const Vector<String>& arguments)
             "Usage: PackageTool <directory to process> <package name> [basepath] [options]\n"
             "\n"
             "Options:\n"
-            "-c      Enable package file LZ4 compression\n"
-            "-q      Enable quiet mode\n"
+            "-c[level] Enable package file LZ4 compression. Level 1-12 selects the LZ4-HC level (default 9),\n"
+            "          level 0 uses the faster but weaker LZ4 default compressor\n"
+            "-b<size>  Set compression block size in bytes (default 32768)\n"
+            "-C<file>  Reuse compressed blocks from a block cache file and update it afterward.\n"
+            "          Only blocks whose contents changed since the previous run are compressed\n"
+            "-j<num>   Set number of threads for reading and compressing files (default number of CPUs)\n"
+            "-q        Enable quiet mode\n"
             "\n"
             "Basepath is an optional prefix that will be added to the file entries.\n\n"
             "Alternative output usage: PackageTool <output option> <package name>\n"
@@ -118,6 +192,21 @@ void Run(const Vector<String>& arguments)
                     {
                     case 'c':
                         compress_ = true;
+                        if (arguments[i].Length() > 2)
+                            compressionLevel_ = Min(ToInt(arguments[i].Substring(2)), LZ4HC_CLEVEL_MAX);
+                        break;
+                    case 'b':
+                        blockSize_ = ToUInt(arguments[i].Substring(2));
+                        if (blockSize_ < MIN_COMPRESSED_BLOCK_SIZE || blockSize_ > MAX_COMPRESSED_BLOCK_SIZE)
+                            ErrorExit("Invalid compression block size");
+                        break;
+                    case 'C':
+                        cacheName_ = arguments[i].Substring(2);
+                        if (cacheName_.Empty())
+                            ErrorExit("Block cache file name missing");
+                        break;
+                    case 'j':
+                        numThreads_ = Max(ToUInt(arguments[i].Substring(2)), 1U);
                         break;
                     case 'q':
                         quiet_ = true;
@@ -172,6 +261,9 @@ void Run(const Vector<String>& arguments)
             PrintLine("Package size: " + String(packageFile->GetTotalSize()));
             PrintLine("Checksum: " + String(packageFile->GetChecksum()));
             PrintLine("Compressed: " + String(packageFile->IsCompressed() ? "yes" : "no"));
+            PrintLine("Format version: " + String(packageFile->GetFormatVersion()));
+            if (packageFile->GetBlockSize())
+                PrintLine("Block size: " + String(packageFile->GetBlockSize()));
             break;
         case 'L':
             if (!packageFile->IsCompressed())
@@ -181,17 +273,36 @@ void Run(const Vector<String>& arguments)
         case 'l':
             {
                 const HashMap<String, PackageEntry>& entries = packageFile->GetEntries();
-                for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End();)
+
+                // The compressed data of a file ends where the next file's data starts. Entries with identical contents share
+                // the same data, and neither they nor the data are in entry order, so take the sizes from the sorted offsets
+                HashMap<unsigned, unsigned> compressedSizes;
+                if (outputCompressionRatio)
+                {
+                    PODVector<unsigned> offsets;
+                    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+                        offsets.Push(i->second_.offset_);
+                    Sort(offsets.Begin(), offsets.End());
+
+                    unsigned dataEnd = packageFile->GetTotalSize() - sizeof(unsigned);
+                    for (unsigned i = offsets.Size(); i-- > 0;)
+                    {
+                        if (offsets[i] != dataEnd)
+                        {
+                            compressedSizes[offsets[i]] = dataEnd - offsets[i];
+                            dataEnd = offsets[i];
+                        }
+                    }
+                }
+
+                for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
                 {
-                    HashMap<String, PackageEntry>::ConstIterator current = i++;
-                    String fileEntry(current->first_);
+                    String fileEntry(i->first_);
                     if (outputCompressionRatio)
                     {
-                        unsigned compressedSize =
-                            (i == entries.End() ? packageFile->GetTotalSize() - sizeof(unsigned) : i->second_.offset_) -
-                            current->second_.offset_;
-                        fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", current->second_.size_, compressedSize,
-                            compressedSize ? 1.f * current->second_.size_ / compressedSize : 0.f);
+                        unsigned compressedSize = compressedSizes[i->second_.offset_];
+                        fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", i->second_.size_, compressedSize,
+                            compressedSize ? 1.f * i->second_.size_ / compressedSize : 0.f);
                     }
                     PrintLine(fileEntry);
                 }
@@ -217,9 +328,85 @@ void ProcessFile(const String& fileName, const String& rootDir)
     newEntry.offset_ = 0; // Offset not yet known
     newEntry.size_ = file.GetSize();
     newEntry.checksum_ = 0; // Will be calculated later
+    newEntry.hash_ = 0;
     entries_.Push(newEntry);
 }
 
+/// Functor for reading files into memory and calculating their checksums and content hashes.
+struct ReadFiles
+{
+    void operator ()(BatchFile* start, BatchFile* end, unsigned threadIndex)
+    {
+        for (BatchFile* i = start; i < end; ++i)
+        {
+            FileEntry& entry = entries_[i->entryIndex_];
+            File srcFile(context_, rootDir_ + "/" + entry.name_);
+            i->data_ = new unsigned char[entry.size_];
+            i->success_ = srcFile.IsOpen() && srcFile.Read(i->data_.Get(), entry.size_) == entry.size_;
+            if (!i->success_)
+                continue;
+
+            unsigned checksum = 0;
+            for (unsigned j = 0; j < entry.size_; ++j)
+                checksum = SDBMHash(checksum, i->data_[j]);
+            entry.checksum_ = checksum;
+            entry.hash_ = ContentHash(i->data_.Get(), entry.size_);
+        }
+    }
+};
+
+/// Functor for compressing blocks, or fetching them from the block cache if their contents have not changed.
+struct CompressBlocks
+{
+    void operator ()(BatchBlock* start, BatchBlock* end, unsigned threadIndex)
+    {
+        for (BatchBlock* i = start; i < end; ++i)
+        {
+            i->hash_ = ContentHash(i->data_, i->size_);
+            i->checksum_ = 0;
+            for (unsigned j = 0; j < i->size_; ++j)
+                i->checksum_ = SDBMHash(i->checksum_, i->data_[j]);
+
+            if (oldCache_)
+            {
+                HashMap<unsigned long long, CachedBlock>::ConstIterator cached = oldCacheBlocks_.Find(i->hash_);
+                if (cached != oldCacheBlocks_.End() && cached->second_.size_ == i->size_ &&
+                    cached->second_.checksum_ == i->checksum_)
+                {
+                    i->packed_.Resize(cached->second_.packedSize_);
+                    MutexLock lock(oldCacheMutex_);
+                    oldCache_->Seek(cached->second_.offset_);
+                    i->success_ = i->cached_ = oldCache_->Read(&i->packed_[0], i->packed_.Size()) == i->packed_.Size();
+                    if (i->success_)
+                        continue;
+                }
+            }
+
+            i->packed_.Resize((unsigned)LZ4_compressBound(i->size_));
+            int packedSize;
+            if (compressionLevel_ > 0)
+            {
+                packedSize = LZ4_compress_HC((const char*)i->data_, (char*)&i->packed_[0], i->size_, i->packed_.Size(),
+                    compressionLevel_);
+            }
+            else
+                packedSize = LZ4_compress_default((const char*)i->data_, (char*)&i->packed_[0], i->size_, i->packed_.Size());
+
+            i->success_ = packedSize > 0;
+            i->cached_ = false;
+
+            // Store incompressible blocks as is. The reader recognizes them by the packed size being equal to the unpacked size
+            if ((unsigned)packedSize < i->size_)
+                i->packed_.Resize((unsigned)packedSize);
+            else
+            {
+                i->packed_.Resize(i->size_);
+                memcpy(&i->packed_[0], i->data_, i->size_);
+            }
+        }
+    }
+};
+
 void WritePackageFile(const String& fileName, const String& rootDir)
 {
     if (!quiet_)
@@ -229,6 +416,16 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     if (!dest.Open(fileName, FILE_WRITE))
         ErrorExit("Could not open output file " + fileName);
 
+    rootDir_ = rootDir;
+
+    WorkQueue* queue = new WorkQueue(context_);
+    context_->RegisterSubsystem(queue);
+    if (numThreads_ > 1)
+        queue->CreateThreads(numThreads_ - 1);
+
+    if (compress_ && !cacheName_.Empty())
+        OpenCache();
+
     // Write ID, number of files & placeholder for checksum
     WriteHeader(dest);
 
@@ -242,70 +439,139 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     }
 
     unsigned totalDataSize = 0;
-    unsigned lastOffset;
-
-    // Write file data, calculate checksums & correct offsets
-    for (unsigned i = 0; i < entries_.Size(); ++i)
+    unsigned numDuplicates = 0;
+    unsigned duplicateDataSize = 0;
+    unsigned numCachedBlocks = 0;
+    unsigned numBlocks = 0;
+    HashMap<unsigned long long, unsigned> contentHashes;
+    Vector<BatchFile> files;
+    Vector<BatchBlock> blocks;
+    ReadFiles readFiles;
+    CompressBlocks compressBlocks;
+
+    // Process the files in batches to bound memory use. Within a batch, files are read and blocks compressed in parallel,
+    // then written in order
+    for (unsigned batchStart = 0; batchStart < entries_.Size();)
     {
-        lastOffset = entries_[i].offset_ = dest.GetSize();
-        String fileFullPath = rootDir + "/" + entries_[i].name_;
-
-        File srcFile(context_, fileFullPath);
-        if (!srcFile.IsOpen())
-            ErrorExit("Could not open file " + fileFullPath);
-
-        unsigned dataSize = entries_[i].size_;
-        totalDataSize += dataSize;
-        SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
-
-        if (srcFile.Read(&buffer[0], dataSize) != dataSize)
-            ErrorExit("Could not read file " + fileFullPath);
-        srcFile.Close();
+        unsigned batchEnd = batchStart;
+        unsigned batchDataSize = 0;
+        while (batchEnd < entries_.Size() && (batchEnd == batchStart || batchDataSize + entries_[batchEnd].size_ <= BATCH_DATA_SIZE))
+            batchDataSize += entries_[batchEnd++].size_;
 
-        for (unsigned j = 0; j < dataSize; ++j)
+        files.Resize(batchEnd - batchStart);
+        for (unsigned i = 0; i < files.Size(); ++i)
         {
-            checksum_ = SDBMHash(checksum_, buffer[j]);
-            entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
+            files[i].entryIndex_ = batchStart + i;
+            files[i].numBlocks_ = 0;
+            files[i].duplicateOf_ = M_MAX_UNSIGNED;
         }
 
-        if (!compress_)
+        queue->ParallelFor(files.Buffer(), files.Buffer() + files.Size(), 1, readFiles);
+
+        // Find files with identical contents, which are stored only once. Update the package checksum as if the data
+        // was hashed sequentially
+        blocks.Clear();
+        for (unsigned i = 0; i < files.Size(); ++i)
         {
-            if (!quiet_)
-                PrintLine(entries_[i].name_ + " size " + String(dataSize));
-            dest.Write(&buffer[0], entries_[i].size_);
+            FileEntry& entry = entries_[files[i].entryIndex_];
+            if (!files[i].success_)
+                ErrorExit("Could not read file " + rootDir + "/" + entry.name_);
+
+            checksum_ = checksum_ * SDBMHashMultiplier(entry.size_) + entry.checksum_;
+            totalDataSize += entry.size_;
+
+            HashMap<unsigned long long, unsigned>::ConstIterator j = contentHashes.Find(entry.hash_);
+            if (j != contentHashes.End() && entries_[j->second_].size_ == entry.size_ &&
+                entries_[j->second_].checksum_ == entry.checksum_)
+            {
+                files[i].duplicateOf_ = j->second_;
+                ++numDuplicates;
+                duplicateDataSize += entry.size_;
+                continue;
+            }
+            contentHashes[entry.hash_] = files[i].entryIndex_;
+
+            if (compress_)
+            {
+                files[i].firstBlock_ = blocks.Size();
+                files[i].numBlocks_ = (entry.size_ + blockSize_ - 1) / blockSize_;
+                blocks.Resize(blocks.Size() + files[i].numBlocks_);
+                for (unsigned k = 0; k < files[i].numBlocks_; ++k)
+                {
+                    BatchBlock& block = blocks[files[i].firstBlock_ + k];
+                    block.data_ = files[i].data_.Get() + k * blockSize_;
+                    block.size_ = Min(blockSize_, entry.size_ - k * blockSize_);
+                }
+            }
         }
-        else
+
+        queue->ParallelFor(blocks.Buffer(), blocks.Buffer() + blocks.Size(), 1, compressBlocks);
+
+        for (unsigned i = 0; i < files.Size(); ++i)
         {
-            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+            FileEntry& entry = entries_[files[i].entryIndex_];
+
+            if (files[i].duplicateOf_ != M_MAX_UNSIGNED)
+            {
+                entry.offset_ = entries_[files[i].duplicateOf_].offset_;
+                if (!quiet_)
+                    PrintLine(entry.name_ + " duplicate of " + entries_[files[i].duplicateOf_].name_);
+                continue;
+            }
+
+            entry.offset_ = dest.GetSize();
 
-            unsigned pos = 0;
+            if (!compress_)
+            {
+                if (!quiet_)
+                    PrintLine(entry.name_ + " size " + String(entry.size_));
+                dest.Write(files[i].data_.Get(), entry.size_);
+                continue;
+            }
 
-            while (pos < dataSize)
+            // The entry data begins with a table of block offsets relative to the entry, with one extra offset marking the
+            // end of the last block
+            unsigned blockOffset = (files[i].numBlocks_ + 1) * sizeof(unsigned);
+            for (unsigned j = 0; j < files[i].numBlocks_; ++j)
             {
-                unsigned unpackedSize = blockSize_;
-                if (pos + unpackedSize > dataSize)
-                    unpackedSize = dataSize - pos;
+                dest.WriteUInt(blockOffset);
+                blockOffset += blocks[files[i].firstBlock_ + j].packed_.Size();
+            }
+            dest.WriteUInt(blockOffset);
 
-                unsigned packedSize = (unsigned)LZ4_compress_HC((const char*)&buffer[pos], (char*)compressBuffer.Get(), unpackedSize, LZ4_compressBound(unpackedSize), 0);
-                if (!packedSize)
-                    ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + String(pos));
+            for (unsigned j = 0; j < files[i].numBlocks_; ++j)
+            {
+                BatchBlock& block = blocks[files[i].firstBlock_ + j];
+                if (!block.success_)
+                    ErrorExit("LZ4 compression failed for file " + entry.name_ + " at offset " + String(j * blockSize_));
 
-                dest.WriteUShort((unsigned short)unpackedSize);
-                dest.WriteUShort((unsigned short)packedSize);
-                dest.Write(compressBuffer.Get(), packedSize);
+                dest.Write(&block.packed_[0], block.packed_.Size());
+                ++numBlocks;
+                if (block.cached_)
+                    ++numCachedBlocks;
 
-                pos += unpackedSize;
+                if (newCache_ && !newCacheBlocks_.Contains(block.hash_))
+                {
+                    CachedBlock& cached = newCacheBlocks_[block.hash_];
+                    cached.checksum_ = block.checksum_;
+                    cached.size_ = block.size_;
+                    cached.packedSize_ = block.packed_.Size();
+                    cached.offset_ = newCache_->GetSize();
+                    newCache_->Write(&block.packed_[0], block.packed_.Size());
+                }
             }
 
             if (!quiet_)
             {
-                unsigned totalPackedBytes = dest.GetSize() - lastOffset;
-                String fileEntry(entries_[i].name_);
-                fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", dataSize, totalPackedBytes,
-                    totalPackedBytes ? 1.f * dataSize / totalPackedBytes : 0.f);
+                unsigned totalPackedBytes = dest.GetSize() - entry.offset_;
+                String fileEntry(entry.name_);
+                fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", entry.size_, totalPackedBytes,
+                    totalPackedBytes ? 1.f * entry.size_ / totalPackedBytes : 0.f);
                 PrintLine(fileEntry);
             }
         }
+
+        batchStart = batchEnd;
     }
 
     // Write package size to the end of file to allow finding it linked to an executable file
@@ -324,6 +590,8 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         dest.WriteUInt(entries_[i].checksum_);
     }
 
+    CloseCache();
+
     if (!quiet_)
     {
         PrintLine("Number of files: " + String(entries_.Size()));
@@ -331,15 +599,109 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         PrintLine("Package size: " + String(dest.GetSize()));
         PrintLine("Checksum: " + String(checksum_));
         PrintLine("Compressed: " + String(compress_ ? "yes" : "no"));
+        PrintLine("Duplicate files: " + String(numDuplicates) + " (" + String(duplicateDataSize) + " bytes)");
+        if (!cacheName_.Empty() && compress_)
+            PrintLine("Cached blocks: " + String(numCachedBlocks) + " of " + String(numBlocks));
     }
 }
 
 void WriteHeader(File& dest)
 {
-    if (!compress_)
-        dest.WriteFileID("UPAK");
-    else
-        dest.WriteFileID("ULZ4");
+    dest.WriteFileID("UPKG");
+    dest.WriteUInt(PACKAGE_FORMAT_VERSION);
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
+    dest.WriteUInt(compress_ ? blockSize_ : 0);
+}
+
+void OpenCache()
+{
+    // Read the index of a previous block cache if it exists and was made with the same settings
+    if (fileSystem_->FileExists(cacheName_))
+    {
+        oldCache_ = new File(context_, cacheName_);
+        if (oldCache_->IsOpen() && oldCache_->ReadFileID() == "UPKC" && oldCache_->ReadUInt() == CACHE_FORMAT_VERSION &&
+            oldCache_->ReadUInt() == blockSize_ && oldCache_->ReadInt() == compressionLevel_)
+        {
+            unsigned numBlocks = oldCache_->ReadUInt();
+            oldCache_->Seek(oldCache_->ReadUInt());
+            for (unsigned i = 0; i < numBlocks && !oldCache_->IsEof(); ++i)
+            {
+                unsigned long long hash = oldCache_->ReadUInt64();
+                CachedBlock& block = oldCacheBlocks_[hash];
+                block.checksum_ = oldCache_->ReadUInt();
+                block.size_ = oldCache_->ReadUInt();
+                block.packedSize_ = oldCache_->ReadUInt();
+                block.offset_ = oldCache_->ReadUInt();
+            }
+        }
+        else if (!quiet_)
+            PrintLine("Block cache " + cacheName_ + " was made with different settings, ignoring");
+
+        if (oldCacheBlocks_.Empty())
+            oldCache_.Reset();
+    }
+
+    // The new cache only holds the blocks of this package, so blocks of deleted or changed files do not accumulate
+    newCache_ = new File(context_);
+    if (!newCache_->Open(cacheName_ + ".new", FILE_WRITE))
+        ErrorExit("Could not open block cache file " + cacheName_ + ".new");
+    newCache_->WriteFileID("UPKC");
+    newCache_->WriteUInt(CACHE_FORMAT_VERSION);
+    newCache_->WriteUInt(blockSize_);
+    newCache_->WriteInt(compressionLevel_);
+    // Placeholder for number of blocks & index offset
+    newCache_->WriteUInt(0);
+    newCache_->WriteUInt(0);
+}
+
+void CloseCache()
+{
+    if (!newCache_)
+        return;
+
+    unsigned indexOffset = newCache_->GetSize();
+    for (HashMap<unsigned long long, CachedBlock>::ConstIterator i = newCacheBlocks_.Begin(); i != newCacheBlocks_.End(); ++i)
+    {
+        newCache_->WriteUInt64(i->first_);
+        newCache_->WriteUInt(i->second_.checksum_);
+        newCache_->WriteUInt(i->second_.size_);
+        newCache_->WriteUInt(i->second_.packedSize_);
+        newCache_->WriteUInt(i->second_.offset_);
+    }
+    newCache_->Seek(16);
+    newCache_->WriteUInt(newCacheBlocks_.Size());
+    newCache_->WriteUInt(indexOffset);
+    newCache_->Close();
+    newCache_.Reset();
+
+    oldCache_.Reset();
+    if (fileSystem_->FileExists(cacheName_))
+        fileSystem_->Delete(cacheName_);
+    if (!fileSystem_->Rename(cacheName_ + ".new", cacheName_))
+        ErrorExit("Could not replace block cache file " + cacheName_);
+}
+
+unsigned long long ContentHash(const unsigned char* data, unsigned size)
+{
+    // 64-bit FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    return hash;
+}
+
+unsigned SDBMHashMultiplier(unsigned size)
+{
+    // Appending size bytes to SDBM hashed data multiplies the previous hash by 65599^size
+    unsigned result = 1;
+    unsigned base = 65599;
+    while (size)
+    {
+        if (size & 1)
+            result *= base;
+        base *= base;
+        size >>= 1;
+    }
+    return result;
 }
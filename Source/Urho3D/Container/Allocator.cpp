@@ -20,103 +20,460 @@
 // THE SOFTWARE.
 //
 
+
 #include "../Precompiled.h"
 
+#include "../Container/Allocator.h"
+#include "../Container/Sort.h"
+#include "../Container/Vector.h"
+#include "../Core/Mutex.h"
+#include "../Math/MathDefs.h"
+
+#include <cstring>
+
+#if defined(URHO3D_THREADING) && !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 #include "../DebugNew.h"
 
+#ifdef URHO3D_THREADING
+#ifdef _MSC_VER
+#define URHO3D_THREAD_LOCAL __declspec(thread)
+#else
+#define URHO3D_THREAD_LOCAL __thread
+#endif
+#else
+#define URHO3D_THREAD_LOCAL
+#endif
+
 namespace Urho3D
 {
 
-AllocatorBlock* AllocatorReserveBlock(AllocatorBlock* allocator, unsigned nodeSize, unsigned capacity)
+/// Size class granularity. Also the alignment of pooled allocations.
+static const unsigned SIZE_CLASS_GRANULARITY = 16;
+/// Number of size classes.
+static const unsigned NUM_SIZE_CLASSES = MAX_POOLED_ALLOCATION_SIZE / SIZE_CLASS_GRANULARITY;
+/// Size of the memory blocks that are divided into allocations of one size class.
+static const unsigned SLAB_SIZE = 64 * 1024;
+/// Size reserved for the header at the start of a slab. Keeps the allocations aligned to the size class granularity.
+static const unsigned SLAB_HEADER_SIZE = 16;
+/// Number of free allocations moved between a thread cache and the shared pool at once.
+static const unsigned TRANSFER_BATCH_SIZE = 32;
+/// Number of large allocations and frees after which a thread publishes its counters.
+static const unsigned PUBLISH_INTERVAL = 64;
+
+/// Free allocation in a free list.
+struct FreeNode
+{
+    /// Next free allocation.
+    FreeNode* next_;
+};
+
+/// Header at the start of a slab.
+struct SlabHeader
+{
+    /// Next slab of the same size class.
+    SlabHeader* next_;
+    /// Number of allocations carved from the slab so far.
+    unsigned numCarved_;
+    /// Number of the carved allocations found in the shared free list. Only valid while trimming.
+    unsigned numFree_;
+};
+
+/// Allocation counters. Threads count the allocations they make and free, which may differ when memory is freed by another
+/// thread, so the counters use unsigned wraparound arithmetic and only the sum over all threads is meaningful.
+struct AllocatorCounters
+{
+    /// Allocations made minus allocations freed.
+    unsigned long long numInUse_[NUM_SIZE_CLASSES];
+    /// Pooled bytes requested minus bytes freed.
+    unsigned long long bytesRequested_;
+    /// Large allocation bytes allocated minus bytes freed.
+    unsigned long long bytesLarge_;
+};
+
+/// Per-thread cache of free allocations.
+struct ThreadCache
+{
+    /// Free lists.
+    FreeNode* free_[NUM_SIZE_CLASSES];
+    /// Free list lengths.
+    unsigned numFree_[NUM_SIZE_CLASSES];
+    /// Counters not yet published to the shared pool. Only accessed by the owning thread.
+    AllocatorCounters counters_;
+    /// Large allocations and frees since the counters were last published.
+    unsigned numUnpublished_;
+};
+
+/// Pool shared by all threads.
+struct SharedPool
 {
-    if (!capacity)
-        capacity = 1;
+    /// Mutex for the shared free lists, the slabs and the published counters.
+    Mutex mutex_;
+    /// Free lists.
+    FreeNode* free_[NUM_SIZE_CLASSES];
+    /// Slabs of each size class, latest first.
+    SlabHeader* slabs_[NUM_SIZE_CLASSES];
+    /// Unused part of the latest slab of each size class.
+    unsigned char* slab_[NUM_SIZE_CLASSES];
+    /// Bytes left in the latest slab of each size class.
+    unsigned slabLeft_[NUM_SIZE_CLASSES];
+    /// Total slab memory.
+    unsigned long long bytesReserved_;
+    /// Counters published by all threads.
+    AllocatorCounters counters_;
+};
 
-    unsigned char* blockPtr = new unsigned char[sizeof(AllocatorBlock) + capacity * (sizeof(AllocatorNode) + nodeSize)];
-    AllocatorBlock* newBlock = reinterpret_cast<AllocatorBlock*>(blockPtr);
-    newBlock->nodeSize_ = nodeSize;
-    newBlock->capacity_ = capacity;
-    newBlock->free_ = 0;
-    newBlock->next_ = 0;
+static URHO3D_THREAD_LOCAL ThreadCache* threadCache = 0;
 
-    if (!allocator)
-        allocator = newBlock;
-    else
+static void ReleaseThreadCache(ThreadCache* cache);
+
+#if defined(URHO3D_THREADING) && !defined(_WIN32)
+/// Thread-specific key whose destructor releases the cache of any thread that exits, including threads not created by Urho3D.
+static pthread_key_t threadCacheKey;
+/// Once flag for creating the key.
+static pthread_once_t threadCacheKeyOnce = PTHREAD_ONCE_INIT;
+
+static void DestroyThreadCache(void* cache)
+{
+    threadCache = 0;
+    ReleaseThreadCache(static_cast<ThreadCache*>(cache));
+}
+
+static void CreateThreadCacheKey()
+{
+    pthread_key_create(&threadCacheKey, DestroyThreadCache);
+}
+#endif
+
+static SharedPool& GetSharedPool()
+{
+    // Created on first use, which happens during static initialization in the main thread. Intentionally never destroyed,
+    // so that objects destroyed at exit can still free their memory
+    static SharedPool* pool = 0;
+    if (!pool)
     {
-        newBlock->next_ = allocator->next_;
-        allocator->next_ = newBlock;
+        pool = new SharedPool();
+        memset(pool->free_, 0, sizeof pool->free_);
+        memset(pool->slabs_, 0, sizeof pool->slabs_);
+        memset(pool->slab_, 0, sizeof pool->slab_);
+        memset(pool->slabLeft_, 0, sizeof pool->slabLeft_);
+        pool->bytesReserved_ = 0;
+        memset(&pool->counters_, 0, sizeof pool->counters_);
     }
+    return *pool;
+}
 
-    // Initialize the nodes. Free nodes are always chained to the first (parent) allocator
-    unsigned char* nodePtr = blockPtr + sizeof(AllocatorBlock);
-    AllocatorNode* firstNewNode = reinterpret_cast<AllocatorNode*>(nodePtr);
+static ThreadCache* CreateThreadCache()
+{
+    ThreadCache* cache = new ThreadCache();
+    memset(cache, 0, sizeof(ThreadCache));
+#if defined(URHO3D_THREADING) && !defined(_WIN32)
+    pthread_once(&threadCacheKeyOnce, CreateThreadCacheKey);
+    pthread_setspecific(threadCacheKey, cache);
+#endif
+    return cache;
+}
 
-    for (unsigned i = 0; i < capacity - 1; ++i)
+/// Add the thread's unpublished counters to the shared pool's counters and reset them. The pool mutex must be held.
+static void PublishCounters(ThreadCache* cache, SharedPool& pool)
+{
+    for (unsigned i = 0; i < NUM_SIZE_CLASSES; ++i)
+        pool.counters_.numInUse_[i] += cache->counters_.numInUse_[i];
+    pool.counters_.bytesRequested_ += cache->counters_.bytesRequested_;
+    pool.counters_.bytesLarge_ += cache->counters_.bytesLarge_;
+    memset(&cache->counters_, 0, sizeof cache->counters_);
+    cache->numUnpublished_ = 0;
+}
+
+/// Publish the counters after a large allocation or free, if enough have accumulated.
+static void PublishCountersPeriodically(ThreadCache* cache)
+{
+    if (++cache->numUnpublished_ < PUBLISH_INTERVAL)
+        return;
+
+    SharedPool& pool = GetSharedPool();
+    MutexLock lock(pool.mutex_);
+    PublishCounters(cache, pool);
+}
+
+static void RefillThreadCache(ThreadCache* cache, unsigned sizeClass)
+{
+    SharedPool& pool = GetSharedPool();
+    unsigned size = (sizeClass + 1) * SIZE_CLASS_GRANULARITY;
+    FreeNode* head = cache->free_[sizeClass];
+    unsigned count = 0;
+
+    MutexLock lock(pool.mutex_);
+    PublishCounters(cache, pool);
+
+    while (count < TRANSFER_BATCH_SIZE && pool.free_[sizeClass])
     {
-        AllocatorNode* newNode = reinterpret_cast<AllocatorNode*>(nodePtr);
-        newNode->next_ = reinterpret_cast<AllocatorNode*>(nodePtr + sizeof(AllocatorNode) + nodeSize);
-        nodePtr += sizeof(AllocatorNode) + nodeSize;
+        FreeNode* node = pool.free_[sizeClass];
+        pool.free_[sizeClass] = node->next_;
+        node->next_ = head;
+        head = node;
+        ++count;
     }
-    // i == capacity - 1
+
+    while (count < TRANSFER_BATCH_SIZE)
     {
-        AllocatorNode* newNode = reinterpret_cast<AllocatorNode*>(nodePtr);
-        newNode->next_ = 0;
+        if (pool.slabLeft_[sizeClass] < size)
+        {
+            // The remainder of the previous slab, if any, is smaller than the size class and is left unused
+            SlabHeader* slab = reinterpret_cast<SlabHeader*>(new unsigned char[SLAB_SIZE]);
+            slab->next_ = pool.slabs_[sizeClass];
+            slab->numCarved_ = 0;
+            pool.slabs_[sizeClass] = slab;
+            pool.slab_[sizeClass] = reinterpret_cast<unsigned char*>(slab) + SLAB_HEADER_SIZE;
+            pool.slabLeft_[sizeClass] = SLAB_SIZE - SLAB_HEADER_SIZE;
+            pool.bytesReserved_ += SLAB_SIZE;
+        }
+
+        FreeNode* node = reinterpret_cast<FreeNode*>(pool.slab_[sizeClass]);
+        pool.slab_[sizeClass] += size;
+        pool.slabLeft_[sizeClass] -= size;
+        ++pool.slabs_[sizeClass]->numCarved_;
+        node->next_ = head;
+        head = node;
+        ++count;
     }
 
-    allocator->free_ = firstNewNode;
+    cache->free_[sizeClass] = head;
+    cache->numFree_[sizeClass] += count;
+}
+
+static void ReleaseFreeNodes(ThreadCache* cache, unsigned sizeClass, unsigned count)
+{
+    SharedPool& pool = GetSharedPool();
+    MutexLock lock(pool.mutex_);
+    PublishCounters(cache, pool);
 
-    return newBlock;
+    while (count--)
+    {
+        FreeNode* node = cache->free_[sizeClass];
+        cache->free_[sizeClass] = node->next_;
+        --cache->numFree_[sizeClass];
+        node->next_ = pool.free_[sizeClass];
+        pool.free_[sizeClass] = node;
+    }
 }
 
-AllocatorBlock* AllocatorInitialize(unsigned nodeSize, unsigned initialCapacity)
+static void ReleaseThreadCache(ThreadCache* cache)
 {
-    AllocatorBlock* block = AllocatorReserveBlock(0, nodeSize, initialCapacity);
-    return block;
+    for (unsigned i = 0; i < NUM_SIZE_CLASSES; ++i)
+        ReleaseFreeNodes(cache, i, cache->numFree_[i]);
+
+    SharedPool& pool = GetSharedPool();
+    {
+        MutexLock lock(pool.mutex_);
+        PublishCounters(cache, pool);
+    }
+
+    delete cache;
 }
 
-void AllocatorUninitialize(AllocatorBlock* allocator)
+/// Return the slab containing an allocation, given the size class's slabs sorted by address.
+static SlabHeader* FindSlab(const PODVector<SlabHeader*>& slabs, void* ptr)
 {
-    while (allocator)
+    unsigned first = 0;
+    unsigned last = slabs.Size();
+    while (last - first > 1)
     {
-        AllocatorBlock* next = allocator->next_;
-        delete[] reinterpret_cast<unsigned char*>(allocator);
-        allocator = next;
+        unsigned middle = (first + last) / 2;
+        if (static_cast<void*>(slabs[middle]) <= ptr)
+            first = middle;
+        else
+            last = middle;
     }
+    return slabs[first];
 }
 
-void* AllocatorReserve(AllocatorBlock* allocator)
+/// Return the slabs of a size class whose allocations are all in the shared free list to the heap. The pool mutex must be held.
+static void TrimSizeClass(SharedPool& pool, unsigned sizeClass, PODVector<SlabHeader*>& slabs)
 {
-    if (!allocator)
-        return 0;
+    slabs.Clear();
+    for (SlabHeader* slab = pool.slabs_[sizeClass]; slab; slab = slab->next_)
+    {
+        slab->numFree_ = 0;
+        slabs.Push(slab);
+    }
+    if (slabs.Empty())
+        return;
+
+    Sort(slabs.Begin(), slabs.End());
+    for (FreeNode* node = pool.free_[sizeClass]; node; node = node->next_)
+        ++FindSlab(slabs, node)->numFree_;
 
-    if (!allocator->free_)
+    // A slab can be returned when all of its carved allocations are in the free list. Drop those from the free list first
+    FreeNode** link = &pool.free_[sizeClass];
+    while (*link)
     {
-        // Free nodes have been exhausted. Allocate a new larger block
-        unsigned newCapacity = (allocator->capacity_ + 1) >> 1;
-        AllocatorReserveBlock(allocator, allocator->nodeSize_, newCapacity);
-        allocator->capacity_ += newCapacity;
+        SlabHeader* slab = FindSlab(slabs, *link);
+        if (slab->numFree_ >= slab->numCarved_)
+            *link = (*link)->next_;
+        else
+            link = &(*link)->next_;
     }
 
-    // We should have new free node(s) chained
-    AllocatorNode* freeNode = allocator->free_;
-    void* ptr = (reinterpret_cast<unsigned char*>(freeNode)) + sizeof(AllocatorNode);
-    allocator->free_ = freeNode->next_;
-    freeNode->next_ = 0;
+    SlabHeader** slabLink = &pool.slabs_[sizeClass];
+    while (*slabLink)
+    {
+        SlabHeader* slab = *slabLink;
+        if (slab->numFree_ >= slab->numCarved_)
+        {
+            // If the slab being carved is returned, the next refill starts a new one
+            if (slab == pool.slabs_[sizeClass])
+            {
+                pool.slab_[sizeClass] = 0;
+                pool.slabLeft_[sizeClass] = 0;
+            }
+            *slabLink = slab->next_;
+            delete[] reinterpret_cast<unsigned char*>(slab);
+            pool.bytesReserved_ -= SLAB_SIZE;
+        }
+        else
+            slabLink = &slab->next_;
+    }
+}
+
+void* AllocatorAllocate(unsigned size)
+{
+    ThreadCache* cache = threadCache;
+    if (!cache)
+        cache = threadCache = CreateThreadCache();
 
-    return ptr;
+    if (size > MAX_POOLED_ALLOCATION_SIZE)
+    {
+        cache->counters_.bytesLarge_ += size;
+        PublishCountersPeriodically(cache);
+        return new unsigned char[size];
+    }
+
+    unsigned sizeClass = size ? (size - 1) / SIZE_CLASS_GRANULARITY : 0;
+    if (!cache->free_[sizeClass])
+        RefillThreadCache(cache, sizeClass);
+
+    FreeNode* node = cache->free_[sizeClass];
+    cache->free_[sizeClass] = node->next_;
+    --cache->numFree_[sizeClass];
+    ++cache->counters_.numInUse_[sizeClass];
+    cache->counters_.bytesRequested_ += size;
+    return node;
 }
 
-void AllocatorFree(AllocatorBlock* allocator, void* ptr)
+void AllocatorFree(void* ptr, unsigned size)
+{
+    if (!ptr)
+        return;
+
+    // Memory freed by another thread than the allocating one simply goes to the freeing thread's cache
+    ThreadCache* cache = threadCache;
+    if (!cache)
+        cache = threadCache = CreateThreadCache();
+
+    if (size > MAX_POOLED_ALLOCATION_SIZE)
+    {
+        cache->counters_.bytesLarge_ -= size;
+        PublishCountersPeriodically(cache);
+        delete[] static_cast<unsigned char*>(ptr);
+        return;
+    }
+
+    unsigned sizeClass = size ? (size - 1) / SIZE_CLASS_GRANULARITY : 0;
+    FreeNode* node = static_cast<FreeNode*>(ptr);
+    node->next_ = cache->free_[sizeClass];
+    cache->free_[sizeClass] = node;
+    ++cache->numFree_[sizeClass];
+    --cache->counters_.numInUse_[sizeClass];
+    cache->counters_.bytesRequested_ -= size;
+
+    // Keep a thread that mostly frees from hoarding memory
+    if (cache->numFree_[sizeClass] >= 2 * TRANSFER_BATCH_SIZE)
+        ReleaseFreeNodes(cache, sizeClass, TRANSFER_BATCH_SIZE);
+}
+
+void AllocatorReleaseThreadCache()
 {
-    if (!allocator || !ptr)
+    ThreadCache* cache = threadCache;
+    if (!cache)
         return;
 
-    unsigned char* dataPtr = static_cast<unsigned char*>(ptr);
-    AllocatorNode* node = reinterpret_cast<AllocatorNode*>(dataPtr - sizeof(AllocatorNode));
+    threadCache = 0;
+#if defined(URHO3D_THREADING) && !defined(_WIN32)
+    pthread_setspecific(threadCacheKey, 0);
+#endif
+    ReleaseThreadCache(cache);
+}
+
+void AllocatorTrim()
+{
+    // Flush the calling thread's cache, but keep the cache itself, as the thread is likely to allocate again
+    ThreadCache* cache = threadCache;
+    if (cache)
+    {
+        for (unsigned i = 0; i < NUM_SIZE_CLASSES; ++i)
+            ReleaseFreeNodes(cache, i, cache->numFree_[i]);
+    }
+
+    SharedPool& pool = GetSharedPool();
+    PODVector<SlabHeader*> slabs;
+    MutexLock lock(pool.mutex_);
+    if (cache)
+        PublishCounters(cache, pool);
+
+    for (unsigned i = 0; i < NUM_SIZE_CLASSES; ++i)
+        TrimSizeClass(pool, i, slabs);
+}
+
+AllocatorBlock* AllocatorInitialize(unsigned nodeSize, unsigned initialCapacity)
+{
+    AllocatorBlock* allocator = new AllocatorBlock();
+    allocator->nodeSize_ = nodeSize;
+    allocator->capacity_ = initialCapacity;
+    return allocator;
+}
+
+void AllocatorUninitialize(AllocatorBlock* allocator)
+{
+    delete allocator;
+}
+
+void* AllocatorReserve(AllocatorBlock* allocator)
+{
+    return allocator ? AllocatorAllocate(allocator->nodeSize_) : 0;
+}
+
+void AllocatorFree(AllocatorBlock* allocator, void* ptr)
+{
+    if (allocator)
+        AllocatorFree(ptr, allocator->nodeSize_);
+}
+
+AllocatorStats GetAllocatorStats()
+{
+    AllocatorStats stats;
+    SharedPool& pool = GetSharedPool();
+    MutexLock lock(pool.mutex_);
+
+    // Other threads' counters are only read once they have published them under the lock. The calling thread's own
+    // counters are published first, so that its recent allocations are always up to date
+    ThreadCache* cache = threadCache;
+    if (cache)
+        PublishCounters(cache, pool);
+
+    stats.bytesReserved_ = pool.bytesReserved_;
+
+    // Unpublished frees of another thread can make a sum temporarily negative, so clamp to zero
+    unsigned long long bytesInUse = 0;
+    for (unsigned i = 0; i < NUM_SIZE_CLASSES; ++i)
+        bytesInUse += pool.counters_.numInUse_[i] * ((i + 1) * SIZE_CLASS_GRANULARITY);
 
-    // Chain the node back to free nodes
-    node->next_ = allocator->free_;
-    allocator->free_ = node;
+    stats.bytesInUse_ = (long long)bytesInUse > 0 ? bytesInUse : 0;
+    stats.bytesRequested_ = (long long)pool.counters_.bytesRequested_ > 0 ? pool.counters_.bytesRequested_ : 0;
+    stats.bytesLarge_ = (long long)pool.counters_.bytesLarge_ > 0 ? pool.counters_.bytesLarge_ : 0;
+    return stats;
 }
 
 }
@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+
 #pragma once
 
 #ifdef URHO3D_IS_BUILDING
@@ -33,64 +34,95 @@
 namespace Urho3D
 {
 
-struct AllocatorBlock;
-struct AllocatorNode;
+/// Largest allocation size served from the size-class pool. Larger allocations go to the heap.
+static const unsigned MAX_POOLED_ALLOCATION_SIZE = 256;
 
-/// %Allocator memory block.
+/// Size-class pool statistics.
+struct URHO3D_API AllocatorStats
+{
+    /// Construct.
+    AllocatorStats() :
+        bytesReserved_(0),
+        bytesInUse_(0),
+        bytesRequested_(0),
+        bytesLarge_(0)
+    {
+    }
+
+    /// Return the fraction of reserved pool memory that is not in use.
+    float GetFreeFraction() const { return bytesReserved_ ? 1.0f - (float)bytesInUse_ / (float)bytesReserved_ : 0.0f; }
+    /// Return the fraction of in-use pool memory lost to rounding up to the size class.
+    float GetRoundingWaste() const { return bytesInUse_ ? 1.0f - (float)bytesRequested_ / (float)bytesInUse_ : 0.0f; }
+
+    /// Memory reserved from the heap for pooled allocations.
+    unsigned long long bytesReserved_;
+    /// Pooled memory handed out to callers, rounded up to the size classes.
+    unsigned long long bytesInUse_;
+    /// Pooled memory requested by callers.
+    unsigned long long bytesRequested_;
+    /// Memory in use by allocations that were too large for the pool.
+    unsigned long long bytesLarge_;
+};
+
+/// Fixed-size allocator of the node allocator API. Its nodes are allocated from the size-class pool.
 struct AllocatorBlock
 {
     /// Size of a node.
     unsigned nodeSize_;
-    /// Number of nodes in this block.
+    /// Initial capacity given on initialization. Only a hint, as the pool reserves memory in slabs shared by all allocators.
     unsigned capacity_;
-    /// First free node.
-    AllocatorNode* free_;
-    /// Next allocator block.
-    AllocatorBlock* next_;
-    /// Nodes follow.
 };
 
-/// %Allocator node.
-struct AllocatorNode
-{
-    /// Next free node.
-    AllocatorNode* next_;
-    /// Data follows.
-};
+/// Allocate memory from the shared size-class pool. Thread-safe. Each thread keeps a cache of free blocks, so that most allocations need no locking.
+URHO3D_API void* AllocatorAllocate(unsigned size);
+/// Free memory allocated with AllocatorAllocate(). The size must be the same as when allocating. Can be called from any thread.
+URHO3D_API void AllocatorFree(void* ptr, unsigned size);
+/// Return the calling thread's cached free blocks to the shared pool and delete the cache. Called automatically when a Thread exits, and on other platforms than Windows also when any other thread exits.
+URHO3D_API void AllocatorReleaseThreadCache();
+/// Return the calling thread's cached free blocks to the shared pool, then return the slabs whose blocks are all free to the heap. Blocks cached by other threads keep their slabs reserved. Called by the Engine on destruction; call also for example after unloading a large scene.
+URHO3D_API void AllocatorTrim();
+/// Return pool statistics. Threads publish their counters whenever they exchange blocks with the shared pool and after every 64 large allocations or frees, so the counters of threads other than the caller may be slightly out of date.
+URHO3D_API AllocatorStats GetAllocatorStats();
 
 /// Initialize a fixed-size allocator with the node size and initial capacity.
 URHO3D_API AllocatorBlock* AllocatorInitialize(unsigned nodeSize, unsigned initialCapacity = 1);
-/// Uninitialize a fixed-size allocator. Frees all blocks in the chain.
+/// Uninitialize a fixed-size allocator. Nodes which have not been freed stay allocated from the pool.
 URHO3D_API void AllocatorUninitialize(AllocatorBlock* allocator);
-/// Reserve a node. Creates a new block if necessary.
+/// Reserve a node.
 URHO3D_API void* AllocatorReserve(AllocatorBlock* allocator);
-/// Free a node. Does not free any blocks.
+/// Free a node.
 URHO3D_API void AllocatorFree(AllocatorBlock* allocator, void* ptr);
 
-/// %Allocator template class. Allocates objects of a specific class.
+/// Declare class-specific new and delete operators which use the size-class pool.
+#define URHO3D_POOL_ALLOCATED \
+    static void* operator new(size_t size) { return Urho3D::AllocatorAllocate((unsigned)size); } \
+    static void operator delete(void* ptr, size_t size) { Urho3D::AllocatorFree(ptr, (unsigned)size); } \
+    static void* operator new(size_t, void* place) { return place; } \
+    static void operator delete(void*, void*) { } \
+    URHO3D_POOL_ALLOCATED_DEBUG
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+// Placement form used by DebugNew.h. Urho3D does not use exceptions, so the matching delete is never called
+#define URHO3D_POOL_ALLOCATED_DEBUG \
+    static void* operator new(size_t size, int, const char*, int) { return Urho3D::AllocatorAllocate((unsigned)size); } \
+    static void operator delete(void*, int, const char*, int) { }
+#else
+#define URHO3D_POOL_ALLOCATED_DEBUG
+#endif
+
+/// %Allocator template class. Allocates objects of a specific class from the size-class pool.
 template <class T> class Allocator
 {
 public:
-    /// Construct.
-    Allocator(unsigned initialCapacity = 0) :
-        allocator_(0)
+    /// Construct. The initial capacity is ignored, as the pool reserves memory in slabs shared by all allocators.
+    Allocator(unsigned initialCapacity = 0)
     {
-        if (initialCapacity)
-            allocator_ = AllocatorInitialize((unsigned)sizeof(T), initialCapacity);
-    }
-
-    /// Destruct.
-    ~Allocator()
-    {
-        AllocatorUninitialize(allocator_);
     }
 
     /// Reserve and default-construct an object.
     T* Reserve()
     {
-        if (!allocator_)
-            allocator_ = AllocatorInitialize((unsigned)sizeof(T));
-        T* newObject = static_cast<T*>(AllocatorReserve(allocator_));
+        T* newObject = static_cast<T*>(AllocatorAllocate((unsigned)sizeof(T)));
         new(newObject) T();
 
         return newObject;
@@ -99,9 +131,7 @@ public:
     /// Reserve and copy-construct an object.
     T* Reserve(const T& object)
     {
-        if (!allocator_)
-            allocator_ = AllocatorInitialize((unsigned)sizeof(T));
-        T* newObject = static_cast<T*>(AllocatorReserve(allocator_));
+        T* newObject = static_cast<T*>(AllocatorAllocate((unsigned)sizeof(T)));
         new(newObject) T(object);
 
         return newObject;
@@ -111,7 +141,7 @@ public:
     void Free(T* object)
     {
         (object)->~T();
-        AllocatorFree(allocator_, object);
+        AllocatorFree(object, (unsigned)sizeof(T));
     }
 
 private:
@@ -119,9 +149,6 @@ private:
     Allocator(const Allocator<T>& rhs);
     /// Prevent assignment.
     Allocator<T>& operator =(const Allocator<T>& rhs);
-
-    /// Allocator block.
-    AllocatorBlock* allocator_;
 };
 
 }
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/FlatHashBase.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+void FlatHashBase::AllocateBuckets(unsigned capacity)
+{
+    delete[] buckets_;
+
+    // Keep the load factor at or below 0.5 so that probe sequences stay short
+    unsigned numBuckets = MIN_CAPACITY * 2;
+    shift_ = 28;
+    while (numBuckets < capacity * 2)
+    {
+        numBuckets <<= 1;
+        --shift_;
+    }
+
+    buckets_ = new FlatHashBucket[numBuckets];
+    numBuckets_ = numBuckets;
+    ResetBuckets();
+}
+
+void FlatHashBase::ResetBuckets()
+{
+    for (unsigned i = 0; i < numBuckets_; ++i)
+        buckets_[i].index_ = EMPTY_BUCKET;
+}
+
+void FlatHashBase::InsertBucket(unsigned hash, unsigned index)
+{
+    unsigned mask = numBuckets_ - 1;
+    unsigned bucket = HomeBucket(hash);
+    unsigned distance = 0;
+    FlatHashBucket entry;
+    entry.hash_ = hash;
+    entry.index_ = index;
+
+    for (;;)
+    {
+        FlatHashBucket& current = buckets_[bucket];
+        if (current.index_ == EMPTY_BUCKET)
+        {
+            current = entry;
+            return;
+        }
+
+        // Robin Hood: take the slot from an entry that is closer to its ideal bucket, and continue inserting that one
+        unsigned currentDistance = ProbeDistance(bucket);
+        if (currentDistance < distance)
+        {
+            Urho3D::Swap(entry, current);
+            distance = currentDistance;
+        }
+
+        bucket = (bucket + 1) & mask;
+        ++distance;
+    }
+}
+
+void FlatHashBase::EraseBucket(unsigned bucket)
+{
+    unsigned mask = numBuckets_ - 1;
+    unsigned next = (bucket + 1) & mask;
+
+    while (buckets_[next].index_ != EMPTY_BUCKET && ProbeDistance(next) != 0)
+    {
+        buckets_[bucket] = buckets_[next];
+        bucket = next;
+        next = (next + 1) & mask;
+    }
+
+    buckets_[bucket].index_ = EMPTY_BUCKET;
+}
+
+void FlatHashBase::ReindexBucket(unsigned hash, unsigned oldIndex, unsigned newIndex)
+{
+    unsigned mask = numBuckets_ - 1;
+    unsigned bucket = HomeBucket(hash);
+
+    while (buckets_[bucket].index_ != oldIndex)
+        bucket = (bucket + 1) & mask;
+
+    buckets_[bucket].index_ = newIndex;
+}
+
+}
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#ifdef URHO3D_IS_BUILDING
+#include "Urho3D.h"
+#else
+#include <Urho3D/Urho3D.h>
+#endif
+
+#include "../Container/Hash.h"
+#include "../Container/Swap.h"
+
+namespace Urho3D
+{
+
+/// Flat hash set/map index bucket.
+struct FlatHashBucket
+{
+    /// Key hash.
+    unsigned hash_;
+    /// Index of the element in the element array, or FlatHashBase::EMPTY_BUCKET.
+    unsigned index_;
+};
+
+/// Flat hash set/map base class. Elements are stored contiguously; an open addressing index with Robin Hood linear probing maps hashes to them.
+class URHO3D_API FlatHashBase
+{
+public:
+    /// Index value of an empty bucket.
+    static const unsigned EMPTY_BUCKET = 0xffffffff;
+    /// Initial element capacity.
+    static const unsigned MIN_CAPACITY = 8;
+
+    /// Construct.
+    FlatHashBase() :
+        elements_(0),
+        buckets_(0),
+        size_(0),
+        capacity_(0),
+        numBuckets_(0),
+        shift_(0)
+    {
+    }
+
+    /// Swap with another flat hash set or map.
+    void Swap(FlatHashBase& rhs)
+    {
+        Urho3D::Swap(elements_, rhs.elements_);
+        Urho3D::Swap(buckets_, rhs.buckets_);
+        Urho3D::Swap(size_, rhs.size_);
+        Urho3D::Swap(capacity_, rhs.capacity_);
+        Urho3D::Swap(numBuckets_, rhs.numBuckets_);
+        Urho3D::Swap(shift_, rhs.shift_);
+    }
+
+    /// Return number of elements.
+    unsigned Size() const { return size_; }
+
+    /// Return number of elements that fit without reallocation.
+    unsigned Capacity() const { return capacity_; }
+
+    /// Return number of index buckets.
+    unsigned NumBuckets() const { return numBuckets_; }
+
+    /// Return whether has no elements.
+    bool Empty() const { return size_ == 0; }
+
+protected:
+    /// Return the ideal bucket for a hash. Fibonacci hashing spreads sequential IDs and aligned pointers over the whole index.
+    unsigned HomeBucket(unsigned hash) const { return (hash * 2654435769u) >> shift_; }
+
+    /// Return how far a bucket's entry is from its ideal bucket.
+    unsigned ProbeDistance(unsigned bucket) const { return (bucket - HomeBucket(buckets_[bucket].hash_)) & (numBuckets_ - 1); }
+
+    /// Allocate an empty index large enough for the element capacity.
+    void AllocateBuckets(unsigned capacity);
+    /// Mark all index buckets empty.
+    void ResetBuckets();
+    /// Add an element to the index. The element's key must not exist yet.
+    void InsertBucket(unsigned hash, unsigned index);
+    /// Remove an index bucket and shift the following displaced entries back.
+    void EraseBucket(unsigned bucket);
+    /// Change the element index an index entry refers to, after an element was moved.
+    void ReindexBucket(unsigned hash, unsigned oldIndex, unsigned newIndex);
+
+    /// Element storage.
+    unsigned char* elements_;
+    /// Index buckets.
+    FlatHashBucket* buckets_;
+    /// Number of elements.
+    unsigned size_;
+    /// Element capacity.
+    unsigned capacity_;
+    /// Number of index buckets, always a power of two.
+    unsigned numBuckets_;
+    /// Shift to get the home bucket from a multiplied hash.
+    unsigned shift_;
+};
+
+}
@@ -0,0 +1,411 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Pair.h"
+#include "../Container/Vector.h"
+
+#include <new>
+
+namespace Urho3D
+{
+
+/// Flat hash map template class. Has the same interface as HashMap, but stores the key-value pairs contiguously without per-pair allocation, which makes lookup and iteration cache friendly. Erasing moves the last pair into the erased position, so iteration order is not preserved and erasing or inserting invalidates iterators and pointers to values; use the iterator returned by Erase() when erasing during iteration.
+template <class T, class U> class FlatHashMap : public FlatHashBase
+{
+public:
+    typedef T KeyType;
+    typedef U ValueType;
+
+    /// Flat hash map key-value pair with const key.
+    class KeyValue
+    {
+    public:
+        /// Construct with default key.
+        KeyValue() :
+            first_(T())
+        {
+        }
+
+        /// Construct with key and value.
+        KeyValue(const T& first, const U& second) :
+            first_(first),
+            second_(second)
+        {
+        }
+
+        /// Copy-construct.
+        KeyValue(const KeyValue& value) :
+            first_(value.first_),
+            second_(value.second_)
+        {
+        }
+
+        /// Test for equality with another pair.
+        bool operator ==(const KeyValue& rhs) const { return first_ == rhs.first_ && second_ == rhs.second_; }
+
+        /// Test for inequality with another pair.
+        bool operator !=(const KeyValue& rhs) const { return first_ != rhs.first_ || second_ != rhs.second_; }
+
+        /// Key.
+        const T first_;
+        /// Value.
+        U second_;
+
+    private:
+        /// Prevent assignment.
+        KeyValue& operator =(const KeyValue& rhs);
+    };
+
+    typedef RandomAccessIterator<KeyValue> Iterator;
+    typedef RandomAccessConstIterator<KeyValue> ConstIterator;
+
+    /// Construct empty.
+    FlatHashMap()
+    {
+    }
+
+    /// Construct from another flat hash map.
+    FlatHashMap(const FlatHashMap<T, U>& map)
+    {
+        *this = map;
+    }
+
+    /// Destruct.
+    ~FlatHashMap()
+    {
+        Clear();
+        delete[] elements_;
+        delete[] buckets_;
+    }
+
+    /// Assign a flat hash map.
+    FlatHashMap& operator =(const FlatHashMap<T, U>& rhs)
+    {
+        // In case of self-assignment do nothing
+        if (&rhs != this)
+        {
+            Clear();
+            Insert(rhs);
+        }
+        return *this;
+    }
+
+    /// Add-assign a pair.
+    FlatHashMap& operator +=(const Pair<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a flat hash map.
+    FlatHashMap& operator +=(const FlatHashMap<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another flat hash map.
+    bool operator ==(const FlatHashMap<T, U>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator i = Begin(); i != End(); ++i)
+        {
+            ConstIterator j = rhs.Find(i->first_);
+            if (j == rhs.End() || j->second_ != i->second_)
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another flat hash map.
+    bool operator !=(const FlatHashMap<T, U>& rhs) const { return !(*this == rhs); }
+
+    /// Index the map. Create a new pair if key not found.
+    U& operator [](const T& key)
+    {
+        unsigned index = FindElement(key, MakeHash(key));
+        if (index != EMPTY_BUCKET)
+            return Elements()[index].second_;
+        return InsertElement(key, U())->second_;
+    }
+
+    /// Index the map. Return null if key is not found, does not create a new pair.
+    U* operator [](const T& key) const
+    {
+        unsigned index = FindElement(key, MakeHash(key));
+        return index != EMPTY_BUCKET ? &Elements()[index].second_ : 0;
+    }
+
+    /// Insert a pair. Return an iterator to it.
+    Iterator Insert(const Pair<T, U>& pair) { return Iterator(InsertElement(pair.first_, pair.second_, true)); }
+
+    /// Insert a pair. Return iterator and set exists flag according to whether the key already existed.
+    Iterator Insert(const Pair<T, U>& pair, bool& exists)
+    {
+        unsigned oldSize = Size();
+        Iterator ret(InsertElement(pair.first_, pair.second_, true));
+        exists = (Size() == oldSize);
+        return ret;
+    }
+
+    /// Insert a flat hash map.
+    void Insert(const FlatHashMap<T, U>& map)
+    {
+        Reserve(Size() + map.Size());
+        for (ConstIterator i = map.Begin(); i != map.End(); ++i)
+            InsertElement(i->first_, i->second_, true);
+    }
+
+    /// Insert a pair by iterator. Return iterator to the value.
+    Iterator Insert(const ConstIterator& it) { return Iterator(InsertElement(it->first_, it->second_, true)); }
+
+    /// Insert a range by iterators.
+    void Insert(const ConstIterator& start, const ConstIterator& end)
+    {
+        for (ConstIterator i = start; i != end; ++i)
+            InsertElement(i->first_, i->second_, true);
+    }
+
+    /// Erase a pair by key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned hash = MakeHash(key);
+        unsigned bucket = FindBucket(key, hash);
+        if (bucket == EMPTY_BUCKET)
+            return false;
+
+        EraseElement(bucket);
+        return true;
+    }
+
+    /// Erase a pair by iterator. Return iterator to the next pair, which is the same position as the last pair is moved into the erased one.
+    Iterator Erase(const Iterator& it)
+    {
+        unsigned index = (unsigned)(it.ptr_ - Elements());
+        if (index >= size_)
+            return End();
+
+        const T& key = it->first_;
+        EraseElement(FindBucket(key, MakeHash(key)));
+        return Iterator(Elements() + index);
+    }
+
+    /// Clear the map. Keeps the allocated memory.
+    void Clear()
+    {
+        KeyValue* elements = Elements();
+        for (unsigned i = 0; i < size_; ++i)
+            (elements + i)->~KeyValue();
+        size_ = 0;
+        ResetBuckets();
+    }
+
+    /// Reserve space for a number of pairs.
+    void Reserve(unsigned capacity)
+    {
+        if (capacity <= capacity_)
+            return;
+
+        KeyValue* elements = Elements();
+        KeyValue* newElements = reinterpret_cast<KeyValue*>(new unsigned char[capacity * sizeof(KeyValue)]);
+        for (unsigned i = 0; i < size_; ++i)
+        {
+            new(newElements + i) KeyValue(elements[i]);
+            (elements + i)->~KeyValue();
+        }
+        delete[] elements_;
+        elements_ = reinterpret_cast<unsigned char*>(newElements);
+        capacity_ = capacity;
+
+        AllocateBuckets(capacity);
+        for (unsigned i = 0; i < size_; ++i)
+            InsertBucket(MakeHash(newElements[i].first_), i);
+    }
+
+    /// Return iterator to the pair with key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        unsigned index = FindElement(key, MakeHash(key));
+        return index != EMPTY_BUCKET ? Iterator(Elements() + index) : End();
+    }
+
+    /// Return const iterator to the pair with key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned index = FindElement(key, MakeHash(key));
+        return index != EMPTY_BUCKET ? ConstIterator(Elements() + index) : End();
+    }
+
+    /// Return whether contains a pair with key.
+    bool Contains(const T& key) const { return FindElement(key, MakeHash(key)) != EMPTY_BUCKET; }
+
+    /// Try to copy value to output. Return true if was found.
+    bool TryGetValue(const T& key, U& out) const
+    {
+        unsigned index = FindElement(key, MakeHash(key));
+        if (index == EMPTY_BUCKET)
+            return false;
+
+        out = Elements()[index].second_;
+        return true;
+    }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->first_);
+        return result;
+    }
+
+    /// Return all the values.
+    Vector<U> Values() const
+    {
+        Vector<U> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->second_);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(Elements()); }
+
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(Elements()); }
+
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(Elements() + size_); }
+
+    /// Return iterator to the end.
+    ConstIterator End() const { return ConstIterator(Elements() + size_); }
+
+    /// Return first pair.
+    const KeyValue& Front() const { return *Begin(); }
+
+    /// Return last pair.
+    const KeyValue& Back() const { return *(--End()); }
+
+private:
+    /// Return the pair array.
+    KeyValue* Elements() const { return reinterpret_cast<KeyValue*>(elements_); }
+
+    /// Find the index bucket of a key. Return EMPTY_BUCKET if not found.
+    unsigned FindBucket(const T& key, unsigned hash) const
+    {
+        if (!size_)
+            return EMPTY_BUCKET;
+
+        unsigned mask = numBuckets_ - 1;
+        unsigned bucket = HomeBucket(hash);
+        KeyValue* elements = Elements();
+
+        // The search can stop at an entry closer to its ideal bucket than the key would be
+        for (unsigned distance = 0;; ++distance)
+        {
+            const FlatHashBucket& current = buckets_[bucket];
+            if (current.index_ == EMPTY_BUCKET || distance > ProbeDistance(bucket))
+                return EMPTY_BUCKET;
+            if (current.hash_ == hash && elements[current.index_].first_ == key)
+                return bucket;
+            bucket = (bucket + 1) & mask;
+        }
+    }
+
+    /// Find the index of the pair with key. Return EMPTY_BUCKET if not found.
+    unsigned FindElement(const T& key, unsigned hash) const
+    {
+        unsigned bucket = FindBucket(key, hash);
+        if (bucket == EMPTY_BUCKET)
+            return EMPTY_BUCKET;
+        return buckets_[bucket].index_;
+    }
+
+    /// Insert a pair, or return the existing pair with key. Optionally replace the existing value.
+    KeyValue* InsertElement(const T& key, const U& value, bool replace = false)
+    {
+        unsigned hash = MakeHash(key);
+        unsigned index = FindElement(key, hash);
+        if (index != EMPTY_BUCKET)
+        {
+            KeyValue* existing = Elements() + index;
+            if (replace)
+                existing->second_ = value;
+            return existing;
+        }
+
+        KeyValue* element;
+        if (size_ == capacity_)
+        {
+            // Construct the new pair before growing, as key or value may refer to the old storage
+            KeyValue pair(key, value);
+            Reserve(capacity_ ? capacity_ * 2 : MIN_CAPACITY);
+            element = Elements() + size_;
+            new(element) KeyValue(pair);
+        }
+        else
+        {
+            element = Elements() + size_;
+            new(element) KeyValue(key, value);
+        }
+        InsertBucket(hash, size_);
+        ++size_;
+        return element;
+    }
+
+    /// Erase the pair referred to by an index bucket and move the last pair into its place.
+    void EraseElement(unsigned bucket)
+    {
+        KeyValue* elements = Elements();
+        unsigned index = buckets_[bucket].index_;
+        unsigned last = size_ - 1;
+
+        EraseBucket(bucket);
+        (elements + index)->~KeyValue();
+        if (index != last)
+        {
+            ReindexBucket(MakeHash(elements[last].first_), last, index);
+            new(elements + index) KeyValue(elements[last]);
+            (elements + last)->~KeyValue();
+        }
+        --size_;
+    }
+};
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator begin(const Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator end(const Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator begin(Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator end(Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+
+}
@@ -0,0 +1,280 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Vector.h"
+
+#include <new>
+
+namespace Urho3D
+{
+
+/// Flat hash set template class. Has the same interface as HashSet, but stores the keys contiguously without per-key allocation. Erasing moves the last key into the erased position, so iteration order is not preserved and erasing or inserting invalidates iterators; use the iterator returned by Erase() when erasing during iteration.
+template <class T> class FlatHashSet : public FlatHashBase
+{
+public:
+    typedef T KeyType;
+    typedef RandomAccessConstIterator<T> Iterator;
+    typedef RandomAccessConstIterator<T> ConstIterator;
+
+    /// Construct empty.
+    FlatHashSet()
+    {
+    }
+
+    /// Construct from another flat hash set.
+    FlatHashSet(const FlatHashSet<T>& set)
+    {
+        *this = set;
+    }
+
+    /// Destruct.
+    ~FlatHashSet()
+    {
+        Clear();
+        delete[] elements_;
+        delete[] buckets_;
+    }
+
+    /// Assign a flat hash set.
+    FlatHashSet& operator =(const FlatHashSet<T>& rhs)
+    {
+        // In case of self-assignment do nothing
+        if (&rhs != this)
+        {
+            Clear();
+            Insert(rhs);
+        }
+        return *this;
+    }
+
+    /// Add-assign a value.
+    FlatHashSet& operator +=(const T& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a flat hash set.
+    FlatHashSet& operator +=(const FlatHashSet<T>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another flat hash set.
+    bool operator ==(const FlatHashSet<T>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator i = Begin(); i != End(); ++i)
+        {
+            if (!rhs.Contains(*i))
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another flat hash set.
+    bool operator !=(const FlatHashSet<T>& rhs) const { return !(*this == rhs); }
+
+    /// Insert a key. Return an iterator to it.
+    Iterator Insert(const T& key) { return Iterator(InsertElement(key)); }
+
+    /// Insert a key. Return iterator and set exists flag according to whether the key already existed.
+    Iterator Insert(const T& key, bool& exists)
+    {
+        unsigned oldSize = Size();
+        Iterator ret(InsertElement(key));
+        exists = (Size() == oldSize);
+        return ret;
+    }
+
+    /// Insert a set.
+    void Insert(const FlatHashSet<T>& set)
+    {
+        Reserve(Size() + set.Size());
+        for (ConstIterator i = set.Begin(); i != set.End(); ++i)
+            InsertElement(*i);
+    }
+
+    /// Insert a key by iterator. Return iterator to the value.
+    Iterator Insert(const ConstIterator& it) { return Iterator(InsertElement(*it)); }
+
+    /// Erase a key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned bucket = FindBucket(key, MakeHash(key));
+        if (bucket == EMPTY_BUCKET)
+            return false;
+
+        EraseElement(bucket);
+        return true;
+    }
+
+    /// Erase a key by iterator. Return iterator to the next key, which is the same position as the last key is moved into the erased one.
+    Iterator Erase(const Iterator& it)
+    {
+        unsigned index = (unsigned)(it.ptr_ - Elements());
+        if (index >= size_)
+            return End();
+
+        EraseElement(FindBucket(*it, MakeHash(*it)));
+        return Iterator(Elements() + index);
+    }
+
+    /// Clear the set. Keeps the allocated memory.
+    void Clear()
+    {
+        T* elements = Elements();
+        for (unsigned i = 0; i < size_; ++i)
+            (elements + i)->~T();
+        size_ = 0;
+        ResetBuckets();
+    }
+
+    /// Reserve space for a number of keys.
+    void Reserve(unsigned capacity)
+    {
+        if (capacity <= capacity_)
+            return;
+
+        T* elements = Elements();
+        T* newElements = reinterpret_cast<T*>(new unsigned char[capacity * sizeof(T)]);
+        for (unsigned i = 0; i < size_; ++i)
+        {
+            new(newElements + i) T(elements[i]);
+            (elements + i)->~T();
+        }
+        delete[] elements_;
+        elements_ = reinterpret_cast<unsigned char*>(newElements);
+        capacity_ = capacity;
+
+        AllocateBuckets(capacity);
+        for (unsigned i = 0; i < size_; ++i)
+            InsertBucket(MakeHash(newElements[i]), i);
+    }
+
+    /// Return iterator to the key, or end iterator if not found.
+    Iterator Find(const T& key) const
+    {
+        unsigned bucket = FindBucket(key, MakeHash(key));
+        return bucket != EMPTY_BUCKET ? Iterator(Elements() + buckets_[bucket].index_) : End();
+    }
+
+    /// Return whether contains a key.
+    bool Contains(const T& key) const { return FindBucket(key, MakeHash(key)) != EMPTY_BUCKET; }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() const { return Iterator(Elements()); }
+
+    /// Return iterator to the end.
+    Iterator End() const { return Iterator(Elements() + size_); }
+
+    /// Return first key.
+    const T& Front() const { return *Begin(); }
+
+    /// Return last key.
+    const T& Back() const { return *(--End()); }
+
+private:
+    /// Return the key array.
+    T* Elements() const { return reinterpret_cast<T*>(elements_); }
+
+    /// Find the index bucket of a key. Return EMPTY_BUCKET if not found.
+    unsigned FindBucket(const T& key, unsigned hash) const
+    {
+        if (!size_)
+            return EMPTY_BUCKET;
+
+        unsigned mask = numBuckets_ - 1;
+        unsigned bucket = HomeBucket(hash);
+        T* elements = Elements();
+
+        // The search can stop at an entry closer to its ideal bucket than the key would be
+        for (unsigned distance = 0;; ++distance)
+        {
+            const FlatHashBucket& current = buckets_[bucket];
+            if (current.index_ == EMPTY_BUCKET || distance > ProbeDistance(bucket))
+                return EMPTY_BUCKET;
+            if (current.hash_ == hash && elements[current.index_] == key)
+                return bucket;
+            bucket = (bucket + 1) & mask;
+        }
+    }
+
+    /// Insert a key, or return the existing key.
+    T* InsertElement(const T& key)
+    {
+        unsigned hash = MakeHash(key);
+        unsigned bucket = FindBucket(key, hash);
+        if (bucket != EMPTY_BUCKET)
+            return Elements() + buckets_[bucket].index_;
+
+        T* element;
+        if (size_ == capacity_)
+        {
+            // Copy the key before growing, as it may refer to the old storage
+            T copy(key);
+            Reserve(capacity_ ? capacity_ * 2 : MIN_CAPACITY);
+            element = Elements() + size_;
+            new(element) T(copy);
+        }
+        else
+        {
+            element = Elements() + size_;
+            new(element) T(key);
+        }
+        InsertBucket(hash, size_);
+        ++size_;
+        return element;
+    }
+
+    /// Erase the key referred to by an index bucket and move the last key into its place.
+    void EraseElement(unsigned bucket)
+    {
+        T* elements = Elements();
+        unsigned index = buckets_[bucket].index_;
+        unsigned last = size_ - 1;
+
+        EraseBucket(bucket);
+        (elements + index)->~T();
+        if (index != last)
+        {
+            ReindexBucket(MakeHash(elements[last]), last, index);
+            new(elements + index) T(elements[last]);
+            (elements + last)->~T();
+        }
+        --size_;
+    }
+};
+
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator begin(const Urho3D::FlatHashSet<T>& v) { return v.Begin(); }
+
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator end(const Urho3D::FlatHashSet<T>& v) { return v.End(); }
+
+}
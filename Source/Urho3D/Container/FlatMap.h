@@ -0,0 +1,454 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Allocator.h"
+#include "../Container/Pair.h"
+#include "../Container/Vector.h"
+
+#if URHO3D_CXX11
+#include <initializer_list>
+#endif
+#include <new>
+
+namespace Urho3D
+{
+
+/// Sorted flat map template class. Has the same interface as HashMap, but stores the key-value pairs in an array sorted by key and finds them by binary search. Suited for small maps: the array is allocated from the size-class pool and kept when the map is cleared, so that reusing a map does not allocate. Inserting and erasing shift the following pairs and invalidate iterators and pointers to values. Iteration is in key order.
+template <class T, class U> class FlatMap
+{
+public:
+    typedef T KeyType;
+    typedef U ValueType;
+
+    /// Flat map key-value pair with const key.
+    class KeyValue
+    {
+    public:
+        /// Construct with default key.
+        KeyValue() :
+            first_(T())
+        {
+        }
+
+        /// Construct with key and value.
+        KeyValue(const T& first, const U& second) :
+            first_(first),
+            second_(second)
+        {
+        }
+
+        /// Copy-construct.
+        KeyValue(const KeyValue& value) :
+            first_(value.first_),
+            second_(value.second_)
+        {
+        }
+
+        /// Test for equality with another pair.
+        bool operator ==(const KeyValue& rhs) const { return first_ == rhs.first_ && second_ == rhs.second_; }
+
+        /// Test for inequality with another pair.
+        bool operator !=(const KeyValue& rhs) const { return first_ != rhs.first_ || second_ != rhs.second_; }
+
+        /// Key.
+        const T first_;
+        /// Value.
+        U second_;
+
+    private:
+        /// Prevent assignment.
+        KeyValue& operator =(const KeyValue& rhs);
+    };
+
+    typedef RandomAccessIterator<KeyValue> Iterator;
+    typedef RandomAccessConstIterator<KeyValue> ConstIterator;
+
+    /// Construct empty.
+    FlatMap() :
+        elements_(0),
+        size_(0),
+        capacity_(0)
+    {
+    }
+
+    /// Construct from another flat map.
+    FlatMap(const FlatMap<T, U>& map) :
+        elements_(0),
+        size_(0),
+        capacity_(0)
+    {
+        *this = map;
+    }
+#if URHO3D_CXX11
+    /// Aggregate initialization constructor.
+    FlatMap(const std::initializer_list<Pair<T, U>>& list) : FlatMap()
+    {
+        for (auto it = list.begin(); it != list.end(); it++)
+        {
+            Insert(*it);
+        }
+    }
+#endif
+    /// Destruct.
+    ~FlatMap()
+    {
+        Clear();
+        AllocatorFree(elements_, capacity_ * (unsigned)sizeof(KeyValue));
+    }
+
+    /// Assign a flat map.
+    FlatMap& operator =(const FlatMap<T, U>& rhs)
+    {
+        // In case of self-assignment do nothing
+        if (&rhs != this)
+        {
+            Clear();
+            Reserve(rhs.size_);
+            // The source is sorted, so the pairs can be copied in order
+            for (unsigned i = 0; i < rhs.size_; ++i)
+                new(elements_ + i) KeyValue(rhs.elements_[i]);
+            size_ = rhs.size_;
+        }
+        return *this;
+    }
+
+    /// Add-assign a pair.
+    FlatMap& operator +=(const Pair<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a flat map.
+    FlatMap& operator +=(const FlatMap<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another flat map.
+    bool operator ==(const FlatMap<T, U>& rhs) const
+    {
+        if (rhs.size_ != size_)
+            return false;
+
+        // Both are sorted by key, so equal maps have equal pairs at each index
+        for (unsigned i = 0; i < size_; ++i)
+        {
+            if (elements_[i] != rhs.elements_[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another flat map.
+    bool operator !=(const FlatMap<T, U>& rhs) const { return !(*this == rhs); }
+
+    /// Index the map. Create a new pair if key not found.
+    U& operator [](const T& key)
+    {
+        unsigned index = LowerBound(key);
+        if (index < size_ && elements_[index].first_ == key)
+            return elements_[index].second_;
+        return InsertElement(key, U())->second_;
+    }
+
+    /// Index the map. Return null if key is not found, does not create a new pair.
+    U* operator [](const T& key) const
+    {
+        unsigned index = LowerBound(key);
+        return index < size_ && elements_[index].first_ == key ? &elements_[index].second_ : 0;
+    }
+
+#if URHO3D_CXX11
+    /// Populate the map using variadic template. This handles the base case.
+    FlatMap& Populate(const T& key, const U& value)
+    {
+        this->operator [](key) = value;
+        return *this;
+    };
+    /// Populate the map using variadic template.
+    template <typename... Args> FlatMap& Populate(const T& key, const U& value, Args... args)
+    {
+        this->operator [](key) = value;
+        return Populate(args...);
+    };
+#endif
+
+    /// Insert a pair. Return an iterator to it.
+    Iterator Insert(const Pair<T, U>& pair) { return Iterator(InsertElement(pair.first_, pair.second_, true)); }
+
+    /// Insert a pair. Return iterator and set exists flag according to whether the key already existed.
+    Iterator Insert(const Pair<T, U>& pair, bool& exists)
+    {
+        unsigned oldSize = size_;
+        Iterator ret(InsertElement(pair.first_, pair.second_, true));
+        exists = (size_ == oldSize);
+        return ret;
+    }
+
+    /// Insert a flat map.
+    void Insert(const FlatMap<T, U>& map)
+    {
+        if (&map == this)
+            return;
+        Reserve(size_ + map.size_);
+        for (unsigned i = 0; i < map.size_; ++i)
+            InsertElement(map.elements_[i].first_, map.elements_[i].second_, true);
+    }
+
+    /// Insert a pair by iterator. Return iterator to the value.
+    Iterator Insert(const ConstIterator& it) { return Iterator(InsertElement(it->first_, it->second_, true)); }
+
+    /// Insert a range by iterators.
+    void Insert(const ConstIterator& start, const ConstIterator& end)
+    {
+        for (ConstIterator i = start; i != end; ++i)
+            InsertElement(i->first_, i->second_, true);
+    }
+
+    /// Erase a pair by key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned index = LowerBound(key);
+        if (index >= size_ || !(elements_[index].first_ == key))
+            return false;
+
+        EraseElement(index);
+        return true;
+    }
+
+    /// Erase a pair by iterator. Return iterator to the next pair.
+    Iterator Erase(const Iterator& it)
+    {
+        unsigned index = (unsigned)(it.ptr_ - elements_);
+        if (index >= size_)
+            return End();
+
+        EraseElement(index);
+        return Iterator(elements_ + index);
+    }
+
+    /// Clear the map. Keeps the allocated memory.
+    void Clear()
+    {
+        for (unsigned i = 0; i < size_; ++i)
+            (elements_ + i)->~KeyValue();
+        size_ = 0;
+    }
+
+    /// Sort pairs. The pairs are always sorted by key, so this does nothing; provided for interface compatibility with HashMap.
+    void Sort()
+    {
+    }
+
+    /// Reserve space for a number of pairs.
+    void Reserve(unsigned capacity)
+    {
+        if (capacity <= capacity_)
+            return;
+
+        KeyValue* newElements = static_cast<KeyValue*>(AllocatorAllocate(capacity * (unsigned)sizeof(KeyValue)));
+        for (unsigned i = 0; i < size_; ++i)
+        {
+            new(newElements + i) KeyValue(elements_[i]);
+            (elements_ + i)->~KeyValue();
+        }
+        AllocatorFree(elements_, capacity_ * (unsigned)sizeof(KeyValue));
+        elements_ = newElements;
+        capacity_ = capacity;
+    }
+
+    /// Return iterator to the pair with key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        unsigned index = LowerBound(key);
+        return index < size_ && elements_[index].first_ == key ? Iterator(elements_ + index) : End();
+    }
+
+    /// Return const iterator to the pair with key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned index = LowerBound(key);
+        return index < size_ && elements_[index].first_ == key ? ConstIterator(elements_ + index) : End();
+    }
+
+    /// Return whether contains a pair with key.
+    bool Contains(const T& key) const
+    {
+        unsigned index = LowerBound(key);
+        return index < size_ && elements_[index].first_ == key;
+    }
+
+    /// Try to copy value to output. Return true if was found.
+    bool TryGetValue(const T& key, U& out) const
+    {
+        unsigned index = LowerBound(key);
+        if (index >= size_ || !(elements_[index].first_ == key))
+            return false;
+
+        out = elements_[index].second_;
+        return true;
+    }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(size_);
+        for (unsigned i = 0; i < size_; ++i)
+            result.Push(elements_[i].first_);
+        return result;
+    }
+
+    /// Return all the values.
+    Vector<U> Values() const
+    {
+        Vector<U> result;
+        result.Reserve(size_);
+        for (unsigned i = 0; i < size_; ++i)
+            result.Push(elements_[i].second_);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(elements_); }
+
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(elements_); }
+
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(elements_ + size_); }
+
+    /// Return iterator to the end.
+    ConstIterator End() const { return ConstIterator(elements_ + size_); }
+
+    /// Return first pair.
+    const KeyValue& Front() const { return *Begin(); }
+
+    /// Return last pair.
+    const KeyValue& Back() const { return *(--End()); }
+
+    /// Return number of pairs.
+    unsigned Size() const { return size_; }
+
+    /// Return capacity.
+    unsigned Capacity() const { return capacity_; }
+
+    /// Return whether map is empty.
+    bool Empty() const { return size_ == 0; }
+
+private:
+    /// Return the index of the first pair whose key is not less than key.
+    unsigned LowerBound(const T& key) const
+    {
+        unsigned low = 0;
+        unsigned high = size_;
+        while (low < high)
+        {
+            unsigned mid = (low + high) >> 1;
+            if (elements_[mid].first_ < key)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low;
+    }
+
+    /// Insert a pair, or return the existing pair with key. Optionally replace the existing value.
+    KeyValue* InsertElement(const T& key, const U& value, bool replace = false)
+    {
+        unsigned index = LowerBound(key);
+        if (index < size_ && elements_[index].first_ == key)
+        {
+            if (replace)
+                elements_[index].second_ = value;
+            return elements_ + index;
+        }
+
+        if (size_ == capacity_)
+        {
+            // Construct the new pair before growing, as key or value may refer to the old storage
+            KeyValue pair(key, value);
+            Reserve(capacity_ ? capacity_ * 2 : MIN_CAPACITY);
+            ShiftUp(index);
+            new(elements_ + index) KeyValue(pair);
+        }
+        else if (index == size_)
+            new(elements_ + index) KeyValue(key, value);
+        else
+        {
+            KeyValue pair(key, value);
+            ShiftUp(index);
+            new(elements_ + index) KeyValue(pair);
+        }
+
+        ++size_;
+        return elements_ + index;
+    }
+
+    /// Move the pairs from index onward up by one, leaving index unconstructed.
+    void ShiftUp(unsigned index)
+    {
+        for (unsigned i = size_; i > index; --i)
+        {
+            new(elements_ + i) KeyValue(elements_[i - 1]);
+            (elements_ + i - 1)->~KeyValue();
+        }
+    }
+
+    /// Erase the pair at index and move the following pairs down.
+    void EraseElement(unsigned index)
+    {
+        (elements_ + index)->~KeyValue();
+        for (unsigned i = index + 1; i < size_; ++i)
+        {
+            new(elements_ + i - 1) KeyValue(elements_[i]);
+            (elements_ + i)->~KeyValue();
+        }
+        --size_;
+    }
+
+    /// Initial capacity when the first pair is inserted.
+    static const unsigned MIN_CAPACITY = 4;
+
+    /// Pairs sorted by key.
+    KeyValue* elements_;
+    /// Number of pairs.
+    unsigned size_;
+    /// Capacity.
+    unsigned capacity_;
+};
+
+template <class T, class U> typename Urho3D::FlatMap<T, U>::ConstIterator begin(const Urho3D::FlatMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatMap<T, U>::ConstIterator end(const Urho3D::FlatMap<T, U>& v) { return v.End(); }
+
+template <class T, class U> typename Urho3D::FlatMap<T, U>::Iterator begin(Urho3D::FlatMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatMap<T, U>::Iterator end(Urho3D::FlatMap<T, U>& v) { return v.End(); }
+
+}
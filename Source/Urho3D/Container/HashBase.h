@@ -109,8 +109,7 @@ public:
     HashBase() :
         head_(0),
         tail_(0),
-        ptrs_(0),
-        allocator_(0)
+        ptrs_(0)
     {
     }
 
@@ -120,7 +119,6 @@ public:
         Urho3D::Swap(head_, rhs.head_);
         Urho3D::Swap(tail_, rhs.tail_);
         Urho3D::Swap(ptrs_, rhs.ptrs_);
-        Urho3D::Swap(allocator_, rhs.allocator_);
     }
 
     /// Return number of elements.
@@ -151,8 +149,6 @@ protected:
     HashNodeBase* tail_;
     /// Bucket head pointers.
     HashNodeBase** ptrs_;
-    /// Node allocator.
-    AllocatorBlock* allocator_;
 };
 
 }
@@ -228,15 +228,13 @@ public:
     HashMap()
     {
         // Reserve the tail node
-        allocator_ = AllocatorInitialize((unsigned)sizeof(Node));
         head_ = tail_ = ReserveNode();
     }
 
     /// Construct from another hash map.
     HashMap(const HashMap<T, U>& map)
     {
-        // Reserve the tail node + initial capacity according to the map's size
-        allocator_ = AllocatorInitialize((unsigned)sizeof(Node), map.Size() + 1);
+        // Reserve the tail node
         head_ = tail_ = ReserveNode();
         *this = map;
     }
@@ -255,7 +253,6 @@ public:
     {
         Clear();
         FreeNode(Tail());
-        AllocatorUninitialize(allocator_);
         delete[] ptrs_;
     }
 
@@ -736,7 +733,7 @@ private:
     /// Reserve a node.
     Node* ReserveNode()
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(AllocatorAllocate((unsigned)sizeof(Node)));
         new(newNode) Node();
         return newNode;
     }
@@ -744,7 +741,7 @@ private:
     /// Reserve a node with specified key and value.
     Node* ReserveNode(const T& key, const U& value)
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(AllocatorAllocate((unsigned)sizeof(Node)));
         new(newNode) Node(key, value);
         return newNode;
     }
@@ -753,7 +750,7 @@ private:
     void FreeNode(Node* node)
     {
         (node)->~Node();
-        AllocatorFree(allocator_, node);
+        AllocatorFree(node, (unsigned)sizeof(Node));
     }
 
     /// Rehash the buckets.
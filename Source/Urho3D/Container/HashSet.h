@@ -183,15 +183,13 @@ public:
     HashSet()
     {
         // Reserve the tail node
-        allocator_ = AllocatorInitialize((unsigned)sizeof(Node));
         head_ = tail_ = ReserveNode();
     }
 
     /// Construct from another hash set.
     HashSet(const HashSet<T>& set)
     {
-        // Reserve the tail node + initial capacity according to the set's size
-        allocator_ = AllocatorInitialize((unsigned)sizeof(Node), set.Size() + 1);
+        // Reserve the tail node
         head_ = tail_ = ReserveNode();
         *this = set;
     }
@@ -210,7 +208,6 @@ public:
     {
         Clear();
         FreeNode(Tail());
-        AllocatorUninitialize(allocator_);
         delete[] ptrs_;
     }
 
@@ -593,7 +590,7 @@ private:
     /// Reserve a node.
     Node* ReserveNode()
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(AllocatorAllocate((unsigned)sizeof(Node)));
         new(newNode) Node();
         return newNode;
     }
@@ -601,7 +598,7 @@ private:
     /// Reserve a node with specified key.
     Node* ReserveNode(const T& key)
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(AllocatorAllocate((unsigned)sizeof(Node)));
         new(newNode) Node(key);
         return newNode;
     }
@@ -610,7 +607,7 @@ private:
     void FreeNode(Node* node)
     {
         (node)->~Node();
-        AllocatorFree(allocator_, node);
+        AllocatorFree(node, (unsigned)sizeof(Node));
     }
 
     /// Rehash the buckets.
@@ -176,15 +176,13 @@ public:
     /// Construct empty.
     List()
     {
-        allocator_ = AllocatorInitialize((unsigned)sizeof(Node));
         head_ = tail_ = ReserveNode();
     }
 
     /// Construct from another list.
     List(const List<T>& list)
     {
-        // Reserve the tail node + initial capacity according to the list's size
-        allocator_ = AllocatorInitialize((unsigned)sizeof(Node), list.Size() + 1);
+        // Reserve the tail node
         head_ = tail_ = ReserveNode();
         *this = list;
     }
@@ -203,7 +201,6 @@ public:
     {
         Clear();
         FreeNode(Tail());
-        AllocatorUninitialize(allocator_);
     }
 
     /// Assign from another list.
@@ -468,7 +465,7 @@ private:
     /// Reserve a node.
     Node* ReserveNode()
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(AllocatorAllocate((unsigned)sizeof(Node)));
         new(newNode) Node();
         return newNode;
     }
@@ -476,7 +473,7 @@ private:
     /// Reserve a node with initial value.
     Node* ReserveNode(const T& value)
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(AllocatorAllocate((unsigned)sizeof(Node)));
         new(newNode) Node(value);
         return newNode;
     }
@@ -485,7 +482,7 @@ private:
     void FreeNode(Node* node)
     {
         (node)->~Node();
-        AllocatorFree(allocator_, node);
+        AllocatorFree(node, (unsigned)sizeof(Node));
     }
 };
 
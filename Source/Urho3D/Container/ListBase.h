@@ -97,7 +97,6 @@ public:
     ListBase() :
         head_(0),
         tail_(0),
-        allocator_(0),
         size_(0)
     {
     }
@@ -107,7 +106,6 @@ public:
     {
         Urho3D::Swap(head_, rhs.head_);
         Urho3D::Swap(tail_, rhs.tail_);
-        Urho3D::Swap(allocator_, rhs.allocator_);
         Urho3D::Swap(size_, rhs.size_);
     }
 
@@ -116,8 +114,6 @@ protected:
     ListNodeBase* head_;
     /// Tail node pointer.
     ListNodeBase* tail_;
-    /// Node allocator.
-    AllocatorBlock* allocator_;
     /// Number of nodes.
     unsigned size_;
 };
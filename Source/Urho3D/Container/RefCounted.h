@@ -28,12 +28,16 @@
 #include <Urho3D/Urho3D.h>
 #endif
 
+#include "../Container/Allocator.h"
+
 namespace Urho3D
 {
 
 /// Reference count structure.
 struct RefCount
 {
+    URHO3D_POOL_ALLOCATED
+
     /// Construct.
     RefCount() :
         refs_(0),
@@ -59,6 +63,8 @@ struct RefCount
 class URHO3D_API RefCounted
 {
 public:
+    URHO3D_POOL_ALLOCATED
+
     /// Construct. Allocate the reference count structure and set an initial self weak reference.
     RefCounted();
     /// Destruct. Mark as expired and also delete the reference count structure if no outside weak references exist.
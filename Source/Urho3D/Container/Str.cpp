@@ -419,16 +419,28 @@ void String::Resize(unsigned newLength)
 {
     if (!capacity_)
     {
-        // If zero length requested, do not allocate buffer yet
-        if (!newLength)
-            return;
+        if (newLength < INLINE_CAPACITY)
+        {
+            // If zero length requested, do not switch to the inline buffer yet
+            if (!newLength && buffer_ == &endZero)
+                return;
 
-        // Calculate initial capacity
-        capacity_ = newLength + 1;
-        if (capacity_ < MIN_CAPACITY)
-            capacity_ = MIN_CAPACITY;
+            // Short strings use the inline buffer. If it was already in use the content stays in place
+            buffer_ = inlineBuffer_;
+        }
+        else
+        {
+            // Calculate initial capacity
+            capacity_ = newLength + 1;
+            if (capacity_ < MIN_CAPACITY)
+                capacity_ = MIN_CAPACITY;
 
-        buffer_ = new char[capacity_];
+            // Move the existing data from the inline buffer, if any
+            char* newBuffer = new char[capacity_];
+            if (length_)
+                CopyChars(newBuffer, buffer_, length_);
+            buffer_ = newBuffer;
+        }
     }
     else
     {
@@ -459,6 +471,24 @@ void String::Reserve(unsigned newCapacity)
     if (newCapacity == capacity_)
         return;
 
+    // Move back to the inline buffer if the capacity fits
+    if (newCapacity <= INLINE_CAPACITY)
+    {
+        if (capacity_)
+        {
+            CopyChars(inlineBuffer_, buffer_, length_ + 1);
+            delete[] buffer_;
+            capacity_ = 0;
+            buffer_ = inlineBuffer_;
+        }
+        else if (buffer_ == &endZero)
+        {
+            inlineBuffer_[0] = 0;
+            buffer_ = inlineBuffer_;
+        }
+        return;
+    }
+
     char* newBuffer = new char[newCapacity];
     // Move the existing data to the new buffer, then delete the old buffer
     CopyChars(newBuffer, buffer_, length_ + 1);
@@ -482,9 +512,22 @@ void String::Clear()
 
 void String::Swap(String& str)
 {
+    bool inlined = buffer_ == inlineBuffer_;
+    bool strInlined = str.buffer_ == str.inlineBuffer_;
+
     Urho3D::Swap(length_, str.length_);
     Urho3D::Swap(capacity_, str.capacity_);
     Urho3D::Swap(buffer_, str.buffer_);
+
+    // Inline buffers can not be exchanged by pointer, so swap their contents and repoint
+    char temp[INLINE_CAPACITY];
+    memcpy(temp, inlineBuffer_, INLINE_CAPACITY);
+    memcpy(inlineBuffer_, str.inlineBuffer_, INLINE_CAPACITY);
+    memcpy(str.inlineBuffer_, temp, INLINE_CAPACITY);
+    if (strInlined)
+        buffer_ = inlineBuffer_;
+    if (inlined)
+        str.buffer_ = str.inlineBuffer_;
 }
 
 String String::Substring(unsigned pos) const
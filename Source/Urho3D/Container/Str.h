@@ -402,7 +402,7 @@ public:
     unsigned Length() const { return length_; }
 
     /// Return buffer capacity.
-    unsigned Capacity() const { return capacity_; }
+    unsigned Capacity() const { return capacity_ ? capacity_ : (buffer_ == inlineBuffer_ ? INLINE_CAPACITY : 0); }
 
     /// Return whether the string is empty.
     bool Empty() const { return length_ == 0; }
@@ -483,6 +483,8 @@ public:
     static const unsigned NPOS = 0xffffffff;
     /// Initial dynamic allocation size.
     static const unsigned MIN_CAPACITY = 8;
+    /// Size of the inline buffer for short strings, including the terminating zero. Sized so that String still fits in a Variant.
+    static const unsigned INLINE_CAPACITY = sizeof(void*) == 8 ? 16 : 4;
     /// Empty string.
     static const String EMPTY;
 
@@ -518,8 +520,10 @@ private:
     unsigned length_;
     /// Capacity, zero if buffer not allocated.
     unsigned capacity_;
-    /// String buffer, null if not allocated.
+    /// String buffer. Points to endZero if empty, or to the inline buffer for short strings.
     char* buffer_;
+    /// Inline buffer for short strings, which avoids allocation. Used when capacity_ is zero and length fits.
+    char inlineBuffer_[INLINE_CAPACITY];
 
     /// End zero for empty strings.
     static char endZero;
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/Ptr.h"
+#include "../Core/ConstString.h"
 #include "../Core/Variant.h"
 
 namespace Urho3D
@@ -49,7 +50,9 @@ static const unsigned AM_NODEIDVECTOR = 0x40;
 /// Attribute is readonly. Can't be used with binary serialized objects.
 static const unsigned AM_FILEREADONLY = 0x81;
 
+class Deserializer;
 class Serializable;
+class Serializer;
 
 /// Abstract base class for invoking attribute accessors.
 class URHO3D_API AttributeAccessor : public RefCounted
@@ -59,6 +62,10 @@ public:
     virtual void Get(const Serializable* ptr, Variant& dest) const = 0;
     /// Set the attribute.
     virtual void Set(Serializable* ptr, const Variant& src) = 0;
+    /// Write the attribute to a binary stream in the same format as Serializer::WriteVariantData(). Default implementation goes through Get(). Return true if successful.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const;
+    /// Read the attribute from a binary stream in the same format as Deserializer::ReadVariant() with the attribute type. Default implementation goes through Set().
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type);
 };
 
 /// Description of an automatically serializable variable.
@@ -71,7 +78,11 @@ struct AttributeInfo
         enumNames_(0),
         variantStructureElementNames_(0),
         mode_(AM_DEFAULT),
-        ptr_(0)
+        ptr_(0),
+        quantizeBits_(0),
+        quantizeMin_(0.0f),
+        quantizeMax_(0.0f),
+        directAccess_(false)
     {
     }
 
@@ -79,12 +90,17 @@ struct AttributeInfo
     AttributeInfo(VariantType type, const char* name, size_t offset, const Variant& defaultValue, unsigned mode) :
         type_(type),
         name_(name),
+        internedName_(name),
         offset_((unsigned)offset),
         enumNames_(0),
         variantStructureElementNames_(0),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizeBits_(0),
+        quantizeMin_(0.0f),
+        quantizeMax_(0.0f),
+        directAccess_(false)
     {
     }
 
@@ -92,12 +108,17 @@ struct AttributeInfo
     AttributeInfo(const char* name, size_t offset, const char** enumNames, const Variant& defaultValue, unsigned mode) :
         type_(VAR_INT),
         name_(name),
+        internedName_(name),
         offset_((unsigned)offset),
         enumNames_(enumNames),
         variantStructureElementNames_(0),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizeBits_(0),
+        quantizeMin_(0.0f),
+        quantizeMax_(0.0f),
+        directAccess_(false)
     {
     }
 
@@ -105,13 +126,18 @@ struct AttributeInfo
     AttributeInfo(VariantType type, const char* name, AttributeAccessor* accessor, const Variant& defaultValue, unsigned mode) :
         type_(type),
         name_(name),
+        internedName_(name),
         offset_(0),
         enumNames_(0),
         variantStructureElementNames_(0),
         accessor_(accessor),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizeBits_(0),
+        quantizeMin_(0.0f),
+        quantizeMax_(0.0f),
+        directAccess_(false)
     {
     }
 
@@ -120,13 +146,18 @@ struct AttributeInfo
         unsigned mode) :
         type_(VAR_INT),
         name_(name),
+        internedName_(name),
         offset_(0),
         enumNames_(enumNames),
         variantStructureElementNames_(0),
         accessor_(accessor),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizeBits_(0),
+        quantizeMin_(0.0f),
+        quantizeMax_(0.0f),
+        directAccess_(false)
     {
     }
 
@@ -134,13 +165,18 @@ struct AttributeInfo
     AttributeInfo(VariantType type, const char* name, AttributeAccessor* accessor, const Variant& defaultValue, const char** variantStructureElementNames, unsigned mode) :
         type_(type),
         name_(name),
+        internedName_(name),
         offset_(0),
         enumNames_(0),
         variantStructureElementNames_(variantStructureElementNames),
         accessor_(accessor),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizeBits_(0),
+        quantizeMin_(0.0f),
+        quantizeMax_(0.0f),
+        directAccess_(false)
     {
     }
 
@@ -148,6 +184,8 @@ struct AttributeInfo
     VariantType type_;
     /// Name.
     String name_;
+    /// Interned name for lookup without string comparison.
+    ConstString internedName_;
     /// Byte offset from start of object.
     unsigned offset_;
     /// Enum names.
@@ -162,6 +200,26 @@ struct AttributeInfo
     unsigned mode_;
     /// Attribute data pointer if elsewhere than in the Serializable.
     void* ptr_;
+    /// Bits per component for quantized network replication of float, vector and quaternion attributes, or 0 for full precision.
+    unsigned quantizeBits_;
+    /// Minimum component value for quantized network replication. Not used for quaternions.
+    float quantizeMin_;
+    /// Maximum component value for quantized network replication. Not used for quaternions.
+    float quantizeMax_;
+    /// Whether the owning class uses the default attribute handlers, so that binary serialization may bypass OnGetAttribute() and OnSetAttribute().
+    bool directAccess_;
+};
+
+/// Helper to detect whether a class overrides Serializable::OnSetAttribute() or Serializable::OnGetAttribute().
+template <class T> struct AttributeHandlersOverridden
+{
+    static char CheckSet(void (Serializable::*)(const AttributeInfo&, const Variant&));
+    template <class U> static long CheckSet(void (U::*)(const AttributeInfo&, const Variant&));
+    static char CheckGet(void (Serializable::*)(const AttributeInfo&, Variant&) const);
+    template <class U> static long CheckGet(void (U::*)(const AttributeInfo&, Variant&) const);
+
+    /// True if either handler is overridden.
+    static const bool value_ = sizeof(CheckSet(&T::OnSetAttribute)) != sizeof(char) || sizeof(CheckGet(&T::OnGetAttribute)) != sizeof(char);
 };
 
 }
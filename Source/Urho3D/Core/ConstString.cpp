@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/ConstString.h"
+#include "../Core/Mutex.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+const ConstString ConstString::EMPTY;
+
+/// Return the global intern table. Function-local so that ConstStrings can be constructed during static initialization.
+static HashMap<String, StringHash>& GetInternTable()
+{
+    static HashMap<String, StringHash> table;
+    return table;
+}
+
+/// Return the mutex that guards the intern table.
+static Mutex& GetInternMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+ConstString::ConstString(const String& str) :
+    entry_(Intern(str.CString(), str.Length()))
+{
+}
+
+ConstString::ConstString(const char* str) :
+    entry_(Intern(str, String::CStringLength(str)))
+{
+}
+
+const ConstString::Entry* ConstString::Intern(const char* str, unsigned length)
+{
+    if (!length)
+        return 0;
+
+    // Short names fit the inline buffer of String, so the lookup key does not allocate
+    String key(str, length);
+
+    MutexLock lock(GetInternMutex());
+    HashMap<String, StringHash>& table = GetInternTable();
+    HashMap<String, StringHash>::Iterator i = table.Find(key);
+    if (i == table.End())
+        i = table.Insert(MakePair(key, StringHash(key)));
+
+    return &(*i);
+}
+
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Math/StringHash.h"
+
+namespace Urho3D
+{
+
+/// Interned immutable string. Equal strings share one entry in a global table that is never freed, so copying is a pointer copy, comparison is a pointer compare and the hash is precomputed. Constructing from text takes a lock and a table lookup, so construct once and keep the ConstString.
+class URHO3D_API ConstString
+{
+public:
+    /// Construct empty.
+    ConstString() :
+        entry_(0)
+    {
+    }
+
+    /// Construct by interning a string.
+    explicit ConstString(const String& str);
+    /// Construct by interning a C string.
+    explicit ConstString(const char* str);
+
+    /// Test for equality with another interned string.
+    bool operator ==(const ConstString& rhs) const { return entry_ == rhs.entry_; }
+
+    /// Test for inequality with another interned string.
+    bool operator !=(const ConstString& rhs) const { return entry_ != rhs.entry_; }
+
+    /// Test if less than another interned string. Orders by table entry, not alphabetically.
+    bool operator <(const ConstString& rhs) const { return entry_ < rhs.entry_; }
+
+    /// Return the case-insensitive hash, same as StringHash constructed from the string.
+    operator StringHash() const { return entry_ ? entry_->second_ : StringHash(); }
+
+    /// Return the string.
+    const String& GetString() const { return entry_ ? entry_->first_ : String::EMPTY; }
+
+    /// Return the C string.
+    const char* CString() const { return GetString().CString(); }
+
+    /// Return length.
+    unsigned Length() const { return GetString().Length(); }
+
+    /// Return whether the string is empty.
+    bool Empty() const { return entry_ == 0; }
+
+    /// Return the case-insensitive hash, same as StringHash constructed from the string.
+    StringHash ToStringHash() const { return entry_ ? entry_->second_ : StringHash(); }
+
+    /// Return hash value for HashSet & HashMap.
+    unsigned ToHash() const { return ToStringHash().Value(); }
+
+    /// Empty interned string.
+    static const ConstString EMPTY;
+
+private:
+    /// Table entry type. The table is node-based, so entries never move.
+    typedef HashMap<String, StringHash>::KeyValue Entry;
+
+    /// Find or add the table entry of a string.
+    static const Entry* Intern(const char* str, unsigned length);
+
+    /// Table entry, null if empty.
+    const Entry* entry_;
+};
+
+}
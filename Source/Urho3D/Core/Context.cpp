@@ -70,32 +70,49 @@ void EventReceiverGroup::EndSendEvent()
         for (unsigned i = receivers_.Size() - 1; i < receivers_.Size(); --i)
         {
             if (!receivers_[i])
+            {
                 receivers_.Erase(i);
+                handlers_.Erase(i);
+            }
         }
 
         dirty_ = false;
     }
 }
 
-void EventReceiverGroup::Add(Object* object)
+void EventReceiverGroup::Add(Object* object, EventHandler* handler)
 {
     if (object)
+    {
         receivers_.Push(object);
+        handlers_.Push(handler);
+    }
 }
 
 void EventReceiverGroup::Remove(Object* object)
 {
+    unsigned index = receivers_.IndexOf(object);
+    if (index == receivers_.Size())
+        return;
+
     if (inSend_ > 0)
     {
-        PODVector<Object*>::Iterator i = receivers_.Find(object);
-        if (i != receivers_.End())
-        {
-            (*i) = 0;
-            dirty_ = true;
-        }
+        receivers_[index] = 0;
+        handlers_[index] = 0;
+        dirty_ = true;
     }
     else
-        receivers_.Remove(object);
+    {
+        receivers_.Erase(index);
+        handlers_.Erase(index);
+    }
+}
+
+void EventReceiverGroup::SetHandler(Object* object, EventHandler* handler)
+{
+    unsigned index = receivers_.IndexOf(object);
+    if (index < receivers_.Size())
+        handlers_[index] = handler;
 }
 
 void RemoveNamedAttribute(HashMap<StringHash, Vector<AttributeInfo> >& attributes, StringHash objectType, const char* name)
@@ -120,7 +137,32 @@ void RemoveNamedAttribute(HashMap<StringHash, Vector<AttributeInfo> >& attribute
         attributes.Erase(i);
 }
 
+void SetNamedAttributeQuantization(HashMap<StringHash, Vector<AttributeInfo> >& attributes, StringHash objectType, const char* name,
+    unsigned bits, float min, float max)
+{
+    HashMap<StringHash, Vector<AttributeInfo> >::Iterator i = attributes.Find(objectType);
+    if (i == attributes.End())
+        return;
+
+    Vector<AttributeInfo>& infos = i->second_;
+
+    for (Vector<AttributeInfo>::Iterator j = infos.Begin(); j != infos.End(); ++j)
+    {
+        if (!j->name_.Compare(name, true))
+        {
+            j->quantizeBits_ = bits;
+            j->quantizeMin_ = min;
+            j->quantizeMax_ = max;
+            break;
+        }
+    }
+}
+
 Context::Context() :
+    eventStamp_(0),
+    dispatchReceiver_(0),
+    dispatchSender_(0),
+    dispatchHandler_(0),
     eventHandler_(0)
 {
 #ifdef __ANDROID__
@@ -188,7 +230,7 @@ void Context::RegisterSubsystem(Object* object)
 
 void Context::RemoveSubsystem(StringHash objectType)
 {
-    HashMap<StringHash, SharedPtr<Object> >::Iterator i = subsystems_.Find(objectType);
+    FlatHashMap<StringHash, SharedPtr<Object> >::Iterator i = subsystems_.Find(objectType);
     if (i != subsystems_.End())
         subsystems_.Erase(i);
 }
@@ -222,6 +264,31 @@ void Context::UpdateAttributeDefaultValue(StringHash objectType, const char* nam
         info->defaultValue_ = defaultValue;
 }
 
+void Context::SetAttributeQuantization(StringHash objectType, const char* name, unsigned bits, float min, float max)
+{
+    AttributeInfo* info = GetAttribute(objectType, name);
+    if (!info)
+        return;
+
+    switch (info->type_)
+    {
+    case VAR_FLOAT:
+    case VAR_VECTOR2:
+    case VAR_VECTOR3:
+    case VAR_VECTOR4:
+    case VAR_QUATERNION:
+        break;
+
+    default:
+        URHO3D_LOGERROR("Can not quantize attribute " + String(name) + " of type " + info->defaultValue_.GetTypeName());
+        return;
+    }
+
+    bits = Min(bits, 32U);
+    SetNamedAttributeQuantization(attributes_, objectType, name, bits, min, max);
+    SetNamedAttributeQuantization(networkAttributes_, objectType, name, bits, min, max);
+}
+
 VariantMap& Context::GetEventDataMap()
 {
     unsigned nestingLevel = eventSenders_.Size();
@@ -313,7 +380,7 @@ void Context::ReleaseIK()
 #endif // ifdef URHO3D_IK
 #endif // ifndef MINI_URHO
 
-void Context::CopyBaseAttributes(StringHash baseType, StringHash derivedType)
+void Context::CopyBaseAttributes(StringHash baseType, StringHash derivedType, bool directAccess)
 {
     // Prevent endless loop if mistakenly copying attributes from same class as derived
     if (baseType == derivedType)
@@ -327,7 +394,8 @@ void Context::CopyBaseAttributes(StringHash baseType, StringHash derivedType)
     {
         for (unsigned i = 0; i < baseAttributes->Size(); ++i)
         {
-            const AttributeInfo& attr = baseAttributes->At(i);
+            AttributeInfo attr = baseAttributes->At(i);
+            attr.directAccess_ = directAccess;
             attributes_[derivedType].Push(attr);
             if (attr.mode_ & AM_NET)
                 networkAttributes_[derivedType].Push(attr);
@@ -337,7 +405,7 @@ void Context::CopyBaseAttributes(StringHash baseType, StringHash derivedType)
 
 Object* Context::GetSubsystem(StringHash type) const
 {
-    HashMap<StringHash, SharedPtr<Object> >::ConstIterator i = subsystems_.Find(type);
+    FlatHashMap<StringHash, SharedPtr<Object> >::ConstIterator i = subsystems_.Find(type);
     if (i != subsystems_.End())
         return i->second_;
     else
@@ -387,24 +455,50 @@ AttributeInfo* Context::GetAttribute(StringHash objectType, const char* name)
     return 0;
 }
 
-void Context::AddEventReceiver(Object* receiver, StringHash eventType)
+void Context::AddEventReceiver(Object* receiver, StringHash eventType, EventHandler* handler)
 {
+    // A new handler may take priority over the one set for dispatch
+    dispatchReceiver_ = 0;
+
     SharedPtr<EventReceiverGroup>& group = eventReceivers_[eventType];
     if (!group)
         group = new EventReceiverGroup();
-    group->Add(receiver);
+    group->Add(receiver, handler);
 }
 
-void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash eventType)
+void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash eventType, EventHandler* handler)
 {
+    dispatchReceiver_ = 0;
+
     SharedPtr<EventReceiverGroup>& group = specificEventReceivers_[sender][eventType];
     if (!group)
         group = new EventReceiverGroup();
-    group->Add(receiver);
+    group->Add(receiver, handler);
+}
+
+void Context::SetEventReceiverHandler(Object* receiver, StringHash eventType, EventHandler* handler)
+{
+    // The old handler has been deleted
+    dispatchReceiver_ = 0;
+
+    EventReceiverGroup* group = GetEventReceivers(eventType);
+    if (group)
+        group->SetHandler(receiver, handler);
+}
+
+void Context::SetEventReceiverHandler(Object* receiver, Object* sender, StringHash eventType, EventHandler* handler)
+{
+    dispatchReceiver_ = 0;
+
+    EventReceiverGroup* group = GetEventReceivers(sender, eventType);
+    if (group)
+        group->SetHandler(receiver, handler);
 }
 
 void Context::RemoveEventSender(Object* sender)
 {
+    dispatchReceiver_ = 0;
+
     HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
     if (i != specificEventReceivers_.End())
     {
@@ -423,6 +517,8 @@ void Context::RemoveEventSender(Object* sender)
 
 void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
 {
+    dispatchReceiver_ = 0;
+
     EventReceiverGroup* group = GetEventReceivers(eventType);
     if (group)
         group->Remove(receiver);
@@ -430,6 +526,8 @@ void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
 
 void Context::RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType)
 {
+    dispatchReceiver_ = 0;
+
     EventReceiverGroup* group = GetEventReceivers(sender, eventType);
     if (group)
         group->Remove(receiver);
@@ -463,4 +561,62 @@ void Context::EndSendEvent()
 #endif
 }
 
+void Context::SendPostedEvents()
+{
+    if (!Thread::IsMainThread())
+    {
+        URHO3D_LOGERROR("Posted events can only be sent from the main thread");
+        return;
+    }
+
+    // Do not allow re-entrance from an event handler
+    if (!sendingEvents_.Empty())
+        return;
+
+    {
+        MutexLock lock(postedEventsMutex_);
+        sendingEvents_.Swap(postedEvents_);
+    }
+
+    // Events posted by the handlers are sent on the next call. Senders destroyed meanwhile have been nulled
+    for (unsigned i = 0; i < sendingEvents_.Size(); ++i)
+    {
+        PostedEvent& event = sendingEvents_[i];
+        if (event.sender_)
+            event.sender_->SendEvent(event.eventType_, event.eventData_);
+    }
+
+    sendingEvents_.Clear();
+}
+
+void Context::PostEvent(Object* sender, StringHash eventType, const VariantMap& eventData)
+{
+    MutexLock lock(postedEventsMutex_);
+
+    postedEvents_.Resize(postedEvents_.Size() + 1);
+    PostedEvent& event = postedEvents_.Back();
+    event.sender_ = sender;
+    event.eventType_ = eventType;
+    event.eventData_ = eventData;
+}
+
+void Context::RemovePostedEvents(Object* sender)
+{
+    for (Vector<PostedEvent>::Iterator i = sendingEvents_.Begin(); i != sendingEvents_.End(); ++i)
+    {
+        if (i->sender_ == sender)
+            i->sender_ = 0;
+    }
+
+    if (postedEvents_.Empty())
+        return;
+
+    MutexLock lock(postedEventsMutex_);
+    for (Vector<PostedEvent>::Iterator i = postedEvents_.Begin(); i != postedEvents_.End(); ++i)
+    {
+        if (i->sender_ == sender)
+            i->sender_ = 0;
+    }
+}
+
 }
@@ -22,13 +22,26 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/HashSet.h"
 #include "../Core/Attribute.h"
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
 namespace Urho3D
 {
 
+/// Event posted from any thread, to be sent later from the main thread.
+struct PostedEvent
+{
+    /// Sender. Null if destroyed before the event was sent.
+    Object* sender_;
+    /// Event type.
+    StringHash eventType_;
+    /// Event parameters.
+    VariantMap eventData_;
+};
+
 /// Tracking structure for event receivers.
 class URHO3D_API EventReceiverGroup : public RefCounted
 {
@@ -46,14 +59,19 @@ public:
     /// End event send. Clean up if necessary.
     void EndSendEvent();
 
-    /// Add receiver. Same receiver must not be double-added!
-    void Add(Object* object);
+    /// Add receiver with its event handler. Same receiver must not be double-added!
+    void Add(Object* object, EventHandler* handler);
 
     /// Remove receiver. Leave holes during send, which requires later cleanup.
     void Remove(Object* object);
 
+    /// Replace the event handler of a receiver.
+    void SetHandler(Object* object, EventHandler* handler);
+
     /// Receivers. May contain holes during sending.
     PODVector<Object*> receivers_;
+    /// Event handlers of the receivers in the same order, so that sending does not need to search them from the receivers.
+    PODVector<EventHandler*> handlers_;
 
 private:
     /// "In send" recursion counter.
@@ -94,6 +112,8 @@ public:
     void RemoveAttribute(StringHash objectType, const char* name);
     /// Update object attribute's default value.
     void UpdateAttributeDefaultValue(StringHash objectType, const char* name, const Variant& defaultValue);
+    /// Set network replication quantization of a float, vector or quaternion attribute. Components are sent with the specified number of bits, clamped to the min-max range. Quaternions use smallest-three encoding and ignore the range. Zero bits restores full precision. Must be set identically on the server and the clients.
+    void SetAttributeQuantization(StringHash objectType, const char* name, unsigned bits, float min = 0.0f, float max = 0.0f);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap();
     /// Initialises the specified SDL systems, if not already. Returns true if successful. This call must be matched with ReleaseSDL() when SDL functions are no longer required, even if this call fails.
@@ -107,8 +127,8 @@ public:
     void ReleaseIK();
 #endif
 
-    /// Copy base class attributes to derived class.
-    void CopyBaseAttributes(StringHash baseType, StringHash derivedType);
+    /// Copy base class attributes to derived class. Set directAccess only if the derived class does not override the attribute handlers.
+    void CopyBaseAttributes(StringHash baseType, StringHash derivedType, bool directAccess = false);
     /// Template version of registering an object factory.
     template <class T> void RegisterFactory();
     /// Template version of registering an object factory with category.
@@ -123,6 +143,8 @@ public:
     template <class T, class U> void CopyBaseAttributes();
     /// Template version of updating an object attribute's default value.
     template <class T> void UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue);
+    /// Template version of setting an object attribute's network quantization.
+    template <class T> void SetAttributeQuantization(const char* name, unsigned bits, float min = 0.0f, float max = 0.0f);
 
     /// Return subsystem by type.
     Object* GetSubsystem(StringHash type) const;
@@ -137,7 +159,7 @@ public:
     void SetGlobalVar(StringHash key, const Variant& value);
 
     /// Return all subsystems.
-    const HashMap<StringHash, SharedPtr<Object> >& GetSubsystems() const { return subsystems_; }
+    const FlatHashMap<StringHash, SharedPtr<Object> >& GetSubsystems() const { return subsystems_; }
 
     /// Return all object factories.
     const HashMap<StringHash, SharedPtr<ObjectFactory> >& GetObjectFactories() const { return factories_; }
@@ -177,6 +199,9 @@ public:
     /// Return all registered attributes.
     const HashMap<StringHash, Vector<AttributeInfo> >& GetAllAttributes() const { return attributes_; }
 
+    /// Send the events posted since the last call. Called from the main thread by Time at the beginning of each frame.
+    void SendPostedEvents();
+
     /// Return event receivers for a sender and event type, or null if they do not exist.
     EventReceiverGroup* GetEventReceivers(Object* sender, StringHash eventType)
     {
@@ -199,9 +224,13 @@ public:
 
 private:
     /// Add event receiver.
-    void AddEventReceiver(Object* receiver, StringHash eventType);
+    void AddEventReceiver(Object* receiver, StringHash eventType, EventHandler* handler);
     /// Add event receiver for specific event.
-    void AddEventReceiver(Object* receiver, Object* sender, StringHash eventType);
+    void AddEventReceiver(Object* receiver, Object* sender, StringHash eventType, EventHandler* handler);
+    /// Replace the handler of an event receiver.
+    void SetEventReceiverHandler(Object* receiver, StringHash eventType, EventHandler* handler);
+    /// Replace the handler of an event receiver for specific event.
+    void SetEventReceiverHandler(Object* receiver, Object* sender, StringHash eventType, EventHandler* handler);
     /// Remove an event sender from all receivers. Called on its destruction.
     void RemoveEventSender(Object* sender);
     /// Remove event receiver from specific events.
@@ -212,14 +241,34 @@ private:
     void BeginSendEvent(Object* sender, StringHash eventType);
     /// End event send. Clean up event receivers removed in the meanwhile.
     void EndSendEvent();
+    /// Queue an event to be sent from the main thread. Thread-safe.
+    void PostEvent(Object* sender, StringHash eventType, const VariantMap& eventData);
+    /// Remove pending posted events of a sender. Called on its destruction.
+    void RemovePostedEvents(Object* sender);
 
     /// Set current event handler. Called by Object.
     void SetEventHandler(EventHandler* handler) { eventHandler_ = handler; }
+    /// Set the event handler of the receiver SendEvent() is about to call. Called by Object.
+    void SetDispatchHandler(Object* receiver, Object* sender, StringHash eventType, EventHandler* handler)
+    {
+        dispatchReceiver_ = receiver;
+        dispatchSender_ = sender;
+        dispatchEventType_ = eventType;
+        dispatchHandler_ = handler;
+    }
+    /// Return and clear the event handler set by SendEvent() if it matches the receiver, sender and event type, or null otherwise. Called by Object.
+    EventHandler* TakeDispatchHandler(Object* receiver, Object* sender, StringHash eventType)
+    {
+        if (dispatchReceiver_ != receiver || dispatchSender_ != sender || dispatchEventType_ != eventType)
+            return 0;
+        dispatchReceiver_ = 0;
+        return dispatchHandler_;
+    }
 
     /// Object factories.
     HashMap<StringHash, SharedPtr<ObjectFactory> > factories_;
     /// Subsystems.
-    HashMap<StringHash, SharedPtr<Object> > subsystems_;
+    FlatHashMap<StringHash, SharedPtr<Object> > subsystems_;
     /// Attribute descriptions per object type.
     HashMap<StringHash, Vector<AttributeInfo> > attributes_;
     /// Network replication attribute descriptions per object type.
@@ -232,6 +281,24 @@ private:
     PODVector<Object*> eventSenders_;
     /// Event data stack.
     PODVector<VariantMap*> eventDataMaps_;
+    /// Stack of receivers that already got the event being sent, shared by nested sends.
+    PODVector<Object*> processedReceivers_;
+    /// Number of the last event send with specific receivers.
+    unsigned long long eventStamp_;
+    /// Receiver SendEvent() is about to call. Cleared when the receiver tables change, as the handler may be gone.
+    Object* dispatchReceiver_;
+    /// Sender of the event being delivered.
+    Object* dispatchSender_;
+    /// Type of the event being delivered.
+    StringHash dispatchEventType_;
+    /// Event handler of the receiver SendEvent() is about to call.
+    EventHandler* dispatchHandler_;
+    /// Events posted from any thread.
+    Vector<PostedEvent> postedEvents_;
+    /// Posted events being sent.
+    Vector<PostedEvent> sendingEvents_;
+    /// Posted events mutex.
+    Mutex postedEventsMutex_;
     /// Active event handler. Not stored in a stack for performance reasons; is needed only in esoteric cases.
     EventHandler* eventHandler_;
     /// Object categories.
@@ -249,11 +316,19 @@ template <class T> void Context::RegisterFactory(const char* category)
 
 template <class T> void Context::RemoveSubsystem() { RemoveSubsystem(T::GetTypeStatic()); }
 
-template <class T> void Context::RegisterAttribute(const AttributeInfo& attr) { RegisterAttribute(T::GetTypeStatic(), attr); }
+template <class T> void Context::RegisterAttribute(const AttributeInfo& attr)
+{
+    AttributeInfo info(attr);
+    info.directAccess_ = !AttributeHandlersOverridden<T>::value_;
+    RegisterAttribute(T::GetTypeStatic(), info);
+}
 
 template <class T> void Context::RemoveAttribute(const char* name) { RemoveAttribute(T::GetTypeStatic(), name); }
 
-template <class T, class U> void Context::CopyBaseAttributes() { CopyBaseAttributes(T::GetTypeStatic(), U::GetTypeStatic()); }
+template <class T, class U> void Context::CopyBaseAttributes()
+{
+    CopyBaseAttributes(T::GetTypeStatic(), U::GetTypeStatic(), !AttributeHandlersOverridden<U>::value_);
+}
 
 template <class T> T* Context::GetSubsystem() const { return static_cast<T*>(GetSubsystem(T::GetTypeStatic())); }
 
@@ -264,4 +339,9 @@ template <class T> void Context::UpdateAttributeDefaultValue(const char* name, c
     UpdateAttributeDefaultValue(T::GetTypeStatic(), name, defaultValue);
 }
 
+template <class T> void Context::SetAttributeQuantization(const char* name, unsigned bits, float min, float max)
+{
+    SetAttributeQuantization(T::GetTypeStatic(), name, bits, min, max);
+}
+
 }
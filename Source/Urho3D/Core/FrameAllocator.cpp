@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/CoreEvents.h"
+#include "../Core/FrameAllocator.h"
+#include "../Core/WorkQueue.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+FrameArena::FrameArena(unsigned size) :
+    data_(new unsigned char[size]),
+    size_(size),
+    current_(data_),
+    currentSize_(size),
+    offset_(0),
+    used_(0),
+    highWaterMark_(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    for (unsigned i = 0; i < overflowBlocks_.Size(); ++i)
+        delete[] overflowBlocks_[i];
+    delete[] data_;
+}
+
+void* FrameArena::Allocate(unsigned size, unsigned alignment)
+{
+    size_t address = (size_t)(current_ + offset_);
+    unsigned padding = (unsigned)((alignment - (address & (alignment - 1))) & (alignment - 1));
+
+    if (offset_ + padding + size > currentSize_)
+    {
+        // Out of space: continue in an overflow block for the rest of the frame
+        unsigned blockSize = Max(size + alignment, size_);
+        unsigned char* block = new unsigned char[blockSize];
+        overflowBlocks_.Push(block);
+        current_ = block;
+        currentSize_ = blockSize;
+        offset_ = 0;
+
+        address = (size_t)block;
+        padding = (unsigned)((alignment - (address & (alignment - 1))) & (alignment - 1));
+    }
+
+    void* ret = current_ + offset_ + padding;
+    offset_ += padding + size;
+    used_ += padding + size;
+    return ret;
+}
+
+bool FrameArena::Extend(void* ptr, unsigned oldSize, unsigned newSize)
+{
+    unsigned char* end = static_cast<unsigned char*>(ptr) + oldSize;
+    if (end != current_ + offset_ || newSize < oldSize)
+        return false;
+
+    unsigned extra = newSize - oldSize;
+    if (offset_ + extra > currentSize_)
+        return false;
+
+    offset_ += extra;
+    used_ += extra;
+    return true;
+}
+
+void FrameArena::Reset()
+{
+    if (used_ > highWaterMark_)
+        highWaterMark_ = used_;
+
+    if (!overflowBlocks_.Empty())
+    {
+        for (unsigned i = 0; i < overflowBlocks_.Size(); ++i)
+            delete[] overflowBlocks_[i];
+        overflowBlocks_.Clear();
+
+        // Grow so that a similar frame fits without overflow
+        delete[] data_;
+        size_ = NextPowerOfTwo(highWaterMark_);
+        data_ = new unsigned char[size_];
+    }
+
+    current_ = data_;
+    currentSize_ = size_;
+    offset_ = 0;
+    used_ = 0;
+}
+
+FrameAllocator::FrameAllocator(Context* context) :
+    Object(context)
+{
+    SetNumThreads(1);
+
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(FrameAllocator, HandleEndFrame));
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    for (unsigned i = 0; i < arenas_.Size(); ++i)
+        delete arenas_[i];
+}
+
+void FrameAllocator::SetNumThreads(unsigned numThreads)
+{
+    if (!numThreads)
+        numThreads = 1;
+
+    while (arenas_.Size() > numThreads)
+    {
+        delete arenas_.Back();
+        arenas_.Pop();
+    }
+    while (arenas_.Size() < numThreads)
+        arenas_.Push(new FrameArena());
+}
+
+unsigned FrameAllocator::GetHighWaterMark() const
+{
+    unsigned ret = 0;
+    for (unsigned i = 0; i < arenas_.Size(); ++i)
+        ret += arenas_[i]->GetHighWaterMark();
+    return ret;
+}
+
+unsigned FrameAllocator::GetMemoryUse() const
+{
+    unsigned ret = 0;
+    for (unsigned i = 0; i < arenas_.Size(); ++i)
+        ret += arenas_[i]->GetSize();
+    return ret;
+}
+
+FrameArena* GetFrameArena(Context* context, unsigned threadIndex)
+{
+    FrameAllocator* allocator = context->GetSubsystem<FrameAllocator>();
+    return allocator && threadIndex < allocator->GetNumThreads() ? &allocator->GetArena(threadIndex) : 0;
+}
+
+void FrameAllocator::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    for (unsigned i = 0; i < arenas_.Size(); ++i)
+        arenas_[i]->Reset();
+
+    // Follow worker thread creation, which may happen after this subsystem was created
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue && queue->GetNumThreads() + 1 != arenas_.Size())
+        SetNumThreads(queue->GetNumThreads() + 1);
+}
+
+}
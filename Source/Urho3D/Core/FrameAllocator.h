@@ -0,0 +1,312 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/VectorBase.h"
+#include "../Core/Object.h"
+
+#include <cstring>
+
+namespace Urho3D
+{
+
+/// Default initial size of a frame arena in bytes.
+static const unsigned DEFAULT_FRAME_ARENA_SIZE = 64 * 1024;
+
+/// Linear (bump) allocator for temporary data that does not outlive the frame. Not thread-safe; each thread uses its own arena. If a frame overflows the arena, extra blocks are allocated for the rest of the frame, and on reset the arena is enlarged to the high-water mark, so that the steady state needs no heap allocations.
+class URHO3D_API FrameArena
+{
+public:
+    /// Construct with initial size.
+    FrameArena(unsigned size = DEFAULT_FRAME_ARENA_SIZE);
+    /// Destruct. Free all memory.
+    ~FrameArena();
+
+    /// Allocate memory. It is released all at once on Reset(). Alignment must be a power of two.
+    void* Allocate(unsigned size, unsigned alignment = 16);
+    /// Grow the latest allocation in place if there is room. Return true on success.
+    bool Extend(void* ptr, unsigned oldSize, unsigned newSize);
+    /// Release all allocations. Enlarge the arena if the frame needed overflow blocks.
+    void Reset();
+
+    /// Return bytes allocated since the last reset.
+    unsigned GetUsed() const { return used_; }
+    /// Return the highest number of bytes allocated during a frame.
+    unsigned GetHighWaterMark() const { return highWaterMark_; }
+    /// Return the arena size in bytes, excluding overflow blocks.
+    unsigned GetSize() const { return size_; }
+
+private:
+    /// Prevent copy construction.
+    FrameArena(const FrameArena& rhs);
+    /// Prevent assignment.
+    FrameArena& operator =(const FrameArena& rhs);
+
+    /// Arena memory.
+    unsigned char* data_;
+    /// Arena size.
+    unsigned size_;
+    /// Block that allocations are currently made from: the arena or the latest overflow block.
+    unsigned char* current_;
+    /// Size of the current block.
+    unsigned currentSize_;
+    /// Allocation offset in the current block.
+    unsigned offset_;
+    /// Overflow blocks allocated during this frame.
+    PODVector<unsigned char*> overflowBlocks_;
+    /// Bytes allocated since the last reset, including alignment padding.
+    unsigned used_;
+    /// Highest number of bytes allocated during a frame.
+    unsigned highWaterMark_;
+};
+
+/// Vector of POD elements allocated from a frame arena. Has a subset of the PODVector interface. Memory is not freed individually, so the vector must not be used after the arena is reset. Without an arena the vector allocates from the heap like PODVector.
+template <class T> class FrameVector
+{
+public:
+    typedef T ValueType;
+    typedef RandomAccessIterator<T> Iterator;
+    typedef RandomAccessConstIterator<T> ConstIterator;
+
+    /// Construct empty. A null arena allocates from the heap.
+    explicit FrameVector(FrameArena* arena = 0) :
+        arena_(arena),
+        buffer_(0),
+        size_(0),
+        capacity_(0)
+    {
+    }
+
+    /// Copy-construct from another vector. Allocates from the same arena.
+    FrameVector(const FrameVector<T>& vector) :
+        arena_(vector.arena_),
+        buffer_(0),
+        size_(0),
+        capacity_(0)
+    {
+        *this = vector;
+    }
+
+    /// Destruct. Frees heap memory, if used.
+    ~FrameVector()
+    {
+        if (!arena_)
+            delete[] reinterpret_cast<unsigned char*>(buffer_);
+    }
+
+    /// Assign from another vector.
+    FrameVector<T>& operator =(const FrameVector<T>& rhs)
+    {
+        if (&rhs != this)
+        {
+            Resize(rhs.size_);
+            if (size_)
+                memcpy(buffer_, rhs.buffer_, size_ * sizeof(T));
+        }
+        return *this;
+    }
+
+    /// Return element at index.
+    T& operator [](unsigned index)
+    {
+        assert(index < size_);
+        return buffer_[index];
+    }
+
+    /// Return const element at index.
+    const T& operator [](unsigned index) const
+    {
+        assert(index < size_);
+        return buffer_[index];
+    }
+
+    /// Add an element at the end.
+    void Push(const T& value)
+    {
+        if (size_ == capacity_)
+            Reserve(capacity_ ? capacity_ * 2 : 16);
+        buffer_[size_++] = value;
+    }
+
+    /// Remove the last element.
+    void Pop()
+    {
+        if (size_)
+            --size_;
+    }
+
+    /// Resize the vector. New elements are uninitialized.
+    void Resize(unsigned newSize)
+    {
+        if (newSize > capacity_)
+            Reserve(Max(newSize, capacity_ * 2));
+        size_ = newSize;
+    }
+
+    /// Set new capacity.
+    void Reserve(unsigned newCapacity)
+    {
+        if (newCapacity <= capacity_)
+            return;
+
+        if (!arena_)
+        {
+            T* newBuffer = reinterpret_cast<T*>(new unsigned char[newCapacity * sizeof(T)]);
+            if (size_)
+                memcpy(newBuffer, buffer_, size_ * sizeof(T));
+            delete[] reinterpret_cast<unsigned char*>(buffer_);
+            buffer_ = newBuffer;
+        }
+        else if (!buffer_ || !arena_->Extend(buffer_, capacity_ * sizeof(T), newCapacity * sizeof(T)))
+        {
+            T* newBuffer = static_cast<T*>(arena_->Allocate(newCapacity * sizeof(T)));
+            if (size_)
+                memcpy(newBuffer, buffer_, size_ * sizeof(T));
+            buffer_ = newBuffer;
+        }
+        capacity_ = newCapacity;
+    }
+
+    /// Remove all elements. Keeps the memory.
+    void Clear() { size_ = 0; }
+
+    /// Remove all elements and set the arena to allocate from. Memory from the previous arena is dropped, so call this at the start of a frame to reuse a vector which lives across frames. A null arena allocates from the heap.
+    void SetArena(FrameArena* arena)
+    {
+        if (!arena_)
+            delete[] reinterpret_cast<unsigned char*>(buffer_);
+        arena_ = arena;
+        buffer_ = 0;
+        size_ = 0;
+        capacity_ = 0;
+    }
+
+    /// Return iterator to value, or to the end if not found.
+    Iterator Find(const T& value)
+    {
+        Iterator it = Begin();
+        while (it != End() && *it != value)
+            ++it;
+        return it;
+    }
+
+    /// Return whether contains a specific value.
+    bool Contains(const T& value) const
+    {
+        for (unsigned i = 0; i < size_; ++i)
+        {
+            if (buffer_[i] == value)
+                return true;
+        }
+        return false;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(buffer_); }
+
+    /// Return const iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(buffer_); }
+
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(buffer_ + size_); }
+
+    /// Return const iterator to the end.
+    ConstIterator End() const { return ConstIterator(buffer_ + size_); }
+
+    /// Return first element.
+    T& Front() { return buffer_[0]; }
+
+    /// Return last element.
+    T& Back()
+    {
+        assert(size_);
+        return buffer_[size_ - 1];
+    }
+
+    /// Return number of elements.
+    unsigned Size() const { return size_; }
+
+    /// Return capacity.
+    unsigned Capacity() const { return capacity_; }
+
+    /// Return whether vector is empty.
+    bool Empty() const { return size_ == 0; }
+
+    /// Return the buffer.
+    T* Buffer() const { return buffer_; }
+
+    /// Return the arena, or null if allocating from the heap.
+    FrameArena* GetArena() const { return arena_; }
+
+private:
+    /// Arena to allocate from, or null to use the heap.
+    FrameArena* arena_;
+    /// Element buffer.
+    T* buffer_;
+    /// Number of elements.
+    unsigned size_;
+    /// Capacity.
+    unsigned capacity_;
+};
+
+/// %Frame allocator subsystem. Owns one frame arena per thread and resets them at the end of each frame.
+class URHO3D_API FrameAllocator : public Object
+{
+    URHO3D_OBJECT(FrameAllocator, Object);
+
+public:
+    /// Construct.
+    FrameAllocator(Context* context);
+    /// Destruct.
+    ~FrameAllocator();
+
+    /// Set number of threads that need an arena, including the main thread. Call only from the main thread while no work items are running.
+    void SetNumThreads(unsigned numThreads);
+
+    /// Return the arena of a thread. Index 0 is the main thread and 1 and up are the worker threads, matching the thread index passed to work item functions.
+    FrameArena& GetArena(unsigned threadIndex = 0) const
+    {
+        assert(threadIndex < arenas_.Size());
+        return *arenas_[threadIndex];
+    }
+
+    /// Return number of arenas.
+    unsigned GetNumThreads() const { return arenas_.Size(); }
+    /// Return the sum of the arenas' high-water marks in bytes.
+    unsigned GetHighWaterMark() const;
+    /// Return the total size of the arenas in bytes.
+    unsigned GetMemoryUse() const;
+
+private:
+    /// Handle end of frame. Reset all arenas.
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+
+    /// Per-thread arenas.
+    PODVector<FrameArena*> arenas_;
+};
+
+/// Return the frame arena of a thread from the context's frame allocator subsystem, or null if there is no subsystem or no arena for the thread yet. Frame vectors constructed with a null arena fall back to the heap.
+URHO3D_API FrameArena* GetFrameArena(Context* context, unsigned threadIndex = 0);
+
+}
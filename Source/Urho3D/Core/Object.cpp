@@ -71,8 +71,21 @@ bool TypeInfo::IsTypeOf(const TypeInfo* typeInfo) const
     return false;
 }
 
+/// Return whether a receiver is in a range of receivers.
+static bool ContainsReceiver(Object** begin, Object** end, Object* receiver)
+{
+    for (Object** i = begin; i != end; ++i)
+    {
+        if (*i == receiver)
+            return true;
+    }
+
+    return false;
+}
+
 Object::Object(Context* context) :
-    context_(context)
+    context_(context),
+    eventStamp_(0)
 {
     assert(context_);
 }
@@ -81,16 +94,28 @@ Object::~Object()
 {
     UnsubscribeFromAllEvents();
     context_->RemoveEventSender(this);
+    context_->RemovePostedEvents(this);
 }
 
 void Object::OnEvent(Object* sender, StringHash eventType, VariantMap& eventData)
 {
     // Make a copy of the context pointer in case the object is destroyed during event handler invocation
     Context* context = context_;
+
+    // Use the handler already looked up from the receiver tables, if the event is being delivered by SendEvent()
+    EventHandler* handler = context->TakeDispatchHandler(this, sender, eventType);
+    if (handler)
+    {
+        context->SetEventHandler(handler);
+        handler->Invoke(eventData);
+        context->SetEventHandler(0);
+        return;
+    }
+
     EventHandler* specific = 0;
     EventHandler* nonSpecific = 0;
 
-    EventHandler* handler = eventHandlers_.First();
+    handler = eventHandlers_.First();
     while (handler)
     {
         if (handler->GetEventType() == eventType)
@@ -146,11 +171,12 @@ void Object::SubscribeToEvent(StringHash eventType, EventHandler* handler)
     {
         eventHandlers_.Erase(oldHandler, previous);
         eventHandlers_.InsertFront(handler);
+        context_->SetEventReceiverHandler(this, eventType, handler);
     }
     else
     {
         eventHandlers_.InsertFront(handler);
-        context_->AddEventReceiver(this, eventType);
+        context_->AddEventReceiver(this, eventType, handler);
     }
 }
 
@@ -171,11 +197,12 @@ void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler
     {
         eventHandlers_.Erase(oldHandler, previous);
         eventHandlers_.InsertFront(handler);
+        context_->SetEventReceiverHandler(this, sender, eventType, handler);
     }
     else
     {
         eventHandlers_.InsertFront(handler);
-        context_->AddEventReceiver(this, sender, eventType);
+        context_->AddEventReceiver(this, sender, eventType, handler);
     }
 }
 
@@ -304,7 +331,12 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     // Make a weak pointer to self to check for destruction during event handling
     WeakPtr<Object> self(this);
     Context* context = context_;
-    HashSet<Object*> processed;
+    // Receivers that got the event as specific receivers are stamped with the number of this send, to skip them as
+    // non-specific receivers. A nested send may stamp them again, so they are also collected on top of the context's shared
+    // stack. Nested sends pop their own entries before returning, so no allocation is needed per send
+    PODVector<Object*>& processed = context->processedReceivers_;
+    unsigned processedStart = processed.Size();
+    unsigned long long stamp = 0;
 
     context->BeginSendEvent(this, eventType);
 
@@ -322,6 +354,12 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
             if (!receiver)
                 continue;
 
+            if (!stamp)
+                stamp = ++context->eventStamp_;
+            receiver->eventStamp_ = stamp;
+            processed.Push(receiver);
+
+            context->SetDispatchHandler(receiver, this, eventType, group->handlers_[i]);
             receiver->OnEvent(this, eventType, eventData);
 
             // If self has been destroyed as a result of event handling, exit
@@ -329,10 +367,9 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
             {
                 group->EndSendEvent();
                 context->EndSendEvent();
+                processed.Resize(processedStart);
                 return;
             }
-
-            processed.Insert(receiver);
         }
 
         group->EndSendEvent();
@@ -344,41 +381,27 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     {
         group->BeginSendEvent();
 
-        if (processed.Empty())
-        {
-            for (unsigned i = 0; i < group->receivers_.Size(); ++i)
-            {
-                Object* receiver = group->receivers_[i];
-                if (!receiver)
-                    continue;
-
-                receiver->OnEvent(this, eventType, eventData);
-
-                if (self.Expired())
-                {
-                    group->EndSendEvent();
-                    context->EndSendEvent();
-                    return;
-                }
-            }
-        }
-        else
+        for (unsigned i = 0; i < group->receivers_.Size(); ++i)
         {
-            // If there were specific receivers, check that the event is not sent doubly to them
-            for (unsigned i = 0; i < group->receivers_.Size(); ++i)
+            Object* receiver = group->receivers_[i];
+            if (!receiver)
+                continue;
+
+            // If there were specific receivers, check that the event is not sent doubly to them. A stamp from a later send
+            // means a nested send has overwritten it, so only then the collected receivers need to be searched
+            if (stamp && receiver->eventStamp_ >= stamp && (receiver->eventStamp_ == stamp ||
+                ContainsReceiver(processed.Buffer() + processedStart, processed.Buffer() + processed.Size(), receiver)))
+                continue;
+
+            context->SetDispatchHandler(receiver, this, eventType, group->handlers_[i]);
+            receiver->OnEvent(this, eventType, eventData);
+
+            if (self.Expired())
             {
-                Object* receiver = group->receivers_[i];
-                if (!receiver || processed.Contains(receiver))
-                    continue;
-
-                receiver->OnEvent(this, eventType, eventData);
-
-                if (self.Expired())
-                {
-                    group->EndSendEvent();
-                    context->EndSendEvent();
-                    return;
-                }
+                group->EndSendEvent();
+                context->EndSendEvent();
+                processed.Resize(processedStart);
+                return;
             }
         }
 
@@ -386,6 +409,17 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     }
 
     context->EndSendEvent();
+    processed.Resize(processedStart);
+}
+
+void Object::PostEvent(StringHash eventType)
+{
+    context_->PostEvent(this, eventType, Variant::emptyVariantMap);
+}
+
+void Object::PostEvent(StringHash eventType, const VariantMap& eventData)
+{
+    context_->PostEvent(this, eventType, eventData);
 }
 
 VariantMap& Object::GetEventDataMap() const
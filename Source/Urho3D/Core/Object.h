@@ -130,6 +130,10 @@ public:
     void SendEvent(StringHash eventType);
     /// Send event with parameters to all subscribers.
     void SendEvent(StringHash eventType, VariantMap& eventData);
+    /// Post event to be sent from the main thread at the beginning of the next frame. Thread-safe. The object must stay alive until then, or be destroyed in the main thread.
+    void PostEvent(StringHash eventType);
+    /// Post event with parameters to be sent from the main thread at the beginning of the next frame. Thread-safe. The parameters must not contain reference counted pointers.
+    void PostEvent(StringHash eventType, const VariantMap& eventData);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap() const;
 #if URHO3D_CXX11
@@ -183,6 +187,8 @@ private:
 
     /// Event handlers. Sender is null for non-specific handlers.
     LinkedList<EventHandler> eventHandlers_;
+    /// Number of the last event send which delivered the event to this object as a specific receiver.
+    unsigned long long eventStamp_;
 };
 
 template <class T> T* Object::GetSubsystem() const { return static_cast<T*>(GetSubsystem(T::GetTypeStatic())); }
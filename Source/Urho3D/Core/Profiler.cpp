@@ -23,6 +23,8 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../IO/File.h"
+#include "../IO/Log.h"
 
 #include <cstdio>
 
@@ -31,17 +33,95 @@
 namespace Urho3D
 {
 
+/// Profiling block begin or end event recorded by a thread.
+struct ProfilerEvent
+{
+    /// Block name, empty for an end event. Copied, as the name may not live until the end of the frame.
+    char name_[PROFILER_EVENT_NAME_LENGTH];
+    /// Time in microseconds since the profiler was created.
+    long long time_;
+};
+
+/// Profiling data of one thread.
+struct ProfilerThread
+{
+    /// Construct.
+    ProfilerThread(ThreadID id, unsigned index, const String& name) :
+        id_(id),
+        index_(index),
+        name_(name),
+        root_(0, name.CString()),
+        current_(&root_)
+    {
+    }
+
+    /// Thread ID.
+    ThreadID id_;
+    /// Thread index in the trace output, 0 is the main thread.
+    unsigned index_;
+    /// Thread name.
+    String name_;
+    /// Events recorded by the thread during the frame.
+    PODVector<ProfilerEvent> events_;
+    /// Events being processed in the main thread.
+    PODVector<ProfilerEvent> processEvents_;
+    /// Begin events of the blocks not yet ended.
+    PODVector<ProfilerEvent> openEvents_;
+    /// Mutex for the recorded events.
+    Mutex mutex_;
+    /// Root profiling block.
+    ProfilerBlock root_;
+    /// Current profiling block.
+    ProfilerBlock* current_;
+};
+
+/// Append a quoted JSON string to the trace output, escaping the characters which would make it invalid.
+static void AppendTraceString(String& dest, const char* str)
+{
+    dest += '"';
+    for (; *str; ++str)
+    {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\')
+        {
+            dest += '\\';
+            dest += (char)c;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            sprintf(escaped, "\\u%04x", c);
+            dest.Append(escaped);
+        }
+        else
+            dest += (char)c;
+    }
+    dest += '"';
+}
+
 Profiler::Profiler(Context* context) :
     Object(context),
     current_(0),
     root_(0),
-    intervalFrames_(0)
+    intervalFrames_(0),
+    mainThread_(0),
+    numThreads_(0),
+    traceFrames_(0)
 {
     current_ = root_ = new ProfilerBlock(0, "RunFrame");
+    mainThread_ = new ProfilerThread(Thread::GetCurrentThreadID(), 0, "Main thread");
 }
 
 Profiler::~Profiler()
 {
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        delete threads_[i];
+        threads_[i] = 0;
+    }
+
+    delete mainThread_;
+    mainThread_ = 0;
     delete root_;
     root_ = 0;
 }
@@ -53,6 +133,8 @@ void Profiler::BeginFrame()
         EndFrame();
 
     root_->Begin();
+    if (traceFrames_)
+        RecordMainThreadEvent(root_->name_);
 }
 
 void Profiler::EndFrame()
@@ -61,14 +143,190 @@ void Profiler::EndFrame()
     ++intervalFrames_;
     root_->EndFrame();
     current_ = root_;
+
+    // Merge the data recorded by the other threads during the frame
+    ProcessThreadEvents(mainThread_, false);
+    for (unsigned i = 0; i < numThreads_; ++i)
+        ProcessThreadEvents(threads_[i], true);
+
+    if (traceFrames_ && --traceFrames_ == 0)
+        EndTraceCapture();
 }
 
 void Profiler::BeginInterval()
 {
     root_->BeginInterval();
+    for (unsigned i = 0; i < numThreads_; ++i)
+        threads_[i]->root_.BeginInterval();
     intervalFrames_ = 0;
 }
 
+bool Profiler::BeginTraceCapture(unsigned numFrames, const String& fileName)
+{
+    if (!numFrames || fileName.Empty())
+        return false;
+
+    if (traceFrames_)
+    {
+        URHO3D_LOGWARNING("Profiler trace capture already in progress");
+        return false;
+    }
+
+    traceFrames_ = numFrames;
+    traceFileName_ = fileName;
+    traceOutput_ = "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Urho3D\"}}";
+    return true;
+}
+
+const ProfilerBlock* Profiler::GetThreadRootBlock(unsigned index) const
+{
+    return index < numThreads_ ? &threads_[index]->root_ : 0;
+}
+
+void Profiler::RecordThreadEvent(const char* name)
+{
+    ThreadID id = Thread::GetCurrentThreadID();
+    ProfilerThread* thread = 0;
+
+    unsigned numThreads = numThreads_;
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        if (threads_[i]->id_ == id)
+        {
+            thread = threads_[i];
+            break;
+        }
+    }
+
+    // Register the thread on its first event. The thread pointer is stored before increasing the count, so that the lookup
+    // above does not need the mutex
+    if (!thread)
+    {
+        MutexLock lock(threadsMutex_);
+        if (numThreads_ >= MAX_PROFILER_THREADS)
+            return;
+
+        unsigned index = numThreads_ + 1;
+        thread = new ProfilerThread(id, index, "Thread " + String(index));
+        threads_[numThreads_] = thread;
+        ++numThreads_;
+    }
+
+    ProfilerEvent event;
+    if (name)
+    {
+        strncpy(event.name_, name, PROFILER_EVENT_NAME_LENGTH - 1);
+        event.name_[PROFILER_EVENT_NAME_LENGTH - 1] = 0;
+    }
+    else
+        event.name_[0] = 0;
+    event.time_ = eventTimer_.GetUSec(false);
+
+    MutexLock lock(thread->mutex_);
+    thread->events_.Push(event);
+}
+
+void Profiler::RecordMainThreadEvent(const char* name)
+{
+    ProfilerEvent event;
+    if (name)
+    {
+        strncpy(event.name_, name, PROFILER_EVENT_NAME_LENGTH - 1);
+        event.name_[PROFILER_EVENT_NAME_LENGTH - 1] = 0;
+    }
+    else
+        event.name_[0] = 0;
+    event.time_ = eventTimer_.GetUSec(false);
+
+    mainThread_->events_.Push(event);
+}
+
+void Profiler::ProcessThreadEvents(ProfilerThread* thread, bool updateTree)
+{
+    // Swap the buffers to hold the thread's mutex only briefly. Both buffers keep their capacity over frames
+    {
+        MutexLock lock(thread->mutex_);
+        thread->processEvents_.Swap(thread->events_);
+    }
+
+    long long busyTime = 0;
+    bool active = false;
+
+    for (PODVector<ProfilerEvent>::ConstIterator i = thread->processEvents_.Begin(); i != thread->processEvents_.End(); ++i)
+    {
+        if (i->name_[0])
+        {
+            if (updateTree)
+                thread->current_ = thread->current_->GetChild(i->name_);
+            thread->openEvents_.Push(*i);
+        }
+        else if (thread->openEvents_.Size())
+        {
+            const ProfilerEvent& begin = thread->openEvents_.Back();
+            long long time = i->time_ - begin.time_;
+
+            if (updateTree)
+            {
+                thread->current_->AddTime(time);
+                if (thread->current_->parent_)
+                    thread->current_ = thread->current_->parent_;
+            }
+
+            // Count the time spent in top-level blocks as the busy time of the thread
+            if (thread->openEvents_.Size() == 1)
+            {
+                busyTime += time;
+                active = true;
+            }
+
+            if (traceFrames_)
+            {
+                char line[256];
+                traceOutput_ += ",\n{\"name\":";
+                AppendTraceString(traceOutput_, begin.name_);
+                sprintf(line, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}", thread->index_, begin.time_, time);
+                traceOutput_.Append(line);
+            }
+
+            thread->openEvents_.Pop();
+        }
+    }
+
+    thread->processEvents_.Clear();
+
+    if (updateTree)
+    {
+        if (active)
+            thread->root_.AddTime(busyTime);
+        thread->root_.EndFrame();
+    }
+}
+
+void Profiler::EndTraceCapture()
+{
+    char line[256];
+    traceOutput_ += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":";
+    AppendTraceString(traceOutput_, mainThread_->name_.CString());
+    traceOutput_ += "}}";
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        sprintf(line, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", threads_[i]->index_);
+        traceOutput_.Append(line);
+        AppendTraceString(traceOutput_, threads_[i]->name_.CString());
+        traceOutput_ += "}}";
+    }
+    traceOutput_ += "\n]}\n";
+
+    File file(context_, traceFileName_, FILE_WRITE);
+    if (file.IsOpen() && file.Write(traceOutput_.CString(), traceOutput_.Length()) == traceOutput_.Length())
+        URHO3D_LOGINFO("Wrote profiler trace to " + traceFileName_);
+    else
+        URHO3D_LOGERROR("Failed to write profiler trace to " + traceFileName_);
+
+    traceOutput_.Clear();
+    traceFileName_.Clear();
+}
+
 const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxDepth) const
 {
     static String output;
@@ -85,6 +343,8 @@ const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxD
         maxDepth = 1;
 
     PrintData(root_, output, 0, maxDepth, showUnused, showTotal);
+    for (unsigned i = 0; i < numThreads_; ++i)
+        PrintData(&threads_[i]->root_, output, 0, maxDepth, showUnused, showTotal);
 
     return output;
 }
@@ -23,12 +23,20 @@
 #pragma once
 
 #include "../Container/Str.h"
+#include "../Core/Mutex.h"
 #include "../Core/Thread.h"
 #include "../Core/Timer.h"
 
 namespace Urho3D
 {
 
+/// Maximum number of threads other than the main thread that can record profiling data.
+static const unsigned MAX_PROFILER_THREADS = 64;
+/// Maximum length of a block name recorded by threads other than the main thread, including the terminating zero.
+static const unsigned PROFILER_EVENT_NAME_LENGTH = 32;
+
+struct ProfilerThread;
+
 /// Profiling data for one block in the profiling tree.
 class URHO3D_API ProfilerBlock
 {
@@ -86,6 +94,15 @@ public:
         time_ += time;
     }
 
+    /// Add a call which was timed elsewhere, for example in another thread.
+    void AddTime(long long time)
+    {
+        ++count_;
+        if (time > maxTime_)
+            maxTime_ = time;
+        time_ += time;
+    }
+
     /// End profiling frame and update interval and total values.
     void EndFrame()
     {
@@ -179,26 +196,35 @@ public:
     /// Destruct.
     virtual ~Profiler();
 
-    /// Begin timing a profiling block.
+    /// Begin timing a profiling block. In other than the main thread, the block is recorded into the thread's buffer and merged into the thread's profiling tree at the end of the frame.
     void BeginBlock(const char* name)
     {
-        // Profiler supports only the main thread currently
         if (!Thread::IsMainThread())
+        {
+            RecordThreadEvent(name);
             return;
+        }
 
         current_ = current_->GetChild(name);
         current_->Begin();
+        if (traceFrames_)
+            RecordMainThreadEvent(name);
     }
 
     /// End timing the current profiling block.
     void EndBlock()
     {
         if (!Thread::IsMainThread())
+        {
+            RecordThreadEvent(0);
             return;
+        }
 
         current_->End();
         if (current_->parent_)
             current_ = current_->parent_;
+        if (traceFrames_)
+            RecordMainThreadEvent(0);
     }
 
     /// Begin the profiling frame. Called by HandleBeginFrame().
@@ -207,6 +233,8 @@ public:
     void EndFrame();
     /// Begin a new interval.
     void BeginInterval();
+    /// Begin capturing the specified number of frames from all threads. Once captured, the timelines are written into a file in the Chrome trace event JSON format. Return true if started.
+    bool BeginTraceCapture(unsigned numFrames, const String& fileName);
 
     /// Return profiling data as text output. This method is not thread-safe.
     const String& PrintData(bool showUnused = false, bool showTotal = false, unsigned maxDepth = M_MAX_UNSIGNED) const;
@@ -214,10 +242,24 @@ public:
     const ProfilerBlock* GetCurrentBlock() { return current_; }
     /// Return the root profiling block.
     const ProfilerBlock* GetRootBlock() { return root_; }
+    /// Return number of other threads that have recorded profiling data.
+    unsigned GetNumThreads() const { return numThreads_; }
+    /// Return the root profiling block of another thread by index. The profiling tree is updated at the end of each frame.
+    const ProfilerBlock* GetThreadRootBlock(unsigned index) const;
+    /// Return whether a trace capture is in progress.
+    bool IsCapturingTrace() const { return traceFrames_ > 0; }
 
 protected:
     /// Return profiling data as text output for a specified profiling block.
     void PrintData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const;
+    /// Record a block begin (name non-null) or end event from other than the main thread.
+    void RecordThreadEvent(const char* name);
+    /// Record a block begin (name non-null) or end event from the main thread for trace capture.
+    void RecordMainThreadEvent(const char* name);
+    /// Process the events recorded by a thread during the frame: update its profiling tree if requested, and append to the trace if capturing.
+    void ProcessThreadEvents(ProfilerThread* thread, bool updateTree);
+    /// Finish the trace capture and write it to the file.
+    void EndTraceCapture();
 
     /// Current profiling block.
     ProfilerBlock* current_;
@@ -225,6 +267,22 @@ protected:
     ProfilerBlock* root_;
     /// Frames in the current interval.
     unsigned intervalFrames_;
+    /// Main thread data for trace capture.
+    ProfilerThread* mainThread_;
+    /// Profiling data of other threads. Only appended to, and never removed while the profiler exists.
+    ProfilerThread* threads_[MAX_PROFILER_THREADS];
+    /// Number of other threads.
+    volatile unsigned numThreads_;
+    /// Mutex for registering new threads.
+    Mutex threadsMutex_;
+    /// Timer for the event timestamps, started when the profiler is created.
+    HiresTimer eventTimer_;
+    /// Frames left to capture to the trace.
+    unsigned traceFrames_;
+    /// Trace output file name.
+    String traceFileName_;
+    /// Trace JSON output being built.
+    String traceOutput_;
 };
 
 /// Helper class for automatically beginning and ending a profiling block
@@ -42,6 +42,7 @@ static DWORD WINAPI ThreadFunctionStatic(void* data)
 {
     Thread* thread = static_cast<Thread*>(data);
     thread->ThreadFunction();
+    AllocatorReleaseThreadCache();
     return 0;
 }
 
@@ -51,6 +52,7 @@ static void* ThreadFunctionStatic(void* data)
 {
     Thread* thread = static_cast<Thread*>(data);
     thread->ThreadFunction();
+    AllocatorReleaseThreadCache();
     pthread_exit((void*)0);
     return 0;
 }
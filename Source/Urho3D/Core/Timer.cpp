@@ -22,6 +22,7 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
 
@@ -125,6 +126,9 @@ void Time::BeginFrame(float timeStep)
         eventData[P_TIMESTEP] = timeStep_;
         SendEvent(E_BEGINFRAME, eventData);
     }
+
+    // Send the events posted from other threads during the previous frame
+    context_->SendPostedEvents();
 }
 
 void Time::EndFrame()
@@ -109,11 +109,11 @@ Variant& Variant::operator =(const Variant& rhs)
         break;
 
     case VAR_MATRIX3:
-        *(reinterpret_cast<Matrix3*>(value_.ptr_)) = *(reinterpret_cast<const Matrix3*>(rhs.value_.ptr_));
+        *(reinterpret_cast<Matrix3*>(&value_)) = *(reinterpret_cast<const Matrix3*>(&rhs.value_));
         break;
 
     case VAR_MATRIX3X4:
-        *(reinterpret_cast<Matrix3x4*>(value_.ptr_)) = *(reinterpret_cast<const Matrix3x4*>(rhs.value_.ptr_));
+        *(reinterpret_cast<Matrix3x4*>(&value_)) = *(reinterpret_cast<const Matrix3x4*>(&rhs.value_));
         break;
 
     case VAR_MATRIX4:
@@ -200,10 +200,10 @@ bool Variant::operator ==(const Variant& rhs) const
         return *(reinterpret_cast<const IntVector3*>(&value_)) == *(reinterpret_cast<const IntVector3*>(&rhs.value_));
 
     case VAR_MATRIX3:
-        return *(reinterpret_cast<const Matrix3*>(value_.ptr_)) == *(reinterpret_cast<const Matrix3*>(rhs.value_.ptr_));
+        return *(reinterpret_cast<const Matrix3*>(&value_)) == *(reinterpret_cast<const Matrix3*>(&rhs.value_));
 
     case VAR_MATRIX3X4:
-        return *(reinterpret_cast<const Matrix3x4*>(value_.ptr_)) == *(reinterpret_cast<const Matrix3x4*>(rhs.value_.ptr_));
+        return *(reinterpret_cast<const Matrix3x4*>(&value_)) == *(reinterpret_cast<const Matrix3x4*>(&rhs.value_));
 
     case VAR_MATRIX4:
         return *(reinterpret_cast<const Matrix4*>(value_.ptr_)) == *(reinterpret_cast<const Matrix4*>(rhs.value_.ptr_));
@@ -457,10 +457,10 @@ String Variant::ToString() const
         return (reinterpret_cast<const IntVector3*>(&value_))->ToString();
 
     case VAR_MATRIX3:
-        return (reinterpret_cast<const Matrix3*>(value_.ptr_))->ToString();
+        return (reinterpret_cast<const Matrix3*>(&value_))->ToString();
 
     case VAR_MATRIX3X4:
-        return (reinterpret_cast<const Matrix3x4*>(value_.ptr_))->ToString();
+        return (reinterpret_cast<const Matrix3x4*>(&value_))->ToString();
 
     case VAR_MATRIX4:
         return (reinterpret_cast<const Matrix4*>(value_.ptr_))->ToString();
@@ -556,10 +556,10 @@ bool Variant::IsZero() const
         return *reinterpret_cast<const WeakPtr<RefCounted>*>(&value_) == (RefCounted*)0;
 
     case VAR_MATRIX3:
-        return *reinterpret_cast<const Matrix3*>(value_.ptr_) == Matrix3::IDENTITY;
+        return *reinterpret_cast<const Matrix3*>(&value_) == Matrix3::IDENTITY;
 
     case VAR_MATRIX3X4:
-        return *reinterpret_cast<const Matrix3x4*>(value_.ptr_) == Matrix3x4::IDENTITY;
+        return *reinterpret_cast<const Matrix3x4*>(&value_) == Matrix3x4::IDENTITY;
 
     case VAR_MATRIX4:
         return *reinterpret_cast<const Matrix4*>(value_.ptr_) == Matrix4::IDENTITY;
@@ -614,16 +614,8 @@ void Variant::SetType(VariantType newType)
         (reinterpret_cast<WeakPtr<RefCounted>*>(&value_))->~WeakPtr<RefCounted>();
         break;
 
-    case VAR_MATRIX3:
-        delete reinterpret_cast<Matrix3*>(value_.ptr_);
-        break;
-
-    case VAR_MATRIX3X4:
-        delete reinterpret_cast<Matrix3x4*>(value_.ptr_);
-        break;
-
     case VAR_MATRIX4:
-        delete reinterpret_cast<Matrix4*>(value_.ptr_);
+        AllocatorFree(value_.ptr_, sizeof(Matrix4));
         break;
 
     default:
@@ -667,15 +659,15 @@ void Variant::SetType(VariantType newType)
         break;
 
     case VAR_MATRIX3:
-        value_.ptr_ = new Matrix3();
+        new(reinterpret_cast<Matrix3*>(&value_)) Matrix3();
         break;
 
     case VAR_MATRIX3X4:
-        value_.ptr_ = new Matrix3x4();
+        new(reinterpret_cast<Matrix3x4*>(&value_)) Matrix3x4();
         break;
 
     case VAR_MATRIX4:
-        value_.ptr_ = new Matrix4();
+        value_.ptr_ = new(AllocatorAllocate(sizeof(Matrix4))) Matrix4();
         break;
 
     default:
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/FlatMap.h"
 #include "../Container/HashMap.h"
 #include "../Container/Ptr.h"
 #include "../Math/Color.h"
@@ -66,7 +67,10 @@ enum VariantType
     MAX_VAR_TYPES
 };
 
-/// Union for the possible variant values. Also stores non-POD objects such as String and math objects (excluding Matrix) which must not exceed 16 bytes in size (or 32 bytes in a 64-bit build.) Objects exceeding the limit are allocated on the heap and pointed to by _ptr.
+/// Size of the inline storage of a Variant, which fits a Matrix3x4.
+static const unsigned VARIANT_VALUE_SIZE = 48;
+
+/// Union for the possible variant values. Also stores non-POD objects such as String, VariantMap and math objects up to Matrix3x4 (VARIANT_VALUE_SIZE bytes). Matrix4, which exceeds the limit, is allocated from the size-class pool and pointed to by ptr_.
 struct VariantValue
 {
     union
@@ -97,6 +101,9 @@ struct VariantValue
         float float4_;
         void* ptr4_;
     };
+
+    /// Remaining storage up to VARIANT_VALUE_SIZE.
+    unsigned char storage_[VARIANT_VALUE_SIZE - 4 * sizeof(void*)];
 };
 
 class Variant;
@@ -108,8 +115,11 @@ typedef Vector<Variant> VariantVector;
 /// Vector of strings.
 typedef Vector<String> StringVector;
 
-/// Map of variants.
-typedef HashMap<StringHash, Variant> VariantMap;
+/// Map of variants. Sorted by key; optimized for the few parameters of events. Unlike the HashMap it replaces, it does not keep
+/// values in place: a reference returned by operator [] or Find() is invalidated by a later insertion or erase, so look the
+/// value up again after modifying the map. Iteration is in key hash order instead of insertion order, so for example node and
+/// scene variables are saved to XML and JSON, and replicated, in hash order.
+typedef FlatMap<StringHash, Variant> VariantMap;
 
 /// Typed resource reference.
 struct URHO3D_API ResourceRef
@@ -698,7 +708,7 @@ public:
     Variant& operator =(const Matrix3& rhs)
     {
         SetType(VAR_MATRIX3);
-        *(reinterpret_cast<Matrix3*>(value_.ptr_)) = rhs;
+        *(reinterpret_cast<Matrix3*>(&value_)) = rhs;
         return *this;
     }
 
@@ -706,7 +716,7 @@ public:
     Variant& operator =(const Matrix3x4& rhs)
     {
         SetType(VAR_MATRIX3X4);
-        *(reinterpret_cast<Matrix3x4*>(value_.ptr_)) = rhs;
+        *(reinterpret_cast<Matrix3x4*>(&value_)) = rhs;
         return *this;
     }
 
@@ -865,13 +875,13 @@ public:
     /// Test for equality with a Matrix3. To return true, both the type and value must match.
     bool operator ==(const Matrix3& rhs) const
     {
-        return type_ == VAR_MATRIX3 ? *(reinterpret_cast<const Matrix3*>(value_.ptr_)) == rhs : false;
+        return type_ == VAR_MATRIX3 ? *(reinterpret_cast<const Matrix3*>(&value_)) == rhs : false;
     }
 
     /// Test for equality with a Matrix3x4. To return true, both the type and value must match.
     bool operator ==(const Matrix3x4& rhs) const
     {
-        return type_ == VAR_MATRIX3X4 ? *(reinterpret_cast<const Matrix3x4*>(value_.ptr_)) == rhs : false;
+        return type_ == VAR_MATRIX3X4 ? *(reinterpret_cast<const Matrix3x4*>(&value_)) == rhs : false;
     }
 
     /// Test for equality with a Matrix4. To return true, both the type and value must match.
@@ -1167,13 +1177,13 @@ public:
     /// Return a Matrix3 or identity on type mismatch.
     const Matrix3& GetMatrix3() const
     {
-        return type_ == VAR_MATRIX3 ? *(reinterpret_cast<const Matrix3*>(value_.ptr_)) : Matrix3::IDENTITY;
+        return type_ == VAR_MATRIX3 ? *(reinterpret_cast<const Matrix3*>(&value_)) : Matrix3::IDENTITY;
     }
 
     /// Return a Matrix3x4 or identity on type mismatch.
     const Matrix3x4& GetMatrix3x4() const
     {
-        return type_ == VAR_MATRIX3X4 ? *(reinterpret_cast<const Matrix3x4*>(value_.ptr_)) : Matrix3x4::IDENTITY;
+        return type_ == VAR_MATRIX3X4 ? *(reinterpret_cast<const Matrix3x4*>(&value_)) : Matrix3x4::IDENTITY;
     }
 
     /// Return a Matrix4 or identity on type mismatch.
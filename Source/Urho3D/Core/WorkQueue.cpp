@@ -31,6 +31,9 @@
 namespace Urho3D
 {
 
+/// How many ParallelFor() chunks to create per thread, so that threads finishing early can steal the remaining ones.
+static const unsigned PARALLEL_CHUNKS_PER_THREAD = 4;
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -60,8 +63,34 @@ private:
     unsigned index_;
 };
 
+/// Prioritized work item queue of one thread. Other threads may steal items from it when idle.
+class WorkerQueue : public RefCounted
+{
+public:
+    /// Insert a work item according to its priority. The mutex must be held.
+    void Insert(WorkItem* item)
+    {
+        for (List<WorkItem*>::Iterator i = items_.Begin(); i != items_.End(); ++i)
+        {
+            if ((*i)->priority_ <= item->priority_)
+            {
+                items_.Insert(i, item);
+                return;
+            }
+        }
+
+        items_.Push(item);
+    }
+
+    /// Work items sorted by descending priority. Pointers are guaranteed to be valid (point to workItems.)
+    List<WorkItem*> items_;
+    /// Queue mutex.
+    Mutex mutex_;
+};
+
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
+    nextQueue_(0),
     shutDown_(false),
     pausing_(false),
     paused_(false),
@@ -70,6 +99,9 @@ WorkQueue::WorkQueue(Context* context) :
     lastSize_(0),
     maxNonThreadedWorkMs_(5)
 {
+    // The main thread queue always exists, also when no worker threads are created
+    queues_.Push(SharedPtr<WorkerQueue>(new WorkerQueue()));
+
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -94,6 +126,10 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
 
+    // Create the queues first, as the threads will begin stealing from all of them
+    for (unsigned i = 0; i < numThreads; ++i)
+        queues_.Push(SharedPtr<WorkerQueue>(new WorkerQueue()));
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -109,8 +145,10 @@ SharedPtr<WorkItem> WorkQueue::GetFreeItem()
 {
     if (poolItems_.Size() > 0)
     {
-        SharedPtr<WorkItem> item = poolItems_.Front();
-        poolItems_.PopFront();
+        // Reuse the most recently returned item, which is likely still in cache and has its dependents vector already
+        // allocated. The oldest items at the front are the ones purged
+        SharedPtr<WorkItem> item = poolItems_.Back();
+        poolItems_.Pop();
         return item;
     }
     else
@@ -137,37 +175,65 @@ void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
     // Clear completed flag in case item is reused
     workItems_.Push(item);
     item->completed_ = false;
+    item->finished_ = false;
+    item->pendingDependencies_ = 0;
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.Acquire();
+    // Distribute the items round-robin, so that each thread only contends for its own queue as long as there is work
+    QueueItem(item, nextQueue_);
+    if (++nextQueue_ >= queues_.Size())
+        nextQueue_ = 0;
 
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
-    else
+    if (threads_.Size())
+        Resume();
+}
+
+void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item, const PODVector<WorkItem*>& dependencies)
+{
+    if (!item)
+    {
+        URHO3D_LOGERROR("Null work item submitted to the work queue");
+        return;
+    }
+
+    assert(!workItems_.Contains(item));
+
+    workItems_.Push(item);
+    item->completed_ = false;
+    item->finished_ = false;
+    // Hold one extra dependency while registering to the dependencies, so that the item can not be released prematurely
+    item->pendingDependencies_ = 1;
+
+    for (PODVector<WorkItem*>::ConstIterator i = dependencies.Begin(); i != dependencies.End(); ++i)
     {
-        bool inserted = false;
+        WorkItem* dependency = *i;
+        if (!dependency || dependency == item)
+            continue;
 
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
+        MutexLock lock(dependency->dependencyMutex_);
+        if (!dependency->finished_)
         {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.Insert(i, item);
-                inserted = true;
-                break;
-            }
+            dependency->dependents_.Push(item);
+            MutexLock itemLock(item->dependencyMutex_);
+            ++item->pendingDependencies_;
         }
+    }
 
-        if (!inserted)
-            queue_.Push(item);
+    bool ready;
+    {
+        MutexLock lock(item->dependencyMutex_);
+        ready = --item->pendingDependencies_ == 0;
     }
 
-    if (threads_.Size())
+    // If the dependencies are all completed already, queue immediately. Otherwise the thread completing the last dependency queues the item
+    if (ready)
     {
-        queueMutex_.Release();
-        paused_ = false;
+        QueueItem(item, nextQueue_);
+        if (++nextQueue_ >= queues_.Size())
+            nextQueue_ = 0;
     }
+
+    if (threads_.Size())
+        Resume();
 }
 
 bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
@@ -175,44 +241,43 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
     if (!item)
         return false;
 
-    MutexLock lock(queueMutex_);
+    List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
+    if (j == workItems_.End())
+        return false;
 
     // Can only remove successfully if the item was not yet taken by threads for execution
-    List<WorkItem*>::Iterator i = queue_.Find(item.Get());
-    if (i != queue_.End())
+    bool removed = false;
+    for (unsigned q = 0; q < queues_.Size() && !removed; ++q)
     {
-        List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
-        if (j != workItems_.End())
+        WorkerQueue* queue = queues_[q];
+        MutexLock lock(queue->mutex_);
+
+        List<WorkItem*>::Iterator i = queue->items_.Find(item.Get());
+        if (i != queue->items_.End())
         {
-            queue_.Erase(i);
-            ReturnToPool(item);
-            workItems_.Erase(j);
-            return true;
+            queue->items_.Erase(i);
+            removed = true;
         }
     }
 
-    return false;
+    if (!removed)
+        return false;
+
+    // The removed item counts as completed, so that its dependents do not wait forever
+    FinishItem(item, 0);
+    ReturnToPool(item);
+    workItems_.Erase(j);
+    return true;
 }
 
 unsigned WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items)
 {
-    MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
     for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
     {
-        List<WorkItem*>::Iterator j = queue_.Find(i->Get());
-        if (j != queue_.End())
-        {
-            List<SharedPtr<WorkItem> >::Iterator k = workItems_.Find(*i);
-            if (k != workItems_.End())
-            {
-                queue_.Erase(j);
-                ReturnToPool(*k);
-                workItems_.Erase(k);
-                ++removed;
-            }
-        }
+        if (RemoveWorkItem(*i))
+            ++removed;
     }
 
     return removed;
@@ -224,7 +289,7 @@ void WorkQueue::Pause()
     {
         pausing_ = true;
 
-        queueMutex_.Acquire();
+        pauseMutex_.Acquire();
         paused_ = true;
 
         pausing_ = false;
@@ -235,62 +300,70 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
         paused_ = false;
+        pauseMutex_.Release();
     }
 }
 
 
 void WorkQueue::Complete(unsigned priority)
 {
+    bool wasCompleting = completing_;
     completing_ = true;
 
     if (threads_.Size())
     {
         Resume();
 
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.Empty())
-        {
-            queueMutex_.Acquire();
-            if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
-                break;
-            }
-        }
+        // Take work items also in the main thread until queues empty or no high-priority items anymore
+        while (WorkItem* item = TakeItem(0, priority, true))
+            ExecuteItem(item, 0);
 
-        // Wait for threaded work to complete
+        // Wait for threaded work to complete. Keep executing items whose dependencies completed meanwhile
         while (!IsCompleted(priority))
         {
+            if (WorkItem* item = TakeItem(0, priority, false))
+                ExecuteItem(item, 0);
         }
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
+        if (!HasQueuedItems())
             Pause();
     }
     else
     {
         // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-        {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
-        }
+        while (WorkItem* item = TakeItem(0, priority, true))
+            ExecuteItem(item, 0);
     }
 
     PurgeCompleted(priority);
-    completing_ = false;
+    completing_ = wasCompleting;
+}
+
+void WorkQueue::CompleteItem(SharedPtr<WorkItem> item)
+{
+    if (!item || item->completed_)
+        return;
+
+    if (!workItems_.Contains(item))
+    {
+        URHO3D_LOGERROR("Can not complete a work item which has not been added to the work queue");
+        return;
+    }
+
+    bool wasCompleting = completing_;
+    completing_ = true;
+
+    if (threads_.Size())
+        Resume();
+
+    WaitForItem(item);
+
+    if (!wasCompleting && threads_.Size() && !HasQueuedItems())
+        Pause();
+
+    completing_ = wasCompleting;
 }
 
 bool WorkQueue::IsCompleted(unsigned priority) const
@@ -315,30 +388,180 @@ void WorkQueue::ProcessItems(unsigned threadIndex)
 
         if (pausing_ && !wasActive)
             Time::Sleep(0);
+        else if (paused_)
+        {
+            // Block until the main thread resumes the queue
+            pauseMutex_.Acquire();
+            pauseMutex_.Release();
+        }
         else
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty())
+            WorkItem* item = TakeItem(threadIndex, 0, false);
+            if (item)
             {
                 wasActive = true;
 
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
+                ExecuteItem(item, threadIndex);
             }
             else
             {
                 wasActive = false;
 
-                queueMutex_.Release();
                 Time::Sleep(0);
             }
         }
     }
 }
 
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    item->workFunction_(item, threadIndex);
+    FinishItem(item, threadIndex);
+}
+
+void WorkQueue::FinishItem(WorkItem* item, unsigned threadIndex)
+{
+    {
+        MutexLock lock(item->dependencyMutex_);
+        item->finished_ = true;
+
+        // Queue the dependents which became ready into the own queue, as their data is likely hot in this thread's cache.
+        // Clearing instead of moving the dependents out keeps the vector's memory with the pooled item for reuse
+        for (PODVector<WorkItem*>::Iterator i = item->dependents_.Begin(); i != item->dependents_.End(); ++i)
+        {
+            WorkItem* dependent = *i;
+            bool ready;
+            {
+                MutexLock dependentLock(dependent->dependencyMutex_);
+                ready = --dependent->pendingDependencies_ == 0;
+            }
+
+            if (ready)
+                QueueItem(dependent, threadIndex);
+        }
+        item->dependents_.Clear();
+    }
+
+    // The main thread may release or reuse the item as soon as it sees the completed flag, so it must be the last access
+    item->completed_ = true;
+}
+
+void WorkQueue::QueueItem(WorkItem* item, unsigned threadIndex)
+{
+    WorkerQueue* queue = queues_[threadIndex];
+    MutexLock lock(queue->mutex_);
+    queue->Insert(item);
+}
+
+WorkItem* WorkQueue::TakeItem(unsigned threadIndex, unsigned priority, bool blocking)
+{
+    unsigned numQueues = queues_.Size();
+
+    for (unsigned i = 0; i < numQueues; ++i)
+    {
+        WorkerQueue* queue = queues_[(threadIndex + i) % numQueues];
+
+        // Always wait for the own queue, but do not wait for a victim's queue that is being accessed by someone else. The
+        // queue may only be inspected while holding its mutex, as other threads insert and take items concurrently
+        if (blocking || !i)
+            queue->mutex_.Acquire();
+        else if (!queue->mutex_.TryAcquire())
+            continue;
+
+        WorkItem* item = 0;
+        if (!queue->items_.Empty() && queue->items_.Front()->priority_ >= priority)
+        {
+            item = queue->items_.Front();
+            queue->items_.PopFront();
+        }
+        queue->mutex_.Release();
+
+        if (item)
+            return item;
+    }
+
+    return 0;
+}
+
+bool WorkQueue::HasQueuedItems() const
+{
+    for (unsigned i = 0; i < queues_.Size(); ++i)
+    {
+        WorkerQueue* queue = queues_[i];
+        MutexLock lock(queue->mutex_);
+        if (!queue->items_.Empty())
+            return true;
+    }
+
+    return false;
+}
+
+bool WorkQueue::WaitForItem(WorkItem* item)
+{
+    while (!item->completed_)
+    {
+        WorkItem* next = TakeItem(0, item->priority_, !threads_.Size());
+        // Without worker threads, lower priority dependencies must also be executed in the main thread
+        if (!next && threads_.Empty())
+        {
+            next = TakeItem(0, 0, true);
+            if (!next)
+            {
+                URHO3D_LOGERROR("Work item can not be completed due to missing dependencies");
+                return false;
+            }
+        }
+
+        if (next)
+            ExecuteItem(next, 0);
+    }
+
+    return true;
+}
+
+unsigned WorkQueue::GetNumParallelChunks(unsigned count, unsigned grainSize) const
+{
+    if (threads_.Empty())
+        return 1;
+
+    unsigned maxChunks = Min((threads_.Size() + 1) * PARALLEL_CHUNKS_PER_THREAD, MAX_PARALLEL_CHUNKS);
+    unsigned numChunks = (count + Max(grainSize, 1U) - 1) / Max(grainSize, 1U);
+    return Clamp(numChunks, 1U, maxChunks);
+}
+
+void WorkQueue::CompleteParallelFor(WorkItem** items, unsigned numItems)
+{
+    // May be called from within Complete(), for example from a work item executed by the main thread, so restore the flag
+    bool wasCompleting = completing_;
+    completing_ = true;
+
+    for (unsigned i = 0; i < numItems; ++i)
+        WaitForItem(items[i]);
+
+    // An outer Complete() pauses the worker threads itself once its own work is done
+    if (!wasCompleting && threads_.Size() && !HasQueuedItems())
+        Pause();
+
+    // Return only the own chunk items to the pool. Other completed items belong to their submitters, which may still be
+    // waiting for them or expect their completion events at the frame start
+    for (List<SharedPtr<WorkItem> >::Iterator i = workItems_.Begin(); i != workItems_.End();)
+    {
+        WorkItem** item = items;
+        while (item != items + numItems && *item != i->Get())
+            ++item;
+
+        if (item != items + numItems)
+        {
+            ReturnToPool(*i);
+            i = workItems_.Erase(i);
+        }
+        else
+            ++i;
+    }
+
+    completing_ = wasCompleting;
+}
+
 void WorkQueue::PurgeCompleted(unsigned priority)
 {
     // Purge completed work items and send completion events. Do not signal items lower than priority threshold,
@@ -392,7 +615,9 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
         item->workFunction_ = 0;
         item->priority_ = M_MAX_UNSIGNED;
         item->sendEvent_ = false;
-        item->completed_ = false;
+        // Items in the pool count as completed, so that late dependencies on them do not block
+        item->completed_ = true;
+        item->finished_ = true;
 
         poolItems_.Push(item);
     }
@@ -401,18 +626,19 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.Empty() && !queue_.Empty())
+    if (threads_.Empty() && HasQueuedItems())
     {
         URHO3D_PROFILE(CompleteWorkNonthreaded);
 
         HiresTimer timer;
 
-        while (!queue_.Empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* item = TakeItem(0, 0, true);
+            if (!item)
+                break;
+
+            ExecuteItem(item, 0);
         }
     }
 
@@ -36,6 +36,14 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+class WorkerQueue;
+struct WorkItem;
+
+/// Maximum number of chunks a ParallelFor() range is split into.
+static const unsigned MAX_PARALLEL_CHUNKS = 64;
+
+/// Work function for ParallelFor() chunks. Calls the functor stored in the auxiliary pointer with the chunk range.
+template <class T, class F> void ParallelForWork(const WorkItem* item, unsigned threadIndex);
 
 /// Work queue item.
 struct WorkItem : public RefCounted
@@ -48,7 +56,9 @@ public:
         priority_(0),
         sendEvent_(false),
         completed_(false),
-        pooled_(false)
+        pooled_(false),
+        finished_(false),
+        pendingDependencies_(0)
     {
     }
 
@@ -69,6 +79,14 @@ public:
 
 private:
     bool pooled_;
+    /// Whether the dependents have been released. Unlike the completed flag, only accessed under the dependency mutex.
+    bool finished_;
+    /// Number of dependencies which have not completed yet.
+    unsigned pendingDependencies_;
+    /// Work items waiting for this item to complete.
+    PODVector<WorkItem*> dependents_;
+    /// Mutex for the completion and dependency bookkeeping.
+    Mutex dependencyMutex_;
 };
 
 /// Work queue subsystem for multithreading.
@@ -90,7 +108,9 @@ public:
     SharedPtr<WorkItem> GetFreeItem();
     /// Add a work item and resume worker threads.
     void AddWorkItem(SharedPtr<WorkItem> item);
-    /// Remove a work item before it has started executing. Return true if successfully removed.
+    /// Add a work item which will only be executed after all the dependency items have completed, and resume worker threads. Dependencies must have been added to the queue before; already completed dependencies are ignored.
+    void AddWorkItem(SharedPtr<WorkItem> item, const PODVector<WorkItem*>& dependencies);
+    /// Remove a work item before it has started executing. Return true if successfully removed. The removed item counts as completed for its dependents.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items);
@@ -100,6 +120,50 @@ public:
     void Resume();
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
+    /// Wait until the specified work item has completed. Main thread will also execute work which has at least the item's priority. Unlike Complete(), other work items are neither waited for nor purged.
+    void CompleteItem(SharedPtr<WorkItem> item);
+
+    /// Execute a functor over the range [begin, end) split into chunks of at least grainSize elements, and return once all chunks have finished. The calling main thread executes the first chunk itself. The functor is called as functor(T* start, T* end, unsigned threadIndex).
+    template <class T, class F> void ParallelFor(T* begin, T* end, unsigned grainSize, F& functor)
+    {
+        unsigned count = (unsigned)(end - begin);
+        if (!count)
+            return;
+
+        unsigned numChunks = GetNumParallelChunks(count, grainSize);
+        if (numChunks <= 1)
+        {
+            functor(begin, end, 0);
+            return;
+        }
+
+        unsigned chunkSize = count / numChunks;
+        unsigned remainder = count % numChunks;
+        // The first chunks get one extra element each to spread the remainder
+        T* mainEnd = begin + chunkSize + (remainder ? 1 : 0);
+        T* start = mainEnd;
+        // The chunk count is bounded, so keep the items on the stack instead of allocating a vector on every call
+        WorkItem* items[MAX_PARALLEL_CHUNKS];
+
+        for (unsigned i = 1; i < numChunks; ++i)
+        {
+            T* chunkEnd = start + chunkSize + (i < remainder ? 1 : 0);
+
+            SharedPtr<WorkItem> item = GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = ParallelForWork<T, F>;
+            item->start_ = start;
+            item->end_ = chunkEnd;
+            item->aux_ = &functor;
+            AddWorkItem(item);
+            items[i - 1] = item;
+
+            start = chunkEnd;
+        }
+
+        functor(begin, mainEnd, 0);
+        CompleteParallelFor(items, numChunks - 1);
+    }
 
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
@@ -124,6 +188,22 @@ public:
 private:
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Execute a work item, mark it completed and queue its dependents which became ready.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Mark a work item completed and queue its dependents which have no more pending dependencies into the specified thread's queue.
+    void FinishItem(WorkItem* item, unsigned threadIndex);
+    /// Insert a work item into a thread queue.
+    void QueueItem(WorkItem* item, unsigned threadIndex);
+    /// Take the next work item which has at least the specified priority, first from the thread's own queue, then by stealing from other threads' queues. If not blocking, queues locked by other threads are skipped. Return null if none available.
+    WorkItem* TakeItem(unsigned threadIndex, unsigned priority, bool blocking);
+    /// Return whether any of the thread queues have pending work items.
+    bool HasQueuedItems() const;
+    /// Execute work in the main thread until the item has completed. Return false if it can not be completed.
+    bool WaitForItem(WorkItem* item);
+    /// Return number of chunks to split a ParallelFor() range into.
+    unsigned GetNumParallelChunks(unsigned count, unsigned grainSize) const;
+    /// Wait for the ParallelFor() chunk items to complete, then return them to the pool. Other work items are neither waited for nor purged.
+    void CompleteParallelFor(WorkItem** items, unsigned numItems);
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
     /// Purge the pool to reduce allocation where its unneeded.
@@ -139,16 +219,18 @@ private:
     List<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     List<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems.)
-    List<WorkItem*> queue_;
-    /// Worker queue mutex.
-    Mutex queueMutex_;
+    /// Per-thread prioritized work item queues, index 0 belongs to the main thread. Work items are distributed round-robin and idle threads steal from the other queues.
+    Vector<SharedPtr<WorkerQueue> > queues_;
+    /// Queue to push the next work item into.
+    unsigned nextQueue_;
+    /// Pause mutex. Held by the main thread while paused to block the worker threads.
+    Mutex pauseMutex_;
     /// Shutting down flag.
     volatile bool shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
+    /// Pausing flag. Indicates the worker threads should not contend for the pause mutex.
     volatile bool pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
-    bool paused_;
+    /// Paused flag. Indicates the pause mutex being locked to prevent worker threads using up CPU time.
+    volatile bool paused_;
     /// Completing work in the main thread flag.
     bool completing_;
     /// Tolerance for the shared pool before it begins to deallocate.
@@ -159,4 +241,10 @@ private:
     int maxNonThreadedWorkMs_;
 };
 
+template <class T, class F> void ParallelForWork(const WorkItem* item, unsigned threadIndex)
+{
+    F& functor = *(reinterpret_cast<F*>(item->aux_));
+    functor(reinterpret_cast<T*>(item->start_), reinterpret_cast<T*>(item->end_), threadIndex);
+}
+
 }
@@ -26,6 +26,7 @@
 #include "../Core/Profiler.h"
 #include "../Core/EventProfiler.h"
 #include "../Core/Context.h"
+#include "../Core/FrameAllocator.h"
 #include "../Engine/DebugHud.h"
 #include "../Engine/Engine.h"
 #include "../Graphics/Graphics.h"
@@ -151,6 +152,14 @@ void DebugHud::Update()
             renderer->GetNumShadowMaps(true),
             renderer->GetNumOccluders(true));
 
+        FrameAllocator* frameAllocator = GetSubsystem<FrameAllocator>();
+        if (frameAllocator)
+            stats.AppendWithFormat("\nFrame arena %u KB", (frameAllocator->GetHighWaterMark() + 1023) / 1024);
+
+        AllocatorStats allocatorStats = GetAllocatorStats();
+        stats.AppendWithFormat("\nPool memory %u KB (%d%% free)", (unsigned)((allocatorStats.bytesReserved_ + 1023) / 1024),
+            (int)(allocatorStats.GetFreeFraction() * 100.0f + 0.5f));
+
         if (!appStats_.Empty())
         {
             stats.Append("\n");
@@ -23,9 +23,11 @@
 #include "../Precompiled.h"
 
 #include "../Audio/Audio.h"
+#include "../Container/Allocator.h"
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/EventProfiler.h"
+#include "../Core/FrameAllocator.h"
 #include "../Core/ProcessUtils.h"
 #include "../Core/WorkQueue.h"
 #include "../Engine/Console.h"
@@ -121,6 +123,7 @@ Engine::Engine(Context* context) :
     // Create subsystems which do not depend on engine initialization or startup parameters
     context_->RegisterSubsystem(new Time(context_));
     context_->RegisterSubsystem(new WorkQueue(context_));
+    context_->RegisterSubsystem(new FrameAllocator(context_));
 #ifdef URHO3D_PROFILING
     context_->RegisterSubsystem(new Profiler(context_));
 #endif
@@ -160,6 +163,8 @@ Engine::Engine(Context* context) :
 
 Engine::~Engine()
 {
+    // Return the pool memory freed during shutdown to the heap, in case the application keeps running
+    AllocatorTrim();
 }
 
 bool Engine::Initialize(const VariantMap& parameters)
@@ -213,6 +218,7 @@ bool Engine::Initialize(const VariantMap& parameters)
     if (numThreads)
     {
         GetSubsystem<WorkQueue>()->CreateThreads(numThreads);
+        GetSubsystem<FrameAllocator>()->SetNumThreads(numThreads + 1);
 
         URHO3D_LOGINFOF("Created %u worker thread%s", numThreads, numThreads > 1 ? "s" : "");
     }
@@ -630,10 +636,10 @@ void Engine::DumpResources(bool dumpFileName)
         URHO3D_LOGRAW("Used resources:\n");
         for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups.Begin(); i != resourceGroups.End(); ++i)
         {
-            const HashMap<StringHash, SharedPtr<Resource> >& resources = i->second_.resources_;
+            const FlatHashMap<StringHash, SharedPtr<Resource> >& resources = i->second_.resources_;
             if (dumpFileName)
             {
-                for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = resources.Begin(); j != resources.End(); ++j)
+                for (FlatHashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = resources.Begin(); j != resources.End(); ++j)
                     URHO3D_LOGRAW(j->second_->GetName() + "\n");
             }
         }
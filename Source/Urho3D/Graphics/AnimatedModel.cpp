@@ -30,6 +30,7 @@
 #include "../Graphics/Batch.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/DebugRenderer.h"
+#include "../Graphics/DecalSet.h"
 #include "../Graphics/DrawableEvents.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Graphics.h"
@@ -66,6 +67,11 @@ static bool CompareAnimationOrder(const SharedPtr<AnimationState>& lhs, const Sh
     return lhs->GetLayer() < rhs->GetLayer();
 }
 
+static bool IsBoneNodeMoved(const Node* node, const BonePose& pose)
+{
+    return node->GetPosition() != pose.position_ || node->GetRotation() != pose.rotation_ || node->GetScale() != pose.scale_;
+}
+
 static const unsigned MAX_ANIMATION_STATES = 256;
 
 AnimatedModel::AnimatedModel(Context* context) :
@@ -76,6 +82,9 @@ AnimatedModel::AnimatedModel(Context* context) :
     animationLodTimer_(-1.0f),
     animationLodDistance_(0.0f),
     updateInvisible_(false),
+    usePoseBuffer_(false),
+    poseBufferSuspended_(false),
+    boneNodesDirty_(false),
     animationDirty_(false),
     animationOrderDirty_(false),
     morphsDirty_(false),
@@ -112,6 +121,7 @@ void AnimatedModel::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Cast Shadows", bool, castShadows_, false, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Update When Invisible", GetUpdateInvisible, SetUpdateInvisible, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Use Pose Buffer", GetUsePoseBuffer, SetUsePoseBuffer, bool, false, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("LOD Bias", GetLodBias, SetLodBias, float, 1.0f, AM_DEFAULT);
@@ -174,6 +184,8 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
         return;
 
     const Vector<Bone>& bones = skeleton_.GetBones();
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    bool usePoseBuffer = IsPoseBufferActive() && boneTransforms_.Size() == bones.Size();
     Sphere boneSphere;
 
     for (unsigned i = 0; i < bones.Size(); ++i)
@@ -189,7 +201,7 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
         {
             // Do an initial crude test using the bone's AABB
             const BoundingBox& box = bone.boundingBox_;
-            const Matrix3x4& transform = bone.node_->GetWorldTransform();
+            Matrix3x4 transform = usePoseBuffer ? worldTransform * boneTransforms_[i] : bone.node_->GetWorldTransform();
             distance = query.ray_.HitDistance(box.Transformed(transform));
             if (distance >= query.maxDistance_)
                 continue;
@@ -205,7 +217,7 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
         }
         else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
         {
-            boneSphere.center_ = bone.node_->GetWorldPosition();
+            boneSphere.center_ = usePoseBuffer ? worldTransform * boneTransforms_[i].Translation() : bone.node_->GetWorldPosition();
             boneSphere.radius_ = bone.radius_;
             distance = query.ray_.HitDistance(boneSphere);
             if (distance >= query.maxDistance_)
@@ -253,8 +265,23 @@ void AnimatedModel::Update(const FrameInfo& frame)
 
     if (animationDirty_ || animationOrderDirty_)
         UpdateAnimation(frame);
-    else if (boneBoundingBoxDirty_)
-        UpdateBoneBoundingBox();
+    else
+    {
+        // In pose buffer mode check whether other code has moved the bone nodes. If not, the root bone may still have
+        // moved along with a parent node other than the model's own
+        if (boneNodesDirty_ && IsPoseBufferActive())
+        {
+            CheckBoneNodes();
+            if (IsPoseBufferActive() && pose_.Size() == skeleton_.GetNumBones())
+            {
+                UpdateBoneTransforms();
+                boneBoundingBoxDirty_ = true;
+            }
+        }
+
+        if (boneBoundingBoxDirty_)
+            UpdateBoneBoundingBox();
+    }
 }
 
 void AnimatedModel::UpdateBatches(const FrameInfo& frame)
@@ -325,6 +352,10 @@ void AnimatedModel::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
 {
     if (debug && IsEnabledEffective())
     {
+        // The skeleton is drawn from the bone nodes, so bring them up to date
+        if (IsPoseBufferActive())
+            UpdateBoneNodes();
+
         debug->AddBoundingBox(GetWorldBoundingBox(), Color::GREEN, depthTest);
         debug->AddSkeleton(skeleton_, Color(0.75f, 0.75f, 0.75f), depthTest);
     }
@@ -549,6 +580,28 @@ void AnimatedModel::SetUpdateInvisible(bool enable)
     MarkNetworkUpdate();
 }
 
+void AnimatedModel::SetUsePoseBuffer(bool enable)
+{
+    if (enable == usePoseBuffer_ && !poseBufferSuspended_)
+        return;
+
+    // Skinning will read the bone nodes again, so write the last pose to them
+    if (!enable)
+        UpdateBoneNodes();
+
+    usePoseBuffer_ = enable;
+    poseBufferSuspended_ = false;
+    pose_.Clear();
+    boneNodePoses_.Clear();
+    boneTransforms_.Clear();
+    boneOrder_.Clear();
+
+    skinningDirty_ = true;
+    boneBoundingBoxDirty_ = true;
+    MarkAnimationDirty();
+    MarkNetworkUpdate();
+}
+
 
 void AnimatedModel::SetMorphWeight(unsigned index, float weight)
 {
@@ -794,6 +847,12 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
         }
     }
 
+    // The bone order for the pose buffer is rebuilt on the next animation update
+    boneOrder_.Clear();
+    pose_.Clear();
+    boneNodePoses_.Clear();
+    boneTransforms_.Clear();
+
     assignBonesPending_ = !createBones;
 }
 
@@ -908,11 +967,32 @@ void AnimatedModel::UpdateBoneBoundingBox()
 {
     if (skeleton_.GetNumBones())
     {
-        // The bone bounding box is in local space, so need the node's inverse transform
         boneBoundingBox_.Clear();
+        const Vector<Bone>& bones = skeleton_.GetBones();
+
+        // In pose buffer mode the bone transforms are already in local space
+        if (IsPoseBufferActive() && boneTransforms_.Size() == bones.Size())
+        {
+            for (unsigned i = 0; i < bones.Size(); ++i)
+            {
+                const Bone& bone = bones[i];
+                if (!bone.node_)
+                    continue;
+
+                if (bone.collisionMask_ & BONECOLLISION_BOX)
+                    boneBoundingBox_.Merge(bone.boundingBox_.Transformed(boneTransforms_[i]));
+                else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
+                    boneBoundingBox_.Merge(Sphere(boneTransforms_[i].Translation(), bone.radius_ * 0.5f));
+            }
+
+            boneBoundingBoxDirty_ = false;
+            worldBoundingBoxDirty_ = true;
+            return;
+        }
+
+        // The bone bounding box is in local space, so need the node's inverse transform
         Matrix3x4 inverseNodeTransform = node_->GetWorldTransform().Inverse();
 
-        const Vector<Bone>& bones = skeleton_.GetBones();
         for (Vector<Bone>::ConstIterator i = bones.Begin(); i != bones.End(); ++i)
         {
             Node* boneNode = i->node_;
@@ -951,9 +1031,15 @@ void AnimatedModel::OnMarkedDirty(Node* node)
     if (skeleton_.GetNumBones())
     {
         skinningDirty_ = true;
-        // Bone bounding box doesn't need to be marked dirty when only the base scene node moves
+        // Bone bounding box doesn't need to be marked dirty when only the base scene node moves. In pose buffer mode it is
+        // calculated from the pose instead of the bone nodes, but they need to be checked for having been moved by other code
         if (node != node_)
-            boneBoundingBoxDirty_ = true;
+        {
+            if (IsPoseBufferActive())
+                boneNodesDirty_ = true;
+            else
+                boneBoundingBoxDirty_ = true;
+        }
     }
 }
 
@@ -1287,12 +1373,35 @@ void AnimatedModel::ApplyAnimation()
     // (first AnimatedModel in a node)
     if (isMaster_)
     {
-        skeleton_.ResetSilent();
-        for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
-            (*i)->Apply();
+        // Bone nodes moved by other code, for example a ragdoll or inverse kinematics, end the use of the pose buffer
+        if (IsPoseBufferActive())
+            CheckBoneNodes();
 
-        // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
-        node_->MarkDirty();
+        if (IsPoseBufferActive())
+        {
+            // Blend the animations into the pose buffer and calculate the model-space transforms. Bone nodes are left alone
+            // unless something is attached to them, so the skinning and bounding box must be marked dirty here
+            ResetPose();
+            for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
+                (*i)->Apply();
+
+            UpdateBoneTransforms();
+            UpdateAttachedBoneNodes();
+            // Clean the bone nodes marked dirty, so that moving them later is noticed
+            if (boneNodesDirty_)
+                CheckBoneNodes();
+            skinningDirty_ = true;
+            MarkForUpdate();
+        }
+        else
+        {
+            skeleton_.ResetSilent();
+            for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
+                (*i)->Apply();
+
+            // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
+            node_->MarkDirty();
+        }
 
         // Calculate new bone bounding box
         UpdateBoneBoundingBox();
@@ -1301,12 +1410,40 @@ void AnimatedModel::ApplyAnimation()
     animationDirty_ = false;
 }
 
+void AnimatedModel::UpdateBoneNodes()
+{
+    if (!IsPoseBufferActive() || pose_.Size() != skeleton_.GetNumBones())
+        return;
+
+    // Do not overwrite bone nodes moved by other code
+    CheckBoneNodes();
+    if (!IsPoseBufferActive())
+        return;
+
+    Vector<Bone>& bones = skeleton_.GetModifiableBones();
+    for (unsigned i = 0; i < bones.Size(); ++i)
+    {
+        const BonePose& pose = pose_[i];
+        if (bones[i].node_)
+        {
+            bones[i].node_->SetTransformSilent(pose.position_, pose.rotation_, pose.scale_);
+            boneNodePoses_[i] = pose;
+        }
+    }
+
+    Bone* rootBone = skeleton_.GetRootBone();
+    if (rootBone && rootBone->node_)
+        rootBone->node_->MarkDirty();
+}
+
 void AnimatedModel::UpdateSkinning()
 {
     // Note: the model's world transform will be baked in the skin matrices
     const Vector<Bone>& bones = skeleton_.GetBones();
     // Use model's world transform in case a bone is missing
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    // In pose buffer mode use the model-space bone transforms instead of the bone nodes
+    bool usePoseBuffer = IsPoseBufferActive() && boneTransforms_.Size() == bones.Size();
 
     // Skinning with global matrices only
     if (!geometrySkinMatrices_.Size())
@@ -1314,10 +1451,12 @@ void AnimatedModel::UpdateSkinning()
         for (unsigned i = 0; i < bones.Size(); ++i)
         {
             const Bone& bone = bones[i];
-            if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
-            else
+            if (!bone.node_)
                 skinMatrices_[i] = worldTransform;
+            else if (usePoseBuffer)
+                skinMatrices_[i] = worldTransform * boneTransforms_[i] * bone.offsetMatrix_;
+            else
+                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
         }
     }
     // Skinning with per-geometry matrices
@@ -1326,10 +1465,12 @@ void AnimatedModel::UpdateSkinning()
         for (unsigned i = 0; i < bones.Size(); ++i)
         {
             const Bone& bone = bones[i];
-            if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
-            else
+            if (!bone.node_)
                 skinMatrices_[i] = worldTransform;
+            else if (usePoseBuffer)
+                skinMatrices_[i] = worldTransform * boneTransforms_[i] * bone.offsetMatrix_;
+            else
+                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
 
             // Copy the skin matrix to per-geometry matrices as needed
             for (unsigned j = 0; j < geometrySkinMatrixPtrs_[i].Size(); ++j)
@@ -1340,6 +1481,235 @@ void AnimatedModel::UpdateSkinning()
     skinningDirty_ = false;
 }
 
+void AnimatedModel::ResetPose()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    bool hasPose = pose_.Size() == bones.Size();
+    pose_.Resize(bones.Size());
+
+    // Remember the bone node transforms to notice when other code moves them. The nodes may be dirty, so clean them later
+    if (boneNodePoses_.Size() != bones.Size())
+    {
+        boneNodePoses_.Resize(bones.Size());
+        for (unsigned i = 0; i < bones.Size(); ++i)
+        {
+            Node* boneNode = bones[i].node_;
+            if (boneNode)
+            {
+                BonePose& nodePose = boneNodePoses_[i];
+                nodePose.position_ = boneNode->GetPosition();
+                nodePose.rotation_ = boneNode->GetRotation();
+                nodePose.scale_ = boneNode->GetScale();
+            }
+        }
+        boneNodesDirty_ = true;
+    }
+
+    for (unsigned i = 0; i < bones.Size(); ++i)
+    {
+        const Bone& bone = bones[i];
+        BonePose& pose = pose_[i];
+
+        // Bones with animation disabled keep their pose, which is read from their nodes at first. Moving the nodes later
+        // falls back to animating the bone nodes
+        if (!bone.animated_ && bone.node_)
+        {
+            if (!hasPose)
+                pose = boneNodePoses_[i];
+        }
+        else
+        {
+            pose.position_ = bone.initialPosition_;
+            pose.rotation_ = bone.initialRotation_;
+            pose.scale_ = bone.initialScale_;
+        }
+    }
+}
+
+void AnimatedModel::UpdateBoneTransforms()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    unsigned numBones = bones.Size();
+
+    // Order the bones parent first once per skeleton. Also count the child bones of each bone
+    if (boneOrder_.Size() != numBones)
+    {
+        boneOrder_.Clear();
+        boneChildCounts_.Resize(numBones);
+        boneNodeUpdates_.Resize(numBones);
+        PODVector<unsigned char> added(numBones);
+
+        for (unsigned i = 0; i < numBones; ++i)
+        {
+            boneChildCounts_[i] = 0;
+            added[i] = 0;
+        }
+        for (unsigned i = 0; i < numBones; ++i)
+        {
+            unsigned parentIndex = bones[i].parentIndex_;
+            if (parentIndex != i && parentIndex < numBones)
+                ++boneChildCounts_[parentIndex];
+        }
+
+        for (unsigned i = 0; i < numBones; ++i)
+        {
+            // Add the topmost ancestor that is not yet added, until the bone itself has been added
+            while (!added[i])
+            {
+                unsigned j = i;
+                for (unsigned depth = 0; depth < numBones; ++depth)
+                {
+                    unsigned parentIndex = bones[j].parentIndex_;
+                    if (parentIndex == j || parentIndex >= numBones || added[parentIndex])
+                        break;
+                    j = parentIndex;
+                }
+
+                added[j] = 1;
+                boneOrder_.Push(j);
+            }
+        }
+    }
+
+    boneTransforms_.Resize(numBones);
+
+    for (PODVector<unsigned>::ConstIterator i = boneOrder_.Begin(); i != boneOrder_.End(); ++i)
+    {
+        unsigned index = *i;
+        const Bone& bone = bones[index];
+        const BonePose& pose = pose_[index];
+        Matrix3x4 localTransform(pose.position_, pose.rotation_, pose.scale_);
+
+        unsigned parentIndex = bone.parentIndex_;
+        if (parentIndex != index && parentIndex < numBones)
+            boneTransforms_[index] = boneTransforms_[parentIndex] * localTransform;
+        else
+        {
+            // The root bone may be parented to another node than the model's node, for example in an imported prefab
+            Node* parentNode = bone.node_ ? bone.node_->GetParent() : 0;
+            if (parentNode && parentNode != node_)
+                boneTransforms_[index] = node_->GetWorldTransform().Inverse() * parentNode->GetWorldTransform() * localTransform;
+            else
+                boneTransforms_[index] = localTransform;
+        }
+    }
+}
+
+void AnimatedModel::UpdateAttachedBoneNodes()
+{
+    // Skinned attachments and decals in the same node read the bone nodes, so they all need to be updated
+    const Vector<SharedPtr<Component> >& components = node_->GetComponents();
+    for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
+    {
+        Component* component = *i;
+        if (component != this && (component->IsInstanceOf<AnimatedModel>() || component->IsInstanceOf<DecalSet>()))
+        {
+            UpdateBoneNodes();
+            return;
+        }
+    }
+
+    // Flag the bones which have other child nodes or components, then their parents. Children are visited first
+    Vector<Bone>& bones = skeleton_.GetModifiableBones();
+    unsigned numBones = bones.Size();
+    bool anyUpdates = false;
+
+    for (unsigned i = 0; i < numBones; ++i)
+        boneNodeUpdates_[i] = 0;
+
+    for (PODVector<unsigned>::ConstIterator i = boneOrder_.End(); i != boneOrder_.Begin();)
+    {
+        unsigned index = *--i;
+        Node* boneNode = bones[index].node_;
+        if (boneNode && (boneNode->GetNumComponents() || boneNode->GetNumChildren() > boneChildCounts_[index]))
+            boneNodeUpdates_[index] = 1;
+
+        if (boneNodeUpdates_[index])
+        {
+            anyUpdates = true;
+            unsigned parentIndex = bones[index].parentIndex_;
+            if (parentIndex != index && parentIndex < numBones)
+                boneNodeUpdates_[parentIndex] = 1;
+        }
+    }
+
+    if (!anyUpdates)
+        return;
+
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        const BonePose& pose = pose_[i];
+        if (boneNodeUpdates_[i] && bones[i].node_)
+        {
+            bones[i].node_->SetTransformSilent(pose.position_, pose.rotation_, pose.scale_);
+            boneNodePoses_[i] = pose;
+        }
+    }
+
+    Bone* rootBone = skeleton_.GetRootBone();
+    if (rootBone && rootBone->node_)
+        rootBone->node_->MarkDirty();
+}
+
+void AnimatedModel::CheckBoneNodes()
+{
+    Vector<Bone>& bones = skeleton_.GetModifiableBones();
+    unsigned numBones = bones.Size();
+    bool cleanNodes = boneNodesDirty_;
+    boneNodesDirty_ = false;
+
+    if (pose_.Size() == numBones && boneNodePoses_.Size() == numBones)
+    {
+        bool moved = false;
+        for (unsigned i = 0; i < numBones; ++i)
+        {
+            if (bones[i].node_ && IsBoneNodeMoved(bones[i].node_, boneNodePoses_[i]))
+            {
+                moved = true;
+                break;
+            }
+        }
+
+        if (moved)
+        {
+            // Write the pose to the bone nodes which were not moved, so that all of them are current, then animate the bone
+            // nodes instead of the pose buffer
+            for (unsigned i = 0; i < numBones; ++i)
+            {
+                Node* boneNode = bones[i].node_;
+                if (boneNode && !IsBoneNodeMoved(boneNode, boneNodePoses_[i]))
+                {
+                    const BonePose& pose = pose_[i];
+                    boneNode->SetTransformSilent(pose.position_, pose.rotation_, pose.scale_);
+                }
+            }
+
+            poseBufferSuspended_ = true;
+            pose_.Clear();
+            boneNodePoses_.Clear();
+            boneTransforms_.Clear();
+
+            Bone* rootBone = skeleton_.GetRootBone();
+            if (rootBone && rootBone->node_)
+                rootBone->node_->MarkDirty();
+            skinningDirty_ = true;
+            boneBoundingBoxDirty_ = true;
+            MarkForUpdate();
+            return;
+        }
+    }
+
+    // Bone nodes only notify when they are moved while not dirty, and the pose buffer does not read them otherwise
+    if (cleanNodes)
+    {
+        for (unsigned i = 0; i < numBones; ++i)
+        {
+            if (bones[i].node_)
+                bones[i].node_->GetWorldTransform();
+        }
+    }
+}
+
 void AnimatedModel::UpdateMorphs()
 {
     Graphics* graphics = GetSubsystem<Graphics>();
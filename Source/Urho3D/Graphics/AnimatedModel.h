@@ -88,6 +88,8 @@ public:
     void SetAnimationLodBias(float bias);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
+    /// Set whether to blend animations into a pose buffer and skin from it instead of the bone scene nodes. Bone nodes are then only updated when they have child nodes or components attached, or when UpdateBoneNodes() is called. If other code such as physics, inverse kinematics or script moves the bone nodes, the model falls back to animating the bone nodes until this is set again. Only has effect on the master model.
+    void SetUsePoseBuffer(bool enable);
     /// Set vertex morph weight by index.
     void SetMorphWeight(unsigned index, float weight);
     /// Set vertex morph weight by name.
@@ -98,6 +100,8 @@ public:
     void ResetMorphWeights();
     /// Apply all animation states to nodes.
     void ApplyAnimation();
+    /// Write the current pose to all bone scene nodes. Only needed in pose buffer mode before reading bone nodes that have nothing attached.
+    void UpdateBoneNodes();
 
     /// Return skeleton.
     Skeleton& GetSkeleton() { return skeleton_; }
@@ -123,6 +127,15 @@ public:
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
 
+    /// Return whether to use a pose buffer instead of the bone scene nodes for animation.
+    bool GetUsePoseBuffer() const { return usePoseBuffer_; }
+
+    /// Return whether animation is currently applied to the pose buffer.
+    bool IsPoseBufferActive() const { return usePoseBuffer_ && isMaster_ && !poseBufferSuspended_; }
+
+    /// Return model-space bone transforms calculated in pose buffer mode.
+    const PODVector<Matrix3x4>& GetBoneTransforms() const { return boneTransforms_; }
+
     /// Return all vertex morphs.
     const Vector<ModelMorph>& GetMorphs() const { return morphs_; }
 
@@ -201,6 +214,14 @@ private:
     void UpdateAnimation(const FrameInfo& frame);
     /// Recalculate skinning.
     void UpdateSkinning();
+    /// Reset the pose buffer to the initial pose of animated bones. Other bones keep their pose, which is first read from their nodes.
+    void ResetPose();
+    /// Calculate model-space bone transforms from the pose buffer in one pass over the bones ordered parent first.
+    void UpdateBoneTransforms();
+    /// Write the pose to the bone nodes which have child nodes or components attached, and to their parent bones.
+    void UpdateAttachedBoneNodes();
+    /// Check whether other code has moved the bone nodes since the pose was last written to or read from them, and fall back to animating the bone nodes if so. Otherwise read the world transforms of dirty bone nodes, so that moving them is notified again.
+    void CheckBoneNodes();
     /// Reapply all vertex morphs.
     void UpdateMorphs();
     /// Apply a vertex morph.
@@ -219,6 +240,18 @@ private:
     Vector<SharedPtr<AnimationState> > animationStates_;
     /// Skinning matrices.
     PODVector<Matrix3x4> skinMatrices_;
+    /// Local bone transforms blended by the animation states in pose buffer mode.
+    PODVector<BonePose> pose_;
+    /// Local bone node transforms last written or read in pose buffer mode, for detecting moves by other code.
+    PODVector<BonePose> boneNodePoses_;
+    /// Model-space bone transforms calculated from the pose buffer.
+    PODVector<Matrix3x4> boneTransforms_;
+    /// Bone indices ordered so that parents precede their children.
+    PODVector<unsigned> boneOrder_;
+    /// Number of child bones per bone, used to detect other child nodes attached to the bone nodes.
+    PODVector<unsigned> boneChildCounts_;
+    /// Per-bone flags for writing the pose to the bone nodes.
+    PODVector<unsigned char> boneNodeUpdates_;
     /// Mapping of subgeometry bone indices, used if more bones than skinning shader can manage.
     Vector<PODVector<unsigned> > geometryBoneMappings_;
     /// Subgeometry skinning matrices, used if more bones than skinning shader can manage.
@@ -241,6 +274,12 @@ private:
     float animationLodDistance_;
     /// Update animation when invisible flag.
     bool updateInvisible_;
+    /// Pose buffer mode flag.
+    bool usePoseBuffer_;
+    /// Pose buffer mode suspended flag, set when other code has moved the bone nodes.
+    bool poseBufferSuspended_;
+    /// Bone nodes marked dirty in pose buffer mode flag.
+    bool boneNodesDirty_;
     /// Animation dirty flag.
     bool animationDirty_;
     /// Animation order dirty flag.
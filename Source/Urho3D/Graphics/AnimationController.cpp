@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/FrameAllocator.h"
 #include "../Core/Profiler.h"
 #include "../Graphics/AnimatedModel.h"
 #include "../Graphics/Animation.h"
@@ -618,14 +619,14 @@ void AnimationController::SetNetAnimationsAttr(const PODVector<unsigned char>& v
     AnimatedModel* model = GetComponent<AnimatedModel>();
 
     // Check which animations we need to remove
-    HashSet<StringHash> processedAnimations;
+    FrameVector<StringHash> processedAnimations(GetFrameArena(context_));
 
     unsigned numAnimations = buf.ReadVLE();
     while (numAnimations--)
     {
         String animName = buf.ReadString();
         StringHash animHash(animName);
-        processedAnimations.Insert(animHash);
+        processedAnimations.Push(animHash);
 
         // Check if the animation state exists. If not, add new
         AnimationState* state = GetAnimationState(animHash);
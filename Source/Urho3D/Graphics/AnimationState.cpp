@@ -36,6 +36,7 @@ namespace Urho3D
 AnimationStateTrack::AnimationStateTrack() :
     track_(0),
     bone_(0),
+    boneIndex_(M_MAX_UNSIGNED),
     weight_(1.0f),
     keyFrame_(0)
 {
@@ -153,6 +154,7 @@ void AnimationState::SetStartBone(Bone* startBone)
         if (trackBone && trackBone->node_)
         {
             stateTrack.bone_ = trackBone;
+            stateTrack.boneIndex_ = (unsigned)(trackBone - &skeleton.GetModifiableBones()[0]);
             stateTrack.node_ = trackBone->node_;
             stateTracks_.Push(stateTrack);
         }
@@ -458,6 +460,9 @@ void AnimationState::Apply()
 
 void AnimationState::ApplyToModel()
 {
+    // In pose buffer mode blend into the model's local pose instead of the bone nodes
+    PODVector<BonePose>* pose = model_->IsPoseBufferActive() ? &model_->pose_ : 0;
+
     for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
     {
         AnimationStateTrack& stateTrack = *i;
@@ -466,8 +471,17 @@ void AnimationState::ApplyToModel()
         // Do not apply if zero effective weight or the bone has animation disabled
         if (Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_)
             continue;
-            
-        ApplyTrack(stateTrack, finalWeight, true);
+
+        if (pose)
+        {
+            if (stateTrack.boneIndex_ < pose->Size() && !stateTrack.track_->keyFrames_.Empty())
+            {
+                BonePose& bonePose = (*pose)[stateTrack.boneIndex_];
+                BlendTrack(stateTrack, finalWeight, bonePose.position_, bonePose.rotation_, bonePose.scale_);
+            }
+        }
+        else
+            ApplyTrack(stateTrack, finalWeight, true);
     }
 }
 
@@ -486,6 +500,38 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
     if (track->keyFrames_.Empty() || !node)
         return;
 
+    unsigned char channelMask = track->channelMask_;
+    Vector3 newPosition = node->GetPosition();
+    Quaternion newRotation = node->GetRotation();
+    Vector3 newScale = node->GetScale();
+
+    BlendTrack(stateTrack, weight, newPosition, newRotation, newScale);
+
+    if (silent)
+    {
+        if (channelMask & CHANNEL_POSITION)
+            node->SetPositionSilent(newPosition);
+        if (channelMask & CHANNEL_ROTATION)
+            node->SetRotationSilent(newRotation);
+        if (channelMask & CHANNEL_SCALE)
+            node->SetScaleSilent(newScale);
+    }
+    else
+    {
+        if (channelMask & CHANNEL_POSITION)
+            node->SetPosition(newPosition);
+        if (channelMask & CHANNEL_ROTATION)
+            node->SetRotation(newRotation);
+        if (channelMask & CHANNEL_SCALE)
+            node->SetScale(newScale);
+    }
+}
+
+void AnimationState::BlendTrack(AnimationStateTrack& stateTrack, float weight, Vector3& position, Quaternion& rotation,
+    Vector3& scale)
+{
+    const AnimationTrack* track = stateTrack.track_;
+
     unsigned& frame = stateTrack.keyFrame_;
     track->GetKeyFrameIndex(time_, frame);
 
@@ -540,19 +586,20 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         if (channelMask & CHANNEL_POSITION)
         {
             Vector3 delta = newPosition - stateTrack.bone_->initialPosition_;
-            newPosition = node->GetPosition() + delta * weight;
+            position += delta * weight;
         }
         if (channelMask & CHANNEL_ROTATION)
         {
             Quaternion delta = newRotation * stateTrack.bone_->initialRotation_.Inverse();
-            newRotation = (delta * node->GetRotation()).Normalized();
+            newRotation = (delta * rotation).Normalized();
             if (!Equals(weight, 1.0f))
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                newRotation = rotation.Slerp(newRotation, weight);
+            rotation = newRotation;
         }
         if (channelMask & CHANNEL_SCALE)
         {
             Vector3 delta = newScale - stateTrack.bone_->initialScale_;
-            newScale = node->GetScale() + delta * weight;
+            scale += delta * weight;
         }
     }
     else
@@ -560,31 +607,21 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         if (!Equals(weight, 1.0f)) // not full weight
         {
             if (channelMask & CHANNEL_POSITION)
-                newPosition = node->GetPosition().Lerp(newPosition, weight);
+                position = position.Lerp(newPosition, weight);
             if (channelMask & CHANNEL_ROTATION)
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                rotation = rotation.Slerp(newRotation, weight);
             if (channelMask & CHANNEL_SCALE)
-                newScale = node->GetScale().Lerp(newScale, weight);
+                scale = scale.Lerp(newScale, weight);
+        }
+        else
+        {
+            if (channelMask & CHANNEL_POSITION)
+                position = newPosition;
+            if (channelMask & CHANNEL_ROTATION)
+                rotation = newRotation;
+            if (channelMask & CHANNEL_SCALE)
+                scale = newScale;
         }
-    }
-    
-    if (silent)
-    {
-        if (channelMask & CHANNEL_POSITION)
-            node->SetPositionSilent(newPosition);
-        if (channelMask & CHANNEL_ROTATION)
-            node->SetRotationSilent(newRotation);
-        if (channelMask & CHANNEL_SCALE)
-            node->SetScaleSilent(newScale);
-    }
-    else
-    {
-        if (channelMask & CHANNEL_POSITION)
-            node->SetPosition(newPosition);
-        if (channelMask & CHANNEL_ROTATION)
-            node->SetRotation(newRotation);
-        if (channelMask & CHANNEL_SCALE)
-            node->SetScale(newScale);
     }
 }
 
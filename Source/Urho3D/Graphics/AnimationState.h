@@ -31,8 +31,10 @@ namespace Urho3D
 class Animation;
 class AnimatedModel;
 class Deserializer;
+class Quaternion;
 class Serializer;
 class Skeleton;
+class Vector3;
 struct AnimationTrack;
 struct Bone;
 
@@ -57,6 +59,8 @@ struct AnimationStateTrack
     const AnimationTrack* track_;
     /// Bone pointer.
     Bone* bone_;
+    /// Bone index in the skeleton.
+    unsigned boneIndex_;
     /// Scene node pointer.
     WeakPtr<Node> node_;
     /// Blending weight.
@@ -152,6 +156,8 @@ private:
     void ApplyToNodes();
     /// Apply track.
     void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent);
+    /// Sample a track at the current time position and blend it into a transform.
+    void BlendTrack(AnimationStateTrack& stateTrack, float weight, Vector3& position, Quaternion& rotation, Vector3& scale);
 
     /// Animated model (model mode.)
     WeakPtr<AnimatedModel> model_;
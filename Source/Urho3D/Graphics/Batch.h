@@ -22,7 +22,9 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/Ptr.h"
+#include "../Core/FrameAllocator.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Material.h"
 #include "../Math/MathDefs.h"
@@ -145,9 +147,10 @@ struct BatchGroup : public Batch
     {
     }
 
-    /// Construct from a batch.
-    BatchGroup(const Batch& batch) :
+    /// Construct from a batch. The instances are allocated from the frame arena, or the heap if null.
+    BatchGroup(const Batch& batch, FrameArena* arena = 0) :
         Batch(batch),
+        instances_(arena),
         startIndex_(M_MAX_UNSIGNED)
     {
     }
@@ -176,8 +179,8 @@ struct BatchGroup : public Batch
     /// Prepare and draw.
     void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
 
-    /// Instance data.
-    PODVector<InstanceData> instances_;
+    /// Instance data. Rebuilt every frame, so allocated from the frame arena.
+    FrameVector<InstanceData> instances_;
     /// Instance stream start index, or M_MAX_UNSIGNED if transforms not pre-set.
     unsigned startIndex_;
 };
@@ -255,7 +258,7 @@ public:
     bool IsEmpty() const { return batches_.Empty() && batchGroups_.Empty(); }
 
     /// Instanced draw calls.
-    HashMap<BatchGroupKey, BatchGroup> batchGroups_;
+    FlatHashMap<BatchGroupKey, BatchGroup> batchGroups_;
     /// Shader remapping table for 2-pass state and distance sort.
     HashMap<unsigned, unsigned> shaderRemapping_;
     /// Material remapping table for 2-pass state and distance sort.
@@ -0,0 +1,512 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Graphics/DebugRenderer.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/LinearBVH.h"
+#include "../Graphics/OctreeQuery.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Maximum number of drawables in a leaf.
+static const unsigned MAX_LEAF_DRAWABLES = 4;
+/// Minimum number of pending drawables to rebuild the hierarchy.
+static const unsigned MIN_REBUILD_PENDING_DRAWABLES = 64;
+/// Rebuild when the pending drawables exceed this fraction of the drawables in the hierarchy.
+static const unsigned REBUILD_PENDING_DIVISOR = 16;
+/// Rebuild when the removed drawables exceed this fraction of the drawables in the hierarchy.
+static const unsigned REBUILD_REMOVED_DIVISOR = 4;
+/// Refit all nodes in one pass when the dirty leaves exceed this fraction of the nodes.
+static const unsigned FULL_REFIT_DIVISOR = 8;
+/// Rebuild when refitting has grown the hierarchy cost by this factor.
+static const float REBUILD_COST_RATIO = 2.0f;
+/// Location flag for pending drawables.
+static const unsigned LOCATION_PENDING = 0x80000000;
+/// Location flag for unbounded drawables.
+static const unsigned LOCATION_UNBOUNDED = 0x40000000;
+/// Mask for the index part of a location.
+static const unsigned LOCATION_INDEX_MASK = 0x3fffffff;
+/// Number of Morton code bits per axis.
+static const unsigned MORTON_BITS = 10;
+
+/// Return whether a bounding box can be stored in the hierarchy.
+static inline bool IsBounded(const BoundingBox& box)
+{
+    return box.Defined() && box.Size().LengthSquared() < M_LARGE_VALUE * M_LARGE_VALUE;
+}
+
+/// Spread the lower 10 bits of a value so that there are two zero bits between each.
+static inline unsigned ExpandMortonBits(unsigned value)
+{
+    value = (value * 0x00010001u) & 0xff0000ffu;
+    value = (value * 0x00000101u) & 0x0f00f00fu;
+    value = (value * 0x00000011u) & 0xc30c30c3u;
+    value = (value * 0x00000005u) & 0x49249249u;
+    return value;
+}
+
+/// Return the surface area of a bounding box.
+static inline float GetSurfaceArea(const BoundingBox& box)
+{
+    Vector3 size = box.Size();
+    return 2.0f * (size.x_ * size.y_ + size.y_ * size.z_ + size.z_ * size.x_);
+}
+
+LinearBVH::LinearBVH() :
+    buildCost_(0.0f),
+    numIndexed_(0),
+    numRemoved_(0),
+    numRefits_(0)
+{
+}
+
+LinearBVH::~LinearBVH()
+{
+}
+
+void LinearBVH::AddDrawable(Drawable* drawable)
+{
+    if (locations_.Contains(drawable))
+        return;
+
+    // Drawables join the hierarchy on the next rebuild
+    locations_[drawable] = pending_.Size() | LOCATION_PENDING;
+    pending_.Push(drawable);
+}
+
+bool LinearBVH::RemoveDrawable(Drawable* drawable)
+{
+    HashMap<Drawable*, unsigned>::Iterator i = locations_.Find(drawable);
+    if (i == locations_.End())
+        return false;
+
+    unsigned location = i->second_;
+    locations_.Erase(i);
+
+    if (location & LOCATION_PENDING)
+        RemoveFromList(pending_, location & LOCATION_INDEX_MASK, LOCATION_PENDING);
+    else if (location & LOCATION_UNBOUNDED)
+        RemoveFromList(unbounded_, location & LOCATION_INDEX_MASK, LOCATION_UNBOUNDED);
+    else
+        RemoveFromSlot(location);
+
+    return true;
+}
+
+void LinearBVH::Update(const PODVector<Drawable*>& drawables)
+{
+    for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        HashMap<Drawable*, unsigned>::Iterator j = locations_.Find(drawable);
+        if (j == locations_.End())
+            continue;
+
+        unsigned location = j->second_;
+        if (location & LOCATION_PENDING)
+            continue;
+
+        bool bounded = IsBounded(drawable->GetWorldBoundingBox());
+        if (location & LOCATION_UNBOUNDED)
+        {
+            // Became bounded: move to pending to be added to the hierarchy on the next rebuild
+            if (bounded)
+            {
+                RemoveFromList(unbounded_, location & LOCATION_INDEX_MASK, LOCATION_UNBOUNDED);
+                locations_[drawable] = pending_.Size() | LOCATION_PENDING;
+                pending_.Push(drawable);
+            }
+        }
+        else if (!bounded)
+        {
+            RemoveFromSlot(location);
+            locations_[drawable] = unbounded_.Size() | LOCATION_UNBOUNDED;
+            unbounded_.Push(drawable);
+        }
+        else
+            MarkLeafDirty(slotLeaves_[location]);
+    }
+
+    if (numRemoved_ > numIndexed_ / REBUILD_REMOVED_DIVISOR ||
+        pending_.Size() >= Max(numIndexed_ / REBUILD_PENDING_DIVISOR, MIN_REBUILD_PENDING_DRAWABLES))
+        Rebuild();
+    else if (!dirtyLeaves_.Empty())
+        Refit();
+}
+
+void LinearBVH::GetDrawables(OctreeQuery& query) const
+{
+    if (!unbounded_.Empty())
+    {
+        Drawable** start = const_cast<Drawable**>(unbounded_.Buffer());
+        query.TestDrawables(start, start + unbounded_.Size(), false);
+    }
+    if (!pending_.Empty())
+    {
+        Drawable** start = const_cast<Drawable**>(pending_.Buffer());
+        query.TestDrawables(start, start + pending_.Size(), false);
+    }
+    if (!nodes_.Empty())
+        GetDrawablesInternal(query, 0, false);
+}
+
+void LinearBVH::GetDrawables(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
+{
+    for (PODVector<Drawable*>::ConstIterator i = unbounded_.Begin(); i != unbounded_.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawables.Push(drawable);
+    }
+    for (PODVector<Drawable*>::ConstIterator i = pending_.Begin(); i != pending_.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawables.Push(drawable);
+    }
+    if (!nodes_.Empty())
+        GetDrawablesInternal(query, 0, drawables);
+}
+
+void LinearBVH::GetAllDrawables(PODVector<Drawable*>& drawables) const
+{
+    for (PODVector<BVHNode>::ConstIterator i = nodes_.Begin(); i != nodes_.End(); ++i)
+    {
+        if (!i->children_)
+        {
+            for (unsigned j = 0; j < i->count_; ++j)
+                drawables.Push(slots_[i->first_ + j]);
+        }
+    }
+    drawables.Push(pending_);
+    drawables.Push(unbounded_);
+}
+
+void LinearBVH::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
+{
+    if (!debug)
+        return;
+
+    for (PODVector<BVHNode>::ConstIterator i = nodes_.Begin(); i != nodes_.End(); ++i)
+    {
+        if (i->box_.Defined() && debug->IsInside(i->box_))
+            debug->AddBoundingBox(i->box_, Color(0.25f, 0.25f, 0.25f), depthTest);
+    }
+}
+
+void LinearBVH::Rebuild()
+{
+    // Collect the drawables of the hierarchy and the pending drawables which have a usable bounding box
+    PODVector<Drawable*> drawables;
+    drawables.Reserve(numIndexed_ + pending_.Size());
+    for (PODVector<BVHNode>::ConstIterator i = nodes_.Begin(); i != nodes_.End(); ++i)
+    {
+        if (!i->children_)
+        {
+            for (unsigned j = 0; j < i->count_; ++j)
+                drawables.Push(slots_[i->first_ + j]);
+        }
+    }
+    for (PODVector<Drawable*>::ConstIterator i = pending_.Begin(); i != pending_.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if (IsBounded(drawable->GetWorldBoundingBox()))
+            drawables.Push(drawable);
+        else
+        {
+            locations_[drawable] = unbounded_.Size() | LOCATION_UNBOUNDED;
+            unbounded_.Push(drawable);
+        }
+    }
+    pending_.Clear();
+
+    nodes_.Clear();
+    nodeDirty_.Clear();
+    dirtyLeaves_.Clear();
+    numIndexed_ = drawables.Size();
+    numRemoved_ = 0;
+    numRefits_ = 0;
+    buildCost_ = 0.0f;
+
+    if (drawables.Empty())
+    {
+        slots_.Clear();
+        slotLeaves_.Clear();
+        return;
+    }
+
+    // Quantize the bounding box centers within their bounds and sort along the Morton curve
+    BoundingBox centerBounds;
+    for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+        centerBounds.Merge((*i)->GetWorldBoundingBox().Center());
+
+    Vector3 size = centerBounds.Size();
+    float maxCoord = (float)((1 << MORTON_BITS) - 1);
+    Vector3 scale(size.x_ > 0.0f ? maxCoord / size.x_ : 0.0f, size.y_ > 0.0f ? maxCoord / size.y_ : 0.0f,
+        size.z_ > 0.0f ? maxCoord / size.z_ : 0.0f);
+
+    buildKeys_.Resize(drawables.Size());
+    for (unsigned i = 0; i < drawables.Size(); ++i)
+    {
+        Vector3 position = (drawables[i]->GetWorldBoundingBox().Center() - centerBounds.min_) * scale;
+        unsigned code = (ExpandMortonBits((unsigned)position.x_) << 2) | (ExpandMortonBits((unsigned)position.y_) << 1) |
+            ExpandMortonBits((unsigned)position.z_);
+        buildKeys_[i] = ((unsigned long long)code << 32) | i;
+    }
+    Sort(buildKeys_.Begin(), buildKeys_.End());
+
+    slots_.Resize(drawables.Size());
+    slotLeaves_.Resize(drawables.Size());
+    for (unsigned i = 0; i < drawables.Size(); ++i)
+    {
+        Drawable* drawable = drawables[(unsigned)(buildKeys_[i] & 0xffffffff)];
+        slots_[i] = drawable;
+        locations_[drawable] = i;
+    }
+
+    // Leaves hold at most MAX_LEAF_DRAWABLES, so there are less than 2 * count / MAX_LEAF_DRAWABLES nodes in the usual case
+    nodes_.Reserve(2 * drawables.Size() / MAX_LEAF_DRAWABLES + 1);
+    nodes_.Resize(1);
+    BuildNode(0, M_MAX_UNSIGNED, 0, slots_.Size());
+    nodeDirty_.Resize(nodes_.Size());
+    for (unsigned i = 0; i < nodeDirty_.Size(); ++i)
+        nodeDirty_[i] = 0;
+
+    buildCost_ = GetCost();
+}
+
+void LinearBVH::BuildNode(unsigned index, unsigned parent, unsigned first, unsigned count)
+{
+    nodes_[index].parent_ = parent;
+
+    if (count <= MAX_LEAF_DRAWABLES)
+    {
+        BVHNode& node = nodes_[index];
+        node.children_ = 0;
+        node.first_ = first;
+        node.count_ = count;
+        for (unsigned i = first; i < first + count; ++i)
+            slotLeaves_[i] = index;
+        node.box_ = GetLeafBox(node);
+        return;
+    }
+
+    // Split at the highest Morton code bit which differs within the range, or at the middle if the codes are equal
+    unsigned last = first + count - 1;
+    unsigned firstCode = (unsigned)(buildKeys_[first] >> 32);
+    unsigned lastCode = (unsigned)(buildKeys_[last] >> 32);
+    unsigned split = first + count / 2;
+    if (firstCode != lastCode)
+    {
+        unsigned bit = 1u << 31;
+        while (!((firstCode ^ lastCode) & bit))
+            bit >>= 1;
+
+        // The range is sorted, so binary search the first code which has the bit set
+        unsigned long long splitKey = (unsigned long long)((firstCode & ~(bit - 1)) | bit) << 32;
+        unsigned low = first + 1;
+        unsigned high = last;
+        while (low < high)
+        {
+            unsigned middle = (low + high) / 2;
+            if (buildKeys_[middle] < splitKey)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        split = low;
+    }
+
+    unsigned children = nodes_.Size();
+    nodes_.Resize(children + 2);
+    nodes_[index].children_ = children;
+    nodes_[index].first_ = 0;
+    nodes_[index].count_ = 0;
+    BuildNode(children, index, first, split - first);
+    BuildNode(children + 1, index, split, first + count - split);
+
+    BoundingBox box = nodes_[children].box_;
+    box.Merge(nodes_[children + 1].box_);
+    nodes_[index].box_ = box;
+}
+
+BoundingBox LinearBVH::GetLeafBox(const BVHNode& node) const
+{
+    BoundingBox box;
+    for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+        box.Merge(slots_[i]->GetWorldBoundingBox());
+    return box;
+}
+
+void LinearBVH::UpdateNodeBox(unsigned index)
+{
+    BVHNode& node = nodes_[index];
+    if (node.children_)
+    {
+        node.box_ = nodes_[node.children_].box_;
+        node.box_.Merge(nodes_[node.children_ + 1].box_);
+    }
+    else
+        node.box_ = GetLeafBox(node);
+}
+
+void LinearBVH::Refit()
+{
+    numRefits_ += dirtyLeaves_.Size();
+
+    if (dirtyLeaves_.Size() > nodes_.Size() / FULL_REFIT_DIVISOR || numRefits_ >= numIndexed_)
+    {
+        // Children always follow their parent, so a reverse pass updates the children first
+        for (unsigned i = nodes_.Size() - 1; i < nodes_.Size(); --i)
+            UpdateNodeBox(i);
+
+        numRefits_ = 0;
+        if (GetCost() > buildCost_ * REBUILD_COST_RATIO)
+        {
+            Rebuild();
+            return;
+        }
+    }
+    else
+    {
+        for (PODVector<unsigned>::ConstIterator i = dirtyLeaves_.Begin(); i != dirtyLeaves_.End(); ++i)
+        {
+            // Walk up until a node's bounding box does not change
+            unsigned index = *i;
+            while (index != M_MAX_UNSIGNED)
+            {
+                BoundingBox oldBox = nodes_[index].box_;
+                UpdateNodeBox(index);
+                if (nodes_[index].box_ == oldBox)
+                    break;
+                index = nodes_[index].parent_;
+            }
+        }
+    }
+
+    for (PODVector<unsigned>::ConstIterator i = dirtyLeaves_.Begin(); i != dirtyLeaves_.End(); ++i)
+        nodeDirty_[*i] = 0;
+    dirtyLeaves_.Clear();
+}
+
+void LinearBVH::MarkLeafDirty(unsigned index)
+{
+    if (!nodeDirty_[index])
+    {
+        nodeDirty_[index] = 1;
+        dirtyLeaves_.Push(index);
+    }
+}
+
+void LinearBVH::RemoveFromSlot(unsigned slot)
+{
+    // Keep the used slots of the leaf contiguous by moving its last drawable to the removed slot
+    unsigned leaf = slotLeaves_[slot];
+    BVHNode& node = nodes_[leaf];
+    unsigned last = node.first_ + node.count_ - 1;
+    if (slot != last)
+    {
+        slots_[slot] = slots_[last];
+        locations_[slots_[slot]] = slot;
+    }
+    slots_[last] = 0;
+    --node.count_;
+
+    ++numRemoved_;
+    MarkLeafDirty(leaf);
+}
+
+void LinearBVH::RemoveFromList(PODVector<Drawable*>& drawables, unsigned index, unsigned flag)
+{
+    unsigned last = drawables.Size() - 1;
+    if (index != last)
+    {
+        drawables[index] = drawables[last];
+        locations_[drawables[index]] = index | flag;
+    }
+    drawables.Pop();
+}
+
+void LinearBVH::GetDrawablesInternal(OctreeQuery& query, unsigned index, bool inside) const
+{
+    const BVHNode& node = nodes_[index];
+    if (!node.box_.Defined())
+        return;
+
+    Intersection res = query.TestOctant(node.box_, inside);
+    if (res == INSIDE)
+        inside = true;
+    else if (res == OUTSIDE)
+        return;
+
+    if (node.children_)
+    {
+        GetDrawablesInternal(query, node.children_, inside);
+        GetDrawablesInternal(query, node.children_ + 1, inside);
+    }
+    else if (node.count_)
+    {
+        Drawable** start = const_cast<Drawable**>(&slots_[node.first_]);
+        query.TestDrawables(start, start + node.count_, inside);
+    }
+}
+
+void LinearBVH::GetDrawablesInternal(RayOctreeQuery& query, unsigned index, PODVector<Drawable*>& drawables) const
+{
+    const BVHNode& node = nodes_[index];
+    if (!node.box_.Defined() || query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+        return;
+
+    if (node.children_)
+    {
+        GetDrawablesInternal(query, node.children_, drawables);
+        GetDrawablesInternal(query, node.children_ + 1, drawables);
+    }
+    else
+    {
+        for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+        {
+            Drawable* drawable = slots_[i];
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                drawables.Push(drawable);
+        }
+    }
+}
+
+float LinearBVH::GetCost() const
+{
+    float cost = 0.0f;
+    for (PODVector<BVHNode>::ConstIterator i = nodes_.Begin(); i != nodes_.End(); ++i)
+    {
+        if (i->children_ && i->box_.Defined())
+            cost += GetSurfaceArea(i->box_);
+    }
+    return cost;
+}
+
+}
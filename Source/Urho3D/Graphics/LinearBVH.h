@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Graphics/SpatialIndex.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+
+/// Linear bounding volume hierarchy node.
+struct BVHNode
+{
+    /// Bounding box of the drawables in the subtree. Undefined if the subtree is empty.
+    BoundingBox box_;
+    /// Index of the first child node, followed by the second, or 0 for a leaf.
+    unsigned children_;
+    /// Parent node index, or M_MAX_UNSIGNED for the root.
+    unsigned parent_;
+    /// First drawable slot of a leaf.
+    unsigned first_;
+    /// Number of drawables in a leaf.
+    unsigned count_;
+};
+
+/// %Spatial index which stores drawables in a bounding volume hierarchy, built by sorting the drawables along a Morton curve into a flat node array. Moving drawables refits the node bounding boxes in place. Drawables added after the build are tested one by one until the next rebuild, which happens when enough drawables have been added or removed, or when refitting has made the hierarchy too loose.
+class URHO3D_API LinearBVH : public SpatialIndex
+{
+public:
+    /// Construct.
+    LinearBVH();
+    /// Destruct.
+    virtual ~LinearBVH();
+
+    /// Add a drawable.
+    virtual void AddDrawable(Drawable* drawable);
+    /// Remove a drawable. Return true if it was found.
+    virtual bool RemoveDrawable(Drawable* drawable);
+    /// Refit or rebuild after drawables have been moved, added or removed.
+    virtual void Update(const PODVector<Drawable*>& drawables);
+    /// Return drawable objects by a query.
+    virtual void GetDrawables(OctreeQuery& query) const;
+    /// Return the drawable objects which a ray query may hit.
+    virtual void GetDrawables(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Return all drawables.
+    virtual void GetAllDrawables(PODVector<Drawable*>& drawables) const;
+    /// Draw the node bounding boxes to the debug graphics.
+    virtual void DrawDebugGeometry(DebugRenderer* debug, bool depthTest);
+
+    /// Rebuild the hierarchy from all drawables. Must be called from the main thread.
+    void Rebuild();
+
+    /// Return number of nodes.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+
+    /// Return number of drawables added after the last build, which are tested one by one.
+    unsigned GetNumPendingDrawables() const { return pending_.Size(); }
+
+private:
+    /// Build a node from a range of Morton-sorted drawable slots. (recursive)
+    void BuildNode(unsigned index, unsigned parent, unsigned first, unsigned count);
+    /// Return the bounding box of a leaf's drawables.
+    BoundingBox GetLeafBox(const BVHNode& node) const;
+    /// Recalculate a node's bounding box from its drawables or children.
+    void UpdateNodeBox(unsigned index);
+    /// Refit the bounding boxes of the dirty leaves and their ancestors. Rebuild if the hierarchy has become too loose.
+    void Refit();
+    /// Mark a leaf's bounding box dirty.
+    void MarkLeafDirty(unsigned index);
+    /// Remove a drawable from a hierarchy slot.
+    void RemoveFromSlot(unsigned slot);
+    /// Remove a drawable from the pending or unbounded list.
+    void RemoveFromList(PODVector<Drawable*>& drawables, unsigned index, unsigned flag);
+    /// Return drawable objects by a query, called internally. (recursive)
+    void GetDrawablesInternal(OctreeQuery& query, unsigned index, bool inside) const;
+    /// Return drawable objects by a ray query, called internally. (recursive)
+    void GetDrawablesInternal(RayOctreeQuery& query, unsigned index, PODVector<Drawable*>& drawables) const;
+    /// Return the total surface area of the non-leaf node bounding boxes, used as the hierarchy quality measure.
+    float GetCost() const;
+
+    /// Nodes. The root is at index 0 and children always follow their parent.
+    PODVector<BVHNode> nodes_;
+    /// Drawable slots in leaf order. Each leaf owns a contiguous range, of which the first count_ slots are in use.
+    PODVector<Drawable*> slots_;
+    /// Leaf node index of each slot.
+    PODVector<unsigned> slotLeaves_;
+    /// Drawables added after the last build.
+    PODVector<Drawable*> pending_;
+    /// Drawables with undefined or infinite bounding boxes, which are kept out of the hierarchy.
+    PODVector<Drawable*> unbounded_;
+    /// Drawable locations: slot index, or pending / unbounded list index combined with a flag.
+    HashMap<Drawable*, unsigned> locations_;
+    /// Leaves whose bounding boxes need refitting.
+    PODVector<unsigned> dirtyLeaves_;
+    /// Dirty flags of the nodes.
+    PODVector<unsigned char> nodeDirty_;
+    /// Morton codes of the drawables during build.
+    PODVector<unsigned long long> buildKeys_;
+    /// Cost of the hierarchy when it was built.
+    float buildCost_;
+    /// Number of drawables in the hierarchy.
+    unsigned numIndexed_;
+    /// Number of drawables removed from the hierarchy since the build.
+    unsigned numRemoved_;
+    /// Number of leaf refits since the last full refit.
+    unsigned numRefits_;
+};
+
+}
@@ -28,6 +28,10 @@
 #include "../Graphics/OcclusionBuffer.h"
 #include "../IO/Log.h"
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -386,6 +390,107 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
         if (projected.z_ < minZ) minZ = projected.z_;
     }
 
+    return IsProjectedBoxVisible(minX, minY, maxX, maxY, minZ);
+}
+
+void OcclusionBuffer::IsVisible(const BoundingBox* worldSpaceBoxes, unsigned count, bool* visible) const
+{
+    if (buffers_.Empty())
+    {
+        for (unsigned i = 0; i < count; ++i)
+            visible[i] = true;
+        return;
+    }
+
+    unsigned i = 0;
+
+#ifdef URHO3D_SSE
+    const Matrix4& m = viewProj_;
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 bias = _mm_set1_ps(OCCLUSION_RELATIVE_BIAS);
+    __m128 scaleX = _mm_set1_ps(scaleX_);
+    __m128 scaleY = _mm_set1_ps(scaleY_);
+    __m128 offsetX = _mm_set1_ps(offsetX_);
+    __m128 offsetY = _mm_set1_ps(offsetY_);
+    __m128 scaleZ = _mm_set1_ps(OCCLUSION_Z_SCALE);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const BoundingBox* boxes = worldSpaceBoxes + i;
+        __m128 boxMin[3];
+        __m128 boxMax[3];
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            boxMin[j] = _mm_set_ps(boxes[3].min_.Data()[j], boxes[2].min_.Data()[j], boxes[1].min_.Data()[j], boxes[0].min_.Data()[j]);
+            boxMax[j] = _mm_set_ps(boxes[3].max_.Data()[j], boxes[2].max_.Data()[j], boxes[1].max_.Data()[j], boxes[0].max_.Data()[j]);
+        }
+
+        __m128 behind = zero;
+        __m128 minX, maxX, minY, maxY, minZ;
+
+        // Transform and project the corners of four boxes at a time. Same operation order as in the single box test, so that
+        // the results are identical
+        for (unsigned j = 0; j < 8; ++j)
+        {
+            __m128 x = (j & 1) ? boxMax[0] : boxMin[0];
+            __m128 y = (j & 2) ? boxMax[1] : boxMin[1];
+            __m128 z = (j & 4) ? boxMax[2] : boxMin[2];
+
+            __m128 clipX = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m00_), x), _mm_mul_ps(_mm_set1_ps(m.m01_), y)),
+                _mm_mul_ps(_mm_set1_ps(m.m02_), z)), _mm_set1_ps(m.m03_));
+            __m128 clipY = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m10_), x), _mm_mul_ps(_mm_set1_ps(m.m11_), y)),
+                _mm_mul_ps(_mm_set1_ps(m.m12_), z)), _mm_set1_ps(m.m13_));
+            __m128 clipZ = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m20_), x), _mm_mul_ps(_mm_set1_ps(m.m21_), y)),
+                _mm_mul_ps(_mm_set1_ps(m.m22_), z)), _mm_set1_ps(m.m23_));
+            __m128 clipW = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m30_), x), _mm_mul_ps(_mm_set1_ps(m.m31_), y)),
+                _mm_mul_ps(_mm_set1_ps(m.m32_), z)), _mm_set1_ps(m.m33_));
+
+            // Apply a far clip relative bias
+            clipZ = _mm_sub_ps(clipZ, bias);
+            behind = _mm_or_ps(behind, _mm_cmple_ps(clipZ, zero));
+
+            __m128 invW = _mm_div_ps(one, clipW);
+            __m128 projectedX = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(invW, clipX), scaleX), offsetX);
+            __m128 projectedY = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(invW, clipY), scaleY), offsetY);
+            __m128 projectedZ = _mm_mul_ps(_mm_mul_ps(invW, clipZ), scaleZ);
+
+            if (!j)
+            {
+                minX = maxX = projectedX;
+                minY = maxY = projectedY;
+                minZ = projectedZ;
+            }
+            else
+            {
+                minX = _mm_min_ps(minX, projectedX);
+                maxX = _mm_max_ps(maxX, projectedX);
+                minY = _mm_min_ps(minY, projectedY);
+                maxY = _mm_max_ps(maxY, projectedY);
+                minZ = _mm_min_ps(minZ, projectedZ);
+            }
+        }
+
+        float minXs[4], maxXs[4], minYs[4], maxYs[4], minZs[4];
+        _mm_storeu_ps(minXs, minX);
+        _mm_storeu_ps(maxXs, maxX);
+        _mm_storeu_ps(minYs, minY);
+        _mm_storeu_ps(maxYs, maxY);
+        _mm_storeu_ps(minZs, minZ);
+        int behindMask = _mm_movemask_ps(behind);
+
+        // If any of the corners cross the near plane, assume visible
+        for (unsigned j = 0; j < 4; ++j)
+            visible[i + j] = (behindMask & (1 << j)) || IsProjectedBoxVisible(minXs[j], minYs[j], maxXs[j], maxYs[j], minZs[j]);
+    }
+#endif
+
+    for (; i < count; ++i)
+        visible[i] = IsVisible(worldSpaceBoxes[i]);
+}
+
+bool OcclusionBuffer::IsProjectedBoxVisible(float minX, float minY, float maxX, float maxY, float minZ) const
+{
     // Expand the bounding box 1 pixel in each direction to be conservative and correct rasterization offset
     IntRect rect(
         (int)(minX - 1.5f), (int)(minY - 1.5f),
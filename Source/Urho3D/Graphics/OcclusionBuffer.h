@@ -149,6 +149,8 @@ public:
 
     /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
+    /// Test several bounding boxes for visibility and write the results. Transforms four boxes at a time with SSE, then performs the same tests as for a single box.
+    void IsVisible(const BoundingBox* worldSpaceBoxes, unsigned count, bool* visible) const;
     /// Return time since last use in milliseconds.
     unsigned GetUseTimer();
 
@@ -164,6 +166,8 @@ private:
     inline Vector4 ClipEdge(const Vector4& v0, const Vector4& v1, float d0, float d1) const;
     /// Return signed area of a triangle. If negative, is clockwise.
     inline float SignedArea(const Vector3& v0, const Vector3& v1, const Vector3& v2) const;
+    /// Test visibility of a projected bounding box against the depth hierarchy and the pixel-level data.
+    bool IsProjectedBoxVisible(float minX, float minY, float maxX, float maxY, float minZ) const;
     /// Calculate viewport transform.
     void CalculateViewport();
     /// Draw a triangle.
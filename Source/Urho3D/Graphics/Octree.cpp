@@ -29,6 +29,7 @@
 #include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Graphics.h"
+#include "../Graphics/LinearBVH.h"
 #include "../Graphics/Octree.h"
 #include "../IO/Log.h"
 #include "../Scene/Scene.h"
@@ -45,22 +46,104 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+/// Minimum number of drawables in the octree to execute a query in worker threads.
+static const unsigned MIN_THREADED_QUERY_DRAWABLES = 4096;
+/// Octree level at which subtrees are handed to worker threads in threaded queries.
+static const unsigned THREADED_QUERY_SPLIT_LEVEL = 2;
+/// Maximum number of drawables in one task of a threaded query, when testing the drawables of octants above the split level.
+static const unsigned THREADED_QUERY_TASK_DRAWABLES = 1024;
+/// Minimum number of queued drawable updates to find the reinsertion octants in worker threads.
+static const unsigned MIN_THREADED_REINSERTIONS = 1024;
+/// Minimum number of queued drawable updates in one work item when finding the reinsertion octants.
+static const unsigned REINSERTION_TASK_DRAWABLES = 64;
+/// Maximum number of work items per thread when finding the reinsertion octants, so that threads finishing early can steal.
+static const unsigned REINSERTION_TASKS_PER_THREAD = 4;
+/// Bit position of the level in an octant path key. The lower bits hold 3 bits of child index per level.
+static const unsigned OCTANT_KEY_LEVEL_SHIFT = 58;
+/// Maximum number of octree levels that fit in an octant path key.
+static const unsigned MAX_OCTANT_KEY_LEVELS = OCTANT_KEY_LEVEL_SHIFT / 3;
+
+static const char* spatialIndexTypeNames[] =
+{
+    "Octants",
+    "Linear BVH",
+    "Custom",
+    0
+};
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
+/// %Drawable update functor for ParallelFor().
+struct UpdateDrawablesFunctor
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
-    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
+    /// Construct.
+    UpdateDrawablesFunctor(const FrameInfo& frame) :
+        frame_(frame)
+    {
+    }
 
-    while (start != end)
+    /// Update a range of drawables.
+    void operator ()(Drawable** start, Drawable** end, unsigned threadIndex)
+    {
+        while (start != end)
+        {
+            Drawable* drawable = *start;
+            if (drawable)
+                drawable->Update(frame_);
+            ++start;
+        }
+    }
+
+    /// Frame info.
+    const FrameInfo& frame_;
+};
+
+/// Threaded octree query functor for ParallelFor(). Collects the results of each thread into its own vector.
+struct OctreeQueryFunctor
+{
+    /// Construct.
+    OctreeQueryFunctor(OctreeQuery& query, Vector<PODVector<Drawable*> >& results) :
+        query_(query),
+        results_(results)
+    {
+    }
+
+    /// Execute a range of query tasks.
+    void operator ()(OctreeQueryTask* start, OctreeQueryTask* end, unsigned threadIndex)
     {
-        Drawable* drawable = *start;
-        if (drawable)
-            drawable->Update(frame);
-        ++start;
+        PODVector<Drawable*>& result = results_[threadIndex];
+
+        while (start != end)
+        {
+            const OctreeQueryTask& task = *start++;
+            if (task.octant_)
+                task.octant_->GetDrawablesThreadedInternal(query_, task.inside_, result);
+            else if (task.batches_)
+                query_.TestDrawableBatchesThreaded(task.start_, task.end_, task.batches_, result);
+            else
+                query_.TestDrawablesThreaded(task.start_, task.end_, task.inside_, result);
+        }
     }
+
+    /// Query.
+    OctreeQuery& query_;
+    /// Per-thread result vectors.
+    Vector<PODVector<Drawable*> >& results_;
+};
+
+/// Work function for finding the octants of a range of moved drawables. Does not modify the octree.
+void FindReinsertionsWork(const WorkItem* item, unsigned threadIndex)
+{
+    Octree* octree = reinterpret_cast<Octree*>(item->aux_);
+    octree->FindReinsertions(reinterpret_cast<Drawable**>(item->start_), reinterpret_cast<Drawable**>(item->end_),
+        octree->threadReinsertions_[threadIndex]);
+}
+
+/// Work function for merging the per-thread reinsertions and sorting them by target octant. Depends on all the find items.
+void MergeReinsertionsWork(const WorkItem* item, unsigned threadIndex)
+{
+    Octree* octree = reinterpret_cast<Octree*>(item->aux_);
+    octree->MergeReinsertions();
 }
 
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
@@ -68,7 +151,57 @@ inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResu
     return lhs.distance_ < rhs.distance_;
 }
 
+/// Return whether a box is small enough for an octant, but too large for its children.
+static inline bool CheckFit(const BoundingBox& box, const BoundingBox& octantBox, const Vector3& halfSize, bool maxLevel)
+{
+    Vector3 boxSize = box.Size();
+
+    // If max split level, size always OK, otherwise check that box is at least half size of octant
+    if (maxLevel || boxSize.x_ >= halfSize.x_ || boxSize.y_ >= halfSize.y_ || boxSize.z_ >= halfSize.z_)
+        return true;
+    // Also check if the box can not fit a child octant's culling box, in that case size OK (must insert here)
+    else
+    {
+        if (box.min_.x_ <= octantBox.min_.x_ - 0.5f * halfSize.x_ ||
+            box.max_.x_ >= octantBox.max_.x_ + 0.5f * halfSize.x_ ||
+            box.min_.y_ <= octantBox.min_.y_ - 0.5f * halfSize.y_ ||
+            box.max_.y_ >= octantBox.max_.y_ + 0.5f * halfSize.y_ ||
+            box.min_.z_ <= octantBox.min_.z_ - 0.5f * halfSize.z_ ||
+            box.max_.z_ >= octantBox.max_.z_ + 0.5f * halfSize.z_)
+            return true;
+    }
+
+    // Bounding box too small, should create a child octant
+    return false;
+}
+
+/// Return the bounding box of a child octant.
+static inline BoundingBox GetChildBox(const BoundingBox& box, unsigned index)
+{
+    Vector3 newMin = box.min_;
+    Vector3 newMax = box.max_;
+    Vector3 oldCenter = box.Center();
+
+    if (index & 1)
+        newMin.x_ = oldCenter.x_;
+    else
+        newMax.x_ = oldCenter.x_;
+
+    if (index & 2)
+        newMin.y_ = oldCenter.y_;
+    else
+        newMax.y_ = oldCenter.y_;
+
+    if (index & 4)
+        newMin.z_ = oldCenter.z_;
+    else
+        newMax.z_ = oldCenter.z_;
+
+    return BoundingBox(newMin, newMax);
+}
+
 Octant::Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* root, unsigned index) :
+    boxBatchesDirty_(true),
     level_(level),
     numDrawables_(0),
     parent_(parent),
@@ -92,6 +225,7 @@ Octant::~Octant()
             root_->drawables_.Push(*i);
             root_->QueueUpdate(*i);
         }
+        root_->boxBatchesDirty_ = true;
         drawables_.Clear();
         numDrawables_ = 0;
     }
@@ -105,26 +239,7 @@ Octant* Octant::GetOrCreateChild(unsigned index)
     if (children_[index])
         return children_[index];
 
-    Vector3 newMin = worldBoundingBox_.min_;
-    Vector3 newMax = worldBoundingBox_.max_;
-    Vector3 oldCenter = worldBoundingBox_.Center();
-
-    if (index & 1)
-        newMin.x_ = oldCenter.x_;
-    else
-        newMax.x_ = oldCenter.x_;
-
-    if (index & 2)
-        newMin.y_ = oldCenter.y_;
-    else
-        newMax.y_ = oldCenter.y_;
-
-    if (index & 4)
-        newMin.z_ = oldCenter.z_;
-    else
-        newMax.z_ = oldCenter.z_;
-
-    children_[index] = new Octant(BoundingBox(newMin, newMax), level_ + 1, this, root_, index);
+    children_[index] = new Octant(GetChildBox(worldBoundingBox_, index), level_ + 1, this, root_, index);
     return children_[index];
 }
 
@@ -140,10 +255,13 @@ void Octant::InsertDrawable(Drawable* drawable)
     const BoundingBox& box = drawable->GetWorldBoundingBox();
 
     // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
-    // Also if drawable is outside the root octant bounds, insert to root
+    // Also if drawable is outside the root octant bounds, insert to root. With a spatial index, all drawables are in the root
     bool insertHere;
     if (this == root_)
-        insertHere = !drawable->IsOccludee() || cullingBox_.IsInside(box) != INSIDE || CheckDrawableFit(box);
+    {
+        insertHere = root_->GetSpatialIndex() || !drawable->IsOccludee() || cullingBox_.IsInside(box) != INSIDE ||
+            CheckDrawableFit(box);
+    }
     else
         insertHere = CheckDrawableFit(box);
 
@@ -169,28 +287,37 @@ void Octant::InsertDrawable(Drawable* drawable)
     }
 }
 
-bool Octant::CheckDrawableFit(const BoundingBox& box) const
+void Octant::AddDrawable(Drawable* drawable)
 {
-    Vector3 boxSize = box.Size();
+    drawable->SetOctant(this);
 
-    // If max split level, size always OK, otherwise check that box is at least half size of octant
-    if (level_ >= root_->GetNumLevels() || boxSize.x_ >= halfSize_.x_ || boxSize.y_ >= halfSize_.y_ ||
-        boxSize.z_ >= halfSize_.z_)
-        return true;
-    // Also check if the box can not fit a child octant's culling box, in that case size OK (must insert here)
+    SpatialIndex* index = this == root_ ? root_->GetSpatialIndex() : 0;
+    if (index)
+        index->AddDrawable(drawable);
     else
     {
-        if (box.min_.x_ <= worldBoundingBox_.min_.x_ - 0.5f * halfSize_.x_ ||
-            box.max_.x_ >= worldBoundingBox_.max_.x_ + 0.5f * halfSize_.x_ ||
-            box.min_.y_ <= worldBoundingBox_.min_.y_ - 0.5f * halfSize_.y_ ||
-            box.max_.y_ >= worldBoundingBox_.max_.y_ + 0.5f * halfSize_.y_ ||
-            box.min_.z_ <= worldBoundingBox_.min_.z_ - 0.5f * halfSize_.z_ ||
-            box.max_.z_ >= worldBoundingBox_.max_.z_ + 0.5f * halfSize_.z_)
-            return true;
+        drawables_.Push(drawable);
+        boxBatchesDirty_ = true;
     }
 
-    // Bounding box too small, should create a child octant
-    return false;
+    IncDrawableCount();
+}
+
+void Octant::RemoveDrawable(Drawable* drawable, bool resetOctant)
+{
+    SpatialIndex* index = this == root_ ? root_->GetSpatialIndex() : 0;
+    if (index ? index->RemoveDrawable(drawable) : drawables_.Remove(drawable))
+    {
+        if (resetOctant)
+            drawable->SetOctant(0);
+        boxBatchesDirty_ = true;
+        DecDrawableCount();
+    }
+}
+
+bool Octant::CheckDrawableFit(const BoundingBox& box) const
+{
+    return CheckFit(box, worldBoundingBox_, halfSize_, level_ >= root_->GetNumLevels());
 }
 
 void Octant::ResetRoot()
@@ -248,7 +375,11 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     {
         Drawable** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        const BoundingBoxBatch* batches = inside ? 0 : GetBoxBatches(query);
+        if (batches)
+            query.TestDrawableBatches(start, end, batches);
+        else
+            query.TestDrawables(start, end, inside);
     }
 
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
@@ -312,9 +443,139 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
     }
 }
 
+void Octant::GetDrawablesThreadedInternal(OctreeQuery& query, bool inside, PODVector<Drawable*>& result) const
+{
+    if (this != root_)
+    {
+        Intersection res = query.TestOctant(cullingBox_, inside);
+        if (res == INSIDE)
+            inside = true;
+        else if (res == OUTSIDE)
+            return;
+    }
+
+    if (drawables_.Size())
+    {
+        Drawable** start = const_cast<Drawable**>(&drawables_[0]);
+        Drawable** end = start + drawables_.Size();
+        const BoundingBoxBatch* batches = inside ? 0 : GetBoxBatches(query);
+        if (batches)
+            query.TestDrawableBatchesThreaded(start, end, batches, result);
+        else
+            query.TestDrawablesThreaded(start, end, inside, result);
+    }
+
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+    {
+        if (children_[i])
+            children_[i]->GetDrawablesThreadedInternal(query, inside, result);
+    }
+}
+
+void Octant::GetQueryTasksInternal(OctreeQuery& query, bool inside, unsigned splitLevel, PODVector<OctreeQueryTask>& tasks) const
+{
+    if (this != root_)
+    {
+        Intersection res = query.TestOctant(cullingBox_, inside);
+        if (res == INSIDE)
+            inside = true;
+        else if (res == OUTSIDE)
+            return;
+    }
+
+    // Split large drawable lists, such as the root's, into several tasks
+    if (drawables_.Size())
+    {
+        Drawable** start = const_cast<Drawable**>(&drawables_[0]);
+        Drawable** end = start + drawables_.Size();
+        const BoundingBoxBatch* batches = inside ? 0 : GetBoxBatches(query);
+        while (start != end)
+        {
+            OctreeQueryTask task;
+            task.octant_ = 0;
+            task.start_ = start;
+            task.end_ = start + Min((unsigned)(end - start), THREADED_QUERY_TASK_DRAWABLES);
+            task.batches_ = batches;
+            task.inside_ = inside;
+            tasks.Push(task);
+            start = task.end_;
+            if (batches)
+                batches += THREADED_QUERY_TASK_DRAWABLES / BOUNDING_BOX_BATCH_SIZE;
+        }
+    }
+
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+    {
+        Octant* child = children_[i];
+        if (!child)
+            continue;
+
+        if (child->level_ < splitLevel)
+            child->GetQueryTasksInternal(query, inside, splitLevel, tasks);
+        else
+        {
+            // The worker thread tests the subtree's root octant
+            OctreeQueryTask task;
+            task.octant_ = child;
+            task.start_ = 0;
+            task.end_ = 0;
+            task.batches_ = 0;
+            task.inside_ = inside;
+            tasks.Push(task);
+        }
+    }
+}
+
+void Octant::RemoveMovedDrawables()
+{
+    PODVector<Drawable*>::Iterator dest = drawables_.Begin();
+    for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+    {
+        if ((*i)->octant_ == this)
+            *dest++ = *i;
+    }
+
+    unsigned numRemoved = (unsigned)(drawables_.End() - dest);
+    if (numRemoved)
+    {
+        drawables_.Resize(drawables_.Size() - numRemoved);
+        boxBatchesDirty_ = true;
+        // May delete this octant
+        DecDrawableCount(numRemoved);
+    }
+}
+
+const BoundingBoxBatch* Octant::GetBoxBatches(const OctreeQuery& query) const
+{
+    // Drawables changed since the last octree update are tested one by one instead
+    return query.useBoxBatches_ && !boxBatchesDirty_ ? boxBatches_.Buffer() : 0;
+}
+
+void Octant::UpdateBoxBatches()
+{
+    if (boxBatchesDirty_)
+    {
+        unsigned numDrawables = drawables_.Size();
+        boxBatches_.Resize((numDrawables + BOUNDING_BOX_BATCH_SIZE - 1) / BOUNDING_BOX_BATCH_SIZE);
+        for (unsigned i = 0; i < numDrawables; ++i)
+            boxBatches_[i / BOUNDING_BOX_BATCH_SIZE].Set(i % BOUNDING_BOX_BATCH_SIZE, drawables_[i]->GetWorldBoundingBox());
+        for (unsigned i = numDrawables; i < boxBatches_.Size() * BOUNDING_BOX_BATCH_SIZE; ++i)
+            boxBatches_[i / BOUNDING_BOX_BATCH_SIZE].Clear(i % BOUNDING_BOX_BATCH_SIZE);
+
+        boxBatchesDirty_ = false;
+    }
+
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+    {
+        if (children_[i])
+            children_[i]->UpdateBoxBatches();
+    }
+}
+
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, 0, this),
+    spatialIndexType_(SPATIAL_INDEX_OCTANTS),
     numLevels_(DEFAULT_OCTREE_LEVELS)
 {
     // If the engine is running headless, subscribe to RenderUpdate events for manually updating the octree
@@ -328,6 +589,16 @@ Octree::~Octree()
     // Reset root pointer from all child octants now so that they do not move their drawables to root
     drawableUpdates_.Clear();
     ResetRoot();
+
+    // Detach the drawables stored in the spatial index
+    if (spatialIndex_)
+    {
+        PODVector<Drawable*> drawables;
+        spatialIndex_->GetAllDrawables(drawables);
+        for (PODVector<Drawable*>::Iterator i = drawables.Begin(); i != drawables.End(); ++i)
+            (*i)->SetOctant(0);
+        spatialIndex_.Reset();
+    }
 }
 
 void Octree::RegisterObject(Context* context)
@@ -340,6 +611,8 @@ void Octree::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE("Bounding Box Min", Vector3, worldBoundingBox_.min_, defaultBoundsMin, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Bounding Box Max", Vector3, worldBoundingBox_.max_, defaultBoundsMax, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Number of Levels", int, numLevels_, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    URHO3D_ENUM_ACCESSOR_ATTRIBUTE("Spatial Index", GetSpatialIndexType, SetSpatialIndexType, SpatialIndexType,
+        spatialIndexTypeNames, SPATIAL_INDEX_OCTANTS, AM_DEFAULT);
 }
 
 void Octree::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
@@ -355,7 +628,10 @@ void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     {
         URHO3D_PROFILE(OctreeDrawDebug);
 
-        Octant::DrawDebugGeometry(debug, depthTest);
+        if (spatialIndex_)
+            spatialIndex_->DrawDebugGeometry(debug, depthTest);
+        else
+            Octant::DrawDebugGeometry(debug, depthTest);
     }
 }
 
@@ -368,10 +644,58 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
         DeleteChild(i);
 
     Initialize(box);
-    numDrawables_ = drawables_.Size();
+    if (!spatialIndex_)
+        numDrawables_ = drawables_.Size();
     numLevels_ = Max(numLevels, 1U);
 }
 
+void Octree::SetSpatialIndexType(SpatialIndexType type)
+{
+    if (type == spatialIndexType_ || type == SPATIAL_INDEX_CUSTOM)
+        return;
+
+    SetSpatialIndex(type == SPATIAL_INDEX_LINEAR_BVH ? new LinearBVH() : 0);
+    spatialIndexType_ = type;
+}
+
+void Octree::SetSpatialIndex(SpatialIndex* index)
+{
+    if (index == spatialIndex_)
+        return;
+
+    URHO3D_PROFILE(SetSpatialIndex);
+
+    // Take the drawables from the octants or the old index. Deleting the child octants moves their drawables to the root
+    PODVector<Drawable*> drawables;
+    if (spatialIndex_)
+        spatialIndex_->GetAllDrawables(drawables);
+    else
+    {
+        for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+            DeleteChild(i);
+        drawables.Swap(drawables_);
+        boxBatchesDirty_ = true;
+    }
+
+    spatialIndex_ = index;
+    spatialIndexType_ = index ? SPATIAL_INDEX_CUSTOM : SPATIAL_INDEX_OCTANTS;
+
+    // The drawables stay in the root octant, so the drawable count does not change
+    for (PODVector<Drawable*>::Iterator i = drawables.Begin(); i != drawables.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if (index)
+            index->AddDrawable(drawable);
+        else
+        {
+            // Reinsert to the octants on the next update
+            drawables_.Push(drawable);
+            if (!drawable->updateQueued_)
+                QueueUpdate(drawable);
+        }
+    }
+}
+
 void Octree::Update(const FrameInfo& frame)
 {
     if (!Thread::IsMainThread())
@@ -391,30 +715,9 @@ void Octree::Update(const FrameInfo& frame)
         WorkQueue* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
-
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
+        UpdateDrawablesFunctor updateDrawables(frame);
+        queue->ParallelFor(drawableUpdates_.Buffer(), drawableUpdates_.Buffer() + drawableUpdates_.Size(), 16, updateDrawables);
 
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
         scene->EndThreadedUpdate();
     }
 
@@ -448,41 +751,46 @@ void Octree::Update(const FrameInfo& frame)
         scene->SendEvent(E_SCENEDRAWABLEUPDATEFINISHED, eventData);
     }
 
+    // With a spatial index, let it refit or rebuild itself. This is done also without updates, as drawables may have been
+    // added or removed
+    if (spatialIndex_)
+    {
+        URHO3D_PROFILE(UpdateSpatialIndex);
+
+        for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+            (*i)->updateQueued_ = false;
+        spatialIndex_->Update(drawableUpdates_);
+    }
     // Reinsert drawables that have been moved or resized, or that have been newly added to the octree and do not sit inside
     // the proper octant yet
-    if (!drawableUpdates_.Empty())
+    else if (!drawableUpdates_.Empty())
     {
         URHO3D_PROFILE(ReinsertToOctree);
 
+        WorkQueue* queue = GetSubsystem<WorkQueue>();
+        if (queue && queue->GetNumThreads() && drawableUpdates_.Size() >= MIN_THREADED_REINSERTIONS &&
+            numLevels_ <= MAX_OCTANT_KEY_LEVELS)
+            ReinsertDrawablesThreaded();
+        else
+            ReinsertDrawables();
+
+        // The drawables which stayed in their octants may have changed their bounding boxes after being queued
         for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
         {
-            Drawable* drawable = *i;
-            drawable->updateQueued_ = false;
-            Octant* octant = drawable->GetOctant();
-            const BoundingBox& box = drawable->GetWorldBoundingBox();
-
-            // Skip if no octant or does not belong to this octree anymore
-            if (!octant || octant->GetRoot() != this)
-                continue;
-            // Skip if still fits the current octant
-            if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
-                continue;
-
-            InsertDrawable(drawable);
-
-#ifdef _DEBUG
-            // Verify that the drawable will be culled correctly
-            octant = drawable->GetOctant();
-            if (octant != this && octant->GetCullingBox().IsInside(box) != INSIDE)
-            {
-                URHO3D_LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() +
-                         " octant box " + octant->GetCullingBox().ToString());
-            }
-#endif
+            Octant* octant = (*i)->GetOctant();
+            if (octant)
+                octant->boxBatchesDirty_ = true;
         }
     }
 
     drawableUpdates_.Clear();
+
+    // Rebuild the bounding box batches here in the main thread, as queries may run in worker threads
+    if (!spatialIndex_)
+    {
+        URHO3D_PROFILE(UpdateBoxBatches);
+        UpdateBoxBatches();
+    }
 }
 
 void Octree::AddManualDrawable(Drawable* drawable)
@@ -506,7 +814,39 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.Clear();
-    GetDrawablesInternal(query, false);
+    if (spatialIndex_)
+        spatialIndex_->GetDrawables(query);
+    else
+        GetDrawablesInternal(query, false);
+}
+
+void Octree::GetDrawablesThreaded(OctreeQuery& query) const
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!queue || !queue->GetNumThreads() || numDrawables_ < MIN_THREADED_QUERY_DRAWABLES || !Thread::IsMainThread() ||
+        spatialIndex_)
+    {
+        GetDrawables(query);
+        return;
+    }
+
+    URHO3D_PROFILE(ThreadedOctreeQuery);
+
+    query.result_.Clear();
+
+    // Test the octants above the split level here, then hand the subtrees and large drawable lists to the threads
+    queryTasks_.Clear();
+    GetQueryTasksInternal(query, false, THREADED_QUERY_SPLIT_LEVEL, queryTasks_);
+
+    threadQueryResults_.Resize(queue->GetNumThreads() + 1);
+    for (unsigned i = 0; i < threadQueryResults_.Size(); ++i)
+        threadQueryResults_[i].Clear();
+
+    OctreeQueryFunctor executeTasks(query, threadQueryResults_);
+    queue->ParallelFor(queryTasks_.Buffer(), queryTasks_.Buffer() + queryTasks_.Size(), 1, executeTasks);
+
+    for (unsigned i = 0; i < threadQueryResults_.Size(); ++i)
+        query.result_.Push(threadQueryResults_[i]);
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -514,7 +854,15 @@ void Octree::Raycast(RayOctreeQuery& query) const
     URHO3D_PROFILE(Raycast);
 
     query.result_.Clear();
-    GetDrawablesInternal(query);
+    if (spatialIndex_)
+    {
+        PODVector<Drawable*> drawables;
+        spatialIndex_->GetDrawables(query, drawables);
+        for (PODVector<Drawable*>::Iterator i = drawables.Begin(); i != drawables.End(); ++i)
+            (*i)->ProcessRayQuery(query, query.result_);
+    }
+    else
+        GetDrawablesInternal(query);
     Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
 }
 
@@ -524,7 +872,10 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
     query.result_.Clear();
     rayQueryDrawables_.Clear();
-    GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+    if (spatialIndex_)
+        spatialIndex_->GetDrawables(query, rayQueryDrawables_);
+    else
+        GetDrawablesOnlyInternal(query, rayQueryDrawables_);
 
     // Sort by increasing hit distance to AABB
     for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
@@ -560,14 +911,23 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
 void Octree::QueueUpdate(Drawable* drawable)
 {
+    // The drawable's bounding box is about to change, so the batched boxes of its octant need to be rebuilt
+    Octant* octant = drawable->GetOctant();
+
     Scene* scene = GetScene();
     if (scene && scene->IsThreadedUpdate())
     {
         MutexLock lock(octreeMutex_);
         threadedDrawableUpdates_.Push(drawable);
+        if (octant)
+            octant->boxBatchesDirty_ = true;
     }
     else
+    {
         drawableUpdates_.Push(drawable);
+        if (octant)
+            octant->boxBatchesDirty_ = true;
+    }
 
     drawable->updateQueued_ = true;
 }
@@ -586,6 +946,209 @@ void Octree::DrawDebugGeometry(bool depthTest)
     DrawDebugGeometry(debug, depthTest);
 }
 
+void Octree::ReinsertDrawables()
+{
+    for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        drawable->updateQueued_ = false;
+        Octant* octant = drawable->GetOctant();
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+
+        // Skip if no octant or does not belong to this octree anymore
+        if (!octant || octant->GetRoot() != this)
+            continue;
+        // Skip if still fits the current octant
+        if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            continue;
+
+        InsertDrawable(drawable);
+
+#ifdef _DEBUG
+        // Verify that the drawable will be culled correctly
+        octant = drawable->GetOctant();
+        if (octant != this && octant->GetCullingBox().IsInside(box) != INSIDE)
+        {
+            URHO3D_LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() +
+                     " octant box " + octant->GetCullingBox().ToString());
+        }
+#endif
+    }
+}
+
+void Octree::ReinsertDrawablesThreaded()
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+
+    // The worker threads calculate the drawables' world bounding boxes from their scene nodes. Nodes may be shared by several
+    // drawables, and parents by several nodes, so update the dirty world transforms here first instead of lazily in the
+    // worker threads
+    for (PODVector<Drawable*>::ConstIterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+    {
+        Node* node = (*i)->GetNode();
+        if (node && node->IsDirty())
+            node->GetWorldTransform();
+    }
+
+    threadReinsertions_.Resize(queue->GetNumThreads() + 1);
+    for (unsigned i = 0; i < threadReinsertions_.Size(); ++i)
+        threadReinsertions_[i].Clear();
+
+    // Find the target octants in worker threads. Like in the threaded drawable update, components marked dirty meanwhile must
+    // not perform non-threadsafe work
+    Scene* scene = GetScene();
+    if (scene)
+        scene->BeginThreadedUpdate();
+
+    unsigned numDrawables = drawableUpdates_.Size();
+    unsigned numTasks = Min((numDrawables + REINSERTION_TASK_DRAWABLES - 1) / REINSERTION_TASK_DRAWABLES,
+        (queue->GetNumThreads() + 1) * REINSERTION_TASKS_PER_THREAD);
+    reinsertionTasks_.Clear();
+
+    for (unsigned i = 0; i < numTasks; ++i)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = FindReinsertionsWork;
+        item->start_ = drawableUpdates_.Buffer() + numDrawables * i / numTasks;
+        item->end_ = drawableUpdates_.Buffer() + numDrawables * (i + 1) / numTasks;
+        item->aux_ = this;
+        queue->AddWorkItem(item);
+        reinsertionTasks_.Push(item);
+    }
+
+    // Merge and sort the results in whichever thread finishes the last find item, so that the main thread waits only once
+    SharedPtr<WorkItem> mergeItem = queue->GetFreeItem();
+    mergeItem->priority_ = M_MAX_UNSIGNED;
+    mergeItem->workFunction_ = MergeReinsertionsWork;
+    mergeItem->aux_ = this;
+    queue->AddWorkItem(mergeItem, reinsertionTasks_);
+    queue->CompleteItem(mergeItem);
+
+    if (scene)
+        scene->EndThreadedUpdate();
+
+    if (reinsertions_.Empty())
+        return;
+
+    // Group by target octant so that each is looked up or created once. Add to the target octants first, then remove from
+    // the old octants in one pass each, because the drawable count going to zero deletes the octree branch in question
+    reinsertionSources_.Clear();
+
+    Octant* target = 0;
+    unsigned long long targetKey = 0;
+    for (PODVector<OctreeReinsertion>::ConstIterator i = reinsertions_.Begin(); i != reinsertions_.End(); ++i)
+    {
+        if (!target || i->key_ != targetKey)
+        {
+            target = GetOrCreateOctant(i->key_);
+            targetKey = i->key_;
+        }
+
+        Drawable* drawable = i->drawable_;
+        Octant* oldOctant = drawable->octant_;
+        if (oldOctant == target)
+            continue;
+
+        target->AddDrawable(drawable);
+        reinsertionSources_.Push(oldOctant);
+
+#ifdef _DEBUG
+        // Verify that the drawable will be culled correctly
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        if (target != this && target->GetCullingBox().IsInside(box) != INSIDE)
+        {
+            URHO3D_LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() +
+                     " octant box " + target->GetCullingBox().ToString());
+        }
+#endif
+    }
+
+    // An old octant can not be deleted before its turn, as its moved drawables still count until it is processed
+    Sort(reinsertionSources_.Begin(), reinsertionSources_.End());
+    for (unsigned i = 0; i < reinsertionSources_.Size(); ++i)
+    {
+        if (!i || reinsertionSources_[i] != reinsertionSources_[i - 1])
+            reinsertionSources_[i]->RemoveMovedDrawables();
+    }
+}
+
+void Octree::FindReinsertions(Drawable** start, Drawable** end, PODVector<OctreeReinsertion>& reinsertions) const
+{
+    while (start != end)
+    {
+        Drawable* drawable = *start++;
+        drawable->updateQueued_ = false;
+        Octant* octant = drawable->GetOctant();
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+
+        // Skip if no octant or does not belong to this octree anymore
+        if (!octant || octant->GetRoot() != this)
+            continue;
+        // Skip if still fits the current octant
+        if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            continue;
+
+        OctreeReinsertion reinsertion;
+        reinsertion.key_ = GetInsertionKey(drawable, box);
+        reinsertion.drawable_ = drawable;
+        reinsertions.Push(reinsertion);
+    }
+}
+
+void Octree::MergeReinsertions()
+{
+    reinsertions_.Clear();
+    for (unsigned i = 0; i < threadReinsertions_.Size(); ++i)
+        reinsertions_.Push(threadReinsertions_[i]);
+
+    Sort(reinsertions_.Begin(), reinsertions_.End());
+}
+
+unsigned long long Octree::GetInsertionKey(Drawable* drawable, const BoundingBox& box) const
+{
+    // Insert all non-occludees and drawables outside the octree bounds to the root, see InsertDrawable()
+    if (!drawable->IsOccludee() || cullingBox_.IsInside(box) != INSIDE || CheckDrawableFit(box))
+        return 0;
+
+    Vector3 boxCenter = box.Center();
+    BoundingBox octantBox = worldBoundingBox_;
+    Vector3 octantCenter = center_;
+    unsigned long long key = 0;
+    unsigned level = 0;
+
+    for (;;)
+    {
+        unsigned x = boxCenter.x_ < octantCenter.x_ ? 0 : 1;
+        unsigned y = boxCenter.y_ < octantCenter.y_ ? 0 : 2;
+        unsigned z = boxCenter.z_ < octantCenter.z_ ? 0 : 4;
+        unsigned index = x + y + z;
+
+        key |= (unsigned long long)index << (3 * level);
+        ++level;
+
+        // Calculate the child octant bounds the same way as when creating it
+        octantBox = GetChildBox(octantBox, index);
+        octantCenter = octantBox.Center();
+        Vector3 halfSize = 0.5f * octantBox.Size();
+        if (CheckFit(box, octantBox, halfSize, level >= numLevels_))
+            break;
+    }
+
+    return key | ((unsigned long long)level << OCTANT_KEY_LEVEL_SHIFT);
+}
+
+Octant* Octree::GetOrCreateOctant(unsigned long long key)
+{
+    Octant* octant = this;
+    unsigned level = (unsigned)(key >> OCTANT_KEY_LEVEL_SHIFT);
+
+    for (unsigned i = 0; i < level; ++i)
+        octant = octant->GetOrCreateChild((unsigned)(key >> (3 * i)) & (NUM_OCTANTS - 1));
+
+    return octant;
+}
+
 void Octree::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
 {
     // When running in headless mode, update the Octree manually during the RenderUpdate event
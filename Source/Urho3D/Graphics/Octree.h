@@ -26,18 +26,50 @@
 #include "../Core/Mutex.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/OctreeQuery.h"
+#include "../Graphics/SpatialIndex.h"
 
 namespace Urho3D
 {
 
 class Octree;
+class Octant;
 
 static const int NUM_OCTANTS = 8;
 static const unsigned ROOT_INDEX = M_MAX_UNSIGNED;
 
+/// Part of a threaded octree query executed by one worker thread: either an octant subtree, or a range of drawables in an octant above the level where the octree is split between threads.
+struct OctreeQueryTask
+{
+    /// Octant subtree to query, or null to test the drawable range.
+    const Octant* octant_;
+    /// Drawable range start.
+    Drawable** start_;
+    /// Drawable range end.
+    Drawable** end_;
+    /// World bounding box batches of the drawable range, or null if not used by the query.
+    const BoundingBoxBatch* batches_;
+    /// Whether the octant is known to be fully inside the query volume.
+    bool inside_;
+};
+
+/// Drawable to be moved to another octant, identified by the octant path key.
+struct OctreeReinsertion
+{
+    /// Test for less than, to sort the reinsertions by target octant.
+    bool operator <(const OctreeReinsertion& rhs) const { return key_ < rhs.key_; }
+
+    /// Target octant path key.
+    unsigned long long key_;
+    /// Drawable.
+    Drawable* drawable_;
+};
+
 /// %Octree octant
 class URHO3D_API Octant
 {
+    friend class Octree;
+    friend struct OctreeQueryFunctor;
+
 public:
     /// Construct.
     Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* root, unsigned index = ROOT_INDEX);
@@ -53,24 +85,10 @@ public:
     /// Check if a drawable object fits.
     bool CheckDrawableFit(const BoundingBox& box) const;
 
-    /// Add a drawable object to this octant.
-    void AddDrawable(Drawable* drawable)
-    {
-        drawable->SetOctant(this);
-        drawables_.Push(drawable);
-        IncDrawableCount();
-    }
-
+    /// Add a drawable object to this octant. If this is the root of an octree using a spatial index, the drawable is stored in the index.
+    void AddDrawable(Drawable* drawable);
     /// Remove a drawable object from this octant.
-    void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
-    {
-        if (drawables_.Remove(drawable))
-        {
-            if (resetOctant)
-                drawable->SetOctant(0);
-            DecDrawableCount();
-        }
-    }
+    void RemoveDrawable(Drawable* drawable, bool resetOctant = true);
 
     /// Return world-space bounding box.
     const BoundingBox& GetWorldBoundingBox() const { return worldBoundingBox_; }
@@ -107,6 +125,16 @@ protected:
     void GetDrawablesInternal(RayOctreeQuery& query) const;
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Return drawable objects by a query from a worker thread into the given vector, called internally.
+    void GetDrawablesThreadedInternal(OctreeQuery& query, bool inside, PODVector<Drawable*>& result) const;
+    /// Split a threaded query into tasks by testing the octants above the split level, called internally.
+    void GetQueryTasksInternal(OctreeQuery& query, bool inside, unsigned splitLevel, PODVector<OctreeQueryTask>& tasks) const;
+    /// Remove drawables which have been moved to another octant without removing them from this octant yet.
+    void RemoveMovedDrawables();
+    /// Return the drawables' world bounding boxes in batches for a query, or null if the query does not use them or they are out of date. Does not modify the octant, so that worker threads can query concurrently.
+    const BoundingBoxBatch* GetBoxBatches(const OctreeQuery& query) const;
+    /// Rebuild the dirty bounding box batches recursively. Called from the main thread at the end of the octree update.
+    void UpdateBoxBatches();
 
     /// Increase drawable object count recursively.
     void IncDrawableCount()
@@ -117,11 +145,11 @@ protected:
     }
 
     /// Decrease drawable object count recursively and remove octant if it becomes empty.
-    void DecDrawableCount()
+    void DecDrawableCount(unsigned count = 1)
     {
         Octant* parent = parent_;
 
-        --numDrawables_;
+        numDrawables_ -= count;
         if (!numDrawables_)
         {
             if (parent)
@@ -129,7 +157,7 @@ protected:
         }
 
         if (parent)
-            parent->DecDrawableCount();
+            parent->DecDrawableCount(count);
     }
 
     /// World bounding box.
@@ -138,6 +166,10 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     PODVector<Drawable*> drawables_;
+    /// World bounding boxes of the drawable objects in batches. Rebuilt at the end of the octree update.
+    PODVector<BoundingBoxBatch> boxBatches_;
+    /// Whether the bounding box batches need to be rebuilt because drawables were added, removed or marked dirty.
+    bool boxBatchesDirty_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS];
     /// World bounding box center.
@@ -160,6 +192,8 @@ protected:
 class URHO3D_API Octree : public Component, public Octant
 {
     friend void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend void FindReinsertionsWork(const WorkItem* item, unsigned threadIndex);
+    friend void MergeReinsertionsWork(const WorkItem* item, unsigned threadIndex);
 
     URHO3D_OBJECT(Octree, Component);
 
@@ -178,6 +212,10 @@ public:
 
     /// Set size and maximum subdivision levels. If octree is not empty, drawable objects will be temporarily moved to the root.
     void SetSize(const BoundingBox& box, unsigned numLevels);
+    /// Set the spatial index type. Octants are used by default. The custom type can only be set with SetSpatialIndex().
+    void SetSpatialIndexType(SpatialIndexType type);
+    /// Set a spatial index to store the drawables and execute the queries instead of the octants, or null to use the octants.
+    void SetSpatialIndex(SpatialIndex* index);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
     /// Add a drawable manually.
@@ -187,6 +225,8 @@ public:
 
     /// Return drawable objects by a query.
     void GetDrawables(OctreeQuery& query) const;
+    /// Return drawable objects by a query, traversing octant subtrees in worker threads. The query's TestOctant() and TestDrawablesThreaded() are called concurrently. The order of the results differs from GetDrawables(). Must be called from the main thread; small octrees and spatial indices are queried without threading.
+    void GetDrawablesThreaded(OctreeQuery& query) const;
     /// Return drawable objects by a ray query.
     void Raycast(RayOctreeQuery& query) const;
     /// Return the closest drawable object by a ray query.
@@ -195,6 +235,12 @@ public:
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
 
+    /// Return spatial index type.
+    SpatialIndexType GetSpatialIndexType() const { return spatialIndexType_; }
+
+    /// Return spatial index, or null if the octants are used.
+    SpatialIndex* GetSpatialIndex() const { return spatialIndex_; }
+
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
     /// Cancel drawable object's update.
@@ -205,6 +251,18 @@ public:
 private:
     /// Handle render update in case of headless execution.
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
+    /// Reinsert the queued drawables one by one.
+    void ReinsertDrawables();
+    /// Reinsert the queued drawables by finding their octants in worker threads, then moving them in batches per octant.
+    void ReinsertDrawablesThreaded();
+    /// Find the drawables which need to move to another octant and their octant path keys. Called from worker threads.
+    void FindReinsertions(Drawable** start, Drawable** end, PODVector<OctreeReinsertion>& reinsertions) const;
+    /// Collect the per-thread reinsertions and sort them by target octant. Called from a worker thread after all finding is done.
+    void MergeReinsertions();
+    /// Return the path key of the octant a drawable should be inserted to. Follows the same rules as InsertDrawable(), but does not require the octants to exist.
+    unsigned long long GetInsertionKey(Drawable* drawable, const BoundingBox& box) const;
+    /// Return or create the octant corresponding to a path key.
+    Octant* GetOrCreateOctant(unsigned long long key);
 
     /// Drawable objects that require update.
     PODVector<Drawable*> drawableUpdates_;
@@ -214,6 +272,22 @@ private:
     Mutex octreeMutex_;
     /// Ray query temporary list of drawables.
     mutable PODVector<Drawable*> rayQueryDrawables_;
+    /// Threaded query tasks.
+    mutable PODVector<OctreeQueryTask> queryTasks_;
+    /// Threaded query results per thread.
+    mutable Vector<PODVector<Drawable*> > threadQueryResults_;
+    /// Drawables to move to another octant per thread.
+    Vector<PODVector<OctreeReinsertion> > threadReinsertions_;
+    /// Work items finding the reinsertions, which the merge item depends on.
+    PODVector<WorkItem*> reinsertionTasks_;
+    /// Drawables to move to another octant, sorted by target octant.
+    PODVector<OctreeReinsertion> reinsertions_;
+    /// Octants which drawables were moved away from.
+    PODVector<Octant*> reinsertionSources_;
+    /// Spatial index used instead of the octants.
+    SharedPtr<SpatialIndex> spatialIndex_;
+    /// Spatial index type.
+    SpatialIndexType spatialIndexType_;
     /// Subdivision level.
     unsigned numLevels_;
 };
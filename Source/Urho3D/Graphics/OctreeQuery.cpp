@@ -22,6 +22,7 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/Mutex.h"
 #include "../Graphics/OctreeQuery.h"
 
 #include "../DebugNew.h"
@@ -29,6 +30,36 @@
 namespace Urho3D
 {
 
+/// Return the mutex for the default threaded drawable test. Shared by all queries instead of each query owning one, as
+/// constructing a mutex allocates memory. Only one threaded query runs at a time, as they are started from the main thread.
+static Mutex& GetThreadedTestMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+void OctreeQuery::TestDrawablesThreaded(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
+{
+    // The query's own result vector is empty during a threaded query, so it can hold the results temporarily
+    MutexLock lock(GetThreadedTestMutex());
+    unsigned oldSize = result_.Size();
+    TestDrawables(start, end, inside);
+    for (unsigned i = oldSize; i < result_.Size(); ++i)
+        result.Push(result_[i]);
+    result_.Resize(oldSize);
+}
+
+void OctreeQuery::TestDrawableBatches(Drawable** start, Drawable** end, const BoundingBoxBatch* batches)
+{
+    TestDrawables(start, end, false);
+}
+
+void OctreeQuery::TestDrawableBatchesThreaded(Drawable** start, Drawable** end, const BoundingBoxBatch* batches,
+    PODVector<Drawable*>& result)
+{
+    TestDrawablesThreaded(start, end, false, result);
+}
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -117,6 +148,36 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestDrawableBatches(Drawable** start, Drawable** end, const BoundingBoxBatch* batches)
+{
+    TestDrawableBatchesThreaded(start, end, batches, result_);
+}
+
+void FrustumOctreeQuery::TestDrawableBatchesThreaded(Drawable** start, Drawable** end, const BoundingBoxBatch* batches,
+    PODVector<Drawable*>& result)
+{
+    unsigned char masks[MAX_FRUSTUM_QUERY_BATCH_DRAWABLES / BOUNDING_BOX_BATCH_SIZE];
+
+    while (start != end)
+    {
+        unsigned count = Min((unsigned)(end - start), MAX_FRUSTUM_QUERY_BATCH_DRAWABLES);
+        frustum_.IsInsideFast(batches, (count + BOUNDING_BOX_BATCH_SIZE - 1) / BOUNDING_BOX_BATCH_SIZE, masks);
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (masks[i / BOUNDING_BOX_BATCH_SIZE] & (1 << (i % BOUNDING_BOX_BATCH_SIZE)))
+            {
+                Drawable* drawable = start[i];
+                if ((drawable->GetDrawableFlags() & drawableFlags_) && (drawable->GetViewMask() & viewMask_))
+                    result.Push(drawable);
+            }
+        }
+
+        start += count;
+        batches += count / BOUNDING_BOX_BATCH_SIZE;
+    }
+}
+
 
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
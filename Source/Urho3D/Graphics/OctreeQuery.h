@@ -34,6 +34,9 @@ namespace Urho3D
 class Drawable;
 class Node;
 
+/// Maximum number of drawables whose batched bounding boxes a frustum query tests at once.
+static const unsigned MAX_FRUSTUM_QUERY_BATCH_DRAWABLES = 256;
+
 /// Base class for octree queries.
 class URHO3D_API OctreeQuery
 {
@@ -42,7 +45,8 @@ public:
     OctreeQuery(PODVector<Drawable*>& result, unsigned char drawableFlags, unsigned viewMask) :
         result_(result),
         drawableFlags_(drawableFlags),
-        viewMask_(viewMask)
+        viewMask_(viewMask),
+        useBoxBatches_(false)
     {
     }
 
@@ -55,6 +59,12 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables from a worker thread, collecting into the given result vector instead of result_. Used by Octree::GetDrawablesThreaded(), which calls this and TestOctant() concurrently. Override to run the tests in parallel; the default serializes calls to TestDrawables().
+    virtual void TestDrawablesThreaded(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result);
+    /// Intersection test for drawables which are not known to be inside, with their world bounding boxes in batches beginning from the first drawable. Called instead of TestDrawables() if useBoxBatches_ is set and the octant's batches are up to date. The default calls TestDrawables().
+    virtual void TestDrawableBatches(Drawable** start, Drawable** end, const BoundingBoxBatch* batches);
+    /// Intersection test for drawables with batched bounding boxes from a worker thread. Called instead of TestDrawablesThreaded() if useBoxBatches_ is set. The default calls TestDrawablesThreaded().
+    virtual void TestDrawableBatchesThreaded(Drawable** start, Drawable** end, const BoundingBoxBatch* batches, PODVector<Drawable*>& result);
 
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -62,6 +72,8 @@ public:
     unsigned char drawableFlags_;
     /// Drawable layers to include.
     unsigned viewMask_;
+    /// Whether octants should pass drawables' world bounding boxes in batches to TestDrawableBatches(). Off by default; set it only if the query's TestDrawableBatches() selects the same drawables as its TestDrawables().
+    bool useBoxBatches_;
 
 private:
     /// Prevent copy construction.
@@ -149,6 +161,10 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    /// Intersection test for drawables with batched bounding boxes.
+    virtual void TestDrawableBatches(Drawable** start, Drawable** end, const BoundingBoxBatch* batches);
+    /// Intersection test for drawables with batched bounding boxes from a worker thread.
+    virtual void TestDrawableBatchesThreaded(Drawable** start, Drawable** end, const BoundingBoxBatch* batches, PODVector<Drawable*>& result);
 
     /// Frustum.
     Frustum frustum_;
@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/RefCounted.h"
+#include "../Container/Vector.h"
+
+namespace Urho3D
+{
+
+class DebugRenderer;
+class Drawable;
+class OctreeQuery;
+class RayOctreeQuery;
+
+/// Spatial index used by an octree to store its drawables.
+enum SpatialIndexType
+{
+    SPATIAL_INDEX_OCTANTS = 0,
+    SPATIAL_INDEX_LINEAR_BVH,
+    SPATIAL_INDEX_CUSTOM
+};
+
+/// Base class for spatial indices which replace the octants of an octree. All drawables stay in the octree's root octant, while the index stores them and executes the queries.
+class URHO3D_API SpatialIndex : public RefCounted
+{
+public:
+    /// Destruct.
+    virtual ~SpatialIndex()
+    {
+    }
+
+    /// Add a drawable.
+    virtual void AddDrawable(Drawable* drawable) = 0;
+    /// Remove a drawable. Return true if it was found.
+    virtual bool RemoveDrawable(Drawable* drawable) = 0;
+    /// Update after drawables have been moved or resized. Called from the main thread by Octree::Update().
+    virtual void Update(const PODVector<Drawable*>& drawables) = 0;
+    /// Return drawable objects by a query. May be called concurrently from several threads.
+    virtual void GetDrawables(OctreeQuery& query) const = 0;
+    /// Return the drawable objects which pass the ray query's drawable flags and view mask, and whose bounding box the ray may hit within the maximum distance. May be called concurrently from several threads.
+    virtual void GetDrawables(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const = 0;
+    /// Return all drawables.
+    virtual void GetAllDrawables(PODVector<Drawable*>& drawables) const = 0;
+    /// Draw the index structure to the debug graphics.
+    virtual void DrawDebugGeometry(DebugRenderer* debug, bool depthTest) {}
+};
+
+}
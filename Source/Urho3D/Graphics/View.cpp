@@ -55,6 +55,8 @@
 namespace Urho3D
 {
 
+static const unsigned OCCLUDEE_BATCH_SIZE = 64;
+
 static const Vector3* directions[] =
 {
     &Vector3::RIGHT,
@@ -74,6 +76,7 @@ public:
         unsigned viewMask = DEFAULT_VIEWMASK) :
         FrustumOctreeQuery(result, frustum, drawableFlags, viewMask)
     {
+        useBoxBatches_ = true;
     }
 
     /// Intersection test for drawables.
@@ -91,6 +94,32 @@ public:
             }
         }
     }
+
+    /// Intersection test for drawables with batched bounding boxes.
+    virtual void TestDrawableBatches(Drawable** start, Drawable** end, const BoundingBoxBatch* batches)
+    {
+        unsigned char masks[MAX_FRUSTUM_QUERY_BATCH_DRAWABLES / BOUNDING_BOX_BATCH_SIZE];
+
+        while (start != end)
+        {
+            unsigned count = Min((unsigned)(end - start), MAX_FRUSTUM_QUERY_BATCH_DRAWABLES);
+            frustum_.IsInsideFast(batches, (count + BOUNDING_BOX_BATCH_SIZE - 1) / BOUNDING_BOX_BATCH_SIZE, masks);
+
+            for (unsigned i = 0; i < count; ++i)
+            {
+                if (masks[i / BOUNDING_BOX_BATCH_SIZE] & (1 << (i % BOUNDING_BOX_BATCH_SIZE)))
+                {
+                    Drawable* drawable = start[i];
+                    if (drawable->GetCastShadows() && (drawable->GetDrawableFlags() & drawableFlags_) &&
+                        (drawable->GetViewMask() & viewMask_))
+                        result_.Push(drawable);
+                }
+            }
+
+            start += count;
+            batches += count / BOUNDING_BOX_BATCH_SIZE;
+        }
+    }
 };
 
 /// %Frustum octree query for zones and occluders.
@@ -106,6 +135,12 @@ public:
 
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside)
+    {
+        TestDrawablesThreaded(start, end, inside, result_);
+    }
+
+    /// Intersection test for drawables from a worker thread.
+    virtual void TestDrawablesThreaded(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
     {
         while (start != end)
         {
@@ -116,28 +151,32 @@ public:
                 (drawable->GetViewMask() & viewMask_))
             {
                 if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                    result_.Push(drawable);
+                    result.Push(drawable);
             }
         }
     }
 };
 
-/// %Frustum octree query with occlusion.
+/// %Frustum octree query with optional occlusion.
 class OccludedFrustumOctreeQuery : public FrustumOctreeQuery
 {
 public:
-    /// Construct with frustum, occlusion buffer and query parameters.
+    /// Construct with frustum, occlusion buffer (may be null) and query parameters.
     OccludedFrustumOctreeQuery(PODVector<Drawable*>& result, const Frustum& frustum, OcclusionBuffer* buffer,
         unsigned char drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) :
         FrustumOctreeQuery(result, frustum, drawableFlags, viewMask),
         buffer_(buffer)
     {
+        // The drawable test is the same as FrustumOctreeQuery's, so its batched test can be used
+        useBoxBatches_ = true;
     }
 
     /// Intersection test for an octant.
     virtual Intersection TestOctant(const BoundingBox& box, bool inside)
     {
-        if (inside)
+        if (!buffer_)
+            return inside ? INSIDE : frustum_.IsInside(box);
+        else if (inside)
             return buffer_->IsVisible(box) ? INSIDE : OUTSIDE;
         else
         {
@@ -150,6 +189,12 @@ public:
 
     /// Intersection test for drawables. Note: drawable occlusion is performed later in worker threads.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside)
+    {
+        TestDrawablesThreaded(start, end, inside, result_);
+    }
+
+    /// Intersection test for drawables from a worker thread.
+    virtual void TestDrawablesThreaded(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
     {
         while (start != end)
         {
@@ -158,7 +203,7 @@ public:
             if ((drawable->GetDrawableFlags() & drawableFlags_) && (drawable->GetViewMask() & viewMask_))
             {
                 if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                    result_.Push(drawable);
+                    result.Push(drawable);
             }
         }
     }
@@ -167,74 +212,104 @@ public:
     OcclusionBuffer* buffer_;
 };
 
-void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
+/// %Drawable visibility check functor for ParallelFor(). Checks drawable occlusion, finds zones for moved drawables and collects geometries & lights.
+struct CheckVisibilityFunctor
 {
-    View* view = reinterpret_cast<View*>(item->aux_);
-    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
-    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
-    OcclusionBuffer* buffer = view->occlusionBuffer_;
-    const Matrix3x4& viewMatrix = view->cullCamera_->GetView();
-    Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
-    Vector3 absViewZ = viewZ.Abs();
-    unsigned cameraViewMask = view->cullCamera_->GetViewMask();
-    bool cameraZoneOverride = view->cameraZoneOverride_;
-    PerThreadSceneResult& result = view->sceneResults_[threadIndex];
+    /// Construct.
+    CheckVisibilityFunctor(View* view) :
+        view_(view)
+    {
+    }
 
-    while (start != end)
+    /// Check a range of drawables.
+    void operator ()(Drawable** start, Drawable** end, unsigned threadIndex)
     {
-        Drawable* drawable = *start++;
+        View* view = view_;
+        OcclusionBuffer* buffer = view->occlusionBuffer_;
+        const Matrix3x4& viewMatrix = view->cullCamera_->GetView();
+        Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
+        Vector3 absViewZ = viewZ.Abs();
+        unsigned cameraViewMask = view->cullCamera_->GetViewMask();
+        bool cameraZoneOverride = view->cameraZoneOverride_;
+        PerThreadSceneResult& result = view->sceneResults_[threadIndex];
+        BoundingBox occludeeBoxes[OCCLUDEE_BATCH_SIZE];
+        bool occludeesVisible[OCCLUDEE_BATCH_SIZE];
+        Drawable** batchEnd = start;
+        unsigned occludeeIndex = 0;
 
-        if (!buffer || !drawable->IsOccludee() || buffer->IsVisible(drawable->GetWorldBoundingBox()))
+        while (start != end)
         {
-            drawable->UpdateBatches(view->frame_);
-            // If draw distance non-zero, update and check it
-            float maxDistance = drawable->GetDrawDistance();
-            if (maxDistance > 0.0f)
+            // Test the occludees of the next drawables against the occlusion buffer at once
+            if (buffer && start == batchEnd)
             {
-                if (drawable->GetDistance() > maxDistance)
-                    continue;
+                unsigned numOccludees = 0;
+                while (batchEnd != end && numOccludees < OCCLUDEE_BATCH_SIZE)
+                {
+                    Drawable* drawable = *batchEnd++;
+                    if (drawable->IsOccludee())
+                        occludeeBoxes[numOccludees++] = drawable->GetWorldBoundingBox();
+                }
+                buffer->IsVisible(occludeeBoxes, numOccludees, occludeesVisible);
+                occludeeIndex = 0;
             }
 
-            drawable->MarkInView(view->frame_);
+            Drawable* drawable = *start++;
 
-            // For geometries, find zone, clear lights and calculate view space Z range
-            if (drawable->GetDrawableFlags() & DRAWABLE_GEOMETRY)
+            if (!buffer || !drawable->IsOccludee() || occludeesVisible[occludeeIndex++])
             {
-                Zone* drawableZone = drawable->GetZone();
-                if (!cameraZoneOverride &&
-                    (drawable->IsZoneDirty() || !drawableZone || (drawableZone->GetViewMask() & cameraViewMask) == 0))
-                    view->FindZone(drawable);
+                drawable->UpdateBatches(view->frame_);
+                // If draw distance non-zero, update and check it
+                float maxDistance = drawable->GetDrawDistance();
+                if (maxDistance > 0.0f)
+                {
+                    if (drawable->GetDistance() > maxDistance)
+                        continue;
+                }
 
-                const BoundingBox& geomBox = drawable->GetWorldBoundingBox();
-                Vector3 center = geomBox.Center();
-                Vector3 edge = geomBox.Size() * 0.5f;
+                drawable->MarkInView(view->frame_);
 
-                // Do not add "infinite" objects like skybox to prevent shadow map focusing behaving erroneously
-                if (edge.LengthSquared() < M_LARGE_VALUE * M_LARGE_VALUE)
+                // For geometries, find zone, clear lights and calculate view space Z range
+                if (drawable->GetDrawableFlags() & DRAWABLE_GEOMETRY)
                 {
-                    float viewCenterZ = viewZ.DotProduct(center) + viewMatrix.m23_;
-                    float viewEdgeZ = absViewZ.DotProduct(edge);
-                    float minZ = viewCenterZ - viewEdgeZ;
-                    float maxZ = viewCenterZ + viewEdgeZ;
-                    drawable->SetMinMaxZ(viewCenterZ - viewEdgeZ, viewCenterZ + viewEdgeZ);
-                    result.minZ_ = Min(result.minZ_, minZ);
-                    result.maxZ_ = Max(result.maxZ_, maxZ);
-                }
-                else
-                    drawable->SetMinMaxZ(M_LARGE_VALUE, M_LARGE_VALUE);
+                    Zone* drawableZone = drawable->GetZone();
+                    if (!cameraZoneOverride &&
+                        (drawable->IsZoneDirty() || !drawableZone || (drawableZone->GetViewMask() & cameraViewMask) == 0))
+                        view->FindZone(drawable);
 
-                result.geometries_.Push(drawable);
-            }
-            else if (drawable->GetDrawableFlags() & DRAWABLE_LIGHT)
-            {
-                Light* light = static_cast<Light*>(drawable);
-                // Skip lights with zero brightness or black color
-                if (!light->GetEffectiveColor().Equals(Color::BLACK))
-                    result.lights_.Push(light);
+                    const BoundingBox& geomBox = drawable->GetWorldBoundingBox();
+                    Vector3 center = geomBox.Center();
+                    Vector3 edge = geomBox.Size() * 0.5f;
+
+                    // Do not add "infinite" objects like skybox to prevent shadow map focusing behaving erroneously
+                    if (edge.LengthSquared() < M_LARGE_VALUE * M_LARGE_VALUE)
+                    {
+                        float viewCenterZ = viewZ.DotProduct(center) + viewMatrix.m23_;
+                        float viewEdgeZ = absViewZ.DotProduct(edge);
+                        float minZ = viewCenterZ - viewEdgeZ;
+                        float maxZ = viewCenterZ + viewEdgeZ;
+                        drawable->SetMinMaxZ(viewCenterZ - viewEdgeZ, viewCenterZ + viewEdgeZ);
+                        result.minZ_ = Min(result.minZ_, minZ);
+                        result.maxZ_ = Max(result.maxZ_, maxZ);
+                    }
+                    else
+                        drawable->SetMinMaxZ(M_LARGE_VALUE, M_LARGE_VALUE);
+
+                    result.geometries_.Push(drawable);
+                }
+                else if (drawable->GetDrawableFlags() & DRAWABLE_LIGHT)
+                {
+                    Light* light = static_cast<Light*>(drawable);
+                    // Skip lights with zero brightness or black color
+                    if (!light->GetEffectiveColor().Equals(Color::BLACK))
+                        result.lights_.Push(light);
+                }
             }
         }
     }
-}
+
+    /// View.
+    View* view_;
+};
 
 void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
 {
@@ -308,6 +383,7 @@ View::View(Context* context) :
     unsigned numThreads = GetSubsystem<WorkQueue>()->GetNumThreads() + 1; // Worker threads + main thread
     tempDrawables_.Resize(numThreads);
     sceneResults_.Resize(numThreads);
+    frameArenas_.Resize(numThreads);
     frame_.camera_ = 0;
 }
 
@@ -555,6 +631,10 @@ void View::Update(const FrameInfo& frame)
 
     SendViewEvent(E_BEGINVIEWUPDATE);
 
+    // The frame allocator may have added arenas for new worker threads since the last update
+    for (unsigned i = 0; i < frameArenas_.Size(); ++i)
+        frameArenas_[i] = GetFrameArena(context_, i);
+
     int maxSortedInstances = renderer_->GetMaxSortedInstances();
 
     // Clear buffers, geometry, light, occluder & batch list
@@ -568,6 +648,21 @@ void View::Update(const FrameInfo& frame)
     for (HashMap<unsigned, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
         i->second_.Clear(maxSortedInstances);
 
+    // Drop the data allocated from the frame arenas during the previous frame, as it is no longer valid and the light queues
+    // and query results may be copied when resized
+    for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+    {
+        i->litBaseBatches_.Clear(maxSortedInstances);
+        i->litBatches_.Clear(maxSortedInstances);
+        for (Vector<ShadowBatchQueue>::Iterator j = i->shadowSplits_.Begin(); j != i->shadowSplits_.End(); ++j)
+            j->shadowBatches_.Clear(maxSortedInstances);
+    }
+    for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+    {
+        i->litGeometries_.SetArena(0);
+        i->shadowCasters_.SetArena(0);
+    }
+
     if (hasScenePasses_ && (!cullCamera_ || !octree_))
     {
         SendViewEvent(E_ENDVIEWUPDATE);
@@ -816,11 +911,11 @@ void View::GetDrawables()
     WorkQueue* queue = GetSubsystem<WorkQueue>();
     PODVector<Drawable*>& tempDrawables = tempDrawables_[0];
 
-    // Get zones and occluders first
+    // Get zones and occluders first. The octree queries are split between worker threads
     {
         ZoneOccluderOctreeQuery
             query(tempDrawables, cullCamera_->GetFrustum(), DRAWABLE_GEOMETRY | DRAWABLE_ZONE, cullCamera_->GetViewMask());
-        octree_->GetDrawables(query);
+        octree_->GetDrawablesThreaded(query);
     }
 
     highestZonePriority_ = M_MIN_INT;
@@ -887,16 +982,10 @@ void View::GetDrawables()
         occluders_.Clear();
 
     // Get lights and geometries. Coarse occlusion for octants is used at this point
-    if (occlusionBuffer_)
     {
         OccludedFrustumOctreeQuery query
             (tempDrawables, cullCamera_->GetFrustum(), occlusionBuffer_, DRAWABLE_GEOMETRY | DRAWABLE_LIGHT, cullCamera_->GetViewMask());
-        octree_->GetDrawables(query);
-    }
-    else
-    {
-        FrustumOctreeQuery query(tempDrawables, cullCamera_->GetFrustum(), DRAWABLE_GEOMETRY | DRAWABLE_LIGHT, cullCamera_->GetViewMask());
-        octree_->GetDrawables(query);
+        octree_->GetDrawablesThreaded(query);
     }
 
     // Check drawable occlusion, find zones for moved drawables and collect geometries & lights in worker threads
@@ -911,30 +1000,8 @@ void View::GetDrawables()
             result.maxZ_ = 0.0f;
         }
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.Size() / numWorkItems;
-
-        PODVector<Drawable*>::Iterator start = tempDrawables.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            PODVector<Drawable*>::Iterator end = tempDrawables.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+        CheckVisibilityFunctor checkVisibility(this);
+        queue->ParallelFor(tempDrawables.Buffer(), tempDrawables.Buffer() + tempDrawables.Size(), 64, checkVisibility);
     }
 
     // Combine lights, geometries & scene Z range from the threads
@@ -1098,7 +1165,7 @@ void View::GetLightBatches()
                     FinalizeShadowCamera(shadowCamera, light, shadowQueue.shadowViewport_, query.shadowCasterBox_[j]);
 
                     // Loop through shadow casters
-                    for (PODVector<Drawable*>::ConstIterator k = query.shadowCasters_.Begin() + query.shadowCasterBegin_[j];
+                    for (FrameVector<Drawable*>::ConstIterator k = query.shadowCasters_.Begin() + query.shadowCasterBegin_[j];
                          k < query.shadowCasters_.Begin() + query.shadowCasterEnd_[j]; ++k)
                     {
                         Drawable* drawable = *k;
@@ -1138,7 +1205,7 @@ void View::GetLightBatches()
                 }
 
                 // Process lit geometries
-                for (PODVector<Drawable*>::ConstIterator j = query.litGeometries_.Begin(); j != query.litGeometries_.End(); ++j)
+                for (FrameVector<Drawable*>::ConstIterator j = query.litGeometries_.Begin(); j != query.litGeometries_.End(); ++j)
                 {
                     Drawable* drawable = *j;
                     drawable->AddLight(light);
@@ -1174,7 +1241,7 @@ void View::GetLightBatches()
             else
             {
                 // Add the vertex light to lit drawables. It will be processed later during base pass batch generation
-                for (PODVector<Drawable*>::ConstIterator j = query.litGeometries_.Begin(); j != query.litGeometries_.End(); ++j)
+                for (FrameVector<Drawable*>::ConstIterator j = query.litGeometries_.Begin(); j != query.litGeometries_.End(); ++j)
                 {
                     Drawable* drawable = *j;
                     drawable->AddVertexLight(light);
@@ -2311,7 +2378,8 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
 #endif
     // Get lit geometries. They must match the light mask and be inside the main camera frustum to be considered
     PODVector<Drawable*>& tempDrawables = tempDrawables_[threadIndex];
-    query.litGeometries_.Clear();
+    query.litGeometries_.SetArena(frameArenas_[threadIndex]);
+    query.shadowCasters_.SetArena(frameArenas_[threadIndex]);
 
     switch (type)
     {
@@ -2327,6 +2395,7 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
         {
             FrustumOctreeQuery octreeQuery(tempDrawables, light->GetFrustum(), DRAWABLE_GEOMETRY,
                 cullCamera_->GetViewMask());
+            octreeQuery.useBoxBatches_ = true;
             octree_->GetDrawables(octreeQuery);
             for (unsigned i = 0; i < tempDrawables.Size(); ++i)
             {
@@ -2361,7 +2430,6 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
     SetupShadowCameras(query);
 
     // Process each split for shadow casters
-    query.shadowCasters_.Clear();
     for (unsigned i = 0; i < query.numSplits_; ++i)
     {
         Camera* shadowCamera = query.shadowCameras_[i];
@@ -2916,12 +2984,12 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     {
         BatchGroupKey key(batch);
 
-        HashMap<BatchGroupKey, BatchGroup>::Iterator i = queue.batchGroups_.Find(key);
+        FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = queue.batchGroups_.Find(key);
         if (i == queue.batchGroups_.End())
         {
             // Create a new group based on the batch
             // In case the group remains below the instancing limit, do not enable instancing shaders yet
-            BatchGroup newGroup(batch);
+            BatchGroup newGroup(batch, frameArenas_[0]);
             newGroup.geometryType_ = GEOM_STATIC;
             renderer_->SetBatchShaders(newGroup, tech, allowShadows, queue);
             newGroup.CalculateSortKey();
@@ -56,10 +56,10 @@ struct LightQueryResult
 {
     /// Light.
     Light* light_;
-    /// Lit geometries.
-    PODVector<Drawable*> litGeometries_;
-    /// Shadow casters.
-    PODVector<Drawable*> shadowCasters_;
+    /// Lit geometries. Allocated from the frame arena of the thread processing the light.
+    FrameVector<Drawable*> litGeometries_;
+    /// Shadow casters. Allocated from the frame arena of the thread processing the light.
+    FrameVector<Drawable*> shadowCasters_;
     /// Shadow cameras.
     Camera* shadowCameras_[MAX_LIGHT_SPLITS];
     /// Shadow caster start indices.
@@ -109,7 +109,7 @@ static const unsigned MAX_VIEWPORT_TEXTURES = 2;
 /// Internal structure for 3D rendering work. Created for each backbuffer and texture viewport, but not for shadow cameras.
 class URHO3D_API View : public Object
 {
-    friend void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex);
+    friend struct CheckVisibilityFunctor;
     friend void ProcessLightWork(const WorkItem* item, unsigned threadIndex);
 
     URHO3D_OBJECT(View, Object);
@@ -388,6 +388,8 @@ private:
     Vector<PODVector<Drawable*> > tempDrawables_;
     /// Per-thread geometries, lights and Z range collection results.
     Vector<PerThreadSceneResult> sceneResults_;
+    /// Per-thread frame arenas for data which is rebuilt every frame. Null entries allocate from the heap.
+    PODVector<FrameArena*> frameArenas_;
     /// Visible zones.
     PODVector<Zone*> zones_;
     /// Visible geometry objects.
@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../IO/BitStream.h"
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+BitWriter::BitWriter(Serializer& dest) :
+    dest_(dest),
+    bits_(0),
+    numBits_(0)
+{
+}
+
+BitWriter::~BitWriter()
+{
+    Flush();
+}
+
+void BitWriter::WriteBits(unsigned value, unsigned numBits)
+{
+    if (!numBits)
+        return;
+    if (numBits < 32)
+        value &= (1u << numBits) - 1;
+
+    bits_ |= (unsigned long long)value << numBits_;
+    numBits_ += numBits;
+
+    while (numBits_ >= 8)
+    {
+        dest_.WriteUByte((unsigned char)(bits_ & 0xff));
+        bits_ >>= 8;
+        numBits_ -= 8;
+    }
+}
+
+void BitWriter::Flush()
+{
+    if (numBits_)
+    {
+        dest_.WriteUByte((unsigned char)(bits_ & 0xff));
+        bits_ = 0;
+        numBits_ = 0;
+    }
+}
+
+BitReader::BitReader(Deserializer& source) :
+    source_(source),
+    bits_(0),
+    numBits_(0)
+{
+}
+
+unsigned BitReader::ReadBits(unsigned numBits)
+{
+    if (!numBits)
+        return 0;
+
+    while (numBits_ < numBits)
+    {
+        unsigned long long byte = source_.IsEof() ? 0 : source_.ReadUByte();
+        bits_ |= byte << numBits_;
+        numBits_ += 8;
+    }
+
+    unsigned value = (unsigned)(bits_ & ((1ULL << numBits) - 1));
+    bits_ >>= numBits;
+    numBits_ -= numBits;
+    return value;
+}
+
+bool BitReader::IsEof() const
+{
+    return !numBits_ && source_.IsEof();
+}
+
+}
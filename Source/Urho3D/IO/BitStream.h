@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#ifdef URHO3D_IS_BUILDING
+#include "Urho3D.h"
+#else
+#include <Urho3D/Urho3D.h>
+#endif
+
+namespace Urho3D
+{
+
+class Deserializer;
+class Serializer;
+
+/// Writer of values with arbitrary bit counts into a serializer. The bits are packed without padding, least significant bit first. Remaining bits are padded to a full byte on Flush() or destruction.
+class URHO3D_API BitWriter
+{
+public:
+    /// Construct with destination serializer.
+    BitWriter(Serializer& dest);
+    /// Destruct. Flush remaining bits.
+    ~BitWriter();
+
+    /// Write the lowest bits of a value. Up to 32 bits can be written at once.
+    void WriteBits(unsigned value, unsigned numBits);
+    /// Write a bool as one bit.
+    void WriteBool(bool value) { WriteBits(value ? 1 : 0, 1); }
+    /// Write the remaining bits padded to a full byte.
+    void Flush();
+
+private:
+    /// Destination serializer.
+    Serializer& dest_;
+    /// Bits not yet written.
+    unsigned long long bits_;
+    /// Number of bits not yet written.
+    unsigned numBits_;
+};
+
+/// Reader of values written by BitWriter from a deserializer.
+class URHO3D_API BitReader
+{
+public:
+    /// Construct with source deserializer.
+    BitReader(Deserializer& source);
+
+    /// Read a value with the specified number of bits. Up to 32 bits can be read at once. Missing bits past the end of the source read as zero.
+    unsigned ReadBits(unsigned numBits);
+    /// Read a bool from one bit.
+    bool ReadBool() { return ReadBits(1) != 0; }
+    /// Return whether all bits of the source have been read. The source itself may already be at its end while bits remain buffered.
+    bool IsEof() const;
+
+private:
+    /// Source deserializer.
+    Deserializer& source_;
+    /// Bits read from the source but not yet returned.
+    unsigned long long bits_;
+    /// Number of bits read from the source but not yet returned.
+    unsigned numBits_;
+};
+
+}
@@ -50,6 +50,8 @@ public:
     virtual unsigned GetChecksum();
     /// Return whether the end of stream has been reached.
     virtual bool IsEof() const { return position_ >= size_; }
+    /// Return pointer to the whole stream contents if they are directly accessible in memory, or null if not. Allows parsing without copying the data first.
+    virtual const unsigned char* GetDirectData() const { return 0; }
 
     /// Return current position.
     unsigned GetPosition() const { return position_; }
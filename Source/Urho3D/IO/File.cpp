@@ -72,6 +72,9 @@ File::File(Context* context) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mapping_(0),
+    blockSize_(0),
+    readBufferBlock_(M_MAX_UNSIGNED),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -89,6 +92,9 @@ File::File(Context* context, const String& fileName, FileMode mode) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mapping_(0),
+    blockSize_(0),
+    readBufferBlock_(M_MAX_UNSIGNED),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -107,6 +113,9 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mapping_(0),
+    blockSize_(0),
+    readBufferBlock_(M_MAX_UNSIGNED),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -137,11 +146,34 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
-    bool success = OpenInternal(package->GetName(), FILE_READ, true);
-    if (!success)
+    PackageFileMapping* mapping = package->GetMapping();
+    if (mapping)
     {
-        URHO3D_LOGERROR("Could not open package file " + fileName);
-        return false;
+        // Read straight from the package's memory mapping instead of opening a file handle
+        Close();
+
+        FileSystem* fileSystem = GetSubsystem<FileSystem>();
+        if (fileSystem && !fileSystem->CheckAccess(GetPath(package->GetName())))
+        {
+            URHO3D_LOGERRORF("Access denied to %s", package->GetName().CString());
+            return false;
+        }
+
+        mapping->AddRef();
+        mapping_ = mapping;
+        mode_ = FILE_READ;
+        position_ = 0;
+        readSyncNeeded_ = false;
+        writeSyncNeeded_ = false;
+    }
+    else
+    {
+        bool success = OpenInternal(package->GetName(), FILE_READ, true);
+        if (!success)
+        {
+            URHO3D_LOGERROR("Could not open package file " + fileName);
+            return false;
+        }
     }
 
     fileName_ = fileName;
@@ -149,9 +181,18 @@ bool File::Open(PackageFile* package, const String& fileName)
     checksum_ = entry->checksum_;
     size_ = entry->size_;
     compressed_ = package->IsCompressed();
+    blockSize_ = compressed_ ? package->GetBlockSize() : 0;
 
     // Seek to beginning of package entry's file data
     SeekInternal(offset_);
+
+    if (blockSize_ && !ReadBlockOffsets(package->GetTotalSize()))
+    {
+        URHO3D_LOGERROR("Corrupted block offset table for " + fileName + " in package file " + package->GetName());
+        Close();
+        return false;
+    }
+
     return true;
 }
 
@@ -174,6 +215,61 @@ unsigned File::Read(void* dest, unsigned size)
     if (!size)
         return 0;
 
+    if (mapping_ && !compressed_)
+    {
+        memcpy(dest, mapping_->GetData() + offset_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
+    if (blockSize_)
+    {
+        unsigned sizeLeft = size;
+        unsigned char* destPtr = (unsigned char*)dest;
+
+        while (sizeLeft)
+        {
+            unsigned block = position_ / blockSize_;
+            unsigned blockOffset = position_ - block * blockSize_;
+            unsigned blockDataSize = Min(blockSize_, size_ - block * blockSize_);
+            unsigned copySize;
+
+            // Decompress whole blocks straight to the destination, partial blocks through the read buffer
+            if (!blockOffset && sizeLeft >= blockDataSize)
+            {
+                if (!ReadBlock(block, destPtr))
+                    break;
+                copySize = blockDataSize;
+            }
+            else
+            {
+                if (block != readBufferBlock_)
+                {
+                    if (!readBuffer_)
+                        readBuffer_ = new unsigned char[blockSize_];
+                    if (!ReadBlock(block, readBuffer_.Get()))
+                    {
+                        readBufferBlock_ = M_MAX_UNSIGNED;
+                        break;
+                    }
+                    readBufferBlock_ = block;
+                }
+
+                copySize = Min(blockDataSize - blockOffset, sizeLeft);
+                memcpy(destPtr, readBuffer_.Get() + blockOffset, copySize);
+            }
+
+            destPtr += copySize;
+            sizeLeft -= copySize;
+            position_ += copySize;
+        }
+
+        if (sizeLeft)
+            URHO3D_LOGERROR("Error while decompressing file " + GetName());
+
+        return size - sizeLeft;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_ && !compressed_)
     {
@@ -282,6 +378,13 @@ unsigned File::Seek(unsigned position)
     if (mode_ == FILE_READ && position > size_)
         position = size_;
 
+    // Block-indexed compressed files decompress the block containing the new position on the next read
+    if (blockSize_)
+    {
+        position_ = position;
+        return position_;
+    }
+
     if (compressed_)
     {
         // Start over from the beginning
@@ -381,8 +484,23 @@ unsigned File::GetChecksum()
     return checksum_;
 }
 
+const unsigned char* File::GetDirectData() const
+{
+    return mapping_ && !compressed_ ? mapping_->GetData() + offset_ : 0;
+}
+
 void File::Close()
 {
+    if (mapping_)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
@@ -393,6 +511,9 @@ void File::Close()
 
     readBuffer_.Reset();
     inputBuffer_.Reset();
+    blockOffsets_.Clear();
+    blockSize_ = 0;
+    readBufferBlock_ = M_MAX_UNSIGNED;
 
     if (handle_)
     {
@@ -419,9 +540,9 @@ void File::SetName(const String& name)
 bool File::IsOpen() const
 {
 #ifdef __ANDROID__
-    return handle_ != 0 || assetHandle_ != 0;
+    return handle_ != 0 || assetHandle_ != 0 || mapping_ != 0;
 #else
-    return handle_ != 0;
+    return handle_ != 0 || mapping_ != 0;
 #endif
 }
 
@@ -537,6 +658,10 @@ bool File::ReadInternal(void* dest, unsigned size)
 
 void File::SeekInternal(unsigned newPosition)
 {
+    // Memory-mapped files only track the position
+    if (mapping_)
+        return;
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
@@ -550,4 +675,61 @@ void File::SeekInternal(unsigned newPosition)
         fseek((FILE*)handle_, newPosition, SEEK_SET);
 }
 
+bool File::ReadBlockOffsets(unsigned packageSize)
+{
+    // Calculate in 64 bits, so that a corrupted file size or offset can not wrap the table size or the bounds check around
+    unsigned numBlocks = (unsigned)(((unsigned long long)size_ + blockSize_ - 1) / blockSize_);
+    unsigned long long tableSize64 = ((unsigned long long)numBlocks + 1) * sizeof(unsigned);
+    if ((unsigned long long)offset_ + tableSize64 > packageSize)
+        return false;
+    unsigned tableSize = (unsigned)tableSize64;
+
+    blockOffsets_.Resize(numBlocks + 1);
+    if (mapping_)
+        memcpy(&blockOffsets_[0], mapping_->GetData() + offset_, tableSize);
+    else if (!ReadInternal(&blockOffsets_[0], tableSize))
+        return false;
+
+    // Validate the offsets so that reading a block can not go outside the package or overflow the input buffer
+    unsigned maxPackedSize = (unsigned)LZ4_compressBound(blockSize_);
+    if (blockOffsets_[0] != tableSize)
+        return false;
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        if (blockOffsets_[i + 1] < blockOffsets_[i] || blockOffsets_[i + 1] - blockOffsets_[i] > maxPackedSize)
+            return false;
+    }
+
+    return (unsigned long long)offset_ + blockOffsets_[numBlocks] <= packageSize;
+}
+
+bool File::ReadBlock(unsigned index, unsigned char* dest)
+{
+    unsigned packedOffset = blockOffsets_[index];
+    unsigned packedSize = blockOffsets_[index + 1] - packedOffset;
+    unsigned unpackedSize = Min(blockSize_, size_ - index * blockSize_);
+
+    const unsigned char* src;
+    if (mapping_)
+        src = mapping_->GetData() + offset_ + packedOffset;
+    else
+    {
+        if (!inputBuffer_)
+            inputBuffer_ = new unsigned char[LZ4_compressBound(blockSize_)];
+        SeekInternal(offset_ + packedOffset);
+        if (!ReadInternal(inputBuffer_.Get(), packedSize))
+            return false;
+        src = inputBuffer_.Get();
+    }
+
+    // Blocks that did not compress are stored as is
+    if (packedSize == unpackedSize)
+    {
+        memcpy(dest, src, unpackedSize);
+        return true;
+    }
+    else
+        return LZ4_decompress_safe((const char*)src, (char*)dest, packedSize, unpackedSize) == (int)unpackedSize;
+}
+
 }
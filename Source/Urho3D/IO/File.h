@@ -55,6 +55,7 @@ enum FileMode
 };
 
 class PackageFile;
+class PackageFileMapping;
 
 /// %File opened either through the filesystem or from within a package file.
 class URHO3D_API File : public Object, public AbstractFile
@@ -83,6 +84,8 @@ public:
 
     /// Return a checksum of the file contents using the SDBM hash algorithm.
     virtual unsigned GetChecksum();
+    /// Return pointer to the file contents if read from a memory-mapped package, or null otherwise.
+    virtual const unsigned char* GetDirectData() const;
 
     /// Open a filesystem file. Return true if successful.
     bool Open(const String& fileName, FileMode mode = FILE_READ);
@@ -107,6 +110,9 @@ public:
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
 
+    /// Return whether the file is read from a memory-mapped package.
+    bool IsMemoryMapped() const { return mapping_ != 0; }
+
 private:
     /// Open file internally using either C standard IO functions or SDL RWops for Android asset files. Return true if successful.
     bool OpenInternal(const String& fileName, FileMode mode, bool fromPackage = false);
@@ -114,6 +120,10 @@ private:
     bool ReadInternal(void* dest, unsigned size);
     /// Seek in file internally using either C standard IO functions or SDL RWops for Android asset files.
     void SeekInternal(unsigned newPosition);
+    /// Read the block offset table of a file in a block-indexed compressed package. Return true if successful.
+    bool ReadBlockOffsets(unsigned packageSize);
+    /// Decompress a block of a file in a block-indexed compressed package. Return true if successful.
+    bool ReadBlock(unsigned index, unsigned char* dest);
 
     /// File name.
     String fileName_;
@@ -125,10 +135,18 @@ private:
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
 #endif
+    /// Memory mapping of the package the file is read from, or null if read through the file handle.
+    PackageFileMapping* mapping_;
     /// Read buffer for Android asset or compressed file loading.
     SharedArrayPtr<unsigned char> readBuffer_;
     /// Decompression input buffer for compressed file loading.
     SharedArrayPtr<unsigned char> inputBuffer_;
+    /// Compressed block offsets relative to the file start, with an extra offset for the end of the last block. Empty unless read from a block-indexed compressed package.
+    PODVector<unsigned> blockOffsets_;
+    /// Uncompressed block size for block-indexed compressed package files.
+    unsigned blockSize_;
+    /// Index of the block held in the read buffer when reading from a block-indexed compressed package.
+    unsigned readBufferBlock_;
     /// Read buffer position.
     unsigned readBufferOffset_;
     /// Bytes in the current read buffer.
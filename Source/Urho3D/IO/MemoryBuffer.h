@@ -46,6 +46,8 @@ public:
     virtual unsigned Seek(unsigned position);
     /// Write bytes to the memory area.
     virtual unsigned Write(const void* data, unsigned size);
+    /// Return pointer to the memory area.
+    virtual const unsigned char* GetDirectData() const { return buffer_; }
 
     /// Return memory area.
     unsigned char* GetData() { return buffer_; }
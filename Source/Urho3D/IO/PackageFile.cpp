@@ -23,18 +23,133 @@
 #include "../Precompiled.h"
 
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
+static bool IsPackageID(const String& id)
+{
+    return id == "UPKG" || id == "UPAK" || id == "ULZ4";
+}
+
+PackageFileMapping* PackageFileMapping::Create(const String& fileName)
+{
+#if defined(__EMSCRIPTEN__)
+    // The Emscripten mmap emulation copies the file, so there is nothing to gain
+    return 0;
+#else
+#ifdef __ANDROID__
+    if (URHO3D_IS_ASSET(fileName))
+        return 0;
+#endif
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(GetWideNativePath(fileName).CString(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || !fileSize.QuadPart || fileSize.QuadPart > M_MAX_UNSIGNED)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+
+    // The mapping object keeps the file open
+    HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(file);
+    if (!mapping)
+        return 0;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return 0;
+    }
+
+    return new PackageFileMapping((const unsigned char*)data, (unsigned)fileSize.QuadPart, mapping);
+#else
+    int fd = open(GetNativePath(fileName).CString(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !st.st_size || (unsigned long long)st.st_size > M_MAX_UNSIGNED)
+    {
+        close(fd);
+        return 0;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 0;
+
+    return new PackageFileMapping((const unsigned char*)data, (unsigned)st.st_size, 0);
+#endif
+#endif
+}
+
+PackageFileMapping::PackageFileMapping(const unsigned char* data, unsigned size, void* handle) :
+    data_(data),
+    size_(size),
+    handle_(handle),
+    refs_(1)
+{
+}
+
+PackageFileMapping::~PackageFileMapping()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle((HANDLE)handle_);
+#elif !defined(__EMSCRIPTEN__)
+    munmap((void*)data_, size_);
+#endif
+}
+
+void PackageFileMapping::AddRef()
+{
+    MutexLock lock(refMutex_);
+    ++refs_;
+}
+
+void PackageFileMapping::ReleaseRef()
+{
+    bool destroy;
+    {
+        MutexLock lock(refMutex_);
+        destroy = --refs_ == 0;
+    }
+
+    if (destroy)
+        delete this;
+}
+
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
-    compressed_(false)
+    formatVersion_(0),
+    blockSize_(0),
+    compressed_(false),
+    mapping_(0)
 {
 }
 
@@ -43,13 +158,19 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
-    compressed_(false)
+    formatVersion_(0),
+    blockSize_(0),
+    compressed_(false),
+    mapping_(0)
 {
     Open(fileName, startOffset);
 }
 
 PackageFile::~PackageFile()
 {
+    // Files opened from the package may still hold the mapping
+    if (mapping_)
+        mapping_->ReleaseRef();
 }
 
 bool PackageFile::Open(const String& fileName, unsigned startOffset)
@@ -61,7 +182,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (!IsPackageID(id))
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -78,21 +199,48 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
 
-        if (id != "UPAK" && id != "ULZ4")
+        if (!IsPackageID(id))
         {
             URHO3D_LOGERROR(fileName + " is not a valid package file");
             return false;
         }
     }
 
+    if (id == "UPKG")
+    {
+        formatVersion_ = file->ReadUInt();
+        if (formatVersion_ < 2 || formatVersion_ > PACKAGE_FORMAT_VERSION)
+        {
+            URHO3D_LOGERROR(fileName + " has unsupported package format version " + String(formatVersion_));
+            return false;
+        }
+    }
+    else
+        formatVersion_ = 1;
+
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
 
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
 
+    if (formatVersion_ >= 2)
+    {
+        blockSize_ = file->ReadUInt();
+        if (blockSize_ && (blockSize_ < MIN_COMPRESSED_BLOCK_SIZE || blockSize_ > MAX_COMPRESSED_BLOCK_SIZE))
+        {
+            URHO3D_LOGERROR(fileName + " has invalid compression block size " + String(blockSize_));
+            return false;
+        }
+        compressed_ = blockSize_ != 0;
+    }
+    else
+    {
+        blockSize_ = 0;
+        compressed_ = id == "ULZ4";
+    }
+
     for (unsigned i = 0; i < numFiles; ++i)
     {
         String entryName = file->ReadString();
@@ -109,6 +257,24 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             entries_[entryName] = newEntry;
     }
 
+    // Map the package into memory so that files can be read without file handles. If mapping is not possible,
+    // fall back to reading each file through its own handle. Version 1 compressed packages are read as a sequential
+    // block stream and are not mapped
+    if (mapping_)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+    }
+    if (!compressed_ || blockSize_)
+    {
+        mapping_ = PackageFileMapping::Create(fileName_);
+        if (mapping_ && mapping_->GetSize() != totalSize_)
+        {
+            mapping_->ReleaseRef();
+            mapping_ = 0;
+        }
+    }
+
     return true;
 }
 
@@ -22,11 +22,55 @@
 
 #pragma once
 
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
 namespace Urho3D
 {
 
+/// Package file format version written by PackageTool. Version 2 stores a block offset table in front of each compressed file, so that any position can be decompressed without reading the blocks before it. Packages with the "UPAK" and "ULZ4" IDs are version 1.
+static const unsigned PACKAGE_FORMAT_VERSION = 2;
+/// Smallest compression block size of a version 2 package.
+static const unsigned MIN_COMPRESSED_BLOCK_SIZE = 1024;
+/// Largest compression block size of a version 2 package.
+static const unsigned MAX_COMPRESSED_BLOCK_SIZE = 16 * 1024 * 1024;
+
+/// Read-only memory mapping of a package file. Shared between the package and the files opened from it, so that it stays valid while any of them exist. Reference counting is thread-safe, as files may be opened and closed in resource loader threads.
+class URHO3D_API PackageFileMapping
+{
+public:
+    /// Map a whole file. Return null if memory mapping is not supported or fails. The returned mapping holds one reference.
+    static PackageFileMapping* Create(const String& fileName);
+
+    /// Add a reference.
+    void AddRef();
+    /// Release a reference. Unmap and delete when no references remain.
+    void ReleaseRef();
+
+    /// Return the mapped data.
+    const unsigned char* GetData() const { return data_; }
+
+    /// Return the mapped size.
+    unsigned GetSize() const { return size_; }
+
+private:
+    /// Construct from mapped data.
+    PackageFileMapping(const unsigned char* data, unsigned size, void* handle);
+    /// Destruct. Unmap the data.
+    ~PackageFileMapping();
+
+    /// Mapped data.
+    const unsigned char* data_;
+    /// Mapped size.
+    unsigned size_;
+    /// Operating system file mapping object, if the platform uses one.
+    void* handle_;
+    /// Mutex for the reference count.
+    Mutex refMutex_;
+    /// Reference count.
+    int refs_;
+};
+
 /// %File entry within the package file.
 struct PackageEntry
 {
@@ -82,6 +126,18 @@ public:
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
 
+    /// Return the package format version.
+    unsigned GetFormatVersion() const { return formatVersion_; }
+
+    /// Return the uncompressed size of a compressed block, or 0 if the package is uncompressed or a version 1 package whose blocks can only be read sequentially.
+    unsigned GetBlockSize() const { return blockSize_; }
+
+    /// Return whether the package is memory-mapped, in which case files are read from it without file handles or copies into intermediate buffers.
+    bool IsMemoryMapped() const { return mapping_ != 0; }
+
+    /// Return the memory mapping, or null if not mapped.
+    PackageFileMapping* GetMapping() const { return mapping_; }
+
     /// Return list of file names in the package.
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
 
@@ -98,8 +154,14 @@ private:
     unsigned totalDataSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Package format version.
+    unsigned formatVersion_;
+    /// Uncompressed block size for block-indexed compressed packages.
+    unsigned blockSize_;
     /// Compressed flag.
     bool compressed_;
+    /// Memory mapping of an uncompressed or block-indexed compressed package.
+    PackageFileMapping* mapping_;
 };
 
 }
@@ -46,6 +46,8 @@ public:
     virtual unsigned Seek(unsigned position);
     /// Write bytes to the buffer. Return number of bytes actually written.
     virtual unsigned Write(const void* data, unsigned size);
+    /// Return pointer to the buffer.
+    virtual const unsigned char* GetDirectData() const { return GetData(); }
 
     /// Set data from another buffer.
     void SetData(const PODVector<unsigned char>& data);
@@ -323,4 +323,43 @@ public:
     float dummyMax_; // This is never used, but exists to pad the max_ value to four floats.
 };
 
+/// Number of bounding boxes in a bounding box batch.
+static const unsigned BOUNDING_BOX_BATCH_SIZE = 4;
+
+/// Bounding boxes stored as centers and half sizes in structure of arrays layout, for testing several boxes at once.
+struct URHO3D_API BoundingBoxBatch
+{
+    /// Set a box. Computed like BoundingBox::Center() so that the test results match those of the single box tests.
+    void Set(unsigned index, const BoundingBox& box)
+    {
+        Vector3 center = box.Center();
+        centerX_[index] = center.x_;
+        centerY_[index] = center.y_;
+        centerZ_[index] = center.z_;
+        halfSizeX_[index] = center.x_ - box.min_.x_;
+        halfSizeY_[index] = center.y_ - box.min_.y_;
+        halfSizeZ_[index] = center.z_ - box.min_.z_;
+    }
+
+    /// Clear a box to zero size at origin. Used for the unused boxes of the last batch.
+    void Clear(unsigned index)
+    {
+        centerX_[index] = centerY_[index] = centerZ_[index] = 0.0f;
+        halfSizeX_[index] = halfSizeY_[index] = halfSizeZ_[index] = 0.0f;
+    }
+
+    /// Center X coordinates.
+    float centerX_[BOUNDING_BOX_BATCH_SIZE];
+    /// Center Y coordinates.
+    float centerY_[BOUNDING_BOX_BATCH_SIZE];
+    /// Center Z coordinates.
+    float centerZ_[BOUNDING_BOX_BATCH_SIZE];
+    /// Half sizes along X axis.
+    float halfSizeX_[BOUNDING_BOX_BATCH_SIZE];
+    /// Half sizes along Y axis.
+    float halfSizeY_[BOUNDING_BOX_BATCH_SIZE];
+    /// Half sizes along Z axis.
+    float halfSizeZ_[BOUNDING_BOX_BATCH_SIZE];
+};
+
 }
@@ -190,6 +190,87 @@ void Frustum::Transform(const Matrix3x4& transform)
     UpdatePlanes();
 }
 
+void Frustum::IsInsideFast(const BoundingBoxBatch* batches, unsigned numBatches, unsigned char* masks) const
+{
+#ifdef URHO3D_SSE
+    __m128 normalX[NUM_FRUSTUM_PLANES];
+    __m128 normalY[NUM_FRUSTUM_PLANES];
+    __m128 normalZ[NUM_FRUSTUM_PLANES];
+    __m128 absNormalX[NUM_FRUSTUM_PLANES];
+    __m128 absNormalY[NUM_FRUSTUM_PLANES];
+    __m128 absNormalZ[NUM_FRUSTUM_PLANES];
+    __m128 d[NUM_FRUSTUM_PLANES];
+    __m128 zero = _mm_setzero_ps();
+
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        const Plane& plane = planes_[i];
+        normalX[i] = _mm_set1_ps(plane.normal_.x_);
+        normalY[i] = _mm_set1_ps(plane.normal_.y_);
+        normalZ[i] = _mm_set1_ps(plane.normal_.z_);
+        absNormalX[i] = _mm_set1_ps(plane.absNormal_.x_);
+        absNormalY[i] = _mm_set1_ps(plane.absNormal_.y_);
+        absNormalZ[i] = _mm_set1_ps(plane.absNormal_.z_);
+        d[i] = _mm_set1_ps(plane.d_);
+    }
+
+    for (unsigned i = 0; i < numBatches; ++i)
+    {
+        const BoundingBoxBatch& batch = batches[i];
+        __m128 centerX = _mm_loadu_ps(batch.centerX_);
+        __m128 centerY = _mm_loadu_ps(batch.centerY_);
+        __m128 centerZ = _mm_loadu_ps(batch.centerZ_);
+        __m128 halfSizeX = _mm_loadu_ps(batch.halfSizeX_);
+        __m128 halfSizeY = _mm_loadu_ps(batch.halfSizeY_);
+        __m128 halfSizeZ = _mm_loadu_ps(batch.halfSizeZ_);
+        __m128 outside = zero;
+
+        // Same operation order as in the single box test, so that the results are identical
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[j], centerX), _mm_mul_ps(normalY[j], centerY)),
+                _mm_mul_ps(normalZ[j], centerZ)), d[j]);
+            __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[j], halfSizeX), _mm_mul_ps(absNormalY[j], halfSizeY)),
+                _mm_mul_ps(absNormalZ[j], halfSizeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(zero, absDist)));
+        }
+
+        masks[i] = (unsigned char)(~_mm_movemask_ps(outside) & 0xf);
+    }
+#else
+    for (unsigned i = 0; i < numBatches; ++i)
+    {
+        const BoundingBoxBatch& batch = batches[i];
+        unsigned char mask = 0;
+
+        for (unsigned j = 0; j < BOUNDING_BOX_BATCH_SIZE; ++j)
+        {
+            Vector3 center(batch.centerX_[j], batch.centerY_[j], batch.centerZ_[j]);
+            Vector3 edge(batch.halfSizeX_[j], batch.halfSizeY_[j], batch.halfSizeZ_[j]);
+            bool outside = false;
+
+            for (unsigned k = 0; k < NUM_FRUSTUM_PLANES; ++k)
+            {
+                const Plane& plane = planes_[k];
+                float dist = plane.normal_.DotProduct(center) + plane.d_;
+                float absDist = plane.absNormal_.DotProduct(edge);
+
+                if (dist < -absDist)
+                {
+                    outside = true;
+                    break;
+                }
+            }
+
+            if (!outside)
+                mask |= 1 << j;
+        }
+
+        masks[i] = mask;
+    }
+#endif
+}
+
 Frustum Frustum::Transformed(const Matrix3& transform) const
 {
     Frustum transformed;
@@ -157,6 +157,9 @@ public:
         return INSIDE;
     }
 
+    /// Test bounding box batches for being (partially) inside or outside. Writes a mask per batch, with the bit of each box set if it is (partially) inside.
+    void IsInsideFast(const BoundingBoxBatch* batches, unsigned numBatches, unsigned char* masks) const;
+
     /// Return distance of a point to the frustum, or 0 if inside.
     float Distance(const Vector3& point) const
     {
@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../IO/Compression.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -46,6 +47,28 @@ namespace Urho3D
 {
 
 static const int STATS_INTERVAL_MSEC = 2000;
+/// Latest data message flag: snapshot is delta encoded against an acknowledged baseline.
+static const unsigned char LATESTDATA_DELTA = 0x1;
+/// Latest data message flag: snapshot is LZ4 compressed.
+static const unsigned char LATESTDATA_COMPRESSED = 0x2;
+/// Minimum latest data snapshot size in bytes to attempt compression on.
+static const unsigned LATESTDATA_COMPRESS_THRESHOLD = 32;
+
+/// XOR a snapshot against a baseline. Bytes past the end of the baseline are copied as is.
+static void DeltaEncodeSnapshot(unsigned char* dest, const unsigned char* src, unsigned size, const PODVector<unsigned char>& baseline)
+{
+    unsigned common = Min(size, baseline.Size());
+    for (unsigned i = 0; i < common; ++i)
+        dest[i] = src[i] ^ baseline[i];
+    for (unsigned i = common; i < size; ++i)
+        dest[i] = src[i];
+}
+
+/// Return whether sequence number a is newer than b, taking wraparound into account.
+static inline bool IsNewerSequence(unsigned char a, unsigned char b)
+{
+    return (signed char)(a - b) > 0;
+}
 
 PackageDownload::PackageDownload() :
     totalFragments_(0),
@@ -65,6 +88,7 @@ Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::Me
     timeStamp_(0),
     connection_(connection),
     sendMode_(OPSM_NONE),
+    interestRadius_(0.0f),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
@@ -226,6 +250,11 @@ void Connection::SetRotation(const Quaternion& rotation)
         sendMode_ = OPSM_POSITION_ROTATION;
 }
 
+void Connection::SetInterestRadius(float radius)
+{
+    interestRadius_ = Max(radius, 0.0f);
+}
+
 void Connection::SetConnectPending(bool connectPending)
 {
     connectPending_ = connectPending;
@@ -242,10 +271,19 @@ void Connection::Disconnect(int waitMSec)
 }
 
 void Connection::SendServerUpdate()
+{
+    BuildServerUpdate();
+    SendBufferedMessages();
+}
+
+void Connection::BuildServerUpdate()
 {
     if (!scene_ || !sceneLoaded_)
         return;
 
+    if (interestRadius_ > 0.0f)
+        UpdateInterest();
+
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
@@ -263,6 +301,25 @@ void Connection::SendServerUpdate()
     }
 }
 
+void Connection::SendBufferedMessages()
+{
+    if (!bufferedMessages_.GetSize())
+        return;
+
+    MemoryBuffer messages(bufferedMessages_.GetData(), bufferedMessages_.GetSize());
+    while (!messages.IsEof())
+    {
+        int msgID = messages.ReadInt();
+        unsigned char flags = messages.ReadUByte();
+        unsigned contentID = messages.ReadUInt();
+        unsigned numBytes = messages.ReadVLE();
+        SendMessage(msgID, (flags & 1) != 0, (flags & 2) != 0, messages.GetData() + messages.GetPosition(), numBytes, contentID);
+        messages.Seek(messages.GetPosition() + numBytes);
+    }
+
+    bufferedMessages_.Clear();
+}
+
 void Connection::SendClientUpdate()
 {
     if (!scene_ || !sceneLoaded_)
@@ -280,6 +337,39 @@ void Connection::SendClientUpdate()
         msg_.WritePackedQuaternion(rotation_);
     SendMessage(MSG_CONTROLS, false, false, msg_, CONTROLS_CONTENT_ID);
 
+    // Acknowledge received latest data so that the server can delta encode against it. Losing an acknowledgement
+    // is harmless, the server just keeps using an older baseline. Objects whose delta baseline was missing are
+    // reported after the acknowledgements, so that the server sends them a full snapshot next
+    if (nodeLatestDataAcks_.Size() || componentLatestDataAcks_.Size() || nodeLatestDataNacks_.Size() ||
+        componentLatestDataNacks_.Size())
+    {
+        msg_.Clear();
+        msg_.WriteVLE(nodeLatestDataAcks_.Size());
+        for (HashMap<unsigned, unsigned char>::ConstIterator i = nodeLatestDataAcks_.Begin(); i != nodeLatestDataAcks_.End(); ++i)
+        {
+            msg_.WriteNetID(i->first_);
+            msg_.WriteUByte(i->second_);
+        }
+        msg_.WriteVLE(componentLatestDataAcks_.Size());
+        for (HashMap<unsigned, unsigned char>::ConstIterator i = componentLatestDataAcks_.Begin(); i != componentLatestDataAcks_.End(); ++i)
+        {
+            msg_.WriteNetID(i->first_);
+            msg_.WriteUByte(i->second_);
+        }
+        msg_.WriteVLE(nodeLatestDataNacks_.Size());
+        for (HashSet<unsigned>::ConstIterator i = nodeLatestDataNacks_.Begin(); i != nodeLatestDataNacks_.End(); ++i)
+            msg_.WriteNetID(*i);
+        msg_.WriteVLE(componentLatestDataNacks_.Size());
+        for (HashSet<unsigned>::ConstIterator i = componentLatestDataNacks_.Begin(); i != componentLatestDataNacks_.End(); ++i)
+            msg_.WriteNetID(*i);
+        SendMessage(MSG_LATESTDATAACK, false, false, msg_);
+
+        nodeLatestDataAcks_.Clear();
+        componentLatestDataAcks_.Clear();
+        nodeLatestDataNacks_.Clear();
+        componentLatestDataNacks_.Clear();
+    }
+
     ++timeStamp_;
 }
 
@@ -356,34 +446,34 @@ void Connection::ProcessPendingLatestData()
         return;
 
     // Iterate through pending node data and see if we can find the nodes now
-    for (HashMap<unsigned, PODVector<unsigned char> >::Iterator i = nodeLatestData_.Begin(); i != nodeLatestData_.End();)
+    for (FlatHashMap<unsigned, PODVector<unsigned char> >::Iterator i = nodeLatestData_.Begin(); i != nodeLatestData_.End();)
     {
-        HashMap<unsigned, PODVector<unsigned char> >::Iterator current = i++;
-        Node* node = scene_->GetNode(current->first_);
+        Node* node = scene_->GetNode(i->first_);
         if (node)
         {
-            MemoryBuffer msg(current->second_);
-            msg.ReadNetID(); // Skip the node ID
+            MemoryBuffer msg(i->second_);
             node->ReadLatestDataUpdate(msg);
             // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
             // Furthermore it would propagate to components and child nodes, which is not desired in this case
-            nodeLatestData_.Erase(current);
+            i = nodeLatestData_.Erase(i);
         }
+        else
+            ++i;
     }
 
     // Iterate through pending component data and see if we can find the components now
-    for (HashMap<unsigned, PODVector<unsigned char> >::Iterator i = componentLatestData_.Begin(); i != componentLatestData_.End();)
+    for (FlatHashMap<unsigned, PODVector<unsigned char> >::Iterator i = componentLatestData_.Begin(); i != componentLatestData_.End();)
     {
-        HashMap<unsigned, PODVector<unsigned char> >::Iterator current = i++;
-        Component* component = scene_->GetComponent(current->first_);
+        Component* component = scene_->GetComponent(i->first_);
         if (component)
         {
-            MemoryBuffer msg(current->second_);
-            msg.ReadNetID(); // Skip the component ID
+            MemoryBuffer msg(i->second_);
             if (component->ReadLatestDataUpdate(msg))
                 component->ApplyAttributes();
-            componentLatestData_.Erase(current);
+            i = componentLatestData_.Erase(i);
         }
+        else
+            ++i;
     }
 }
 
@@ -401,6 +491,10 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
         ProcessControls(msgID, msg);
         break;
 
+    case MSG_LATESTDATAACK:
+        ProcessLatestDataAck(msgID, msg);
+        break;
+
     case MSG_SCENELOADED:
         ProcessSceneLoaded(msgID, msg);
         break;
@@ -466,6 +560,12 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
     // Clear previous pending latest data and package downloads if any
     nodeLatestData_.Clear();
     componentLatestData_.Clear();
+    nodeLatestDataHistory_.Clear();
+    componentLatestDataHistory_.Clear();
+    nodeLatestDataAcks_.Clear();
+    componentLatestDataAcks_.Clear();
+    nodeLatestDataNacks_.Clear();
+    componentLatestDataNacks_.Clear();
     downloads_.Clear();
 
     // In case we have joined other scenes in this session, remove first all downloaded package files from the resource system
@@ -606,19 +706,23 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
     case MSG_NODELATESTDATA:
         {
             unsigned nodeID = msg.ReadNetID();
+            // Latest data messages are unordered, so skip if a newer snapshot has already been applied
+            if (!ReadLatestDataSnapshot(msg, nodeLatestDataHistory_[nodeID], nodeLatestDataAcks_, nodeLatestDataNacks_,
+                nodeID))
+                break;
+
             Node* node = scene_->GetNode(nodeID);
             if (node)
             {
-                node->ReadLatestDataUpdate(msg);
+                MemoryBuffer snapshot(latestDataSnapshot_);
+                node->ReadLatestDataUpdate(snapshot);
                 // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
                 // Furthermore it would propagate to components and child nodes, which is not desired in this case
             }
             else
             {
                 // Latest data messages may be received out-of-order relative to node creation, so cache if necessary
-                PODVector<unsigned char>& data = nodeLatestData_[nodeID];
-                data.Resize(msg.GetSize());
-                memcpy(&data[0], msg.GetData(), msg.GetSize());
+                nodeLatestData_[nodeID] = latestDataSnapshot_;
             }
         }
         break;
@@ -628,8 +732,14 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             unsigned nodeID = msg.ReadNetID();
             Node* node = scene_->GetNode(nodeID);
             if (node)
+            {
+                // Removing the node removes its whole subtree, so the child nodes can not be found anymore when the server
+                // removes them
+                RemoveLatestDataHistory(node);
                 node->Remove();
+            }
             nodeLatestData_.Erase(nodeID);
+            nodeLatestDataHistory_.Erase(nodeID);
         }
         break;
 
@@ -684,18 +794,22 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
     case MSG_COMPONENTLATESTDATA:
         {
             unsigned componentID = msg.ReadNetID();
+            // Latest data messages are unordered, so skip if a newer snapshot has already been applied
+            if (!ReadLatestDataSnapshot(msg, componentLatestDataHistory_[componentID], componentLatestDataAcks_,
+                componentLatestDataNacks_, componentID))
+                break;
+
             Component* component = scene_->GetComponent(componentID);
             if (component)
             {
-                if (component->ReadLatestDataUpdate(msg))
+                MemoryBuffer snapshot(latestDataSnapshot_);
+                if (component->ReadLatestDataUpdate(snapshot))
                     component->ApplyAttributes();
             }
             else
             {
                 // Latest data messages may be received out-of-order relative to component creation, so cache if necessary
-                PODVector<unsigned char>& data = componentLatestData_[componentID];
-                data.Resize(msg.GetSize());
-                memcpy(&data[0], msg.GetData(), msg.GetSize());
+                componentLatestData_[componentID] = latestDataSnapshot_;
             }
         }
         break;
@@ -707,6 +821,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             if (component)
                 component->Remove();
             componentLatestData_.Erase(componentID);
+            componentLatestDataHistory_.Erase(componentID);
         }
         break;
 
@@ -901,6 +1016,80 @@ void Connection::ProcessControls(int msgID, MemoryBuffer& msg)
         rotation_ = msg.ReadPackedQuaternion();
 }
 
+void Connection::ProcessLatestDataAck(int msgID, MemoryBuffer& msg)
+{
+    if (!IsClient())
+    {
+        URHO3D_LOGWARNING("Received unexpected LatestDataAck message from server");
+        return;
+    }
+
+    if (!scene_)
+        return;
+
+    unsigned numNodes = msg.ReadVLE();
+    while (numNodes-- && !msg.IsEof())
+    {
+        unsigned nodeID = msg.ReadNetID();
+        unsigned char sequence = msg.ReadUByte();
+        HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(nodeID);
+        if (i == sceneState_.nodeStates_.End() || !i->second_.latestData_)
+            continue;
+
+        // Accept only snapshots still in the history, and never move the baseline backward
+        LatestDataHistory& history = *i->second_.latestData_;
+        if (history.Get(sequence) && (!history.hasSequence_ || IsNewerSequence(sequence, history.sequence_)))
+        {
+            history.sequence_ = sequence;
+            history.hasSequence_ = true;
+        }
+    }
+
+    unsigned numComponents = msg.ReadVLE();
+    while (numComponents-- && !msg.IsEof())
+    {
+        unsigned componentID = msg.ReadNetID();
+        unsigned char sequence = msg.ReadUByte();
+        LatestDataHistory* history = GetComponentLatestDataHistory(componentID);
+        if (history && history->Get(sequence) && (!history->hasSequence_ || IsNewerSequence(sequence, history->sequence_)))
+        {
+            history->sequence_ = sequence;
+            history->hasSequence_ = true;
+        }
+    }
+
+    // The client lacked the baseline of these objects' last delta snapshot. Forget the acknowledged baseline so that the next
+    // snapshot is sent in full
+    unsigned numNodeNacks = msg.ReadVLE();
+    while (numNodeNacks-- && !msg.IsEof())
+    {
+        HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(msg.ReadNetID());
+        if (i != sceneState_.nodeStates_.End() && i->second_.latestData_)
+            i->second_.latestData_->hasSequence_ = false;
+    }
+
+    unsigned numComponentNacks = msg.ReadVLE();
+    while (numComponentNacks-- && !msg.IsEof())
+    {
+        LatestDataHistory* history = GetComponentLatestDataHistory(msg.ReadNetID());
+        if (history)
+            history->hasSequence_ = false;
+    }
+}
+
+LatestDataHistory* Connection::GetComponentLatestDataHistory(unsigned componentID)
+{
+    Component* component = scene_->GetComponent(componentID);
+    Node* node = component ? component->GetNode() : 0;
+    if (!node)
+        return 0;
+    HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(node->GetID());
+    if (i == sceneState_.nodeStates_.End())
+        return 0;
+    HashMap<unsigned, ComponentReplicationState>::Iterator j = i->second_.componentStates_.Find(componentID);
+    return j != i->second_.componentStates_.End() ? j->second_.latestData_.Get() : 0;
+}
+
 void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
 {
     if (!IsClient())
@@ -1101,6 +1290,234 @@ void Connection::HandleAsyncLoadFinished(StringHash eventType, VariantMap& event
     SendMessage(MSG_SCENELOADED, true, true, msg_);
 }
 
+void Connection::WriteLatestDataSnapshot(LatestDataHistory& history, const VectorBuffer& snapshot)
+{
+    const unsigned char* data = snapshot.GetData();
+    unsigned size = snapshot.GetSize();
+    unsigned char flags = 0;
+    unsigned char sequence = history.nextSequence_++;
+    unsigned char baselineSequence = history.sequence_;
+    const PODVector<unsigned char>* baseline = history.hasSequence_ ? history.Get(baselineSequence) : 0;
+
+    // Delta encode against the last snapshot the client has acknowledged. Unchanged bytes become zero, which compresses well
+    if (baseline && size)
+    {
+        deltaBuffer_.Resize(size);
+        DeltaEncodeSnapshot(&deltaBuffer_[0], data, size, *baseline);
+        data = &deltaBuffer_[0];
+        flags |= LATESTDATA_DELTA;
+    }
+
+    // Compress if the result, including the uncompressed size, is smaller
+    unsigned compressedSize = 0;
+    if (size >= LATESTDATA_COMPRESS_THRESHOLD)
+    {
+        compressBuffer_.Resize(EstimateCompressBound(size));
+        compressedSize = CompressData(&compressBuffer_[0], data, size);
+        if (compressedSize && compressedSize + 4 < size)
+            flags |= LATESTDATA_COMPRESSED;
+    }
+
+    msg_.WriteUByte(flags);
+    msg_.WriteUByte(sequence);
+    if (flags & LATESTDATA_DELTA)
+        msg_.WriteUByte(baselineSequence);
+    if (flags & LATESTDATA_COMPRESSED)
+    {
+        msg_.WriteVLE(size);
+        msg_.Write(&compressBuffer_[0], compressedSize);
+    }
+    else
+        msg_.Write(data, size);
+
+    history.Store(sequence, snapshot.GetData(), snapshot.GetSize());
+}
+
+bool Connection::ReadLatestDataSnapshot(MemoryBuffer& msg, SharedPtr<LatestDataHistory>& history, HashMap<unsigned, unsigned char>& acks,
+    HashSet<unsigned>& nacks, unsigned id)
+{
+    if (!history)
+        history = new LatestDataHistory();
+
+    unsigned char flags = msg.ReadUByte();
+    unsigned char sequence = msg.ReadUByte();
+    const PODVector<unsigned char>* baseline = 0;
+    if (flags & LATESTDATA_DELTA)
+    {
+        baseline = history->Get(msg.ReadUByte());
+        // The baseline can only be missing if the object was recreated in between. Drop, and tell the server to send
+        // a full snapshot next instead of waiting for the baseline to fall out of its history
+        if (!baseline)
+        {
+            acks.Erase(id);
+            nacks.Insert(id);
+            return false;
+        }
+    }
+
+    const unsigned char* src = msg.GetData() + msg.GetPosition();
+    unsigned srcSize = msg.GetSize() - msg.GetPosition();
+    if (flags & LATESTDATA_COMPRESSED)
+    {
+        unsigned size = msg.ReadVLE();
+        src = msg.GetData() + msg.GetPosition();
+        srcSize = msg.GetSize() - msg.GetPosition();
+        deltaBuffer_.Resize(size);
+        if (!size || DecompressData(&deltaBuffer_[0], src, size) != srcSize)
+        {
+            URHO3D_LOGERROR("Failed to decompress latest data for object " + String(id));
+            return false;
+        }
+        src = &deltaBuffer_[0];
+        srcSize = size;
+    }
+
+    latestDataSnapshot_.Resize(srcSize);
+    if (srcSize)
+    {
+        if (baseline)
+            DeltaEncodeSnapshot(&latestDataSnapshot_[0], src, srcSize, *baseline);
+        else
+            memcpy(&latestDataSnapshot_[0], src, srcSize);
+    }
+
+    history->Store(sequence, latestDataSnapshot_.Buffer(), latestDataSnapshot_.Size());
+    acks[id] = sequence;
+    nacks.Erase(id);
+
+    if (history->hasSequence_ && !IsNewerSequence(sequence, history->sequence_))
+        return false;
+    history->sequence_ = sequence;
+    history->hasSequence_ = true;
+    return true;
+}
+
+void Connection::RemoveLatestDataHistory(Node* node)
+{
+    nodeLatestDataHistory_.Erase(node->GetID());
+
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.Size(); ++i)
+        componentLatestDataHistory_.Erase(components[i]->GetID());
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+        RemoveLatestDataHistory(children[i]);
+}
+
+void Connection::BufferMessage(int msgID, bool reliable, bool inOrder, const VectorBuffer& msg, unsigned contentID)
+{
+    bufferedMessages_.WriteInt(msgID);
+    bufferedMessages_.WriteUByte((unsigned char)((reliable ? 1 : 0) | (inOrder ? 2 : 0)));
+    bufferedMessages_.WriteUInt(contentID);
+    bufferedMessages_.WriteVLE(msg.GetSize());
+    bufferedMessages_.Write(msg.GetData(), msg.GetSize());
+}
+
+void Connection::UpdateInterest()
+{
+    Network* network = GetSubsystem<Network>();
+    const InterestGrid* grid = network ? network->GetInterestGrid(scene_) : 0;
+
+    interestNodes_.Clear();
+    if (grid)
+        grid->GetNodes(interestNodes_, position_, interestRadius_);
+
+    // Nodes which the replicated nodes inside the area depend on stay replicated, so that the client does not receive
+    // parent or component references to nodes it does not have
+    requiredNodes_.Clear();
+    for (HashMap<unsigned, NodeReplicationState>::ConstIterator i = sceneState_.nodeStates_.Begin();
+         i != sceneState_.nodeStates_.End(); ++i)
+    {
+        Node* node = i->second_.node_;
+        if (node && IsInInterest(node))
+            RequireDependencyNodes(node);
+    }
+
+    // Remove the nodes which have left the area of interest. They will be recreated in full if they enter it again
+    for (HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Begin(); i != sceneState_.nodeStates_.End();)
+    {
+        HashMap<unsigned, NodeReplicationState>::Iterator current = i++;
+        NodeReplicationState& nodeState = current->second_;
+        Node* node = nodeState.node_;
+        // Nodes removed from the scene are handled by ProcessNode()
+        if (!node || IsInInterest(node))
+            continue;
+
+        msg_.Clear();
+        msg_.WriteNetID(current->first_);
+        BufferMessage(MSG_REMOVENODE, true, true, msg_);
+
+        sceneState_.dirtyNodes_.Erase(current->first_);
+
+        MutexLock lock(scene_->GetReplicationStateMutex());
+        for (HashMap<unsigned, ComponentReplicationState>::Iterator j = nodeState.componentStates_.Begin();
+             j != nodeState.componentStates_.End(); ++j)
+        {
+            Component* component = j->second_.component_;
+            if (component)
+                component->RemoveReplicationState(&j->second_);
+        }
+        node->RemoveReplicationState(&nodeState);
+        sceneState_.nodeStates_.Erase(current);
+    }
+
+    // Mark the nodes which have entered the area of interest dirty, along with their replicated children
+    for (HashSet<unsigned>::ConstIterator i = interestNodes_.Begin(); i != interestNodes_.End(); ++i)
+    {
+        if (sceneState_.nodeStates_.Contains(*i))
+            continue;
+
+        Node* node = scene_->GetNode(*i);
+        if (!node)
+            continue;
+
+        if (node->GetID() < FIRST_LOCAL_ID)
+            sceneState_.dirtyNodes_.Insert(node->GetID());
+
+        interestChildren_.Clear();
+        node->GetChildren(interestChildren_, true);
+        for (PODVector<Node*>::ConstIterator j = interestChildren_.Begin(); j != interestChildren_.End(); ++j)
+        {
+            if ((*j)->GetID() < FIRST_LOCAL_ID)
+                sceneState_.dirtyNodes_.Insert((*j)->GetID());
+        }
+    }
+}
+
+void Connection::RequireDependencyNodes(Node* node)
+{
+    const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
+    for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
+    {
+        Node* dependency = *i;
+        if (dependency->GetID() < FIRST_LOCAL_ID && !IsInInterest(dependency))
+        {
+            requiredNodes_.Insert(dependency->GetID());
+            RequireDependencyNodes(dependency);
+        }
+    }
+}
+
+bool Connection::IsInInterest(Node* node) const
+{
+    if (interestRadius_ <= 0.0f)
+        return true;
+
+    if (requiredNodes_.Contains(node->GetID()))
+        return true;
+
+    // Child nodes follow their root-level ancestor
+    Node* parent = node->GetParent();
+    while (parent && parent != scene_)
+    {
+        node = parent;
+        parent = node->GetParent();
+    }
+
+    return node == scene_ || interestNodes_.Contains(node->GetID());
+}
+
 void Connection::ProcessNode(unsigned nodeID)
 {
     // Check that we have not already processed this due to dependency recursion
@@ -1121,7 +1538,10 @@ void Connection::ProcessNode(unsigned nodeID)
             // Note: we will send MSG_REMOVENODE redundantly for each node in the hierarchy, even if removing the root node
             // would be enough. However, this may be better due to the client not possibly having updated parenting
             // information at the time of receiving this message
-            SendMessage(MSG_REMOVENODE, true, true, msg_);
+            BufferMessage(MSG_REMOVENODE, true, true, msg_);
+
+            // Other connections may be releasing their weak references to the node at the same time
+            MutexLock lock(scene_->GetReplicationStateMutex());
             sceneState_.nodeStates_.Erase(nodeID);
         }
         else
@@ -1129,9 +1549,12 @@ void Connection::ProcessNode(unsigned nodeID)
     }
     else
     {
-        // Replication state not found: this is a new node
+        // Replication state not found: this is a new node. If it is outside the area of interest, it will be marked
+        // dirty again when it enters
         Node* node = scene_->GetNode(nodeID);
-        if (node)
+        if (node && !IsInInterest(node))
+            sceneState_.dirtyNodes_.Erase(nodeID);
+        else if (node)
             ProcessNewNode(node);
         else
         {
@@ -1141,16 +1564,33 @@ void Connection::ProcessNode(unsigned nodeID)
     }
 }
 
-void Connection::ProcessNewNode(Node* node)
+void Connection::ProcessDependencyNodes(Node* node)
 {
     // Process depended upon nodes first, if they are dirty
     const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
     for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
     {
         unsigned nodeID = (*i)->GetID();
+
+        // A dependency outside the area of interest is replicated anyway. If it was skipped or removed before, queue it again
+        if (nodeID < FIRST_LOCAL_ID && !IsInInterest(*i))
+        {
+            requiredNodes_.Insert(nodeID);
+            if (!sceneState_.nodeStates_.Contains(nodeID))
+            {
+                sceneState_.dirtyNodes_.Insert(nodeID);
+                nodesToProcess_.Insert(nodeID);
+            }
+        }
+
         if (sceneState_.dirtyNodes_.Contains(nodeID))
             ProcessNode(nodeID);
     }
+}
+
+void Connection::ProcessNewNode(Node* node)
+{
+    ProcessDependencyNodes(node);
 
     msg_.Clear();
     msg_.WriteNetID(node->GetID());
@@ -1158,8 +1598,12 @@ void Connection::ProcessNewNode(Node* node)
     NodeReplicationState& nodeState = sceneState_.nodeStates_[node->GetID()];
     nodeState.connection_ = this;
     nodeState.sceneState_ = &sceneState_;
-    nodeState.node_ = node;
-    node->AddReplicationState(&nodeState);
+    {
+        // The node is shared with the other connections, which may be building their updates at the same time
+        MutexLock lock(scene_->GetReplicationStateMutex());
+        nodeState.node_ = node;
+        node->AddReplicationState(&nodeState);
+    }
 
     // Write node's attributes
     node->WriteInitialDeltaUpdate(msg_, timeStamp_);
@@ -1186,15 +1630,18 @@ void Connection::ProcessNewNode(Node* node)
         ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
         componentState.connection_ = this;
         componentState.nodeState_ = &nodeState;
-        componentState.component_ = component;
-        component->AddReplicationState(&componentState);
+        {
+            MutexLock lock(scene_->GetReplicationStateMutex());
+            componentState.component_ = component;
+            component->AddReplicationState(&componentState);
+        }
 
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
         component->WriteInitialDeltaUpdate(msg_, timeStamp_);
     }
 
-    SendMessage(MSG_CREATENODE, true, true, msg_);
+    BufferMessage(MSG_CREATENODE, true, true, msg_);
 
     nodeState.markedDirty_ = false;
     sceneState_.dirtyNodes_.Erase(node->GetID());
@@ -1202,14 +1649,7 @@ void Connection::ProcessNewNode(Node* node)
 
 void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState)
 {
-    // Process depended upon nodes first, if they are dirty
-    const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
-    for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
-    {
-        unsigned nodeID = (*i)->GetID();
-        if (sceneState_.dirtyNodes_.Contains(nodeID))
-            ProcessNode(nodeID);
-    }
+    ProcessDependencyNodes(node);
 
     // Check from the interest management component, if exists, whether should update
     /// \todo Searching for the component is a potential CPU hotspot. It should be cached
@@ -1240,11 +1680,16 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         // Send latestdata message if necessary
         if (hasLatestData)
         {
+            if (!nodeState.latestData_)
+                nodeState.latestData_ = new LatestDataHistory();
+            latestDataMsg_.Clear();
+            node->WriteLatestDataUpdate(latestDataMsg_, timeStamp_);
+
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteLatestDataUpdate(msg_, timeStamp_);
+            WriteLatestDataSnapshot(*nodeState.latestData_, latestDataMsg_);
 
-            SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
+            BufferMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
         }
 
         // Send deltaupdate if remaining dirty bits, or vars have changed
@@ -1274,7 +1719,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 }
             }
 
-            SendMessage(MSG_NODEDELTAUPDATE, true, true, msg_);
+            BufferMessage(MSG_NODEDELTAUPDATE, true, true, msg_);
 
             nodeState.dirtyAttributes_.ClearAll();
             nodeState.dirtyVars_.Clear();
@@ -1294,7 +1739,9 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             msg_.Clear();
             msg_.WriteNetID(current->first_);
 
-            SendMessage(MSG_REMOVECOMPONENT, true, true, msg_);
+            BufferMessage(MSG_REMOVECOMPONENT, true, true, msg_);
+
+            MutexLock lock(scene_->GetReplicationStateMutex());
             nodeState.componentStates_.Erase(current);
         }
         else
@@ -1318,11 +1765,16 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 // Send latestdata message if necessary
                 if (hasLatestData)
                 {
+                    if (!componentState.latestData_)
+                        componentState.latestData_ = new LatestDataHistory();
+                    latestDataMsg_.Clear();
+                    component->WriteLatestDataUpdate(latestDataMsg_, timeStamp_);
+
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteLatestDataUpdate(msg_, timeStamp_);
+                    WriteLatestDataSnapshot(*componentState.latestData_, latestDataMsg_);
 
-                    SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
+                    BufferMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
                 }
 
                 // Send deltaupdate if remaining dirty bits
@@ -1332,7 +1784,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     msg_.WriteNetID(component->GetID());
                     component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
 
-                    SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
+                    BufferMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
 
                     componentState.dirtyAttributes_.ClearAll();
                 }
@@ -1358,8 +1810,11 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
                 componentState.connection_ = this;
                 componentState.nodeState_ = &nodeState;
-                componentState.component_ = component;
-                component->AddReplicationState(&componentState);
+                {
+                    MutexLock lock(scene_->GetReplicationStateMutex());
+                    componentState.component_ = component;
+                    component->AddReplicationState(&componentState);
+                }
 
                 msg_.Clear();
                 msg_.WriteNetID(node->GetID());
@@ -1367,7 +1822,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 msg_.WriteNetID(component->GetID());
                 component->WriteInitialDeltaUpdate(msg_, timeStamp_);
 
-                SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
+                BufferMessage(MSG_CREATECOMPONENT, true, true, msg_);
             }
         }
     }
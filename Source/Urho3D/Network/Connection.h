@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/HashSet.h"
 #include "../Core/Object.h"
 #include "../Core/Timer.h"
@@ -130,6 +131,8 @@ public:
     void SetPosition(const Vector3& position);
     /// Set the observer rotation for interest management, to be sent to the server. Note: not used by the NetworkPriority component.
     void SetRotation(const Quaternion& rotation);
+    /// Set the area of interest radius around the observer position on the server. Only nodes whose root-level ancestor node is within the radius are replicated to the client, and nodes leaving the area are removed from the client. Zero (default) replicates all nodes.
+    void SetInterestRadius(float radius);
     /// Set the connection pending status. Called by Network.
     void SetConnectPending(bool connectPending);
     /// Set whether to log data in/out statistics.
@@ -138,6 +141,10 @@ public:
     void Disconnect(int waitMSec = 0);
     /// Send scene update messages. Called by Network.
     void SendServerUpdate();
+    /// Build the scene update messages into a buffer without sending them, using the attribute values gathered by Scene::PrepareNetworkUpdate(). Can be called from a worker thread, if the scene is not modified meanwhile. Called by Network.
+    void BuildServerUpdate();
+    /// Send the messages buffered by BuildServerUpdate(). Called by Network.
+    void SendBufferedMessages();
     /// Send latest controls from the client. Called by Network.
     void SendClientUpdate();
     /// Send queued remote events. Called by Network.
@@ -170,6 +177,9 @@ public:
     /// Return the observer rotation sent by the client for interest management.
     const Quaternion& GetRotation() const { return rotation_; }
 
+    /// Return the area of interest radius.
+    float GetInterestRadius() const { return interestRadius_; }
+
     /// Return whether is a client connection.
     bool IsClient() const { return isClient_; }
 
@@ -245,10 +255,31 @@ private:
     void ProcessIdentity(int msgID, MemoryBuffer& msg);
     /// Process a Controls message from the client. Called by Network.
     void ProcessControls(int msgID, MemoryBuffer& msg);
+    /// Process a LatestDataAck message from the client. Called by Network.
+    void ProcessLatestDataAck(int msgID, MemoryBuffer& msg);
     /// Process a SceneLoaded message from the client. Called by Network.
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
     void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
+    /// Write a latest data snapshot to msg_, delta encoded against the acknowledged baseline and LZ4 compressed when beneficial.
+    void WriteLatestDataSnapshot(LatestDataHistory& history, const VectorBuffer& snapshot);
+    /// Decode a latest data snapshot into latestDataSnapshot_ and record its acknowledgement, or a negative acknowledgement if its delta baseline is missing. Return true if it is newer than the last applied snapshot.
+    bool ReadLatestDataSnapshot(MemoryBuffer& msg, SharedPtr<LatestDataHistory>& history, HashMap<unsigned, unsigned char>& acks,
+        HashSet<unsigned>& nacks, unsigned id);
+    /// Return the sent latest data snapshots of a replicated component, or null if none.
+    LatestDataHistory* GetComponentLatestDataHistory(unsigned componentID);
+    /// Erase the latest data histories of a node, its components and its child nodes recursively. Called before the node is removed.
+    void RemoveLatestDataHistory(Node* node);
+    /// Buffer a message to be sent by SendBufferedMessages().
+    void BufferMessage(int msgID, bool reliable, bool inOrder, const VectorBuffer& msg, unsigned contentID = 0);
+    /// Find the nodes in the area of interest. Remove the replicated nodes which left it and mark the nodes which entered it dirty.
+    void UpdateInterest();
+    /// Mark the nodes which a node depends on as required, if they are outside the area of interest. Recurses to their dependencies.
+    void RequireDependencyNodes(Node* node);
+    /// Return whether a node is in the area of interest, or required by a replicated node in it.
+    bool IsInInterest(Node* node) const;
+    /// Process the dirty nodes which a node depends on. Queues the dependencies outside the area of interest if they have not been replicated.
+    void ProcessDependencyNodes(Node* node);
     /// Process a node for sending a network update. Recurses to process depended on node(s) first.
     void ProcessNode(unsigned nodeID);
     /// Process a node that the client has not yet received.
@@ -281,13 +312,35 @@ private:
     /// Ongoing package send transfers.
     HashMap<StringHash, PackageUpload> uploads_;
     /// Pending latest data for not yet received nodes.
-    HashMap<unsigned, PODVector<unsigned char> > nodeLatestData_;
+    FlatHashMap<unsigned, PODVector<unsigned char> > nodeLatestData_;
     /// Pending latest data for not yet received components.
-    HashMap<unsigned, PODVector<unsigned char> > componentLatestData_;
+    FlatHashMap<unsigned, PODVector<unsigned char> > componentLatestData_;
+    /// Received latest data snapshots of nodes, used as delta compression baselines.
+    HashMap<unsigned, SharedPtr<LatestDataHistory> > nodeLatestDataHistory_;
+    /// Received latest data snapshots of components, used as delta compression baselines.
+    HashMap<unsigned, SharedPtr<LatestDataHistory> > componentLatestDataHistory_;
+    /// Node latest data sequence numbers to acknowledge with the next client update.
+    HashMap<unsigned, unsigned char> nodeLatestDataAcks_;
+    /// Component latest data sequence numbers to acknowledge with the next client update.
+    HashMap<unsigned, unsigned char> componentLatestDataAcks_;
+    /// Node ID's whose latest data delta baseline was missing, to report with the next client update.
+    HashSet<unsigned> nodeLatestDataNacks_;
+    /// Component ID's whose latest data delta baseline was missing, to report with the next client update.
+    HashSet<unsigned> componentLatestDataNacks_;
     /// Node ID's to process during a replication update.
     HashSet<unsigned> nodesToProcess_;
     /// Reusable message buffer.
     VectorBuffer msg_;
+    /// Scene update messages waiting to be sent.
+    VectorBuffer bufferedMessages_;
+    /// Reusable buffer for an uncompressed latest data snapshot.
+    VectorBuffer latestDataMsg_;
+    /// Reusable buffer for a decoded latest data snapshot.
+    PODVector<unsigned char> latestDataSnapshot_;
+    /// Reusable buffer for delta encoding.
+    PODVector<unsigned char> deltaBuffer_;
+    /// Reusable buffer for compression.
+    PODVector<unsigned char> compressBuffer_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
     /// Scene file to load once all packages (if any) have been downloaded.
@@ -304,6 +357,14 @@ private:
     Quaternion rotation_;
     /// Send mode for the observer position & rotation.
     ObserverPositionSendMode sendMode_;
+    /// Root-level node ID's in the area of interest.
+    HashSet<unsigned> interestNodes_;
+    /// Node ID's outside the area of interest which replicated nodes depend on, for example as parent or through component node references.
+    HashSet<unsigned> requiredNodes_;
+    /// Child nodes of a node which entered the area of interest.
+    PODVector<Node*> interestChildren_;
+    /// Area of interest radius.
+    float interestRadius_;
     /// Client connection flag.
     bool isClient_;
     /// Connection pending flag.
@@ -0,0 +1,115 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Network/InterestGrid.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+InterestGrid::InterestGrid() :
+    cellSize_(1.0f)
+{
+}
+
+void InterestGrid::Build(Scene* scene, float cellSize)
+{
+    for (HashMap<IntVector3, PODVector<InterestGridEntry> >::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+        i->second_.Clear();
+
+    // If the cell size changes, the old cells are useless
+    cellSize = Max(cellSize, M_EPSILON);
+    if (cellSize != cellSize_)
+    {
+        cells_.Clear();
+        cellSize_ = cellSize;
+    }
+
+    if (!scene)
+        return;
+
+    // Child nodes follow their root-level ancestor, so only the root level needs to be stored
+    const Vector<SharedPtr<Node> >& children = scene->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+    {
+        InterestGridEntry entry;
+        entry.nodeID_ = (*i)->GetID();
+        entry.position_ = (*i)->GetWorldPosition();
+        cells_[GetCell(entry.position_)].Push(entry);
+    }
+}
+
+void InterestGrid::GetNodes(HashSet<unsigned>& dest, const Vector3& position, float radius) const
+{
+    IntVector3 minCell = GetCell(position - Vector3(radius, radius, radius));
+    IntVector3 maxCell = GetCell(position + Vector3(radius, radius, radius));
+    float radiusSquared = radius * radius;
+
+    // If the query covers more cells than there are occupied, it is cheaper to check all of them
+    float numQueryCells = (float)(maxCell.x_ - minCell.x_ + 1) * (float)(maxCell.y_ - minCell.y_ + 1) *
+        (float)(maxCell.z_ - minCell.z_ + 1);
+    if (numQueryCells > (float)cells_.Size())
+    {
+        for (HashMap<IntVector3, PODVector<InterestGridEntry> >::ConstIterator i = cells_.Begin(); i != cells_.End(); ++i)
+        {
+            const PODVector<InterestGridEntry>& entries = i->second_;
+            for (PODVector<InterestGridEntry>::ConstIterator j = entries.Begin(); j != entries.End(); ++j)
+            {
+                if ((j->position_ - position).LengthSquared() <= radiusSquared)
+                    dest.Insert(j->nodeID_);
+            }
+        }
+        return;
+    }
+
+    for (int z = minCell.z_; z <= maxCell.z_; ++z)
+    {
+        for (int y = minCell.y_; y <= maxCell.y_; ++y)
+        {
+            for (int x = minCell.x_; x <= maxCell.x_; ++x)
+            {
+                HashMap<IntVector3, PODVector<InterestGridEntry> >::ConstIterator i = cells_.Find(IntVector3(x, y, z));
+                if (i == cells_.End())
+                    continue;
+
+                const PODVector<InterestGridEntry>& entries = i->second_;
+                for (PODVector<InterestGridEntry>::ConstIterator j = entries.Begin(); j != entries.End(); ++j)
+                {
+                    if ((j->position_ - position).LengthSquared() <= radiusSquared)
+                        dest.Insert(j->nodeID_);
+                }
+            }
+        }
+    }
+}
+
+IntVector3 InterestGrid::GetCell(const Vector3& position) const
+{
+    return IntVector3(FloorToInt(position.x_ / cellSize_), FloorToInt(position.y_ / cellSize_), FloorToInt(position.z_ / cellSize_));
+}
+
+}
@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Container/HashSet.h"
+#include "../Math/Vector3.h"
+
+namespace Urho3D
+{
+
+class Scene;
+
+/// Node entry in an interest grid cell.
+struct InterestGridEntry
+{
+    /// Node ID.
+    unsigned nodeID_;
+    /// World position of the node.
+    Vector3 position_;
+};
+
+/// Uniform grid of a scene's root-level nodes for area of interest queries in scene replication.
+class URHO3D_API InterestGrid
+{
+public:
+    /// Construct.
+    InterestGrid();
+
+    /// Rebuild from the current world positions of the scene's root-level child nodes.
+    void Build(Scene* scene, float cellSize);
+    /// Collect the IDs of nodes within radius of a position. Is thread-safe while the grid is not being rebuilt.
+    void GetNodes(HashSet<unsigned>& dest, const Vector3& position, float radius) const;
+
+    /// Return cell size.
+    float GetCellSize() const { return cellSize_; }
+
+private:
+    /// Return the cell coordinates for a position.
+    IntVector3 GetCell(const Vector3& position) const;
+
+    /// Cells with their node entries. Emptied cells are retained to avoid reallocation on rebuild.
+    HashMap<IntVector3, PODVector<InterestGridEntry> > cells_;
+    /// Cell size.
+    float cellSize_;
+};
+
+}
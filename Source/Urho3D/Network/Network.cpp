@@ -24,7 +24,9 @@
 
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
+#include "../Core/FrameAllocator.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Engine/EngineEvents.h"
 #include "../IO/FileSystem.h"
 #include "../Input/InputEvents.h"
@@ -45,10 +47,23 @@
 namespace Urho3D
 {
 
+/// Server update functor for building the connections' scene updates in parallel.
+struct BuildServerUpdateFunctor
+{
+    /// Build the updates of a range of connections.
+    void operator ()(Connection** start, Connection** end, unsigned threadIndex)
+    {
+        while (start != end)
+            (*start++)->BuildServerUpdate();
+    }
+};
+
 static const int DEFAULT_UPDATE_FPS = 30;
+static const float DEFAULT_INTEREST_CELL_SIZE = 50.0f;
 
 Network::Network(Context* context) :
     Object(context),
+    interestCellSize_(DEFAULT_INTEREST_CELL_SIZE),
     updateFps_(DEFAULT_UPDATE_FPS),
     simulatedLatency_(0),
     simulatedPacketLoss_(0.0f),
@@ -339,6 +354,11 @@ void Network::SetUpdateFps(int fps)
     updateAcc_ = 0.0f;
 }
 
+void Network::SetInterestCellSize(float size)
+{
+    interestCellSize_ = Max(size, M_EPSILON);
+}
+
 void Network::SetSimulatedLatency(int ms)
 {
     simulatedLatency_ = Max(ms, 0);
@@ -447,6 +467,12 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
     return allowedRemoteEvents_.Contains(eventType);
 }
 
+const InterestGrid* Network::GetInterestGrid(Scene* scene) const
+{
+    HashMap<Scene*, InterestGrid>::ConstIterator i = interestGrids_.Find(scene);
+    return i != interestGrids_.End() ? &i->second_ : 0;
+}
+
 void Network::Update(float timeStep)
 {
     URHO3D_PROFILE(UpdateNetwork);
@@ -511,14 +537,35 @@ void Network::PostUpdate(float timeStep)
                     (*i)->PrepareNetworkUpdate();
             }
 
+            UpdateInterestGrids();
+
+            {
+                URHO3D_PROFILE(BuildServerUpdate);
+
+                // Then build the server updates for each client connection. The scenes are not modified meanwhile, so
+                // the connections can be processed in parallel
+                updateConnections_.Clear();
+                for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+                     i != clientConnections_.End(); ++i)
+                    updateConnections_.Push(i->second_);
+
+                BuildServerUpdateFunctor buildServerUpdate;
+                WorkQueue* queue = GetSubsystem<WorkQueue>();
+                if (queue)
+                    queue->ParallelFor(updateConnections_.Buffer(), updateConnections_.Buffer() + updateConnections_.Size(), 1,
+                        buildServerUpdate);
+                else
+                    buildServerUpdate(updateConnections_.Buffer(), updateConnections_.Buffer() + updateConnections_.Size(), 0);
+            }
+
             {
                 URHO3D_PROFILE(SendServerUpdate);
 
-                // Then send server updates for each client connection
+                // Send the built updates from the main thread
                 for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
                      i != clientConnections_.End(); ++i)
                 {
-                    i->second_->SendServerUpdate();
+                    i->second_->SendBufferedMessages();
                     i->second_->SendRemoteEvents();
                     i->second_->SendPackages();
                 }
@@ -583,6 +630,32 @@ void Network::OnServerDisconnected()
     }
 }
 
+void Network::UpdateInterestGrids()
+{
+    URHO3D_PROFILE(UpdateInterestGrids);
+
+    FrameVector<Scene*> interestScenes(GetFrameArena(context_));
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::ConstIterator i = clientConnections_.Begin();
+         i != clientConnections_.End(); ++i)
+    {
+        Scene* scene = i->second_->GetScene();
+        if (scene && i->second_->GetInterestRadius() > 0.0f && !interestScenes.Contains(scene))
+            interestScenes.Push(scene);
+    }
+
+    // Drop the grids of scenes which no longer need them
+    for (HashMap<Scene*, InterestGrid>::Iterator i = interestGrids_.Begin(); i != interestGrids_.End();)
+    {
+        if (!interestScenes.Contains(i->first_))
+            i = interestGrids_.Erase(i);
+        else
+            ++i;
+    }
+
+    for (unsigned i = 0; i < interestScenes.Size(); ++i)
+        interestGrids_[interestScenes[i]].Build(interestScenes[i], interestCellSize_);
+}
+
 void Network::ConfigureNetworkSimulator()
 {
     if (serverConnection_)
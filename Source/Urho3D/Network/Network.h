@@ -26,6 +26,7 @@
 #include "../Core/Object.h"
 #include "../IO/VectorBuffer.h"
 #include "../Network/Connection.h"
+#include "../Network/InterestGrid.h"
 
 #include <kNet/IMessageHandler.h>
 #include <kNet/INetworkServerListener.h>
@@ -87,6 +88,8 @@ public:
         (Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
     /// Set network update FPS.
     void SetUpdateFps(int fps);
+    /// Set the cell size of the grid used for the client connections' area of interest queries.
+    void SetInterestCellSize(float size);
     /// Set simulated latency in milliseconds. This adds a fixed delay before sending each packet.
     void SetSimulatedLatency(int ms);
     /// Set simulated packet loss probability between 0.0 - 1.0.
@@ -109,6 +112,9 @@ public:
     /// Return network update FPS.
     int GetUpdateFps() const { return updateFps_; }
 
+    /// Return the cell size of the area of interest grid.
+    float GetInterestCellSize() const { return interestCellSize_; }
+
     /// Return simulated latency in milliseconds.
     int GetSimulatedLatency() const { return simulatedLatency_; }
 
@@ -125,6 +131,8 @@ public:
     bool IsServerRunning() const;
     /// Return whether a remote event is allowed to be received.
     bool CheckRemoteEvent(StringHash eventType) const;
+    /// Return the area of interest grid of a networked scene, or null if no client connection in the scene uses an area of interest. Called by Connection.
+    const InterestGrid* GetInterestGrid(Scene* scene) const;
 
     /// Return the package download cache directory.
     const String& GetPackageCacheDir() const { return packageCacheDir_; }
@@ -145,6 +153,8 @@ private:
     void OnServerDisconnected();
     /// Reconfigure network simulator parameters on all existing connections.
     void ConfigureNetworkSimulator();
+    /// Rebuild the area of interest grids of the networked scenes which need them.
+    void UpdateInterestGrids();
 
     /// kNet instance.
     UniquePtr<kNet::Network> network_;
@@ -158,6 +168,12 @@ private:
     HashSet<StringHash> blacklistedRemoteEvents_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
+    /// Client connections to build the server update for.
+    PODVector<Connection*> updateConnections_;
+    /// Area of interest grids of the networked scenes.
+    HashMap<Scene*, InterestGrid> interestGrids_;
+    /// Area of interest grid cell size.
+    float interestCellSize_;
     /// Update FPS.
     int updateFps_;
     /// Simulated latency (send delay) in milliseconds.
@@ -63,6 +63,8 @@ static const int MSG_REMOTEEVENT = 0x14;
 static const int MSG_REMOTENODEEVENT = 0x15;
 /// Server->client: info about package.
 static const int MSG_PACKAGEINFO = 0x16;
+/// Client->server: acknowledge received latest data snapshots, which the server may then use as delta compression baselines, and report objects whose baseline was missing.
+static const int MSG_LATESTDATAACK = 0x17;
 
 /// Fixed content ID for client controls update.
 static const unsigned CONTROLS_CONTENT_ID = 1;
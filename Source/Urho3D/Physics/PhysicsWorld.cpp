@@ -36,6 +36,7 @@
 #include "../Physics/PhysicsWorld.h"
 #include "../Physics/RaycastVehicle.h"
 #include "../Physics/RigidBody.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 
@@ -807,6 +808,11 @@ void PhysicsWorld::PreStep(float timeStep)
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPRESTEP, eventData);
 
+    // Update thread-safe logic components
+    Scene* scene = GetScene();
+    if (scene)
+        scene->UpdateThreadedLogic(USE_FIXEDUPDATE, timeStep);
+
     // Start profiling block for the actual simulation step
 #ifdef URHO3D_PROFILING
     Profiler* profiler = GetSubsystem<Profiler>();
@@ -832,15 +838,19 @@ void PhysicsWorld::PostStep(float timeStep)
     eventData[P_WORLD] = this;
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPOSTSTEP, eventData);
+
+    Scene* scene = GetScene();
+    if (scene)
+        scene->UpdateThreadedLogic(USE_FIXEDPOSTUPDATE, timeStep);
 }
 
 void PhysicsWorld::SendCollisionEvents()
 {
     URHO3D_PROFILE(SendCollisionEvents);
 
+    // The event data maps are not cleared, as every event sets all their parameters. This way the contact buffers keep their
+    // memory between frames
     currentCollisions_.Clear();
-    physicsCollisionData_.Clear();
-    nodeCollisionData_.Clear();
 
     int numManifolds = collisionDispatcher_->getNumManifolds();
 
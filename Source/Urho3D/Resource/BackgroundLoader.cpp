@@ -25,6 +25,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
 #include "../IO/Log.h"
 #include "../Resource/BackgroundLoader.h"
@@ -36,76 +37,134 @@
 namespace Urho3D
 {
 
+/// Resource loader thread managed by the background loader.
+class BackgroundLoaderThread : public Thread, public RefCounted
+{
+public:
+    /// Construct.
+    BackgroundLoaderThread(BackgroundLoader* owner) :
+        owner_(owner)
+    {
+    }
+
+    /// Load queued resources until stopped.
+    virtual void ThreadFunction()
+    {
+        while (shouldRun_)
+        {
+            if (!owner_->LoadNextResource())
+                Time::Sleep(5);
+        }
+    }
+
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+};
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    numThreads_(Clamp((int)GetNumLogicalCPUs() - 1, 1, 4))
 {
 }
 
 BackgroundLoader::~BackgroundLoader()
 {
+    // Stop the threads before the queue they operate on goes away
+    threads_.Clear();
+
     MutexLock lock(backgroundLoadMutex_);
 
     backgroundLoadQueue_.Clear();
+    loadOrder_.Clear();
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoader::SetNumThreads(unsigned num)
 {
-    while (shouldRun_)
-    {
-        backgroundLoadMutex_.Acquire();
+    numThreads_ = Max(num, 1U);
 
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
+    // If already running, adjust now. Otherwise the threads are started on demand
+    if (threads_.Size())
+        UpdateThreads();
+}
+
+bool BackgroundLoader::LoadNextResource()
+{
+    backgroundLoadMutex_.Acquire();
+
+    // Take the next resource that has not been loaded yet. Resources already loaded through WaitForResource() are skipped
+    BackgroundLoadItem* item = 0;
+    while (!loadOrder_.Empty())
+    {
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(loadOrder_.Front());
+        loadOrder_.PopFront();
+        if (i != backgroundLoadQueue_.End() && i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
         {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
+            item = &i->second_;
+            break;
         }
+    }
+
+    if (!item)
+    {
+        backgroundLoadMutex_.Release();
+        return false;
+    }
+
+    // Claim the resource while holding the mutex so that no other thread takes it
+    item->resource_->SetAsyncLoadState(ASYNC_LOADING);
+    backgroundLoadMutex_.Release();
 
-        if (i == backgroundLoadQueue_.End())
+    LoadResource(*item);
+    return true;
+}
+
+void BackgroundLoader::LoadResource(BackgroundLoadItem& item)
+{
+    // We can be sure that the item is not removed from the queue as long as it is in the "loading" state
+    Resource* resource = item.resource_;
+    HiresTimer loadTimer;
+    bool success = false;
+    SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+    if (file)
+        success = resource->BeginLoad(*file);
+    long long loadTime = loadTimer.GetUSec(false);
+
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    MutexLock lock(backgroundLoadMutex_);
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End(); ++i)
         {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
-        else
-        {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
-                     i != item.dependents_.End(); ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
+        item.dependents_.Clear();
+    }
 
-                item.dependents_.Clear();
-            }
+    stats_[resource->GetType()].beginLoadTime_ += loadTime;
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+}
+
+void BackgroundLoader::UpdateThreads()
+{
+    // Removing a thread stops it after it has finished the resource it is loading
+    if (threads_.Size() > numThreads_)
+        threads_.Resize(numThreads_);
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+    while (threads_.Size() < numThreads_)
+    {
+        SharedPtr<BackgroundLoaderThread> thread(new BackgroundLoaderThread(this));
+        if (!thread->Run())
+        {
+            URHO3D_LOGERROR("Failed to start background loader thread");
+            break;
         }
+        threads_.Push(thread);
     }
 }
 
@@ -148,6 +207,7 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
     item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
 
     // If this is a resource calling for the background load of more resources, mark the dependency as necessary
+    bool isDependency = false;
     if (caller)
     {
         Pair<StringHash, StringHash> callerKey = MakePair(caller->GetType(), caller->GetNameHash());
@@ -157,15 +217,22 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
             BackgroundLoadItem& callerItem = j->second_;
             item.dependents_.Insert(callerKey);
             callerItem.dependencies_.Insert(key);
+            isDependency = true;
         }
         else
             URHO3D_LOGWARNING("Resource " + caller->GetName() +
                        " requested for a background loaded resource but was not in the background load queue");
     }
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    // Dependencies are loaded before other queued resources, as their dependents can not finish until they are done
+    if (isDependency)
+        loadOrder_.PushFront(key);
+    else
+        loadOrder_.Push(key);
+
+    // Start the background loader threads now
+    if (threads_.Empty())
+        UpdateThreads();
 
     return true;
 }
@@ -179,8 +246,15 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
     if (i != backgroundLoadQueue_.End())
     {
+        // If no loader thread has taken the resource yet, load it here instead of waiting for one to become free
+        bool loadHere = i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED;
+        if (loadHere)
+            i->second_.resource_->SetAsyncLoadState(ASYNC_LOADING);
         backgroundLoadMutex_.Release();
 
+        if (loadHere)
+            LoadResource(i->second_);
+
         {
             Resource* resource = i->second_.resource_;
             HiresTimer waitTimer;
@@ -217,7 +291,7 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    if (threads_.Size())
     {
         HiresTimer timer;
 
@@ -250,20 +324,34 @@ void BackgroundLoader::FinishResources(int maxMs)
     }
 }
 
+void BackgroundLoader::ResetStats()
+{
+    MutexLock lock(backgroundLoadMutex_);
+    stats_.Clear();
+}
+
 unsigned BackgroundLoader::GetNumQueuedResources() const
 {
     MutexLock lock(backgroundLoadMutex_);
     return backgroundLoadQueue_.Size();
 }
 
+HashMap<StringHash, BackgroundLoadStats> BackgroundLoader::GetStats() const
+{
+    MutexLock lock(backgroundLoadMutex_);
+    return stats_;
+}
+
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 {
     Resource* resource = item.resource_;
 
     bool success = resource->GetAsyncLoadState() == ASYNC_SUCCESS;
+    long long finishTime = 0;
     // If BeginLoad() phase was successful, call EndLoad() and get the final success/failure result
     if (success)
     {
+        HiresTimer finishTimer;
 #ifdef URHO3D_PROFILING
         String profileBlockName("Finish" + resource->GetTypeName());
 
@@ -273,6 +361,7 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 #endif
         URHO3D_LOGDEBUG("Finishing background loaded resource " + resource->GetName());
         success = resource->EndLoad();
+        finishTime = finishTimer.GetUSec(false);
 
 #ifdef URHO3D_PROFILING
         if (profiler)
@@ -281,6 +370,16 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     }
     resource->SetAsyncLoadState(ASYNC_DONE);
 
+    {
+        MutexLock lock(backgroundLoadMutex_);
+        BackgroundLoadStats& stats = stats_[resource->GetType()];
+        stats.endLoadTime_ += finishTime;
+        if (success)
+            ++stats.numLoaded_;
+        else
+            ++stats.numFailed_;
+    }
+
     if (!success && item.sendEventOnFailure_)
     {
         using namespace LoadFailed;
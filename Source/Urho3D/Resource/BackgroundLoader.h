@@ -24,6 +24,7 @@
 
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
+#include "../Container/List.h"
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
 #include "../Container/RefCounted.h"
@@ -33,6 +34,7 @@
 namespace Urho3D
 {
 
+class BackgroundLoaderThread;
 class Resource;
 class ResourceCache;
 
@@ -49,19 +51,42 @@ struct BackgroundLoadItem
     bool sendEventOnFailure_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+/// Background loading timing statistics of one resource type.
+struct BackgroundLoadStats
 {
+    /// Construct.
+    BackgroundLoadStats() :
+        numLoaded_(0),
+        numFailed_(0),
+        beginLoadTime_(0),
+        endLoadTime_(0)
+    {
+    }
+
+    /// Number of resources loaded successfully.
+    unsigned numLoaded_;
+    /// Number of resources that failed to load.
+    unsigned numFailed_;
+    /// Total time in microseconds spent opening files and in BeginLoad() on the loader threads.
+    long long beginLoadTime_;
+    /// Total time in microseconds spent in EndLoad() on the main thread.
+    long long endLoadTime_;
+};
+
+/// Background loader of resources. Owned by the ResourceCache. Runs BeginLoad() of queued resources in a pool of loader threads, and finishes them with EndLoad() in the main thread.
+class BackgroundLoader : public RefCounted
+{
+    friend class BackgroundLoaderThread;
+
 public:
     /// Construct.
     BackgroundLoader(ResourceCache* owner);
 
-    /// Destruct. Forcibly clear the load queue.
+    /// Destruct. Stop the loader threads and forcibly clear the load queue.
     ~BackgroundLoader();
 
-    /// Resource background loading loop.
-    virtual void ThreadFunction();
-
+    /// Set number of loader threads. Threads are started on the first background load request.
+    void SetNumThreads(unsigned num);
     /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
     bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
     /// Wait and finish possible loading of a resource when being requested from the cache.
@@ -69,10 +94,23 @@ public:
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
 
+    /// Reset the timing statistics.
+    void ResetStats();
+
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
+    /// Return timing statistics per resource type.
+    HashMap<StringHash, BackgroundLoadStats> GetStats() const;
 
 private:
+    /// Take the next queued resource and run its BeginLoad(). Called from the loader threads. Return false if nothing to load.
+    bool LoadNextResource();
+    /// Run BeginLoad() of a resource that has been claimed for loading, then resolve its dependents.
+    void LoadResource(BackgroundLoadItem& item);
+    /// Start or stop loader threads to match the requested count.
+    void UpdateThreads();
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
@@ -82,6 +120,14 @@ private:
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Keys of resources waiting for a loader thread. Dependencies of other resources are at the front, so that their dependents can be finished sooner.
+    List<Pair<StringHash, StringHash> > loadOrder_;
+    /// Timing statistics per resource type.
+    HashMap<StringHash, BackgroundLoadStats> stats_;
+    /// Loader threads.
+    Vector<SharedPtr<BackgroundLoaderThread> > threads_;
+    /// Requested number of loader threads.
+    unsigned numThreads_;
 };
 
 }
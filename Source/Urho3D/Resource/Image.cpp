@@ -2128,6 +2128,11 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
+    // Decode in place if the source is in memory, such as a file in a memory-mapped package
+    const unsigned char* directData = source.GetDirectData();
+    if (directData)
+        return stbi_load_from_memory(directData, dataSize, &width, &height, (int*)&components, 0);
+
     SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.Get(), dataSize);
     return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int*)&components, 0);
@@ -175,6 +175,7 @@ bool ResourceCache::AddManualResource(Resource* resource)
     }
 
     resource->ResetUseTimer();
+    MutexLock lock(resourceMutex_);
     resourceGroups_[resource->GetType()].resources_[resource->GetNameHash()] = resource;
     UpdateResourceGroup(resource->GetType());
     return true;
@@ -246,12 +247,13 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
 void ResourceCache::ReleaseResource(StringHash type, const String& name, bool force)
 {
     StringHash nameHash(name);
-    const SharedPtr<Resource>& existingRes = FindResource(type, nameHash);
+    MutexLock lock(resourceMutex_);
+    Resource* existingRes = FindResource(type, nameHash);
     if (!existingRes)
         return;
 
-    // If other references exist, do not release, unless forced
-    if ((existingRes.Refs() == 1 && existingRes.WeakRefs() == 0) || force)
+    // If other references exist, do not release, unless forced. The cache holds one reference
+    if ((existingRes->Refs() == 1 && existingRes->WeakRefs() == 0) || force)
     {
         resourceGroups_[type].resources_.Erase(nameHash);
         UpdateResourceGroup(type);
@@ -260,21 +262,23 @@ void ResourceCache::ReleaseResource(StringHash type, const String& name, bool fo
 
 void ResourceCache::ReleaseResources(StringHash type, bool force)
 {
+    MutexLock lock(resourceMutex_);
     bool released = false;
 
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
              j != i->second_.resources_.End();)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
             // If other references exist, do not release, unless forced
-            if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
+            if ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) || force)
             {
-                i->second_.resources_.Erase(current);
+                j = i->second_.resources_.Erase(j);
                 released = true;
             }
+            else
+                ++j;
         }
     }
 
@@ -284,24 +288,24 @@ void ResourceCache::ReleaseResources(StringHash type, bool force)
 
 void ResourceCache::ReleaseResources(StringHash type, const String& partialName, bool force)
 {
+    MutexLock lock(resourceMutex_);
     bool released = false;
 
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
              j != i->second_.resources_.End();)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
-            if (current->second_->GetName().Contains(partialName))
+            // If other references exist, do not release, unless forced
+            if (j->second_->GetName().Contains(partialName) &&
+                ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) || force))
             {
-                // If other references exist, do not release, unless forced
-                if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
-                {
-                    i->second_.resources_.Erase(current);
-                    released = true;
-                }
+                j = i->second_.resources_.Erase(j);
+                released = true;
             }
+            else
+                ++j;
         }
     }
 
@@ -314,6 +318,7 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
     // Some resources refer to others, like materials to textures. Release twice to ensure these get released.
     // This is not necessary if forcing release
     unsigned repeat = force ? 1 : 2;
+    MutexLock lock(resourceMutex_);
 
     while (repeat--)
     {
@@ -321,19 +326,18 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
         {
             bool released = false;
 
-            for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+            for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
                  j != i->second_.resources_.End();)
             {
-                HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
-                if (current->second_->GetName().Contains(partialName))
+                // If other references exist, do not release, unless forced
+                if (j->second_->GetName().Contains(partialName) &&
+                    ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) || force))
                 {
-                    // If other references exist, do not release, unless forced
-                    if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
-                    {
-                        i->second_.resources_.Erase(current);
-                        released = true;
-                    }
+                    j = i->second_.resources_.Erase(j);
+                    released = true;
                 }
+                else
+                    ++j;
             }
             if (released)
                 UpdateResourceGroup(i->first_);
@@ -344,6 +348,7 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
 void ResourceCache::ReleaseAllResources(bool force)
 {
     unsigned repeat = force ? 1 : 2;
+    MutexLock lock(resourceMutex_);
 
     while (repeat--)
     {
@@ -352,16 +357,17 @@ void ResourceCache::ReleaseAllResources(bool force)
         {
             bool released = false;
 
-            for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+            for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
                  j != i->second_.resources_.End();)
             {
-                HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
                 // If other references exist, do not release, unless forced
-                if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
+                if ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) || force)
                 {
-                    i->second_.resources_.Erase(current);
+                    j = i->second_.resources_.Erase(j);
                     released = true;
                 }
+                else
+                    ++j;
             }
             if (released)
                 UpdateResourceGroup(i->first_);
@@ -398,8 +404,9 @@ bool ResourceCache::ReloadResource(Resource* resource)
 void ResourceCache::ReloadResourceWithDependencies(const String& fileName)
 {
     StringHash fileNameHash(fileName);
-    // If the filename is a resource we keep track of, reload it
-    const SharedPtr<Resource>& resource = FindResource(fileNameHash);
+    // If the filename is a resource we keep track of, reload it. Hold a reference of our own, as reloading may modify the
+    // resource storage
+    SharedPtr<Resource> resource = FindResource(fileNameHash);
     if (resource)
     {
         URHO3D_LOGDEBUG("Reloading changed resource " + fileName);
@@ -419,7 +426,7 @@ void ResourceCache::ReloadResourceWithDependencies(const String& fileName)
 
             for (HashSet<StringHash>::ConstIterator k = j->second_.Begin(); k != j->second_.End(); ++k)
             {
-                const SharedPtr<Resource>& dependent = FindResource(*k);
+                SharedPtr<Resource> dependent = FindResource(*k);
                 if (dependent)
                     dependents.Push(dependent);
             }
@@ -435,6 +442,7 @@ void ResourceCache::ReloadResourceWithDependencies(const String& fileName)
 
 void ResourceCache::SetMemoryBudget(StringHash type, unsigned long long budget)
 {
+    MutexLock lock(resourceMutex_);
     resourceGroups_[type].memoryBudget_ = budget;
 }
 
@@ -555,8 +563,7 @@ Resource* ResourceCache::GetExistingResource(StringHash type, const String& name
 
     StringHash nameHash(name);
 
-    const SharedPtr<Resource>& existing = FindResource(type, nameHash);
-    return existing;
+    return FindResource(type, nameHash);
 }
 
 Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool sendEventOnFailure)
@@ -580,7 +587,7 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     backgroundLoader_->WaitForResource(type, nameHash);
 #endif
 
-    const SharedPtr<Resource>& existing = FindResource(type, nameHash);
+    SharedPtr<Resource> existing = FindResource(type, nameHash);
     if (existing)
         return existing;
 
@@ -627,8 +634,9 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
             return 0;
     }
 
-    // Store to cache
+    // Store to cache. Lock, as the background loader threads may look up resources meanwhile
     resource->ResetUseTimer();
+    MutexLock lock(resourceMutex_);
     resourceGroups_[type].resources_[nameHash] = resource;
     UpdateResourceGroup(type);
 
@@ -645,7 +653,7 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
 
     // First check if already exists as a loaded resource
     StringHash nameHash(name);
-    if (FindResource(type, nameHash) != noResource)
+    if (HasResource(type, nameHash))
         return false;
 
     return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller);
@@ -717,13 +725,45 @@ unsigned ResourceCache::GetNumBackgroundLoadResources() const
 #endif
 }
 
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetNumThreads(num);
+#endif
+}
+
+void ResourceCache::ResetBackgroundLoadStats()
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->ResetStats();
+#endif
+}
+
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetNumThreads();
+#else
+    return 0;
+#endif
+}
+
+HashMap<StringHash, BackgroundLoadStats> ResourceCache::GetBackgroundLoadStats() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetStats();
+#else
+    return HashMap<StringHash, BackgroundLoadStats>();
+#endif
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, StringHash type) const
 {
     result.Clear();
     HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
-        for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = i->second_.resources_.Begin();
              j != i->second_.resources_.End(); ++j)
             result.Push(j->second_);
     }
@@ -932,7 +972,7 @@ String ResourceCache::PrintMemoryUsage() const
         else
             average = 0;
         unsigned long long largest = 0;
-        for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator resIt = cit->second_.resources_.Begin(); resIt != cit->second_.resources_.End(); ++resIt)
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::ConstIterator resIt = cit->second_.resources_.Begin(); resIt != cit->second_.resources_.End(); ++resIt)
         {
             if (resIt->second_->GetMemoryUse() > largest)
                 largest = resIt->second_->GetMemoryUse();
@@ -972,27 +1012,57 @@ String ResourceCache::PrintMemoryUsage() const
     return output;
 }
 
-const SharedPtr<Resource>& ResourceCache::FindResource(StringHash type, StringHash nameHash)
+String ResourceCache::PrintBackgroundLoadStats() const
+{
+    String output = "Resource Type                 Cnt    Failed  Load ms  Finish ms  Avg load ms\n\n";
+    char outputLine[256];
+
+    HashMap<StringHash, BackgroundLoadStats> stats = GetBackgroundLoadStats();
+    for (HashMap<StringHash, BackgroundLoadStats>::ConstIterator i = stats.Begin(); i != stats.End(); ++i)
+    {
+        const BackgroundLoadStats& typeStats = i->second_;
+        unsigned count = typeStats.numLoaded_ + typeStats.numFailed_;
+        float loadMs = typeStats.beginLoadTime_ / 1000.0f;
+        float finishMs = typeStats.endLoadTime_ / 1000.0f;
+        float averageMs = count ? (loadMs + finishMs) / count : 0.0f;
+
+        sprintf(outputLine, "%-28s %4u %9u %8.1f %10.1f %12.2f\n", context_->GetTypeName(i->first_).CString(), count,
+            typeStats.numFailed_, loadMs, finishMs, averageMs);
+        output += ((const char*)outputLine);
+    }
+
+    return output;
+}
+
+SharedPtr<Resource> ResourceCache::FindResource(StringHash type, StringHash nameHash)
 {
     MutexLock lock(resourceMutex_);
 
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
         return noResource;
-    HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
+    FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
     if (j == i->second_.resources_.End())
         return noResource;
 
     return j->second_;
 }
 
-const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
+bool ResourceCache::HasResource(StringHash type, StringHash nameHash) const
+{
+    MutexLock lock(resourceMutex_);
+
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() && i->second_.resources_.Contains(nameHash);
+}
+
+SharedPtr<Resource> ResourceCache::FindResource(StringHash nameHash)
 {
     MutexLock lock(resourceMutex_);
 
     for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
     {
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
+        FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
         if (j != i->second_.resources_.End())
             return j->second_;
     }
@@ -1012,7 +1082,7 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
         // We do not know the actual resource type, so search all type containers
         for (HashMap<StringHash, ResourceGroup>::Iterator j = resourceGroups_.Begin(); j != resourceGroups_.End(); ++j)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator k = j->second_.resources_.Find(nameHash);
+            FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator k = j->second_.resources_.Find(nameHash);
             if (k != j->second_.resources_.End())
             {
                 // If other references exist, do not release, unless forced
@@ -1032,6 +1102,8 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 
 void ResourceCache::UpdateResourceGroup(StringHash type)
 {
+    MutexLock lock(resourceMutex_);
+
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
         return;
@@ -1040,9 +1112,9 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     {
         unsigned totalSize = 0;
         unsigned oldestTimer = 0;
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
+        FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
 
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
              j != i->second_.resources_.End(); ++j)
         {
             totalSize += j->second_->GetMemoryUse();
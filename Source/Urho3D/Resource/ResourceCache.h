@@ -22,16 +22,17 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/HashSet.h"
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
 #include "../IO/File.h"
+#include "../Resource/BackgroundLoader.h"
 #include "../Resource/Resource.h"
 
 namespace Urho3D
 {
 
-class BackgroundLoader;
 class FileWatcher;
 class PackageFile;
 
@@ -53,7 +54,7 @@ struct ResourceGroup
     /// Current memory use.
     unsigned long long memoryUse_;
     /// Resources.
-    HashMap<StringHash, SharedPtr<Resource> > resources_;
+    FlatHashMap<StringHash, SharedPtr<Resource> > resources_;
 };
 
 /// Resource request types.
@@ -128,6 +129,10 @@ public:
 
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of threads used for background loading. Default is one less than the number of logical CPUs, clamped to 1-4.
+    void SetNumBackgroundLoadThreads(unsigned num);
+    /// Reset the background loading timing statistics.
+    void ResetBackgroundLoadStats();
 
     /// Add a resource router object. By default there is none, so the routing process is skipped.
     void AddResourceRouter(ResourceRouter* router, bool addAsFirst = false);
@@ -144,6 +149,10 @@ public:
     bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
+    /// Return number of threads used for background loading.
+    unsigned GetNumBackgroundLoadThreads() const;
+    /// Return background loading timing statistics per resource type.
+    HashMap<StringHash, BackgroundLoadStats> GetBackgroundLoadStats() const;
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, StringHash type) const;
     /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist.
@@ -209,12 +218,16 @@ public:
 
     /// Returns a formatted string containing the memory actively used.
     String PrintMemoryUsage() const;
+    /// Returns a formatted string containing the background loading timing statistics.
+    String PrintBackgroundLoadStats() const;
 
 private:
-    /// Find a resource.
-    const SharedPtr<Resource>& FindResource(StringHash type, StringHash nameHash);
+    /// Find a resource. Returned by value, as loading or reloading resources may rehash the resource storage.
+    SharedPtr<Resource> FindResource(StringHash type, StringHash nameHash);
     /// Find a resource by name only. Searches all type groups.
-    const SharedPtr<Resource>& FindResource(StringHash nameHash);
+    SharedPtr<Resource> FindResource(StringHash nameHash);
+    /// Return whether a resource is loaded. Does not touch the resource's reference count, so can be called from the background loader threads.
+    bool HasResource(StringHash type, StringHash nameHash) const;
     /// Release resources loaded from a package file.
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
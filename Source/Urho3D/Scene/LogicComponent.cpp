@@ -37,7 +37,10 @@ LogicComponent::LogicComponent(Context* context) :
     Component(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
-    delayedStartCalled_(false)
+    delayedStartCalled_(false),
+    threadedUpdate_(false),
+    threadedUpdateScene_(0),
+    threadedUpdateIndex_(M_MAX_UNSIGNED)
 {
 }
 
@@ -75,6 +78,15 @@ void LogicComponent::SetUpdateEventMask(unsigned char mask)
     }
 }
 
+void LogicComponent::SetThreadedUpdate(bool enable)
+{
+    if (threadedUpdate_ != enable)
+    {
+        threadedUpdate_ = enable;
+        UpdateEventSubscription();
+    }
+}
+
 void LogicComponent::OnNodeSet(Node* node)
 {
     if (node)
@@ -102,6 +114,12 @@ void LogicComponent::OnSceneSet(Scene* scene)
         UnsubscribeFromEvent(E_PHYSICSPOSTSTEP);
 #endif
         currentEventMask_ = 0;
+
+        if (threadedUpdateScene_)
+        {
+            threadedUpdateScene_->RemoveThreadedLogicComponent(this);
+            threadedUpdateScene_ = 0;
+        }
     }
 }
 
@@ -113,6 +131,21 @@ void LogicComponent::UpdateEventSubscription()
 
     bool enabled = IsEnabledEffective();
 
+    // Thread-safe components are updated by the scene instead of events, once DelayedStart() has been called from the main thread
+    bool threaded = enabled && threadedUpdate_ && delayedStartCalled_;
+    if (threaded && !threadedUpdateScene_)
+    {
+        scene->AddThreadedLogicComponent(this);
+        threadedUpdateScene_ = scene;
+    }
+    else if (!threaded && threadedUpdateScene_)
+    {
+        threadedUpdateScene_->RemoveThreadedLogicComponent(this);
+        threadedUpdateScene_ = 0;
+    }
+
+    enabled = enabled && !threaded;
+
     bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
     if (needUpdate && !(currentEventMask_ & USE_UPDATE))
     {
@@ -178,6 +211,14 @@ void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
         DelayedStart();
         delayedStartCalled_ = true;
 
+        // If thread-safe, switch over to the scene's threaded update. It runs after the update event, so the first update
+        // will still happen on this frame
+        if (threadedUpdate_)
+        {
+            UpdateEventSubscription();
+            return;
+        }
+
         // If did not need actual update events, unsubscribe now
         if (!(updateEventMask_ & USE_UPDATE))
         {
@@ -210,6 +251,12 @@ void LogicComponent::HandlePhysicsPreStep(StringHash eventType, VariantMap& even
     {
         DelayedStart();
         delayedStartCalled_ = true;
+
+        if (threadedUpdate_)
+        {
+            UpdateEventSubscription();
+            return;
+        }
     }
 
     // Execute user-defined fixed update function
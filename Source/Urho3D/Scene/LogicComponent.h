@@ -41,6 +41,8 @@ class URHO3D_API LogicComponent : public Component
 {
     URHO3D_OBJECT(LogicComponent, Component);
 
+    friend class Scene;
+
     /// Construct.
     LogicComponent(Context* context);
     /// Destruct.
@@ -69,10 +71,15 @@ class URHO3D_API LogicComponent : public Component
 
     /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(unsigned char mask);
+    /// Set whether the update functions are thread-safe. If enabled, the scene calls Update(), PostUpdate(), FixedUpdate() and FixedPostUpdate() of all such components in parallel on the work queue threads instead of sending them the update events. DelayedStart() is still called in the main thread. The update functions may then only modify their own node and its children, and must not create or remove nodes or components, or send events. Like the update event mask, this is not an attribute and should be called eg. in the subclass constructor.
+    void SetThreadedUpdate(bool enable);
 
     /// Return what update events are subscribed to.
     unsigned char GetUpdateEventMask() const { return updateEventMask_; }
 
+    /// Return whether the update functions are thread-safe and called in parallel.
+    bool GetThreadedUpdate() const { return threadedUpdate_; }
+
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
 
@@ -101,6 +108,12 @@ private:
     unsigned char currentEventMask_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
+    /// Thread-safe update flag.
+    bool threadedUpdate_;
+    /// Scene the component is registered to for threaded updates, or null if not registered.
+    Scene* threadedUpdateScene_;
+    /// Index in the scene's threaded logic component list.
+    unsigned threadedUpdateIndex_;
 };
 
 }
@@ -26,6 +26,7 @@
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
 #include "../Container/Ptr.h"
+#include "../Container/RefCounted.h"
 #include "../Math/StringHash.h"
 
 #include <cstring>
@@ -34,6 +35,8 @@ namespace Urho3D
 {
 
 static const unsigned MAX_NETWORK_ATTRIBUTES = 64;
+/// Number of latest data snapshots remembered per object for delta compression.
+static const unsigned LATESTDATA_HISTORY_SIZE = 8;
 
 class Component;
 class Connection;
@@ -144,6 +147,51 @@ struct URHO3D_API NetworkState
     unsigned long long interceptMask_;
 };
 
+/// History of latest data snapshots sent to or received from one connection, used for delta compression.
+struct URHO3D_API LatestDataHistory : public RefCounted
+{
+    /// Construct empty.
+    LatestDataHistory() :
+        nextSequence_(0),
+        sequence_(0),
+        hasSequence_(false)
+    {
+        memset(sequences_, 0, sizeof sequences_);
+        memset(valid_, 0, sizeof valid_);
+    }
+
+    /// Store a snapshot with a sequence number.
+    void Store(unsigned char sequence, const unsigned char* data, unsigned size)
+    {
+        unsigned index = sequence % LATESTDATA_HISTORY_SIZE;
+        snapshots_[index].Resize(size);
+        if (size)
+            memcpy(&snapshots_[index][0], data, size);
+        sequences_[index] = sequence;
+        valid_[index] = true;
+    }
+
+    /// Return a snapshot by sequence number, or null if it is no longer remembered.
+    const PODVector<unsigned char>* Get(unsigned char sequence) const
+    {
+        unsigned index = sequence % LATESTDATA_HISTORY_SIZE;
+        return valid_[index] && sequences_[index] == sequence ? &snapshots_[index] : 0;
+    }
+
+    /// Snapshot data.
+    PODVector<unsigned char> snapshots_[LATESTDATA_HISTORY_SIZE];
+    /// Snapshot sequence numbers.
+    unsigned char sequences_[LATESTDATA_HISTORY_SIZE];
+    /// Snapshot valid flags.
+    bool valid_[LATESTDATA_HISTORY_SIZE];
+    /// Next sequence number to send. Used on the server only.
+    unsigned char nextSequence_;
+    /// Acknowledged baseline sequence number on the server, or last applied sequence number on the client.
+    unsigned char sequence_;
+    /// Whether sequence_ is valid.
+    bool hasSequence_;
+};
+
 /// Base class for per-user network replication states.
 struct URHO3D_API ReplicationState
 {
@@ -160,6 +208,8 @@ struct URHO3D_API ComponentReplicationState : public ReplicationState
     WeakPtr<Component> component_;
     /// Dirty attribute bits.
     DirtyBits dirtyAttributes_;
+    /// Sent latest data snapshots, allocated on demand.
+    SharedPtr<LatestDataHistory> latestData_;
 };
 
 /// Per-user node network replication state.
@@ -183,6 +233,8 @@ struct URHO3D_API NodeReplicationState : public ReplicationState
     HashSet<StringHash> dirtyVars_;
     /// Components by ID.
     HashMap<unsigned, ComponentReplicationState> componentStates_;
+    /// Sent latest data snapshots, allocated on demand.
+    SharedPtr<LatestDataHistory> latestData_;
     /// Interest management priority accumulator.
     float priorityAcc_;
     /// Whether exists in the SceneState's dirty set.
@@ -34,6 +34,7 @@
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
 #include "../Scene/Component.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
@@ -55,6 +56,52 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
 
+/// %Scene update functor for thread-safe logic components.
+struct UpdateLogicFunctor
+{
+    /// Construct.
+    UpdateLogicFunctor(unsigned char mask, float timeStep) :
+        mask_(mask),
+        timeStep_(timeStep)
+    {
+    }
+
+    /// Call the update function of a range of logic components.
+    void operator ()(LogicComponent** start, LogicComponent** end, unsigned threadIndex)
+    {
+        while (start != end)
+        {
+            LogicComponent* component = *start++;
+            if (!(component->GetUpdateEventMask() & mask_))
+                continue;
+
+            switch (mask_)
+            {
+            case USE_UPDATE:
+                component->Update(timeStep_);
+                break;
+
+            case USE_POSTUPDATE:
+                component->PostUpdate(timeStep_);
+                break;
+
+            case USE_FIXEDUPDATE:
+                component->FixedUpdate(timeStep_);
+                break;
+
+            case USE_FIXEDPOSTUPDATE:
+                component->FixedPostUpdate(timeStep_);
+                break;
+            }
+        }
+    }
+
+    /// Update function mask.
+    unsigned char mask_;
+    /// Timestep.
+    float timeStep_;
+};
+
 Scene::Scene(Context* context) :
     Node(context),
     replicatedNodeID_(FIRST_REPLICATED_ID),
@@ -779,6 +826,7 @@ void Scene::Update(float timeStep)
 
     // Update variable timestep logic
     SendEvent(E_SCENEUPDATE, eventData);
+    UpdateThreadedLogic(USE_UPDATE, timeStep);
 
     // Update scene attribute animation.
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
@@ -802,6 +850,7 @@ void Scene::Update(float timeStep)
 
     // Post-update variable timestep logic
     SendEvent(E_SCENEPOSTUPDATE, eventData);
+    UpdateThreadedLogic(USE_POSTUPDATE, timeStep);
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -839,6 +888,28 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.Push(component);
 }
 
+void Scene::UpdateThreadedLogic(unsigned char mask, float timeStep)
+{
+    if (threadedLogicComponents_.Empty())
+        return;
+
+    URHO3D_PROFILE(UpdateThreadedLogic);
+
+    // Transform changes during the update are routed through the delayed dirty mechanism. If a threaded update is
+    // already in progress, let its owner end it
+    bool wasThreadedUpdate = threadedUpdate_;
+    if (!wasThreadedUpdate)
+        BeginThreadedUpdate();
+
+    UpdateLogicFunctor updateLogic(mask, timeStep);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    queue->ParallelFor(threadedLogicComponents_.Buffer(), threadedLogicComponents_.Buffer() + threadedLogicComponents_.Size(), 16,
+        updateLogic);
+
+    if (!wasThreadedUpdate)
+        EndThreadedUpdate();
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
     if (mode == REPLICATED)
@@ -1147,6 +1218,26 @@ void Scene::MarkNetworkUpdate(Component* component)
     }
 }
 
+void Scene::AddThreadedLogicComponent(LogicComponent* component)
+{
+    component->threadedUpdateIndex_ = threadedLogicComponents_.Size();
+    threadedLogicComponents_.Push(component);
+}
+
+void Scene::RemoveThreadedLogicComponent(LogicComponent* component)
+{
+    unsigned index = component->threadedUpdateIndex_;
+    if (index >= threadedLogicComponents_.Size() || threadedLogicComponents_[index] != component)
+        return;
+
+    // Swap the last component into the vacated slot for constant time removal
+    LogicComponent* last = threadedLogicComponents_.Back();
+    threadedLogicComponents_[index] = last;
+    last->threadedUpdateIndex_ = index;
+    threadedLogicComponents_.Pop();
+    component->threadedUpdateIndex_ = M_MAX_UNSIGNED;
+}
+
 void Scene::MarkReplicationDirty(Node* node)
 {
     unsigned id = node->GetID();
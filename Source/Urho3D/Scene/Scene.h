@@ -33,6 +33,7 @@ namespace Urho3D
 {
 
 class File;
+class LogicComponent;
 class PackageFile;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
@@ -219,9 +220,13 @@ public:
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
+    /// Call the update functions selected by the mask (USE_UPDATE, USE_POSTUPDATE, USE_FIXEDUPDATE or USE_FIXEDPOSTUPDATE) of the thread-safe logic components in parallel, within a threaded update. Called by Update() and by the physics world for the fixed timestep updates.
+    void UpdateThreadedLogic(unsigned char mask, float timeStep);
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
+    /// Return the mutex for adding and removing replication states of nodes and components. Needed when network connections build their updates in parallel.
+    Mutex& GetReplicationStateMutex() { return replicationStateMutex_; }
 
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
@@ -255,6 +260,10 @@ public:
     void MarkNetworkUpdate(Component* component);
     /// Mark a node dirty in scene replication states. The node does not need to have own replication state yet.
     void MarkReplicationDirty(Node* node);
+    /// Add a thread-safe logic component to be updated in parallel.
+    void AddThreadedLogicComponent(LogicComponent* component);
+    /// Remove a thread-safe logic component.
+    void RemoveThreadedLogicComponent(LogicComponent* component);
 
 private:
     /// Handle the logic update event to update the scene, if active.
@@ -302,8 +311,12 @@ private:
     HashSet<unsigned> networkUpdateComponents_;
     /// Delayed dirty notification queue for components.
     PODVector<Component*> delayedDirtyComponents_;
+    /// Thread-safe logic components updated in parallel.
+    PODVector<LogicComponent*> threadedLogicComponents_;
     /// Mutex for the delayed dirty notification queue.
     Mutex sceneMutex_;
+    /// Mutex for adding and removing replication states.
+    Mutex replicationStateMutex_;
     /// Preallocated event data map for smoothing update events.
     VariantMap smoothingData_;
     /// Next free non-local node ID.
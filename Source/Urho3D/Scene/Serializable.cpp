@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../IO/BitStream.h"
 #include "../IO/Deserializer.h"
 #include "../IO/Log.h"
 #include "../IO/Serializer.h"
@@ -37,6 +38,134 @@
 namespace Urho3D
 {
 
+/// Maximum absolute value of the three smallest components of a normalized quaternion.
+static const float QUATERNION_COMPONENT_MAX = 0.707107f;
+
+static unsigned QuantizeFloat(float value, float min, float max, unsigned bits)
+{
+    double maxValue = (double)(bits < 32 ? (1u << bits) - 1 : M_MAX_UNSIGNED);
+    double range = (double)max - (double)min;
+    if (range <= 0.0)
+        return 0;
+
+    double normalized = Clamp(((double)value - (double)min) / range, 0.0, 1.0);
+    return (unsigned)(normalized * maxValue + 0.5);
+}
+
+static float DequantizeFloat(unsigned value, float min, float max, unsigned bits)
+{
+    double maxValue = (double)(bits < 32 ? (1u << bits) - 1 : M_MAX_UNSIGNED);
+    return (float)((double)min + ((double)max - (double)min) * (double)value / maxValue);
+}
+
+static void WriteQuantizedComponents(BitWriter& writer, const float* data, unsigned numComponents, const AttributeInfo& attr)
+{
+    for (unsigned i = 0; i < numComponents; ++i)
+        writer.WriteBits(QuantizeFloat(data[i], attr.quantizeMin_, attr.quantizeMax_, attr.quantizeBits_), attr.quantizeBits_);
+}
+
+static void ReadQuantizedComponents(BitReader& reader, float* data, unsigned numComponents, const AttributeInfo& attr)
+{
+    for (unsigned i = 0; i < numComponents; ++i)
+        data[i] = DequantizeFloat(reader.ReadBits(attr.quantizeBits_), attr.quantizeMin_, attr.quantizeMax_, attr.quantizeBits_);
+}
+
+static void WriteQuantizedVariant(BitWriter& writer, const AttributeInfo& attr, const Variant& value)
+{
+    switch (attr.type_)
+    {
+    case VAR_FLOAT:
+        {
+            float data = value.GetFloat();
+            WriteQuantizedComponents(writer, &data, 1, attr);
+        }
+        break;
+
+    case VAR_VECTOR2:
+        WriteQuantizedComponents(writer, value.GetVector2().Data(), 2, attr);
+        break;
+
+    case VAR_VECTOR3:
+        WriteQuantizedComponents(writer, value.GetVector3().Data(), 3, attr);
+        break;
+
+    case VAR_VECTOR4:
+        WriteQuantizedComponents(writer, value.GetVector4().Data(), 4, attr);
+        break;
+
+    case VAR_QUATERNION:
+        {
+            // Smallest-three encoding: send the index of the largest component and the three others. The largest can be
+            // reconstructed from the unit length, and its sign made positive as q and -q represent the same rotation
+            Quaternion rotation = value.GetQuaternion().Normalized();
+            const float* data = rotation.Data();
+            unsigned largest = 0;
+            for (unsigned i = 1; i < 4; ++i)
+            {
+                if (Abs(data[i]) > Abs(data[largest]))
+                    largest = i;
+            }
+            float sign = data[largest] < 0.0f ? -1.0f : 1.0f;
+
+            writer.WriteBits(largest, 2);
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                if (i != largest)
+                    writer.WriteBits(QuantizeFloat(data[i] * sign, -QUATERNION_COMPONENT_MAX, QUATERNION_COMPONENT_MAX,
+                        attr.quantizeBits_), attr.quantizeBits_);
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static Variant ReadQuantizedVariant(BitReader& reader, const AttributeInfo& attr)
+{
+    float data[4];
+
+    switch (attr.type_)
+    {
+    case VAR_FLOAT:
+        ReadQuantizedComponents(reader, data, 1, attr);
+        return Variant(data[0]);
+
+    case VAR_VECTOR2:
+        ReadQuantizedComponents(reader, data, 2, attr);
+        return Variant(Vector2(data));
+
+    case VAR_VECTOR3:
+        ReadQuantizedComponents(reader, data, 3, attr);
+        return Variant(Vector3(data));
+
+    case VAR_VECTOR4:
+        ReadQuantizedComponents(reader, data, 4, attr);
+        return Variant(Vector4(data));
+
+    case VAR_QUATERNION:
+        {
+            unsigned largest = reader.ReadBits(2);
+            float sumSquares = 0.0f;
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                if (i != largest)
+                {
+                    data[i] = DequantizeFloat(reader.ReadBits(attr.quantizeBits_), -QUATERNION_COMPONENT_MAX,
+                        QUATERNION_COMPONENT_MAX, attr.quantizeBits_);
+                    sumSquares += data[i] * data[i];
+                }
+            }
+            data[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+            return Variant(Quaternion(data).Normalized());
+        }
+
+    default:
+        return Variant::EMPTY;
+    }
+}
+
 static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, const AttributeInfo& netAttr, unsigned netAttrIndex)
 {
     if (!attributes)
@@ -55,6 +184,199 @@ static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, con
     return netAttrIndex; // Could not remap
 }
 
+static bool WriteAttributeDirect(Serializer& dest, const Serializable* object, const AttributeInfo& attr)
+{
+    if (attr.accessor_)
+        return attr.accessor_->Write(object, dest);
+
+    const void* src = attr.ptr_ ? attr.ptr_ : reinterpret_cast<const unsigned char*>(object) + attr.offset_;
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        // If enum type, use the low 8 bits only
+        if (attr.enumNames_)
+            return dest.WriteInt(*(reinterpret_cast<const unsigned char*>(src)));
+        else
+            return dest.WriteInt(*(reinterpret_cast<const int*>(src)));
+
+    case VAR_BOOL:
+        return dest.WriteBool(*(reinterpret_cast<const bool*>(src)));
+
+    case VAR_FLOAT:
+        return dest.WriteFloat(*(reinterpret_cast<const float*>(src)));
+
+    case VAR_VECTOR2:
+        return dest.WriteVector2(*(reinterpret_cast<const Vector2*>(src)));
+
+    case VAR_VECTOR3:
+        return dest.WriteVector3(*(reinterpret_cast<const Vector3*>(src)));
+
+    case VAR_VECTOR4:
+        return dest.WriteVector4(*(reinterpret_cast<const Vector4*>(src)));
+
+    case VAR_QUATERNION:
+        return dest.WriteQuaternion(*(reinterpret_cast<const Quaternion*>(src)));
+
+    case VAR_COLOR:
+        return dest.WriteColor(*(reinterpret_cast<const Color*>(src)));
+
+    case VAR_STRING:
+        return dest.WriteString(*(reinterpret_cast<const String*>(src)));
+
+    case VAR_BUFFER:
+        return dest.WriteBuffer(*(reinterpret_cast<const PODVector<unsigned char>*>(src)));
+
+    case VAR_RESOURCEREF:
+        return dest.WriteResourceRef(*(reinterpret_cast<const ResourceRef*>(src)));
+
+    case VAR_RESOURCEREFLIST:
+        return dest.WriteResourceRefList(*(reinterpret_cast<const ResourceRefList*>(src)));
+
+    case VAR_VARIANTVECTOR:
+        return dest.WriteVariantVector(*(reinterpret_cast<const VariantVector*>(src)));
+
+    case VAR_STRINGVECTOR:
+        return dest.WriteStringVector(*(reinterpret_cast<const StringVector*>(src)));
+
+    case VAR_VARIANTMAP:
+        return dest.WriteVariantMap(*(reinterpret_cast<const VariantMap*>(src)));
+
+    case VAR_INTRECT:
+        return dest.WriteIntRect(*(reinterpret_cast<const IntRect*>(src)));
+
+    case VAR_INTVECTOR2:
+        return dest.WriteIntVector2(*(reinterpret_cast<const IntVector2*>(src)));
+
+    case VAR_INTVECTOR3:
+        return dest.WriteIntVector3(*(reinterpret_cast<const IntVector3*>(src)));
+
+    case VAR_DOUBLE:
+        return dest.WriteDouble(*(reinterpret_cast<const double*>(src)));
+
+    default:
+        {
+            Variant value;
+            object->OnGetAttribute(attr, value);
+            return dest.WriteVariantData(value);
+        }
+    }
+}
+
+static void ReadAttributeDirect(Deserializer& source, Serializable* object, const AttributeInfo& attr)
+{
+    if (attr.accessor_)
+    {
+        attr.accessor_->Read(object, source, attr.type_);
+        return;
+    }
+
+    void* dest = attr.ptr_ ? attr.ptr_ : reinterpret_cast<unsigned char*>(object) + attr.offset_;
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        // If enum type, use the low 8 bits only
+        if (attr.enumNames_)
+            *(reinterpret_cast<unsigned char*>(dest)) = (unsigned char)source.ReadInt();
+        else
+            *(reinterpret_cast<int*>(dest)) = source.ReadInt();
+        break;
+
+    case VAR_BOOL:
+        *(reinterpret_cast<bool*>(dest)) = source.ReadBool();
+        break;
+
+    case VAR_FLOAT:
+        *(reinterpret_cast<float*>(dest)) = source.ReadFloat();
+        break;
+
+    case VAR_VECTOR2:
+        *(reinterpret_cast<Vector2*>(dest)) = source.ReadVector2();
+        break;
+
+    case VAR_VECTOR3:
+        *(reinterpret_cast<Vector3*>(dest)) = source.ReadVector3();
+        break;
+
+    case VAR_VECTOR4:
+        *(reinterpret_cast<Vector4*>(dest)) = source.ReadVector4();
+        break;
+
+    case VAR_QUATERNION:
+        *(reinterpret_cast<Quaternion*>(dest)) = source.ReadQuaternion();
+        break;
+
+    case VAR_COLOR:
+        *(reinterpret_cast<Color*>(dest)) = source.ReadColor();
+        break;
+
+    case VAR_STRING:
+        *(reinterpret_cast<String*>(dest)) = source.ReadString();
+        break;
+
+    case VAR_BUFFER:
+        *(reinterpret_cast<PODVector<unsigned char>*>(dest)) = source.ReadBuffer();
+        break;
+
+    case VAR_RESOURCEREF:
+        *(reinterpret_cast<ResourceRef*>(dest)) = source.ReadResourceRef();
+        break;
+
+    case VAR_RESOURCEREFLIST:
+        *(reinterpret_cast<ResourceRefList*>(dest)) = source.ReadResourceRefList();
+        break;
+
+    case VAR_VARIANTVECTOR:
+        *(reinterpret_cast<VariantVector*>(dest)) = source.ReadVariantVector();
+        break;
+
+    case VAR_STRINGVECTOR:
+        *(reinterpret_cast<StringVector*>(dest)) = source.ReadStringVector();
+        break;
+
+    case VAR_VARIANTMAP:
+        *(reinterpret_cast<VariantMap*>(dest)) = source.ReadVariantMap();
+        break;
+
+    case VAR_INTRECT:
+        *(reinterpret_cast<IntRect*>(dest)) = source.ReadIntRect();
+        break;
+
+    case VAR_INTVECTOR2:
+        *(reinterpret_cast<IntVector2*>(dest)) = source.ReadIntVector2();
+        break;
+
+    case VAR_INTVECTOR3:
+        *(reinterpret_cast<IntVector3*>(dest)) = source.ReadIntVector3();
+        break;
+
+    case VAR_DOUBLE:
+        *(reinterpret_cast<double*>(dest)) = source.ReadDouble();
+        break;
+
+    default:
+        object->OnSetAttribute(attr, source.ReadVariant(attr.type_));
+        return;
+    }
+
+    // If it is a network attribute then mark it for next network update
+    if (attr.mode_ & AM_NET)
+        object->MarkNetworkUpdate();
+}
+
+bool AttributeAccessor::Write(const Serializable* ptr, Serializer& dest) const
+{
+    Variant value;
+    Get(ptr, value);
+    return dest.WriteVariantData(value);
+}
+
+void AttributeAccessor::Read(Serializable* ptr, Deserializer& source, VariantType type)
+{
+    Set(ptr, source.ReadVariant(type));
+}
+
 Serializable::Serializable(Context* context) :
     Object(context),
     temporary_(false)
@@ -297,6 +619,13 @@ bool Serializable::Load(Deserializer& source, bool setInstanceDefault)
             return false;
         }
 
+        // Bypass the Variant conversion when the class uses the default attribute handlers
+        if (attr.directAccess_ && !setInstanceDefault)
+        {
+            ReadAttributeDirect(source, this, attr);
+            continue;
+        }
+
         Variant varValue = source.ReadVariant(attr.type_);
         OnSetAttribute(attr, varValue);
 
@@ -321,9 +650,16 @@ bool Serializable::Save(Serializer& dest) const
         if (!(attr.mode_ & AM_FILE) || (attr.mode_ & AM_FILEREADONLY) == AM_FILEREADONLY)
             continue;
 
-        OnGetAttribute(attr, value);
+        bool success;
+        if (attr.directAccess_)
+            success = WriteAttributeDirect(dest, this, attr);
+        else
+        {
+            OnGetAttribute(attr, value);
+            success = dest.WriteVariantData(value);
+        }
 
-        if (!dest.WriteVariantData(value))
+        if (!success)
         {
             URHO3D_LOGERROR("Could not save " + GetTypeName() + ", writing to stream failed");
             return false;
@@ -649,6 +985,22 @@ bool Serializable::SetAttribute(const String& name, const Variant& value)
     return false;
 }
 
+bool Serializable::SetAttribute(const ConstString& name, const Variant& value)
+{
+    const Vector<AttributeInfo>* attributes = GetAttributes();
+    if (attributes)
+    {
+        for (unsigned i = 0; i < attributes->Size(); ++i)
+        {
+            if (attributes->At(i).internedName_ == name)
+                return SetAttribute(i, value);
+        }
+    }
+
+    // Attribute names are matched case-insensitively, which the interned name can not do
+    return SetAttribute(name.GetString(), value);
+}
+
 void Serializable::ResetToDefault()
 {
     const Vector<AttributeInfo>* attributes = GetAttributes();
@@ -762,12 +1114,7 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
     // First write the change bitfield, then attribute data for non-default attributes
     dest.WriteUByte(timeStamp);
     dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteNetworkValues(dest, attributeBits);
 }
 
 void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp)
@@ -788,12 +1135,7 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
     // Note: the attribute bits should not contain LATESTDATA attributes
     dest.WriteUByte(timeStamp);
     dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteNetworkValues(dest, attributeBits);
 }
 
 void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp)
@@ -809,14 +1151,16 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
         return;
 
     unsigned numAttributes = attributes->Size();
-
-    dest.WriteUByte(timeStamp);
+    DirtyBits attributeBits;
 
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         if (attributes->At(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+            attributeBits.Set(i);
     }
+
+    dest.WriteUByte(timeStamp);
+    WriteNetworkValues(dest, attributeBits);
 }
 
 bool Serializable::ReadDeltaUpdate(Deserializer& source)
@@ -827,38 +1171,11 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
 
     unsigned numAttributes = attributes->Size();
     DirtyBits attributeBits;
-    bool changed = false;
 
-    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
     unsigned char timeStamp = source.ReadUByte();
     source.Read(attributeBits.data_, (numAttributes + 7) >> 3);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
-    {
-        if (attributeBits.IsSet(i))
-        {
-            const AttributeInfo& attr = attributes->At(i);
-            if (!(interceptMask & (1ULL << i)))
-            {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
-                changed = true;
-            }
-            else
-            {
-                using namespace InterceptNetworkUpdate;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_SERIALIZABLE] = this;
-                eventData[P_TIMESTAMP] = (unsigned)timeStamp;
-                eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
-                eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
-                SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
-            }
-        }
-    }
-
-    return changed;
+    return ReadNetworkValues(source, attributeBits, timeStamp);
 }
 
 bool Serializable::ReadLatestDataUpdate(Deserializer& source)
@@ -868,37 +1185,17 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
         return false;
 
     unsigned numAttributes = attributes->Size();
-    bool changed = false;
+    DirtyBits attributeBits;
 
-    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
     unsigned char timeStamp = source.ReadUByte();
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    for (unsigned i = 0; i < numAttributes; ++i)
     {
-        const AttributeInfo& attr = attributes->At(i);
-        if (attr.mode_ & AM_LATESTDATA)
-        {
-            if (!(interceptMask & (1ULL << i)))
-            {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
-                changed = true;
-            }
-            else
-            {
-                using namespace InterceptNetworkUpdate;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_SERIALIZABLE] = this;
-                eventData[P_TIMESTAMP] = (unsigned)timeStamp;
-                eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
-                eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
-                SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
-            }
-        }
+        if (attributes->At(i).mode_ & AM_LATESTDATA)
+            attributeBits.Set(i);
     }
 
-    return changed;
+    return ReadNetworkValues(source, attributeBits, timeStamp);
 }
 
 Variant Serializable::GetAttribute(unsigned index) const
@@ -921,6 +1218,22 @@ Variant Serializable::GetAttribute(unsigned index) const
     return ret;
 }
 
+Variant Serializable::GetAttribute(const ConstString& name) const
+{
+    const Vector<AttributeInfo>* attributes = GetAttributes();
+    if (attributes)
+    {
+        for (unsigned i = 0; i < attributes->Size(); ++i)
+        {
+            if (attributes->At(i).internedName_ == name)
+                return GetAttribute(i);
+        }
+    }
+
+    // Attribute names are matched case-insensitively, which the interned name can not do
+    return GetAttribute(name.GetString());
+}
+
 Variant Serializable::GetAttribute(const String& name) const
 {
     Variant ret;
@@ -1018,6 +1331,92 @@ bool Serializable::GetInterceptNetworkUpdate(const String& attributeName) const
     return false;
 }
 
+void Serializable::WriteNetworkValues(Serializer& dest, const DirtyBits& attributeBits) const
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
+    bool hasQuantized = false;
+
+    // Full precision values are written first, then the quantized values packed into a bit stream
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (attributeBits.IsSet(i))
+        {
+            if (!attributes->At(i).quantizeBits_)
+                dest.WriteVariantData(networkState_->currentValues_[i]);
+            else
+                hasQuantized = true;
+        }
+    }
+
+    if (hasQuantized)
+    {
+        BitWriter writer(dest);
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            if (attributeBits.IsSet(i) && attr.quantizeBits_)
+                WriteQuantizedVariant(writer, attr, networkState_->currentValues_[i]);
+        }
+    }
+}
+
+bool Serializable::ReadNetworkValues(Deserializer& source, const DirtyBits& attributeBits, unsigned char timeStamp)
+{
+    const Vector<AttributeInfo>* attributes = GetNetworkAttributes();
+    unsigned numAttributes = attributes->Size();
+    bool hasQuantized = false;
+    bool changed = false;
+
+    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    {
+        if (attributeBits.IsSet(i))
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            if (!attr.quantizeBits_)
+                changed |= ApplyNetworkValue(attr, i, source.ReadVariant(attr.type_), timeStamp);
+            else
+                hasQuantized = true;
+        }
+    }
+
+    if (hasQuantized)
+    {
+        BitReader reader(source);
+        for (unsigned i = 0; i < numAttributes && !reader.IsEof(); ++i)
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            if (attributeBits.IsSet(i) && attr.quantizeBits_)
+                changed |= ApplyNetworkValue(attr, i, ReadQuantizedVariant(reader, attr), timeStamp);
+        }
+    }
+
+    return changed;
+}
+
+bool Serializable::ApplyNetworkValue(const AttributeInfo& attr, unsigned index, const Variant& value, unsigned char timeStamp)
+{
+    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
+    if (!(interceptMask & (1ULL << index)))
+    {
+        OnSetAttribute(attr, value);
+        return true;
+    }
+    else
+    {
+        using namespace InterceptNetworkUpdate;
+
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_SERIALIZABLE] = this;
+        eventData[P_TIMESTAMP] = (unsigned)timeStamp;
+        eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, index);
+        eventData[P_NAME] = attr.name_;
+        eventData[P_VALUE] = value;
+        SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
+        return false;
+    }
+}
+
 void Serializable::SetInstanceDefault(const String& name, const Variant& defaultValue)
 {
     // Allocate the instance level default value
@@ -24,6 +24,8 @@
 
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
 
 #include <cstddef>
 
@@ -31,8 +33,6 @@ namespace Urho3D
 {
 
 class Connection;
-class Deserializer;
-class Serializer;
 class XMLElement;
 class JSONValue;
 
@@ -85,6 +85,8 @@ public:
     bool SetAttribute(unsigned index, const Variant& value);
     /// Set attribute by name. Return true if successfully set.
     bool SetAttribute(const String& name, const Variant& value);
+    /// Set attribute by interned name, which is matched by pointer before falling back to string comparison. Return true if successfully set.
+    bool SetAttribute(const ConstString& name, const Variant& value);
     /// Reset all editable attributes to their default values.
     void ResetToDefault();
     /// Remove instance's default values if they are set previously.
@@ -110,6 +112,8 @@ public:
     Variant GetAttribute(unsigned index) const;
     /// Return attribute value by name. Return empty if not found.
     Variant GetAttribute(const String& name) const;
+    /// Return attribute value by interned name, which is matched by pointer before falling back to string comparison. Return empty if not found.
+    Variant GetAttribute(const ConstString& name) const;
     /// Return attribute default value by index. Return empty if illegal index.
     Variant GetAttributeDefault(unsigned index) const;
     /// Return attribute default value by name. Return empty if not found.
@@ -133,6 +137,12 @@ protected:
     UniquePtr<NetworkState> networkState_;
 
 private:
+    /// Write the network attribute values selected by the bits. Quantized attributes are written last as a bit stream.
+    void WriteNetworkValues(Serializer& dest, const DirtyBits& attributeBits) const;
+    /// Read and apply the network attribute values selected by the bits. Return true if any were applied.
+    bool ReadNetworkValues(Deserializer& source, const DirtyBits& attributeBits, unsigned char timeStamp);
+    /// Apply a network attribute value, or send it in an intercept event if the attribute's updates are intercepted. Return true if applied.
+    bool ApplyNetworkValue(const AttributeInfo& attr, unsigned index, const Variant& value, unsigned char timeStamp);
     /// Set instance-level default value. Allocate the internal data structure as necessary.
     void SetInstanceDefault(const String& name, const Variant& defaultValue);
     /// Get instance-level default value.
@@ -144,6 +154,62 @@ private:
     bool temporary_;
 };
 
+/// Write an attribute value to a binary stream in the same format as Serializer::WriteVariantData(), without constructing a Variant for common types.
+template <typename T> inline bool WriteAttributeValue(Serializer& dest, const T& value) { return dest.WriteVariantData(Variant(value)); }
+inline bool WriteAttributeValue(Serializer& dest, int value) { return dest.WriteInt(value); }
+inline bool WriteAttributeValue(Serializer& dest, unsigned value) { return dest.WriteUInt(value); }
+inline bool WriteAttributeValue(Serializer& dest, long long value) { return dest.WriteInt64(value); }
+inline bool WriteAttributeValue(Serializer& dest, unsigned long long value) { return dest.WriteUInt64(value); }
+inline bool WriteAttributeValue(Serializer& dest, bool value) { return dest.WriteBool(value); }
+inline bool WriteAttributeValue(Serializer& dest, float value) { return dest.WriteFloat(value); }
+inline bool WriteAttributeValue(Serializer& dest, double value) { return dest.WriteDouble(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Vector2& value) { return dest.WriteVector2(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Vector3& value) { return dest.WriteVector3(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Vector4& value) { return dest.WriteVector4(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Quaternion& value) { return dest.WriteQuaternion(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Color& value) { return dest.WriteColor(value); }
+inline bool WriteAttributeValue(Serializer& dest, const String& value) { return dest.WriteString(value); }
+inline bool WriteAttributeValue(Serializer& dest, const PODVector<unsigned char>& value) { return dest.WriteBuffer(value); }
+inline bool WriteAttributeValue(Serializer& dest, const ResourceRef& value) { return dest.WriteResourceRef(value); }
+inline bool WriteAttributeValue(Serializer& dest, const ResourceRefList& value) { return dest.WriteResourceRefList(value); }
+inline bool WriteAttributeValue(Serializer& dest, const VariantVector& value) { return dest.WriteVariantVector(value); }
+inline bool WriteAttributeValue(Serializer& dest, const StringVector& value) { return dest.WriteStringVector(value); }
+inline bool WriteAttributeValue(Serializer& dest, const VariantMap& value) { return dest.WriteVariantMap(value); }
+inline bool WriteAttributeValue(Serializer& dest, const IntRect& value) { return dest.WriteIntRect(value); }
+inline bool WriteAttributeValue(Serializer& dest, const IntVector2& value) { return dest.WriteIntVector2(value); }
+inline bool WriteAttributeValue(Serializer& dest, const IntVector3& value) { return dest.WriteIntVector3(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Matrix3& value) { return dest.WriteMatrix3(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Matrix3x4& value) { return dest.WriteMatrix3x4(value); }
+inline bool WriteAttributeValue(Serializer& dest, const Matrix4& value) { return dest.WriteMatrix4(value); }
+
+/// Read an attribute value from a binary stream in the same format as Deserializer::ReadVariant(), without constructing a Variant for common types.
+template <typename T> inline void ReadAttributeValue(Deserializer& source, T& value) { value = source.ReadVariant(GetVariantType<T>()).template Get<T>(); }
+inline void ReadAttributeValue(Deserializer& source, int& value) { value = source.ReadInt(); }
+inline void ReadAttributeValue(Deserializer& source, unsigned& value) { value = source.ReadUInt(); }
+inline void ReadAttributeValue(Deserializer& source, long long& value) { value = source.ReadInt64(); }
+inline void ReadAttributeValue(Deserializer& source, unsigned long long& value) { value = source.ReadUInt64(); }
+inline void ReadAttributeValue(Deserializer& source, bool& value) { value = source.ReadBool(); }
+inline void ReadAttributeValue(Deserializer& source, float& value) { value = source.ReadFloat(); }
+inline void ReadAttributeValue(Deserializer& source, double& value) { value = source.ReadDouble(); }
+inline void ReadAttributeValue(Deserializer& source, Vector2& value) { value = source.ReadVector2(); }
+inline void ReadAttributeValue(Deserializer& source, Vector3& value) { value = source.ReadVector3(); }
+inline void ReadAttributeValue(Deserializer& source, Vector4& value) { value = source.ReadVector4(); }
+inline void ReadAttributeValue(Deserializer& source, Quaternion& value) { value = source.ReadQuaternion(); }
+inline void ReadAttributeValue(Deserializer& source, Color& value) { value = source.ReadColor(); }
+inline void ReadAttributeValue(Deserializer& source, String& value) { value = source.ReadString(); }
+inline void ReadAttributeValue(Deserializer& source, PODVector<unsigned char>& value) { value = source.ReadBuffer(); }
+inline void ReadAttributeValue(Deserializer& source, ResourceRef& value) { value = source.ReadResourceRef(); }
+inline void ReadAttributeValue(Deserializer& source, ResourceRefList& value) { value = source.ReadResourceRefList(); }
+inline void ReadAttributeValue(Deserializer& source, VariantVector& value) { value = source.ReadVariantVector(); }
+inline void ReadAttributeValue(Deserializer& source, StringVector& value) { value = source.ReadStringVector(); }
+inline void ReadAttributeValue(Deserializer& source, VariantMap& value) { value = source.ReadVariantMap(); }
+inline void ReadAttributeValue(Deserializer& source, IntRect& value) { value = source.ReadIntRect(); }
+inline void ReadAttributeValue(Deserializer& source, IntVector2& value) { value = source.ReadIntVector2(); }
+inline void ReadAttributeValue(Deserializer& source, IntVector3& value) { value = source.ReadIntVector3(); }
+inline void ReadAttributeValue(Deserializer& source, Matrix3& value) { value = source.ReadMatrix3(); }
+inline void ReadAttributeValue(Deserializer& source, Matrix3x4& value) { value = source.ReadMatrix3x4(); }
+inline void ReadAttributeValue(Deserializer& source, Matrix4& value) { value = source.ReadMatrix4(); }
+
 /// Template implementation of the enum attribute accessor invoke helper class.
 template <typename T, typename U> class EnumAttributeAccessorImpl : public AttributeAccessor
 {
@@ -176,6 +242,22 @@ public:
         (classPtr->*setFunction_)((U)value.GetInt());
     }
 
+    /// Invoke getter function and write the value to a binary stream.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return dest.WriteInt((int)(classPtr->*getFunction_)());
+    }
+
+    /// Read the value from a binary stream and invoke setter function.
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type)
+    {
+        assert(ptr);
+        T* classPtr = static_cast<T*>(ptr);
+        (classPtr->*setFunction_)((U)source.ReadInt());
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
@@ -214,6 +296,22 @@ public:
         (*setFunction_)(classPtr, (U)value.GetInt());
     }
 
+    /// Invoke getter function and write the value to a binary stream.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return dest.WriteInt((int)(*getFunction_)(classPtr));
+    }
+
+    /// Read the value from a binary stream and invoke setter function.
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type)
+    {
+        assert(ptr);
+        T* classPtr = static_cast<T*>(ptr);
+        (*setFunction_)(classPtr, (U)source.ReadInt());
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
@@ -296,6 +394,24 @@ public:
         (classPtr->*setFunction_)(value.Get<U>());
     }
 
+    /// Invoke getter function and write the value to a binary stream.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return WriteAttributeValue(dest, (classPtr->*getFunction_)());
+    }
+
+    /// Read the value from a binary stream and invoke setter function.
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type)
+    {
+        assert(ptr);
+        T* classPtr = static_cast<T*>(ptr);
+        U value;
+        ReadAttributeValue(source, value);
+        (classPtr->*setFunction_)(value);
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
@@ -334,6 +450,24 @@ public:
         (*setFunction_)(classPtr, value.Get<U>());
     }
 
+    /// Invoke getter function and write the value to a binary stream.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return WriteAttributeValue(dest, (*getFunction_)(classPtr));
+    }
+
+    /// Read the value from a binary stream and invoke setter function.
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type)
+    {
+        assert(ptr);
+        T* classPtr = static_cast<T*>(ptr);
+        U value;
+        ReadAttributeValue(source, value);
+        (*setFunction_)(classPtr, value);
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
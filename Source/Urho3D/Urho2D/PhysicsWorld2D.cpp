@@ -28,6 +28,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Renderer.h"
 #include "../IO/Log.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Urho2D/CollisionShape2D.h"
@@ -291,6 +292,12 @@ void PhysicsWorld2D::Update(float timeStep)
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPRESTEP, eventData);
 
+    // Update thread-safe logic components, unless they take their fixed updates from a 3D physics world
+    Scene* scene = GetScene();
+    bool updateThreadedLogic = scene && GetFixedUpdateSource() == this;
+    if (updateThreadedLogic)
+        scene->UpdateThreadedLogic(USE_FIXEDUPDATE, timeStep);
+
     physicsStepping_ = true;
     world_->Step(timeStep, velocityIterations_, positionIterations_);
     physicsStepping_ = false;
@@ -334,6 +341,9 @@ void PhysicsWorld2D::Update(float timeStep)
 
     using namespace PhysicsPostStep;
     SendEvent(E_PHYSICSPOSTSTEP, eventData);
+
+    if (updateThreadedLogic)
+        scene->UpdateThreadedLogic(USE_FIXEDPOSTUPDATE, timeStep);
 }
 
 void PhysicsWorld2D::DrawDebugGeometry()
@@ -305,19 +305,29 @@ SharedPtr<Material> Renderer2D::CreateMaterial(Texture2D* texture, BlendMode ble
     return newMaterial;
 }
 
-void CheckDrawableVisibilityWork(const WorkItem* item, unsigned threadIndex)
+/// 2D drawable visibility check functor for ParallelFor().
+struct CheckDrawableVisibilityFunctor
 {
-    Renderer2D* renderer = reinterpret_cast<Renderer2D*>(item->aux_);
-    Drawable2D** start = reinterpret_cast<Drawable2D**>(item->start_);
-    Drawable2D** end = reinterpret_cast<Drawable2D**>(item->end_);
+    /// Construct.
+    CheckDrawableVisibilityFunctor(Renderer2D* renderer) :
+        renderer_(renderer)
+    {
+    }
 
-    while (start != end)
+    /// Check a range of drawables.
+    void operator ()(Drawable2D** start, Drawable2D** end, unsigned threadIndex)
     {
-        Drawable2D* drawable = *start++;
-        if (renderer->CheckVisibility(drawable))
-            drawable->MarkInView(renderer->frame_);
+        while (start != end)
+        {
+            Drawable2D* drawable = *start++;
+            if (renderer_->CheckVisibility(drawable))
+                drawable->MarkInView(renderer_->frame_);
+        }
     }
-}
+
+    /// 2D renderer.
+    Renderer2D* renderer_;
+};
 
 void Renderer2D::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventData)
 {
@@ -340,29 +350,8 @@ void Renderer2D::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventDa
         URHO3D_PROFILE(CheckDrawableVisibility);
 
         WorkQueue* queue = GetSubsystem<WorkQueue>();
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = drawables_.Size() / numWorkItems;
-
-        PODVector<Drawable2D*>::Iterator start = drawables_.Begin();
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckDrawableVisibilityWork;
-            item->aux_ = this;
-
-            PODVector<Drawable2D*>::Iterator end = drawables_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+        CheckDrawableVisibilityFunctor checkVisibility(this);
+        queue->ParallelFor(drawables_.Buffer(), drawables_.Buffer() + drawables_.Size(), 128, checkVisibility);
     }
 
     ViewBatchInfo2D& viewBatchInfo = viewBatchInfos_[camera];